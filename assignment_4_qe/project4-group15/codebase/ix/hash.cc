@@ -0,0 +1,592 @@
+
+#include "hash.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+HashIndexManager* HashIndexManager::_hash_index_manager = 0;
+
+HashIndexManager* HashIndexManager::instance()
+{
+	if (!_hash_index_manager)
+		_hash_index_manager = new HashIndexManager();
+
+	return _hash_index_manager;
+}
+
+HashIndexManager::HashIndexManager()
+{
+}
+
+HashIndexManager::~HashIndexManager()
+{
+}
+
+static int getEntryLength(const char *entry) {
+	HashEntryHeader header;
+	memcpy(&header, entry, sizeof(HashEntryHeader));
+	return sizeof(HashEntryHeader) + header.keyLength + header.payloadLength;
+}
+
+// the key of an entry is key (a search key, varchars carry their length); reals within 0.00001 of each other are equal,
+// as in the B+ tree
+static bool isEntryKey(const char *entry, const void *key, AttrType attrType) {
+	HashEntryHeader header;
+	memcpy(&header, entry, sizeof(HashEntryHeader));
+	const char *keyData = entry + sizeof(HashEntryHeader);
+
+	if (attrType == TypeVarChar)
+		return header.keyLength == *(const int *)key && memcmp(keyData, (const char *)key + sizeof(int), header.keyLength) == 0;
+
+	if (attrType == TypeReal) {
+		float entryValue;
+		memcpy(&entryValue, keyData, sizeof(float));
+		float difference = *(const float *)key - entryValue;
+		return difference <= 0.00001 && difference >= -0.00001;
+	}
+
+	return memcmp(keyData, key, sizeof(int)) == 0;
+}
+
+static void initializeBucket(char *page, unsigned localDepth) {
+	memset(page, 0, PAGE_SIZE);
+	BucketHeader *header = (BucketHeader *)page;
+	header->pageType = Bucket;
+	header->localDepth = localDepth;
+	header->numOfRecords = 0;
+	header->freeSpaceOffset = sizeof(BucketHeader);
+	header->nextOverFlowPage = NO_PAGE;
+}
+
+// the range of REAL_HASH_CELL a real falls in, -0.0 in the one of 0.0
+static double getRealCell(float value) {
+	return floor(value / REAL_HASH_CELL) + 0.0;
+}
+
+/**
+ * FNV-1a over the bytes, then the finalizer of MurmurHash3 so that the top bits, which pick the directory entry, depend
+ * on every byte.
+ */
+static unsigned hashBytes(const void *bytes, int length) {
+	const unsigned char *data = (const unsigned char *)bytes;
+	unsigned hashValue = 2166136261u;
+	for (int i = 0; i < length; i++)
+		hashValue = (hashValue ^ data[i]) * 16777619u;
+
+	hashValue ^= hashValue >> 16;
+	hashValue *= 0x85ebca6bu;
+	hashValue ^= hashValue >> 13;
+	hashValue *= 0xc2b2ae35u;
+	hashValue ^= hashValue >> 16;
+	return hashValue;
+}
+
+// a real is hashed by its range of REAL_HASH_CELL
+unsigned HashIndexManager::hashKey(const void *key, AttrType attrType)
+{
+	if (attrType == TypeVarChar)
+		return hashBytes((const char *)key + sizeof(int), *(const int *)key);
+
+	if (attrType == TypeReal) {
+		double cell = getRealCell(*(const float *)key);
+		return hashBytes(&cell, sizeof(double));
+	}
+
+	return hashBytes(key, sizeof(int));
+}
+
+/**
+ * The reals within 0.00001 of a real are at most a quarter of REAL_HASH_CELL away from it, in its range or in the
+ * neighbour range on the side of the nearer end of its own. Where the ranges are too wide for two of them to differ
+ * (or the real is infinite) the hash values are the same, and there is one.
+ */
+int HashIndexManager::getKeyHashValues(const void *key, AttrType attrType, unsigned hashValues[2])
+{
+	hashValues[0] = hashKey(key, attrType);
+	if (attrType != TypeReal)
+		return 1;
+
+	double position = *(const float *)key / REAL_HASH_CELL;
+	double cell = getRealCell(*(const float *)key);
+	double neighbour = cell + (position - cell < 0.5 ? -1 : 1);
+	hashValues[1] = hashBytes(&neighbour, sizeof(double));
+	return hashValues[1] == hashValues[0] ? 1 : 2;
+}
+
+RC HashIndexManager::appendEmptyIndex(FileHandle &fileHandle)
+{
+	char *page = (char *)malloc(PAGE_SIZE);
+
+	// header page: no root, no freed page, one directory page
+	memset(page, 0, PAGE_SIZE);
+	FileHeader *fileHeader = (FileHeader *)page;
+	fileHeader->magic = INDEX_FILE_MAGIC;
+	fileHeader->version = INDEX_FILE_VERSION;
+	fileHeader->rootPage = NO_PAGE;
+	fileHeader->freePage = NO_PAGE;
+	fileHeader->indexType = HashIndex;
+	HashHeader *hashHeader = (HashHeader *)(page + sizeof(FileHeader));
+	hashHeader->globalDepth = 0;
+	hashHeader->numOfDirectoryPages = 1;
+	*(unsigned *)(page + sizeof(FileHeader) + sizeof(HashHeader)) = 1;
+	int returnValue = fileHandle.appendPage(page);
+
+	// the directory of its one entry, pointing at the empty bucket
+	if (returnValue == SUCCESS) {
+		memset(page, 0, PAGE_SIZE);
+		*(unsigned *)page = 2;
+		returnValue = fileHandle.appendPage(page);
+	}
+
+	if (returnValue == SUCCESS) {
+		initializeBucket(page, 0);
+		returnValue = fileHandle.appendPage(page);
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::readDirectory(FileHandle &fileHandle, IndexLatches *latches)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	char *page = (char *)malloc(PAGE_SIZE);
+
+	int returnValue = fileHandle.readPage(0, page);
+	if (returnValue == SUCCESS) {
+		HashHeader *hashHeader = (HashHeader *)(page + sizeof(FileHeader));
+		unsigned *directoryPages = (unsigned *)(page + sizeof(FileHeader) + sizeof(HashHeader));
+		directory.globalDepth = hashHeader->globalDepth;
+		directory.pages.assign(directoryPages, directoryPages + hashHeader->numOfDirectoryPages);
+		directory.buckets.clear();
+	}
+
+	unsigned numOfBuckets = 1u << directory.globalDepth;
+	for (unsigned i = 0; returnValue == SUCCESS && i < directory.pages.size(); i++) {
+		returnValue = fileHandle.readPage(directory.pages[i], page);
+		unsigned numOfEntries = min(numOfBuckets - (unsigned)directory.buckets.size(), (unsigned)DIRECTORY_ENTRIES_PER_PAGE);
+		directory.buckets.insert(directory.buckets.end(), (unsigned *)page, (unsigned *)page + numOfEntries);
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::readChain(FileHandle &fileHandle, unsigned firstPage, vector<unsigned> &pages, string &entries,
+		unsigned &localDepth)
+{
+	char *page = (char *)malloc(PAGE_SIZE);
+	BucketHeader *header = (BucketHeader *)page;
+	int returnValue = SUCCESS;
+
+	pages.clear();
+	entries.clear();
+	for (unsigned pageNum = firstPage; pageNum != NO_PAGE && returnValue == SUCCESS; pageNum = header->nextOverFlowPage) {
+		returnValue = fileHandle.readPage(pageNum, page);
+		if (returnValue != SUCCESS)
+			break;
+
+		if (pages.empty())
+			localDepth = header->localDepth;
+		pages.push_back(pageNum);
+		entries.append(page + sizeof(BucketHeader), header->freeSpaceOffset - sizeof(BucketHeader));
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::writeChain(FileHandle &fileHandle, vector<unsigned> &pages, unsigned localDepth, const string &entries)
+{
+	IndexManager *indexManager = IndexManager::instance();
+	char *page = (char *)malloc(PAGE_SIZE);
+	BucketHeader *header = (BucketHeader *)page;
+	int returnValue = SUCCESS;
+	unsigned numOfPages = 0;
+	size_t offset = 0;
+
+	// a bucket has its first page even when it is empty
+	do {
+		if (numOfPages == pages.size()) {
+			unsigned pageNum;
+			returnValue = indexManager->allocatePage(fileHandle, pageNum);
+			if (returnValue != SUCCESS)
+				break;
+			pages.push_back(pageNum);
+		}
+
+		initializeBucket(page, localDepth);
+		while (offset < entries.size()) {
+			int entryLength = getEntryLength(entries.data() + offset);
+			if (header->freeSpaceOffset + entryLength > PAGE_SIZE)
+				break;
+
+			memcpy(page + header->freeSpaceOffset, entries.data() + offset, entryLength);
+			header->freeSpaceOffset += entryLength;
+			header->numOfRecords++;
+			offset += entryLength;
+		}
+		numOfPages++;
+
+		if (offset < entries.size()) {
+			if (numOfPages == pages.size()) {
+				unsigned pageNum;
+				returnValue = indexManager->allocatePage(fileHandle, pageNum);
+				if (returnValue != SUCCESS)
+					break;
+				pages.push_back(pageNum);
+			}
+			header->nextOverFlowPage = pages[numOfPages];
+		}
+
+		returnValue = fileHandle.writePage(pages[numOfPages - 1], page);
+	} while (returnValue == SUCCESS && offset < entries.size());
+
+	// the pages left over
+	for (unsigned i = numOfPages; returnValue == SUCCESS && i < pages.size(); i++)
+		returnValue = indexManager->freePage(fileHandle, pages[i]);
+	if (returnValue == SUCCESS)
+		pages.resize(numOfPages);
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::writeDirectory(FileHandle &fileHandle, IndexLatches *latches, unsigned begin, unsigned end)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	char *page = (char *)malloc(PAGE_SIZE);
+	int returnValue = SUCCESS;
+
+	for (unsigned i = begin / DIRECTORY_ENTRIES_PER_PAGE; returnValue == SUCCESS && i * DIRECTORY_ENTRIES_PER_PAGE < end; i++) {
+		unsigned first = i * DIRECTORY_ENTRIES_PER_PAGE;
+		unsigned last = min(first + (unsigned)DIRECTORY_ENTRIES_PER_PAGE, (unsigned)directory.buckets.size());
+		memset(page, 0, PAGE_SIZE);
+		memcpy(page, &directory.buckets[first], (last - first) * sizeof(unsigned));
+		returnValue = fileHandle.writePage(directory.pages[i], page);
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::writeHashHeader(FileHandle &fileHandle, IndexLatches *latches)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	lock_guard<mutex> guard(latches->headerMutex);
+	char *page = (char *)malloc(PAGE_SIZE);
+
+	int returnValue = fileHandle.readPage(0, page);
+	if (returnValue == SUCCESS) {
+		HashHeader *hashHeader = (HashHeader *)(page + sizeof(FileHeader));
+		hashHeader->globalDepth = directory.globalDepth;
+		hashHeader->numOfDirectoryPages = directory.pages.size();
+		memcpy(page + sizeof(FileHeader) + sizeof(HashHeader), &directory.pages[0], directory.pages.size() * sizeof(unsigned));
+		returnValue = fileHandle.writePage(0, page);
+	}
+
+	free(page);
+	return returnValue;
+}
+
+// every entry i becomes entries 2i and 2i + 1, the hash values of both having the top bits of i
+RC HashIndexManager::doubleDirectory(FileHandle &fileHandle, IndexLatches *latches)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	vector<unsigned> buckets(directory.buckets.size() * 2);
+	for (unsigned i = 0; i < directory.buckets.size(); i++)
+		buckets[2 * i] = buckets[2 * i + 1] = directory.buckets[i];
+
+	int returnValue = SUCCESS;
+	while (returnValue == SUCCESS && directory.pages.size() * DIRECTORY_ENTRIES_PER_PAGE < buckets.size()) {
+		unsigned pageNum;
+		returnValue = IndexManager::instance()->allocatePage(fileHandle, pageNum);
+		if (returnValue == SUCCESS)
+			directory.pages.push_back(pageNum);
+	}
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	directory.buckets.swap(buckets);
+	directory.globalDepth++;
+
+	returnValue = writeDirectory(fileHandle, latches, 0, directory.buckets.size());
+	if (returnValue == SUCCESS)
+		returnValue = writeHashHeader(fileHandle, latches);
+	return returnValue;
+}
+
+/**
+ * The entries with the next bit of their hash value set move to a new bucket, which takes the upper half of the
+ * directory entries of the bucket.
+ */
+RC HashIndexManager::splitBucket(FileHandle &fileHandle, IndexLatches *latches, unsigned hashValue)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	vector<unsigned> pages;
+	string entries;
+	unsigned localDepth = 0;
+
+	int returnValue = readChain(fileHandle, directory.buckets[getDirectoryIndex(hashValue, directory.globalDepth)], pages,
+			entries, localDepth);
+	if (returnValue == SUCCESS && localDepth == directory.globalDepth)
+		returnValue = doubleDirectory(fileHandle, latches);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	string lowEntries;
+	string highEntries;
+	for (size_t offset = 0; offset < entries.size(); ) {
+		HashEntryHeader header;
+		memcpy(&header, entries.data() + offset, sizeof(HashEntryHeader));
+		int entryLength = getEntryLength(entries.data() + offset);
+		string &half = (header.hashValue >> (31 - localDepth)) & 1 ? highEntries : lowEntries;
+		half.append(entries, offset, entryLength);
+		offset += entryLength;
+	}
+
+	vector<unsigned> highPages;
+	returnValue = writeChain(fileHandle, pages, localDepth + 1, lowEntries);
+	if (returnValue == SUCCESS)
+		returnValue = writeChain(fileHandle, highPages, localDepth + 1, highEntries);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	unsigned span = 1u << (directory.globalDepth - localDepth);
+	unsigned begin = getDirectoryIndex(hashValue, directory.globalDepth) & ~(span - 1);
+	for (unsigned i = begin + span / 2; i < begin + span; i++)
+		directory.buckets[i] = highPages[0];
+
+	return writeDirectory(fileHandle, latches, begin + span / 2, begin + span);
+}
+
+/**
+ * The entry goes on the first page of its bucket with room for it. A full bucket is split until the bucket of the
+ * entry has room, unless its entries all have the hash value of the entry or it has MAX_GLOBAL_DEPTH bits: then a page
+ * is added to its chain. The rid under a key equal to key (in the buckets of getKeyHashValues) is the entry already.
+ */
+RC HashIndexManager::insertEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		const RID &rid, const void *payload, short payloadLength)
+{
+	HashEntryHeader entryHeader;
+	entryHeader.hashValue = hashKey(key, attrType);
+	entryHeader.rid = rid;
+	entryHeader.keyLength = attrType == TypeVarChar ? *(const int *)key : sizeof(int);
+	entryHeader.payloadLength = payloadLength;
+
+	const char *keyData = attrType == TypeVarChar ? (const char *)key + sizeof(int) : (const char *)key;
+	string entry((const char *)&entryHeader, sizeof(HashEntryHeader));
+	entry.append(keyData, entryHeader.keyLength);
+	entry.append((const char *)payload, payloadLength);
+	if (entry.size() > PAGE_SIZE - sizeof(BucketHeader))
+		return -1;
+
+	unique_lock<shared_mutex> guard(latches->structureMutex);
+	unsigned hashValues[2];
+	int numOfHashValues = getKeyHashValues(key, attrType, hashValues);
+	for (int i = 0; i < numOfHashValues; i++) {
+		RID entryRid;
+		EID entryId;
+		int returnValue = findEntry(fileHandle, latches, attrType, key, hashValues[i], &rid, entryRid, entryId);
+		if (returnValue != 1)
+			return returnValue == SUCCESS ? 3 : returnValue;
+	}
+
+	HashDirectory &directory = latches->hashDirectory;
+	char *page = (char *)malloc(PAGE_SIZE);
+	BucketHeader *header = (BucketHeader *)page;
+	int returnValue = SUCCESS;
+
+	while (returnValue == SUCCESS) {
+		unsigned pageNum = directory.buckets[getDirectoryIndex(entryHeader.hashValue, directory.globalDepth)];
+		unsigned lastPage = NO_PAGE;
+		unsigned localDepth = 0;
+		bool isSameHash = true;
+
+		for (; pageNum != NO_PAGE; pageNum = header->nextOverFlowPage) {
+			returnValue = fileHandle.readPage(pageNum, page);
+			if (returnValue != SUCCESS)
+				break;
+
+			if (header->freeSpaceOffset + entry.size() <= PAGE_SIZE) {
+				memcpy(page + header->freeSpaceOffset, entry.data(), entry.size());
+				header->freeSpaceOffset += entry.size();
+				header->numOfRecords++;
+				returnValue = fileHandle.writePage(pageNum, page);
+				free(page);
+				return returnValue;
+			}
+
+			if (lastPage == NO_PAGE)
+				localDepth = header->localDepth;
+			for (short offset = sizeof(BucketHeader); offset < header->freeSpaceOffset && isSameHash;
+					offset += getEntryLength(page + offset)) {
+				unsigned hashValue;
+				memcpy(&hashValue, page + offset, sizeof(unsigned));
+				isSameHash = hashValue == entryHeader.hashValue;
+			}
+			lastPage = pageNum;
+		}
+		if (returnValue != SUCCESS)
+			break;
+
+		if (localDepth < MAX_GLOBAL_DEPTH && !isSameHash) {
+			returnValue = splitBucket(fileHandle, latches, entryHeader.hashValue);
+			continue;
+		}
+
+		// a new last page of the chain, page still holds the one before
+		unsigned newPage;
+		returnValue = IndexManager::instance()->allocatePage(fileHandle, newPage);
+		if (returnValue == SUCCESS) {
+			header->nextOverFlowPage = newPage;
+			returnValue = fileHandle.writePage(lastPage, page);
+		}
+		if (returnValue == SUCCESS) {
+			initializeBucket(page, localDepth);
+			memcpy(page + header->freeSpaceOffset, entry.data(), entry.size());
+			header->freeSpaceOffset += entry.size();
+			header->numOfRecords++;
+			returnValue = fileHandle.writePage(newPage, page);
+		}
+		break;
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::deleteEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		const RID &rid)
+{
+	unsigned hashValues[2];
+	int numOfHashValues = getKeyHashValues(key, attrType, hashValues);
+
+	unique_lock<shared_mutex> guard(latches->structureMutex);
+	int returnValue = -1;
+	for (int i = 0; i < numOfHashValues && returnValue == -1; i++)
+		returnValue = deleteEntry(fileHandle, latches, attrType, key, hashValues[i], rid);
+	return returnValue;
+}
+
+RC HashIndexManager::deleteEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		unsigned hashValue, const RID &rid)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	char *page = (char *)malloc(PAGE_SIZE);
+	BucketHeader *header = (BucketHeader *)page;
+	unsigned prevPage = NO_PAGE;
+	int returnValue = -1;
+
+	for (unsigned pageNum = directory.buckets[getDirectoryIndex(hashValue, directory.globalDepth)]; pageNum != NO_PAGE;
+			pageNum = header->nextOverFlowPage) {
+		if (fileHandle.readPage(pageNum, page) != SUCCESS)
+			break;
+
+		short offset = sizeof(BucketHeader);
+		for (; offset < header->freeSpaceOffset; offset += getEntryLength(page + offset)) {
+			HashEntryHeader entryHeader;
+			memcpy(&entryHeader, page + offset, sizeof(HashEntryHeader));
+			if (entryHeader.hashValue == hashValue && entryHeader.rid.pageNum == rid.pageNum
+					&& entryHeader.rid.slotNum == rid.slotNum && isEntryKey(page + offset, key, attrType))
+				break;
+		}
+
+		if (offset == header->freeSpaceOffset) {
+			prevPage = pageNum;
+			continue;
+		}
+
+		int entryLength = getEntryLength(page + offset);
+		memmove(page + offset, page + offset + entryLength, header->freeSpaceOffset - offset - entryLength);
+		header->freeSpaceOffset -= entryLength;
+		header->numOfRecords--;
+
+		// an overflow page left empty is unlinked from its chain
+		if (header->numOfRecords == 0 && prevPage != NO_PAGE) {
+			unsigned nextPage = header->nextOverFlowPage;
+			returnValue = fileHandle.readPage(prevPage, page);
+			if (returnValue == SUCCESS) {
+				header->nextOverFlowPage = nextPage;
+				returnValue = fileHandle.writePage(prevPage, page);
+			}
+			if (returnValue == SUCCESS)
+				returnValue = IndexManager::instance()->freePage(fileHandle, pageNum);
+		}
+		else {
+			returnValue = fileHandle.writePage(pageNum, page);
+		}
+		break;
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC HashIndexManager::searchEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		RID &rid, EID &entryId)
+{
+	unsigned hashValues[2];
+	int numOfHashValues = getKeyHashValues(key, attrType, hashValues);
+
+	shared_lock<shared_mutex> guard(latches->structureMutex);
+	int returnValue = 1;
+	for (int i = 0; i < numOfHashValues && returnValue == 1; i++)
+		returnValue = findEntry(fileHandle, latches, attrType, key, hashValues[i], NULL, rid, entryId);
+	return returnValue;
+}
+
+RC HashIndexManager::findEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		unsigned hashValue, const RID *rid, RID &entryRid, EID &entryId)
+{
+	HashDirectory &directory = latches->hashDirectory;
+	char *page = (char *)malloc(PAGE_SIZE);
+	BucketHeader *header = (BucketHeader *)page;
+	int returnValue = 1;
+
+	for (unsigned pageNum = directory.buckets[getDirectoryIndex(hashValue, directory.globalDepth)];
+			pageNum != NO_PAGE && returnValue == 1; pageNum = header->nextOverFlowPage) {
+		if (fileHandle.readPage(pageNum, page) != SUCCESS) {
+			returnValue = -1;
+			break;
+		}
+
+		short offset = sizeof(BucketHeader);
+		for (unsigned slotNum = 0; offset < header->freeSpaceOffset; slotNum++, offset += getEntryLength(page + offset)) {
+			HashEntryHeader entryHeader;
+			memcpy(&entryHeader, page + offset, sizeof(HashEntryHeader));
+			if (entryHeader.hashValue == hashValue && (rid == NULL || (entryHeader.rid.pageNum == rid->pageNum
+					&& entryHeader.rid.slotNum == rid->slotNum)) && isEntryKey(page + offset, key, attrType)) {
+				entryRid = entryHeader.rid;
+				entryId.pageNum = pageNum;
+				entryId.slotNum = slotNum;
+				returnValue = SUCCESS;
+				break;
+			}
+		}
+	}
+
+	free(page);
+	return returnValue;
+}
+
+/**
+ * The bucket of hashValue holds the hash values with its top localDepth bits, the next bucket starts where they
+ * end; a split meanwhile only divides that range, so a scan resuming from nextHashValue meets every entry once.
+ */
+RC HashIndexManager::readBucket(FileHandle &fileHandle, IndexLatches *latches, uint64_t hashValue, string &entries,
+		uint64_t &nextHashValue)
+{
+	shared_lock<shared_mutex> guard(latches->structureMutex);
+	HashDirectory &directory = latches->hashDirectory;
+	vector<unsigned> pages;
+	unsigned localDepth = 0;
+
+	int returnValue = readChain(fileHandle, directory.buckets[getDirectoryIndex((unsigned)hashValue, directory.globalDepth)],
+			pages, entries, localDepth);
+
+	uint64_t bucketSize = (uint64_t)1 << (32 - localDepth);
+	nextHashValue = (hashValue / bucketSize + 1) * bucketSize;
+	return returnValue;
+}
@@ -0,0 +1,103 @@
+
+#ifndef _hash_h_
+#define _hash_h_
+
+#include <vector>
+#include <string>
+
+#include "ix.h"
+
+# define MAX_GLOBAL_DEPTH 18 // the directory has 2^MAX_GLOBAL_DEPTH entries at most, a full bucket gets overflow pages then
+# define DIRECTORY_ENTRIES_PER_PAGE (PAGE_SIZE / sizeof(unsigned))
+# define REAL_HASH_CELL 0.00004 // width of the ranges of real keys hashed alike, four times the tolerance of real keys
+
+// Page 0 of a hash index file: its FileHeader (no root page, indexType HashIndex), then a HashHeader followed by the
+// numbers of the directory pages, DIRECTORY_ENTRIES_PER_PAGE bucket page numbers each
+struct HashHeader {
+	unsigned globalDepth;
+	unsigned numOfDirectoryPages;
+};
+
+// The entries of a bucket share the top localDepth bits of their hash value, from freeSpaceOffset on the page is free.
+// A bucket which cannot be split any more (its entries have one hash value, or it has MAX_GLOBAL_DEPTH bits) goes on
+// on overflow pages, Bucket pages as well chained from nextOverFlowPage.
+struct BucketHeader {
+	PageType pageType;
+	unsigned localDepth;
+	short numOfRecords;
+	short freeSpaceOffset;
+	unsigned nextOverFlowPage;
+};
+
+// an entry of a bucket, followed by its key (a varchar without its length) and its payload; entries are not aligned
+struct HashEntryHeader {
+	unsigned hashValue;
+	RID rid;
+	short keyLength;
+	short payloadLength;
+};
+
+// HashIndexManager is the extendible hash index behind IndexManager for the files created as a HashIndex: the
+// directory maps the top globalDepth bits of the hash value of a key to its bucket, and a full bucket is split in two
+// on the next bit, the directory doubling when the bucket had globalDepth bits already. The directory is kept in memory
+// with the latches of the open index (HashDirectory), so a lookup reads the pages of one bucket only, two for a real.
+// Buckets are never merged nor the directory shrunk; an overflow page left empty by deleteEntry is freed.
+// insertEntry and deleteEntry hold the structureMutex of the index alone, searches and scans share it.
+// Keys are equal as in the B+ tree, reals within 0.00001 of each other too: a real is hashed by the range of
+// REAL_HASH_CELL it falls in, so the reals equal to it are in that range or in the neighbour one nearer to it, and the
+// buckets of both are read (see getKeyHashValues).
+class HashIndexManager {
+public:
+	static HashIndexManager* instance();
+
+	// append the header page, the directory and the one bucket of an empty index to an empty file
+	RC appendEmptyIndex(FileHandle &fileHandle);
+	// read the directory of the file into latches->hashDirectory
+	RC readDirectory(FileHandle &fileHandle, IndexLatches *latches);
+
+	// 3 when the entry is there already, as in the B+ tree
+	RC insertEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, const RID &rid,
+			const void *payload, short payloadLength);
+	RC deleteEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, const RID &rid);
+	// the first entry of key, 1 when there is none; entryId is its page and its position on the page
+	RC searchEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, RID &rid, EID &entryId);
+
+	// the entries of the bucket of hashValue one after the other (see HashEntryHeader); nextHashValue gets the first hash
+	// value past that bucket, 2^32 after the last one
+	RC readBucket(FileHandle &fileHandle, IndexLatches *latches, uint64_t hashValue, string &entries, uint64_t &nextHashValue);
+
+	unsigned hashKey(const void *key, AttrType attrType);
+	// the hash values of the entries equal to key, hashKey first: one, or two for a real; the number of them
+	int getKeyHashValues(const void *key, AttrType attrType, unsigned hashValues[2]);
+
+protected:
+	HashIndexManager();
+	~HashIndexManager();
+
+private:
+	static HashIndexManager *_hash_index_manager;
+
+	// the first entry of key with hashValue, and with rid unless it is NULL; 1 when there is none
+	RC findEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, unsigned hashValue,
+			const RID *rid, RID &entryRid, EID &entryId);
+	// delete the entry of key with hashValue and rid, -1 when there is none
+	RC deleteEntry(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, unsigned hashValue,
+			const RID &rid);
+
+	// the entries of the chain from firstPage, pages gets its pages
+	RC readChain(FileHandle &fileHandle, unsigned firstPage, vector<unsigned> &pages, string &entries, unsigned &localDepth);
+	// write entries to the chain of pages, pages being allocated or freed as needed (pages[0] is kept)
+	RC writeChain(FileHandle &fileHandle, vector<unsigned> &pages, unsigned localDepth, const string &entries);
+	// split the bucket of hashValue on the bit after its localDepth ones
+	RC splitBucket(FileHandle &fileHandle, IndexLatches *latches, unsigned hashValue);
+	RC doubleDirectory(FileHandle &fileHandle, IndexLatches *latches);
+	// write the directory pages holding the entries [begin, end)
+	RC writeDirectory(FileHandle &fileHandle, IndexLatches *latches, unsigned begin, unsigned end);
+	RC writeHashHeader(FileHandle &fileHandle, IndexLatches *latches);
+
+	unsigned getDirectoryIndex(unsigned hashValue, unsigned globalDepth) {
+		return globalDepth == 0 ? 0 : hashValue >> (32 - globalDepth);
+	}
+};
+
+#endif
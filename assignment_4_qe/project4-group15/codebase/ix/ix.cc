@@ -1,5 +1,15 @@
 
 #include "ix.h"
+#include "hash.h"
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 IndexManager* IndexManager::_index_manager = 0;
 
@@ -20,7 +30,120 @@ IndexManager::~IndexManager()
 {
 }
 
-RC IndexManager::createFile(const string &fileName)
+/**
+ * Page latches, see IndexLatches. A writer takes the latch of a page it read from the version it read the page at, so it
+ * never changes a page which changed since; it waits for a latch only while it runs alone.
+ */
+thread_local LatchSet *LatchSet::current = NULL;
+
+// the version of a latch once no writer holds it
+static uint64_t readLatch(const atomic<uint64_t> &latch) {
+	uint64_t version;
+	while ((version = latch.load(memory_order_acquire)) & 1)
+		this_thread::yield();
+	return version;
+}
+
+// no writer took the latch since version was read
+static bool isLatchValid(const atomic<uint64_t> &latch, uint64_t version) {
+	atomic_thread_fence(memory_order_acquire);
+	return latch.load(memory_order_relaxed) == version;
+}
+
+static atomic<uint64_t> &getPageLatch(IndexLatches *latches, unsigned pageNum) {
+	return latches->pageLatches[pageNum % NUM_PAGE_LATCHES];
+}
+
+IndexLatches::IndexLatches() : rootPage(0), rootLatch(0), indexType(BTreeIndex)
+{
+	for (int i = 0; i < NUM_PAGE_LATCHES; i++)
+		pageLatches[i].store(0, memory_order_relaxed);
+	for (int i = 0; i < PINNED_LEVELS; i++)
+		numOfPinned[i] = 0;
+}
+
+LatchSet::LatchSet(IndexLatches *latches) : latches(latches), lockOnWrite(false)
+{
+	current = this;
+}
+
+LatchSet::~LatchSet()
+{
+	release();
+	current = NULL;
+}
+
+bool LatchSet::tryLock(atomic<uint64_t> &latch, uint64_t version)
+{
+	// a latch shared by two pages is held already, both pages were read at the version it was taken from
+	for (unsigned i = 0; i < held.size(); i++) {
+		if (held[i] == &latch)
+			return heldVersions[i] == version;
+	}
+
+	if (!latch.compare_exchange_strong(version, version + 1, memory_order_acquire))
+		return false;
+	held.push_back(&latch);
+	heldVersions.push_back(version);
+	return true;
+}
+
+bool LatchSet::tryLock(unsigned pageNum, uint64_t version)
+{
+	return tryLock(getPageLatch(latches, pageNum), version);
+}
+
+bool LatchSet::tryLock(unsigned pageNum)
+{
+	atomic<uint64_t> &latch = getPageLatch(latches, pageNum);
+	for (unsigned i = 0; i < held.size(); i++) {
+		if (held[i] == &latch)
+			return true;
+	}
+
+	uint64_t version = latch.load(memory_order_relaxed);
+	return (version & 1) == 0 && tryLock(latch, version);
+}
+
+bool LatchSet::tryLockRoot(uint64_t version)
+{
+	return tryLock(latches->rootLatch, version);
+}
+
+void LatchSet::lock(atomic<uint64_t> &latch)
+{
+	for (unsigned i = 0; i < held.size(); i++) {
+		if (held[i] == &latch)
+			return;
+	}
+
+	uint64_t version;
+	do {
+		version = readLatch(latch);
+	} while (!latch.compare_exchange_weak(version, version + 1, memory_order_acquire));
+	held.push_back(&latch);
+	heldVersions.push_back(version);
+}
+
+void LatchSet::lock(unsigned pageNum)
+{
+	lock(getPageLatch(latches, pageNum));
+}
+
+void LatchSet::lockRoot()
+{
+	lock(latches->rootLatch);
+}
+
+void LatchSet::release()
+{
+	for (unsigned i = 0; i < held.size(); i++)
+		held[i]->store(heldVersions[i] + 2, memory_order_release);
+	held.clear();
+	heldVersions.clear();
+}
+
+RC IndexManager::createFile(const string &fileName, IndexType indexType)
 {
 	int returnValue = SUCCESS;
 
@@ -41,67 +164,113 @@ RC IndexManager::createFile(const string &fileName)
 			return returnValue;
 		}
 
-		// header page to store root page num
-		char * header = (char*) malloc(PAGE_SIZE);
-		*((unsigned *) header) = 1;  //write out the root node page number
-		
-        returnValue = fileHandle.appendPage(header);
-        if(returnValue != SUCCESS){
-            pfm->closeFile(fileHandle);
-            free(header);
-            return returnValue;
-        }
+		if (indexType == HashIndex)
+			returnValue = HashIndexManager::instance()->appendEmptyIndex(fileHandle);
+		else
+			returnValue = appendEmptyTree(fileHandle);
+		if (returnValue != SUCCESS) {
+			pfm->closeFile(fileHandle);
+			return returnValue;
+		}
 
-		free(header);
+		returnValue = pfm->closeFile(fileHandle);
 
-		// rootHeader: [pageType][numRecords][freeSpace][freeSpaceOffset][firstPtr]
-		char * rootPage = (char *) malloc(PAGE_SIZE);
-		IndexHeader *rootHeader = (IndexHeader *)rootPage;
-		rootHeader->pageType = Index;
-		rootHeader->numOfRecords = 0;
-		rootHeader->freeSpace = PAGE_SIZE - sizeof(IndexHeader);
-		rootHeader->freeSpaceOffset = PAGE_SIZE;
-		rootHeader->firstPtr = 2;
+	}
+	return returnValue;
+}
 
-		returnValue = fileHandle.appendPage(rootPage);
-        if(returnValue != SUCCESS){
-            pfm->closeFile(fileHandle);
-            free(rootPage);
-            return returnValue;
-        }
-        
-		free(rootPage);
-
-
-		// leafHeader: [pageType][numRecords][freeSpace][freeSpaceOffset][nextOFlow][nextPage][prevPage]
-		char * firstLeafPage = (char*) malloc(PAGE_SIZE);
-		LeafHeader *leafHeader = (LeafHeader *) firstLeafPage;
-		leafHeader->pageType = Leaf;
-		leafHeader->numOfRecords = 0;
-		leafHeader->freeSpace = PAGE_SIZE - sizeof(LeafHeader);
-		leafHeader->freeSpaceOffset = PAGE_SIZE;
-		leafHeader->nextOverFlowPage = NO_PAGE;
-		leafHeader->nextPage = NO_PAGE;
-		leafHeader->prevPage = NO_PAGE;
-
-		returnValue = fileHandle.appendPage(firstLeafPage);
-        if(returnValue != SUCCESS) {
-            pfm->closeFile(fileHandle);
-            free(firstLeafPage);
-            return returnValue;
-        }
+RC IndexManager::appendEmptyTree(FileHandle &fileHandle)
+{
+	int returnValue = SUCCESS;
 
-		free(firstLeafPage);
+	// header page to store root page num and the free list
+	char * header = (char*) malloc(PAGE_SIZE);
+	memset(header, 0, PAGE_SIZE);
+	FileHeader *fileHeader = (FileHeader *)header;
+	fileHeader->magic = INDEX_FILE_MAGIC;
+	fileHeader->version = INDEX_FILE_VERSION;
+	fileHeader->rootPage = 1;  //write out the root node page number
+	fileHeader->freePage = NO_PAGE;
+	fileHeader->indexType = BTreeIndex;
+	
+    returnValue = fileHandle.appendPage(header);
+    if(returnValue != SUCCESS){
+        free(header);
+        return returnValue;
+    }
 
-		returnValue = pfm->closeFile(fileHandle);
+	free(header);
+
+	// rootHeader: [pageType][numRecords][freeSpace][freeSpaceOffset][firstPtr]
+	char * rootPage = (char *) malloc(PAGE_SIZE);
+	IndexHeader *rootHeader = (IndexHeader *)rootPage;
+	rootHeader->pageType = Index;
+	rootHeader->numOfRecords = 0;
+	rootHeader->freeSpace = PAGE_SIZE - sizeof(IndexHeader);
+	rootHeader->freeSpaceOffset = PAGE_SIZE;
+	rootHeader->firstPtr = 2;
+
+	returnValue = fileHandle.appendPage(rootPage);
+    if(returnValue != SUCCESS){
+        free(rootPage);
+        return returnValue;
+    }
+    
+	free(rootPage);
 
-	}
+
+	// leafHeader: [pageType][numRecords][freeSpace][freeSpaceOffset][nextOFlow][nextPage][prevPage]
+	char * firstLeafPage = (char*) malloc(PAGE_SIZE);
+	LeafHeader *leafHeader = (LeafHeader *) firstLeafPage;
+	leafHeader->pageType = Leaf;
+	leafHeader->numOfRecords = 0;
+	leafHeader->freeSpace = PAGE_SIZE - sizeof(LeafHeader);
+	leafHeader->freeSpaceOffset = PAGE_SIZE;
+	leafHeader->prefixLength = 0;
+	leafHeader->nextOverFlowPage = NO_PAGE;
+	leafHeader->nextPage = NO_PAGE;
+	leafHeader->prevPage = NO_PAGE;
+
+	returnValue = fileHandle.appendPage(firstLeafPage);
+
+	free(firstLeafPage);
 	return returnValue;
 }
 
+/**
+ * The file keeps its descriptor and every handle on it stays valid, only the cached root page of the file is reset.
+ * The caller holds the index exclusively (the RM table lock).
+ */
+RC IndexManager::truncateFile(FileHandle &fileHandle)
+{
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	if (latches == NULL)
+		return -1;
+
+	unpinAllPages(latches);
+	if (fileHandle.truncate(0) != SUCCESS)
+		return -1;
+
+	if (latches->indexType == HashIndex) {
+		HashIndexManager *hashIndexManager = HashIndexManager::instance();
+		int returnValue = hashIndexManager->appendEmptyIndex(fileHandle);
+		if (returnValue == SUCCESS)
+			returnValue = hashIndexManager->readDirectory(fileHandle, latches);
+		return returnValue;
+	}
+
+	int returnValue = appendEmptyTree(fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	latches->rootPage.store(1, memory_order_release);
+	return SUCCESS;
+}
+
 RC IndexManager::destroyFile(const string &fileName)
 {
-	if (rootPageMap.find(fileName) != rootPageMap.end())
+	unique_lock<shared_mutex> guard(openIndexMutex);
+	if (openIndexes.find(fileName) != openIndexes.end())
 		return 2;
 
 	return pfm->destroyFile(fileName.c_str());
@@ -113,17 +282,33 @@ RC IndexManager::openFile(const string &fileName, FileHandle &fileHandle)
 		return -1;
 	}
     
+	// open and close run under the lock, so the latches are never dropped while another handle is being opened
+	unique_lock<shared_mutex> guard(openIndexMutex);
 	int returnValue = pfm->openFile(fileName.c_str(), fileHandle);
 
 	if (returnValue != SUCCESS)
 		return returnValue;
 
-	if (rootPageMap.find(fileName) == rootPageMap.end()) {
+	if (openIndexes.find(fileName) == openIndexes.end()) {
 		void *page = malloc(PAGE_SIZE);
-		fileHandle.readPage(0, page);
-		unsigned rootPageNum = *(unsigned *)page;
-		rootPageMap[fileName] = rootPageNum;
+		returnValue = fileHandle.readPage(0, page);
+		FileHeader *fileHeader = (FileHeader *)page;
+		if (returnValue == SUCCESS && (fileHeader->magic != INDEX_FILE_MAGIC || fileHeader->version != INDEX_FILE_VERSION))
+			returnValue = 5;
+
+		if (returnValue == SUCCESS) {
+			IndexLatches &latches = openIndexes[fileName];
+			latches.rootPage.store(fileHeader->rootPage);
+			latches.indexType = fileHeader->indexType;
+			if (latches.indexType == HashIndex)
+				returnValue = HashIndexManager::instance()->readDirectory(fileHandle, &latches);
+		}
 		free(page);
+
+		if (returnValue != SUCCESS) {
+			openIndexes.erase(fileName);
+			pfm->closeFile(fileHandle);
+		}
 	}
 
 	return returnValue;
@@ -133,25 +318,452 @@ RC IndexManager::closeFile(FileHandle &fileHandle)
 {
 	string fileName = fileHandle.getFileName();
 
+	unique_lock<shared_mutex> guard(openIndexMutex);
 	int returnValue = pfm->closeFile(fileHandle);
 
 	if (returnValue == SUCCESS && pfm->numOfFileHandle(fileName) == 0) {
-		rootPageMap.erase(fileName);
+		openIndexes.erase(fileName);
 	}
 
 	return returnValue;
 }
 
+IndexLatches *IndexManager::getLatches(const string &fileName)
+{
+	shared_lock<shared_mutex> guard(openIndexMutex);
+	map<string, IndexLatches>::iterator itr = openIndexes.find(fileName);
+	return itr == openIndexes.end() ? NULL : &itr->second;
+}
+
+RC IndexManager::readValidPage(FileHandle &fileHandle, IndexLatches *latches, unsigned pageNum, void *page, uint64_t &version)
+{
+	atomic<uint64_t> &latch = getPageLatch(latches, pageNum);
+	do {
+		version = readLatch(latch);
+		if (fileHandle.readPage(pageNum, page) != SUCCESS)
+			return -1;
+	} while (!isLatchValid(latch, version));
+
+	return SUCCESS;
+}
+
+bool IndexManager::readPinnedPage(IndexLatches *latches, unsigned pageNum, uint64_t version, void *page)
+{
+	shared_lock<shared_mutex> guard(latches->pinnedMutex);
+	map<unsigned, PinnedPage>::iterator itr = latches->pinnedPages.find(pageNum);
+	if (itr == latches->pinnedPages.end() || itr->second.version != version)
+		return false;
+
+	memcpy(page, itr->second.data, PAGE_SIZE);
+	return true;
+}
+
+/**
+ * Once PINNED_PAGES pages are pinned, a page of the lowest level pinned makes room for a page above it; the pages of
+ * that level are not pinned otherwise.
+ */
+void IndexManager::pinPage(IndexLatches *latches, unsigned pageNum, unsigned level, uint64_t version, const void *page)
+{
+	unique_lock<shared_mutex> guard(latches->pinnedMutex);
+	map<unsigned, PinnedPage> &pinnedPages = latches->pinnedPages;
+	map<unsigned, PinnedPage>::iterator itr = pinnedPages.find(pageNum);
+
+	if (itr == pinnedPages.end()) {
+		if (pinnedPages.size() >= PINNED_PAGES) {
+			unsigned lowestLevel = PINNED_LEVELS - 1;
+			while (lowestLevel > level && latches->numOfPinned[lowestLevel] == 0)
+				lowestLevel--;
+			if (lowestLevel <= level)
+				return;
+
+			for (itr = pinnedPages.begin(); itr->second.level != lowestLevel; itr++)
+				;
+			latches->numOfPinned[lowestLevel]--;
+			pinnedPages.erase(itr);
+		}
+		itr = pinnedPages.insert(make_pair(pageNum, PinnedPage())).first;
+		itr->second.version = 0;
+		itr->second.level = level;
+		latches->numOfPinned[level]++;
+	}
+	// another search may have pinned a newer copy meanwhile
+	else if (itr->second.version > version)
+		return;
+
+	latches->numOfPinned[itr->second.level]--;
+	latches->numOfPinned[level]++;
+	itr->second.level = level;
+	itr->second.version = version;
+	memcpy(itr->second.data, page, PAGE_SIZE);
+}
+
+void IndexManager::unpinPage(IndexLatches *latches, unsigned pageNum)
+{
+	unique_lock<shared_mutex> guard(latches->pinnedMutex);
+	map<unsigned, PinnedPage>::iterator itr = latches->pinnedPages.find(pageNum);
+	if (itr != latches->pinnedPages.end()) {
+		latches->numOfPinned[itr->second.level]--;
+		latches->pinnedPages.erase(itr);
+	}
+}
+
+// pages written without their latches: the tree of an emptied or bulk loaded file
+void IndexManager::unpinAllPages(IndexLatches *latches)
+{
+	unique_lock<shared_mutex> guard(latches->pinnedMutex);
+	latches->pinnedPages.clear();
+	for (int i = 0; i < PINNED_LEVELS; i++)
+		latches->numOfPinned[i] = 0;
+}
+
+RC IndexManager::writePage(FileHandle &fileHandle, unsigned pageNum, const void *data)
+{
+	if (LatchSet::current != NULL && LatchSet::current->isLockOnWrite())
+		LatchSet::current->lock(pageNum);
+	return fileHandle.writePage(pageNum, data);
+}
+
+RC IndexManager::setRootPage(FileHandle &fileHandle, unsigned rootPageNum)
+{
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	lock_guard<mutex> guard(latches->headerMutex);
+
+	char *headerPage = (char *)malloc(PAGE_SIZE);
+	int returnValue = fileHandle.readPage(0, headerPage);
+
+	if (returnValue == SUCCESS) {
+		((FileHeader *)headerPage)->rootPage = rootPageNum;
+		returnValue = fileHandle.writePage(0, headerPage);
+	}
+	free(headerPage);
+
+	if (returnValue != SUCCESS)
+		return -1;
+
+	latches->rootPage.store(rootPageNum, memory_order_release);
+	return SUCCESS;
+}
+
+RC IndexManager::allocatePage(FileHandle &fileHandle, unsigned &pageNum)
+{
+	lock_guard<mutex> guard(getLatches(fileHandle.getFileName())->headerMutex);
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	int returnValue = fileHandle.readPage(0, page);
+	FileHeader fileHeader = *(FileHeader *)page;
+
+	if (returnValue == SUCCESS && fileHeader.freePage != NO_PAGE) {
+		pageNum = fileHeader.freePage;
+		returnValue = fileHandle.readPage(pageNum, page);
+
+		if (returnValue == SUCCESS) {
+			fileHeader.freePage = ((FreeHeader *)page)->nextFreePage;
+			returnValue = fileHandle.readPage(0, page);
+		}
+		if (returnValue == SUCCESS) {
+			*(FileHeader *)page = fileHeader;
+			returnValue = fileHandle.writePage(0, page);
+		}
+	}
+	else if (returnValue == SUCCESS) {
+		memset(page, 0, PAGE_SIZE);
+		returnValue = fileHandle.appendPage(page);
+		pageNum = fileHandle.getNumberOfPages() - 1;
+	}
+
+	free(page);
+	return returnValue == SUCCESS ? SUCCESS : -1;
+}
+
+RC IndexManager::freePage(FileHandle &fileHandle, unsigned pageNum)
+{
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	unpinPage(latches, pageNum);
+	lock_guard<mutex> guard(latches->headerMutex);
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	int returnValue = fileHandle.readPage(0, page);
+	FileHeader *fileHeader = (FileHeader *)page;
+	unsigned nextFreePage = fileHeader->freePage;
+
+	if (returnValue == SUCCESS) {
+		fileHeader->freePage = pageNum;
+		returnValue = fileHandle.writePage(0, page);
+	}
+
+	if (returnValue == SUCCESS) {
+		memset(page, 0, PAGE_SIZE);
+		FreeHeader *freeHeader = (FreeHeader *)page;
+		freeHeader->pageType = Free;
+		freeHeader->nextFreePage = nextFreePage;
+		returnValue = writePage(fileHandle, pageNum, page);
+	}
+
+	free(page);
+	return returnValue == SUCCESS ? SUCCESS : -1;
+}
+
+/**
+ * Posting lists: a rid is stored as the varint of its page number minus the previous one, then the varint of its slot
+ * number (minus the previous one when on the same page) shifted left by one, the lowest bit telling whether a varint
+ * length and the included values follow. The first rid of a list is encoded from rid 0.0.
+ */
+static void appendVarint(string &out, unsigned value) {
+	while (value >= 0x80) {
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+static const char *readVarint(const char *data, unsigned &value) {
+	value = 0;
+	for (int shift = 0; ; shift += 7) {
+		unsigned char byte = *data++;
+		value |= (unsigned)(byte & 0x7f) << shift;
+		if (byte < 0x80)
+			return data;
+	}
+}
+
+static void appendPosting(string &out, RID &prevRid, const RID &rid, const void *payload, short payloadLength) {
+	bool isSamePage = rid.pageNum == prevRid.pageNum;
+	appendVarint(out, rid.pageNum - prevRid.pageNum);
+	appendVarint(out, ((isSamePage ? rid.slotNum - prevRid.slotNum : rid.slotNum) << 1) | (payloadLength > 0 ? 1 : 0));
+	if (payloadLength > 0) {
+		appendVarint(out, payloadLength);
+		out.append((const char *)payload, payloadLength);
+	}
+	prevRid = rid;
+}
+
+// rid holds the previous rid and is moved to the next one, returns the end of the posting
+static const char *readPosting(const char *data, RID &rid, const char *&payload, short &payloadLength) {
+	unsigned pageDelta, slotPart;
+	// most deltas take one byte
+	if ((unsigned char)data[0] < 0x80 && (unsigned char)data[1] < 0x80) {
+		pageDelta = (unsigned char)data[0];
+		slotPart = (unsigned char)data[1];
+		data += 2;
+	}
+	else {
+		data = readVarint(data, pageDelta);
+		data = readVarint(data, slotPart);
+	}
+	rid.slotNum = pageDelta == 0 ? rid.slotNum + (slotPart >> 1) : slotPart >> 1;
+	rid.pageNum += pageDelta;
+
+	unsigned length = 0;
+	if (slotPart & 1)
+		data = readVarint(data, length);
+	payload = data;
+	payloadLength = length;
+	return data + length;
+}
+
+static void encodePostings(const vector<Posting> &postings, unsigned begin, unsigned end, string &out) {
+	RID prevRid = {0, 0};
+	for (unsigned i = begin; i < end; i++)
+		appendPosting(out, prevRid, postings[i].rid, postings[i].payload.data(), postings[i].payload.size());
+}
+
+static void decodePostings(const char *data, int length, vector<Posting> &postings) {
+	const char *end = data + length;
+	RID rid = {0, 0};
+	while (data < end) {
+		Posting posting;
+		const char *payload;
+		short payloadLength;
+		data = readPosting(data, rid, payload, payloadLength);
+		posting.rid = rid;
+		posting.payload.assign(payload, payloadLength);
+		postings.push_back(posting);
+	}
+}
+
+static bool isRidLess(const RID &a, const RID &b) {
+	return a.pageNum < b.pageNum || (a.pageNum == b.pageNum && a.slotNum < b.slotNum);
+}
+
+static bool isPostingLess(const Posting &posting, const RID &rid) {
+	return isRidLess(posting.rid, rid);
+}
+
+// false when the rid is in the list already
+static bool insertPosting(vector<Posting> &postings, const RID &rid, const void *payload, short payloadLength) {
+	vector<Posting>::iterator itr = lower_bound(postings.begin(), postings.end(), rid, isPostingLess);
+	if (itr != postings.end() && !isRidLess(rid, itr->rid))
+		return false;
+
+	itr = postings.insert(itr, Posting());
+	itr->rid = rid;
+	itr->payload.assign((const char *)payload, payloadLength);
+	return true;
+}
+
+// false when the rid is not in the list
+static bool removePosting(vector<Posting> &postings, const RID &rid) {
+	vector<Posting>::iterator itr = lower_bound(postings.begin(), postings.end(), rid, isPostingLess);
+	if (itr == postings.end() || isRidLess(rid, itr->rid))
+		return false;
+
+	postings.erase(itr);
+	return true;
+}
+
+// fill an overflow page with postings[begin, ...) up to capacity bytes (one posting at least), returns where it stopped
+static unsigned fillOverflowPage(char *page, const vector<Posting> &postings, unsigned begin, unsigned end, int capacity,
+		unsigned nextPage) {
+	string encoded;
+	RID prevRid = {0, 0};
+	unsigned i = begin;
+	for (; i < end; i++) {
+		size_t length = encoded.size();
+		appendPosting(encoded, prevRid, postings[i].rid, postings[i].payload.data(), postings[i].payload.size());
+		if ((int)encoded.size() > capacity && i > begin) {
+			encoded.resize(length);
+			break;
+		}
+	}
+
+	OverflowHeader *header = (OverflowHeader *)page;
+	header->pageType = Overflow;
+	header->numOfRids = i - begin;
+	header->postingLength = encoded.size();
+	header->nextOverFlowPage = nextPage;
+	header->lastRid = postings[i - 1].rid;
+	memcpy(page + sizeof(OverflowHeader), encoded.data(), encoded.size());
+	return i;
+}
+
+// bytes of the prefix shared by the sorted varchar keys from first to last, and so by all the keys between them
+static short getCommonPrefixLength(const string &first, const string &last, AttrType attrType) {
+	if (attrType != TypeVarChar)
+		return 0;
+
+	short length = 0;
+	while (length < (short)first.size() && length < (short)last.size() && first[length] == last[length])
+		length++;
+	return length;
+}
+
+static int getLeafEntrySize(const LeafEntry &entry, short prefixLength) {
+	return sizeof(LeafSlot) + entry.key.size() - prefixLength + entry.postings.size();
+}
+
+// bytes of a leaf taken by entries[begin, end) as writeLeafEntries writes them
+static int getLeafEntriesSize(const vector<LeafEntry> &entries, unsigned begin, unsigned end, AttrType attrType) {
+	short prefixLength = end - begin > 1 ? getCommonPrefixLength(entries[begin].key, entries[end - 1].key, attrType) : 0;
+	int size = prefixLength;
+	for (unsigned i = begin; i < end; i++)
+		size += getLeafEntrySize(entries[i], prefixLength);
+	return size;
+}
+
+// where the second of two leaves taking entries starts: each leaf gets the prefix of its own keys taken out, and the
+// fuller one is as small as it can be. A key which does not share the prefix of a page sorts first or last, so the
+// page still fits on one side of it
+static unsigned getLeafSplit(const vector<LeafEntry> &entries, AttrType attrType) {
+	unsigned numOfEntries = entries.size();
+	vector<int> sizes(numOfEntries + 1, 0);
+	for (unsigned i = 0; i < numOfEntries; i++)
+		sizes[i + 1] = sizes[i] + getLeafEntrySize(entries[i], 0);
+
+	unsigned begin = 1;
+	int minSize = sizes[numOfEntries] + 1;
+	for (unsigned i = 1; i < numOfEntries; i++) {
+		short leftPrefix = i > 1 ? getCommonPrefixLength(entries[0].key, entries[i - 1].key, attrType) : 0;
+		short rightPrefix = numOfEntries - i > 1 ? getCommonPrefixLength(entries[i].key, entries.back().key, attrType) : 0;
+		int leftSize = sizes[i] - (i - 1) * leftPrefix;
+		int rightSize = sizes[numOfEntries] - sizes[i] - (numOfEntries - i - 1) * rightPrefix;
+
+		if (max(leftSize, rightSize) < minSize) {
+			minSize = max(leftSize, rightSize);
+			begin = i;
+		}
+	}
+	return begin;
+}
+
+// the key copied up for a leaf whose first key is "right" and whose left sibling ends with "left": a varchar is cut
+// after the first byte where it differs from "left", which still separates the two leaves
+static string getSeparator(const string &left, const string &right, AttrType attrType) {
+	if (attrType != TypeVarChar)
+		return right;
+	return right.substr(0, getCommonPrefixLength(left, right, attrType) + 1);
+}
+
 
 
 RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid)
 {
+	return insertEntry(fileHandle, attribute, key, rid, NULL, 0);
+}
+
+/**
+ * The path to the leaf is found without latches, then the pages the insert changes are latched at the versions they were
+ * found at, or it starts over: the leaf only, or when the leaf may split, the lowest index page with room for one more
+ * entry and the pages below it, plus the next leaf, whose prevPage changes. The root latch is taken too when no index
+ * page has room. The insert then runs from the highest latched page.
+ */
+RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid,
+		const void *payload, short payloadLength)
+{
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	if (latches == NULL)
+		return -1;
+	if (latches->indexType == HashIndex)
+		return HashIndexManager::instance()->insertEntry(fileHandle, latches, attribute.type, key, rid, payload, payloadLength);
+
+	// an index page takes the key copied up by a split below it when it has room for the longest key, varchar keys being
+	// at most attribute.length long
+	int keyLength = getKeyLength(key, attribute.type);
+	short indexEntrySize = getIndexEntrySize(max(keyLength, (int)attribute.length), attribute.type);
+
+	shared_lock<shared_mutex> structureGuard(latches->structureMutex);
+	LatchSet latchSet(latches);
+	vector<PathEntry> path;
+	char *page = (char *)malloc(PAGE_SIZE);
+	unsigned top = 0;
 	int returnValue = SUCCESS;
 
+	while (true) {
+		uint64_t rootVersion;
+		returnValue = findPath(fileHandle, latches, attribute.type, key, path, rootVersion, page);
+		if (returnValue != SUCCESS)
+			break;
+
+		bool isLocked = true;
+		top = path.size() - 1;
+		if (!isSafeLeafInsert(page, key, attribute.type, payloadLength)) {
+			int safePage = path.size() - 2;
+			while (safePage >= 0 && path[safePage].freeSpace < indexEntrySize)
+				safePage--;
+
+			top = safePage < 0 ? 0 : safePage;
+			if (safePage < 0)
+				isLocked = latchSet.tryLockRoot(rootVersion);
+			unsigned nextPage = ((LeafHeader *)page)->nextPage;
+			if (isLocked && nextPage != NO_PAGE)
+				isLocked = latchSet.tryLock(nextPage);
+		}
+
+		for (unsigned i = top; i < path.size() && isLocked; i++)
+			isLocked = latchSet.tryLock(path[i].pageNum, path[i].version);
+
+		if (isLocked)
+			break;
+		latchSet.release();
+	}
+	free(page);
+
+	if (returnValue != SUCCESS)
+		return returnValue;
+
 	SplitInfo splitInfo;
 	splitInfo.handleSplit = false;
 
-	returnValue = insert(fileHandle, attribute, key, rid, rootPageMap[fileHandle.getFileName()], splitInfo);
+	returnValue = insert(fileHandle, attribute, key, rid, payload, payloadLength, path[top].pageNum, splitInfo);
 
 	if (returnValue != SUCCESS) {
 		return returnValue;
@@ -159,7 +771,14 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 
 	// root page has been splitted, create a new root page, change rootPageNum in map and header page
 	if (splitInfo.handleSplit) {
-		unsigned oldRootNumber = rootPageMap[fileHandle.getFileName()];
+		unsigned oldRootNumber = path[0].pageNum;
+		unsigned newRootNumber;
+
+		returnValue = allocatePage(fileHandle, newRootNumber);
+		if (returnValue != SUCCESS) {
+			free(splitInfo.key);
+			return -1;
+		}
 
 		void * newRootPage = malloc(PAGE_SIZE);
 
@@ -172,37 +791,16 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 
 		insertEntryInIndexPage((char*)newRootPage, splitInfo.key, rootHeader, attribute, splitInfo.pageNo);
 
-		returnValue = fileHandle.appendPage(newRootPage);
+		returnValue = writePage(fileHandle, newRootNumber, newRootPage);
 		free(newRootPage);
+		free(splitInfo.key);
 
 		if(returnValue != SUCCESS) {
 			return -1;
 		}
 
-		unsigned newRootNumber = fileHandle.getNumberOfPages() - 1;
-
 		// change the root page number in headerPage
-		void * headerPage = malloc(PAGE_SIZE);
-		returnValue = fileHandle.readPage(0, headerPage);
-		if(returnValue != SUCCESS) {
-            free(splitInfo.key);
-			free(headerPage);
-			return -1;
-		}
-
-		*(unsigned *)headerPage = newRootNumber;
-
-		returnValue = fileHandle.writePage(0, headerPage);
-		if(returnValue != SUCCESS) {
-            free(splitInfo.key);
-			free(headerPage);
-			return -1;
-		}
-
-		rootPageMap[fileHandle.getFileName()] = newRootNumber;
-
-		free(headerPage);
-		free(splitInfo.key);
+		returnValue = setRootPage(fileHandle, newRootNumber);
 	}
 
 
@@ -210,7 +808,8 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 }
 
 
-RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid, unsigned pageNo, SplitInfo &splitInfo) {
+RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid, const void *payload, short payloadLength,
+		unsigned pageNo, SplitInfo &splitInfo) {
 	int returnValue = SUCCESS;
 	char * pageIn = (char *) malloc(PAGE_SIZE);
 	returnValue = fileHandle.readPage(pageNo, pageIn);  //read the page num that was passed in (index or node to be processed)
@@ -227,16 +826,9 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 		IndexHeader * indexHeader = ((IndexHeader *)pageIn);
 		int numberOfRecs = indexHeader->numOfRecords;
 		short slotNum = indexBinarySearch(key, pageIn, numberOfRecs, attribute.type);
+		unsigned nextNode = getIndexChild(pageIn, slotNum, attribute.type);
 
-		unsigned nextNode;
-		if (slotNum == -1)
-			nextNode = indexHeader->firstPtr;
-		else {
-			IndexSlot * iSlot = goToIndexSlot(pageIn, slotNum);
-			nextNode = iSlot->ptr;
-		}
-
-		returnValue = insert(fileHandle, attribute, key, rid, nextNode, splitInfo);
+		returnValue = insert(fileHandle, attribute, key, rid, payload, payloadLength, nextNode, splitInfo);
 		if (returnValue != SUCCESS) {
 			free(pageIn);
 			return returnValue;
@@ -245,12 +837,12 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 		// split occurred
 		if (splitInfo.handleSplit) {
 			int keyLength = getKeyLength(splitInfo.key, attribute.type);
-			short dataEntrySize = keyLength + sizeof(IndexSlot);
+			short dataEntrySize = getIndexEntrySize(keyLength, attribute.type);
 
 			// have enough space in this index page, insert and set splitInfo to "null"
 			if (indexHeader->freeSpace >= dataEntrySize) {
 				insertEntryInIndexPage(pageIn, splitInfo.key, indexHeader, attribute, splitInfo.pageNo);
-				returnValue = fileHandle.writePage(pageNo, pageIn);
+				returnValue = writePage(fileHandle, pageNo, pageIn);
 
 				if (returnValue != SUCCESS) {
                     free(splitInfo.key);
@@ -265,7 +857,8 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 
 				// create the new index page
 				char * newIndexPage = (char *) malloc(PAGE_SIZE);
-				returnValue = fileHandle.appendPage(newIndexPage);
+				unsigned newPageNo;
+				returnValue = allocatePage(fileHandle, newPageNo);
 				if (returnValue != SUCCESS) {
                     free(splitInfo.key);
 					free(pageIn);
@@ -273,8 +866,6 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 					return returnValue;
 				}
 
-				unsigned newPageNo = fileHandle.getNumberOfPages() - 1;
-
 				// create back up SplitInfo, this SplitInfo will be passed one level up
 				SplitInfo backUpSplitInfo;
 				backUpSplitInfo.pageNo = newPageNo;
@@ -313,7 +904,7 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 				}
 
 				// write both page
-				returnValue = fileHandle.writePage(pageNo, pageIn);
+				returnValue = writePage(fileHandle, pageNo, pageIn);
 				if (returnValue != SUCCESS) {
                     free(backUpSplitInfo.key);
                     free(splitInfo.key);
@@ -323,7 +914,7 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 					return -1;
 				}
 
-				returnValue = fileHandle.writePage(newPageNo, newIndexPage);
+				returnValue = writePage(fileHandle, newPageNo, newIndexPage);
 				if (returnValue != SUCCESS) {
                     free(backUpSplitInfo.key);
                     free(splitInfo.key);
@@ -364,181 +955,430 @@ RC IndexManager::insert(FileHandle &fileHandle, const Attribute &attribute, cons
 	else   //PROCESS A LEAF PAGE
 	{
 		int keyLength = getKeyLength(key, attribute.type);
-		short dataEntrySize = keyLength + sizeof(LeafSlot);
-
+		const char *keyData = attribute.type == TypeVarChar ? (const char *)key + sizeof(int) : (const char *)key;
 		LeafHeader * leafHeader = (LeafHeader *) pageIn;
+		short prefixLength = leafHeader->prefixLength;
 
-		if (leafHeader->freeSpace >= dataEntrySize) { //there enough space in this leaf, we can insert the key directly
+		bool isEqual;
+		short slotNum = leafBinarySearch(key, pageIn, leafHeader->numOfRecords, attribute.type, isEqual);
+		LeafSlot *leafSlot = goToLeafSlot(pageIn, slotNum);
 
-			// need to reorganize page
-			if ((unsigned)(leafHeader->freeSpaceOffset - keyLength) <
-					sizeof(LeafHeader) + (leafHeader->numOfRecords + 1) * sizeof(LeafSlot))
-				reorgLeafPage(pageIn);
+		// the posting list is on overflow pages, the leaf does not change
+		if (isEqual && leafSlot->overflowPage != NO_PAGE) {
+			returnValue = insertOverflowPosting(fileHandle, leafSlot->overflowPage, rid, payload, payloadLength);
+			free(pageIn);
+			return returnValue;
+		}
 
-			insertKeyInLeafPage(pageIn, (char*)key, leafHeader, attribute, rid);
-			returnValue = fileHandle.writePage(pageNo, pageIn);
+		// the posting list of the key with the new rid, a new key starts one
+		vector<Posting> postings;
+		if (isEqual)
+			decodePostings(pageIn + leafSlot->offset + leafSlot->length, leafSlot->postingLength, postings);
+		if (!insertPosting(postings, rid, payload, payloadLength)) {
+			// entry already exists
+			free(pageIn);
+			return 3;
+		}
 
+		string encoded;
+		encodePostings(postings, 0, postings.size(), encoded);
+		unsigned overflowPage = NO_PAGE;
+		if (encoded.size() > MAX_INLINE_POSTING_LENGTH && postings.size() > 1) {
+			returnValue = writeOverflowPages(fileHandle, postings, overflowPage);
 			if (returnValue != SUCCESS) {
 				free(pageIn);
 				return returnValue;
 			}
-
-			splitInfo.handleSplit = false;
+			encoded.clear();
 		}
 
-		else {                                            //Need to split the current leaf and
-			//  0. prepare new leaf page
-			char * newLeafPage = (char *) malloc(PAGE_SIZE);
-			returnValue = fileHandle.appendPage(newLeafPage);
+		// a new key without the prefix of the page is only added by rewriting the page
+		bool hasPrefix = isEqual || (keyLength >= prefixLength && memcmp(keyData, goToLeafPrefix(pageIn), prefixLength) == 0);
+		short dataEntrySize = isEqual ? encoded.size() - leafSlot->postingLength
+				: sizeof(LeafSlot) + keyLength - prefixLength + encoded.size();
 
-			if(returnValue != SUCCESS) {
-				free(newLeafPage);
-				free(pageIn);
-				return -1;
+		if (hasPrefix && leafHeader->freeSpace >= dataEntrySize) { //there enough space in this leaf, we can change it directly
+			if (isEqual)
+				replaceLeafPostings(pageIn, slotNum, encoded, overflowPage);
+			else
+				insertLeafEntry(pageIn, slotNum + 1, keyData + prefixLength, keyLength - prefixLength, encoded, overflowPage);
+
+			returnValue = writePage(fileHandle, pageNo, pageIn);
+			splitInfo.handleSplit = false;
+		}
+		else {                                            //Rewrite the leaf with a new prefix, or split it
+			vector<LeafEntry> entries;
+			readLeafEntries(pageIn, entries);
+
+			if (isEqual) {
+				entries[slotNum].postings = encoded;
+				entries[slotNum].overflowPage = overflowPage;
+			}
+			else {
+				LeafEntry entry;
+				entry.key.assign(keyData, keyLength);
+				entry.postings = encoded;
+				entry.overflowPage = overflowPage;
+				entries.insert(entries.begin() + slotNum + 1, entry);
 			}
-			unsigned newPageNo = fileHandle.getNumberOfPages() - 1;
 
-			//  1. copy all the keys starting from startslot from current leaf to new leaf
-			copyLeafKeysInOrder(pageIn, newLeafPage, pageNo, newPageNo, attribute.type);
+			if (getLeafEntriesSize(entries, 0, entries.size(), attribute.type) <= (int)(PAGE_SIZE - sizeof(LeafHeader))) {
+				writeLeafEntries(pageIn, entries, 0, entries.size(), attribute.type);
+				returnValue = writePage(fileHandle, pageNo, pageIn);
+				splitInfo.handleSplit = false;
+			}
+			else {
+				returnValue = splitLeafPage(fileHandle, pageIn, pageNo, entries, attribute.type, splitInfo);
+			}
+		}
+	}
+	free(pageIn);
+	return returnValue;
+}
 
-			//  2. now insert the original key into either the old leaf page or the new leaf page
-			LeafSlot * ls = goToLeafSlot(newLeafPage, 0);
 
-			void * keyOnPage = malloc(ls->length);
-			memcpy(keyOnPage, newLeafPage + ls->offset, ls->length);
 
-			//  4. compare the new key to the largest key on the existing leaf
-			int compareVal = compare(key, keyOnPage, attribute.type, ls->length);
 
-			//  5. insert the key into the correct leaf page (existing or new leaf page)
-			if (compareVal < 0) {  //key entry can be inserted on the existing leaf
-				returnValue = insertKeyInLeafPage(pageIn, key, leafHeader, attribute, rid);
-				if (returnValue != SUCCESS) { // key already exist
-					free(pageIn);
-					free(newLeafPage);
-					free(keyOnPage);
-					return returnValue;
-				}
-			}
-			else {  //insert key entry into the newly created leaf page
-				LeafHeader * newLeafHeader = (LeafHeader*) newLeafPage;
-				returnValue = insertKeyInLeafPage(newLeafPage, key, newLeafHeader, attribute, rid);
-				if (returnValue != SUCCESS) { // key already exist
-					free(pageIn);
-					free(newLeafPage);
-					free(keyOnPage);
-					return returnValue;
-				}
-			}
+// the entry goes to the bottom of the free space, the page is reorganized first when the slots would reach it
+void IndexManager::insertLeafEntry(char *page, short slotNum, const char *keyData, short keyLength, const string &postings,
+		unsigned overflowPage) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	short dataLength = keyLength + postings.size();
 
-			//Save Both Pages
-			returnValue = fileHandle.writePage(newPageNo, newLeafPage);
-			if(returnValue != SUCCESS) {
-				free(newLeafPage);
-				free(keyOnPage);
-				free(pageIn);
-				return returnValue;
-			}
+	if (leafHeader->freeSpaceOffset - dataLength < (int)(sizeof(LeafHeader) + (leafHeader->numOfRecords + 1) * sizeof(LeafSlot)))
+		reorgLeafPage(page);
 
-			returnValue = fileHandle.writePage(pageNo, pageIn);
-			if(returnValue != SUCCESS) {
-				free(newLeafPage);
-				free(keyOnPage);
-				free(pageIn);
-				return returnValue;
-			}
+	// shift the slots from slotNum on by one
+	LeafSlot *leafSlot = goToLeafSlot(page, slotNum);
+	memmove(leafSlot + 1, leafSlot, (leafHeader->numOfRecords - slotNum) * sizeof(LeafSlot));
 
-			// prepare splitInfo which will be return to the level above
-			if (attribute.type == TypeVarChar) {
-				splitInfo.key = malloc(sizeof(int) + ls->length);
-				int length = (int)ls->length;
-				memcpy(splitInfo.key, &length, sizeof(int));
-				memcpy((char *)splitInfo.key + sizeof(int), keyOnPage, ls->length);
-			}
-			else {
-				splitInfo.key = malloc(ls->length);
-				memcpy(splitInfo.key, keyOnPage, ls->length);
-			}
+	leafSlot->offset = leafHeader->freeSpaceOffset - dataLength;
+	leafSlot->length = keyLength;
+	leafSlot->postingLength = postings.size();
+	leafSlot->overflowPage = overflowPage;
+	memcpy(page + leafSlot->offset, keyData, keyLength);
+	memcpy(page + leafSlot->offset + keyLength, postings.data(), postings.size());
+
+	leafHeader->numOfRecords++;
+	leafHeader->freeSpace -= sizeof(LeafSlot) + dataLength;
+	leafHeader->freeSpaceOffset -= dataLength;
+}
+
+// a shorter list is written over the old one, a longer one moves the entry to the free space
+void IndexManager::replaceLeafPostings(char *page, short slotNum, const string &postings, unsigned overflowPage) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	LeafSlot *leafSlot = goToLeafSlot(page, slotNum);
+	short oldPostingLength = leafSlot->postingLength;
+	leafSlot->overflowPage = overflowPage;
+
+	if ((short)postings.size() <= oldPostingLength) {
+		memcpy(page + leafSlot->offset + leafSlot->length, postings.data(), postings.size());
+		leafSlot->postingLength = postings.size();
+		leafHeader->freeSpace += oldPostingLength - (short)postings.size();
+		return;
+	}
+
+	string key(page + leafSlot->offset, leafSlot->length);
+	short dataLength = key.size() + postings.size();
+
+	if (leafHeader->freeSpaceOffset - dataLength < (int)(sizeof(LeafHeader) + leafHeader->numOfRecords * sizeof(LeafSlot))) {
+		// the old entry is dropped by the reorganization
+		leafSlot->length = 0;
+		leafSlot->postingLength = 0;
+		reorgLeafPage(page);
+		leafHeader->freeSpace -= dataLength;
+	}
+	else {
+		leafHeader->freeSpace -= (short)postings.size() - oldPostingLength;
+	}
+
+	leafSlot->offset = leafHeader->freeSpaceOffset - dataLength;
+	leafSlot->length = key.size();
+	leafSlot->postingLength = postings.size();
+	memcpy(page + leafSlot->offset, key.data(), key.size());
+	memcpy(page + leafSlot->offset + key.size(), postings.data(), postings.size());
+	leafHeader->freeSpaceOffset -= dataLength;
+}
+
+void IndexManager::removeLeafEntry(char *page, short slotNum) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	LeafSlot *leafSlot = goToLeafSlot(page, slotNum);
+
+	// shift the all data entries behind the deleted one left by one
+	leafHeader->freeSpace += sizeof(LeafSlot) + leafSlot->length + leafSlot->postingLength;
+	memmove(leafSlot, leafSlot + 1, (leafHeader->numOfRecords - slotNum - 1) * sizeof(LeafSlot));
+	leafHeader->numOfRecords--;
+}
+
+/**
+ *  The entries are split about evenly by bytes (see getLeafSplit): the first ones are written back to the page, the
+ *  others to a new leaf linked right after it. The shortest key between the two leaves (see getSeparator) is copied up
+ *  to the parent.
+ **/
+RC IndexManager::splitLeafPage(FileHandle &fileHandle, char *page, unsigned pageNo, const vector<LeafEntry> &entries,
+		AttrType attrType, SplitInfo &splitInfo) {
+	// the new leaf starts at entries[begin]
+	unsigned begin = getLeafSplit(entries, attrType);
+
+	unsigned newPageNo;
+	if (allocatePage(fileHandle, newPageNo) != SUCCESS)
+		return -1;
 
-			splitInfo.pageNo = newPageNo;
-			splitInfo.handleSplit = true;
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	char *newLeafPage = (char *)malloc(PAGE_SIZE);
+	LeafHeader *newLeafHeader = (LeafHeader *)newLeafPage;
+	newLeafHeader->pageType = Leaf;
+	newLeafHeader->nextOverFlowPage = NO_PAGE;
+	newLeafHeader->nextPage = leafHeader->nextPage;
+	newLeafHeader->prevPage = pageNo;
+	leafHeader->nextPage = newPageNo;
 
-			free(keyOnPage);
-			free(newLeafPage);
+	writeLeafEntries(page, entries, 0, begin, attrType);
+	writeLeafEntries(newLeafPage, entries, begin, entries.size(), attrType);
+
+	//Save Both Pages
+	int returnValue = writePage(fileHandle, newPageNo, newLeafPage);
+	if (returnValue == SUCCESS)
+		returnValue = writePage(fileHandle, pageNo, page);
+
+	// link the following leaf back to the new one
+	unsigned nextPageNo = newLeafHeader->nextPage;
+	if (returnValue == SUCCESS && nextPageNo != NO_PAGE) {
+		returnValue = fileHandle.readPage(nextPageNo, newLeafPage);
+		if (returnValue == SUCCESS) {
+			newLeafHeader->prevPage = newPageNo;
+			returnValue = writePage(fileHandle, nextPageNo, newLeafPage);
 		}
 	}
-	free(pageIn);
-	return returnValue;
+	free(newLeafPage);
+
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// prepare splitInfo which will be return to the level above
+	string key = getSeparator(entries[begin - 1].key, entries[begin].key, attrType);
+	if (attrType == TypeVarChar) {
+		int length = key.size();
+		splitInfo.key = malloc(sizeof(int) + length);
+		memcpy(splitInfo.key, &length, sizeof(int));
+		memcpy((char *)splitInfo.key + sizeof(int), key.data(), length);
+	}
+	else {
+		splitInfo.key = malloc(key.size());
+		memcpy(splitInfo.key, key.data(), key.size());
+	}
+
+	splitInfo.pageNo = newPageNo;
+	splitInfo.handleSplit = true;
+	return SUCCESS;
 }
 
+/**
+ * A posting list too long for its leaf is written to as many full overflow pages as it needs.
+ */
+RC IndexManager::writeOverflowPages(FileHandle &fileHandle, const vector<Posting> &postings, unsigned &firstPage) {
+	char *page = (char *)malloc(PAGE_SIZE);
+	int capacity = PAGE_SIZE - sizeof(OverflowHeader);
+	int returnValue = allocatePage(fileHandle, firstPage);
+	unsigned pageNum = firstPage;
+	unsigned begin = 0;
+
+	while (returnValue == SUCCESS) {
+		begin = fillOverflowPage(page, postings, begin, postings.size(), capacity, NO_PAGE);
+		if (begin < postings.size())
+			returnValue = allocatePage(fileHandle, ((OverflowHeader *)page)->nextOverFlowPage);
+		if (returnValue == SUCCESS)
+			returnValue = writePage(fileHandle, pageNum, page);
+		if (begin == postings.size())
+			break;
+		pageNum = ((OverflowHeader *)page)->nextOverFlowPage;
+	}
 
+	free(page);
+	return returnValue == SUCCESS ? SUCCESS : -1;
+}
 
+RC IndexManager::readOverflowPages(FileHandle &fileHandle, unsigned firstPage, string &postings, vector<unsigned> &pageStarts) {
+	char *page = (char *)malloc(PAGE_SIZE);
+	OverflowHeader *header = (OverflowHeader *)page;
+	int returnValue = SUCCESS;
+	postings.clear();
+	pageStarts.clear();
+
+	for (unsigned pageNum = firstPage; pageNum != NO_PAGE && returnValue == SUCCESS; pageNum = header->nextOverFlowPage) {
+		returnValue = fileHandle.readPage(pageNum, page);
+		if (returnValue == SUCCESS) {
+			if (pageNum != firstPage)
+				pageStarts.push_back(postings.size());
+			postings.append(page + sizeof(OverflowHeader), header->postingLength);
+		}
+	}
 
-// key here contains four bytes to indicate the length of string
-RC IndexManager::insertKeyInLeafPage(char *pageIn, const void *key, LeafHeader *leafHeader, const Attribute &attribute, const RID &rid) {
+	free(page);
+	return returnValue == SUCCESS ? SUCCESS : -1;
+}
 
-    int keyLength = getKeyLength(key, attribute.type);
-    short dataEntrySize = sizeof(LeafSlot) + keyLength;
+/**
+ * The rid goes to the first page whose last rid is above it, or to the last page. A full page is split in halves,
+ * except that a rid above every other starts a new last page, so that appended rids fill their pages.
+ */
+RC IndexManager::insertOverflowPosting(FileHandle &fileHandle, unsigned firstPage, const RID &rid, const void *payload,
+		short payloadLength) {
+	char *page = (char *)malloc(PAGE_SIZE);
+	OverflowHeader *header = (OverflowHeader *)page;
+	unsigned pageNum = firstPage;
+	int returnValue;
+
+	while ((returnValue = fileHandle.readPage(pageNum, page)) == SUCCESS) {
+		if (!isRidLess(header->lastRid, rid) || header->nextOverFlowPage == NO_PAGE)
+			break;
+		pageNum = header->nextOverFlowPage;
+	}
 
-    void * keyEntry = malloc(keyLength);
+	vector<Posting> postings;
+	if (returnValue == SUCCESS) {
+		bool isAppend = isRidLess(header->lastRid, rid);
+		decodePostings(page + sizeof(OverflowHeader), header->postingLength, postings);
 
-    if (attribute.type == TypeVarChar) {
-        memcpy(keyEntry, ((char*)key) + sizeof(int), keyLength);
-    }
-    else{
-        memcpy(keyEntry, key, keyLength);
-    }
+		if (!insertPosting(postings, rid, payload, payloadLength)) {
+			free(page);
+			return 3;
+		}
 
-    bool isEqual;
-    short newSlotNum = leafBinarySearch(key, pageIn, leafHeader->numOfRecords, attribute.type, isEqual);
-    newSlotNum++;  //leafBinarySearch returns the predecessor, we want the next slot
+		int capacity = PAGE_SIZE - sizeof(OverflowHeader);
+		unsigned nextPage = header->nextOverFlowPage;
+		unsigned end = fillOverflowPage(page, postings, 0, postings.size(), capacity, nextPage);
+
+		if (end < postings.size()) {
+			string encoded;
+			encodePostings(postings, 0, postings.size(), encoded);
+			// the page is scratch until the halves are written
+			unsigned middle = isAppend ? postings.size() - 1
+					: fillOverflowPage(page, postings, 0, postings.size(), encoded.size() / 2, nextPage);
+
+			unsigned newPageNum;
+			returnValue = allocatePage(fileHandle, newPageNum);
+			if (returnValue == SUCCESS) {
+				fillOverflowPage(page, postings, middle, postings.size(), capacity, nextPage);
+				returnValue = writePage(fileHandle, newPageNum, page);
+			}
+			if (returnValue == SUCCESS)
+				fillOverflowPage(page, postings, 0, middle, capacity, newPageNum);
+		}
 
-    if (isEqual) {
-        //two keys with the same value, handle with OVERFLOW pages, temporarily just return error code
-    	free(keyEntry);
-    	return 3;
-    }
-    else {
-        //get the old slot information
-        short prevSlotsStart = sizeof(LeafHeader) + (sizeof(LeafSlot) * newSlotNum);
-        short prevSlotsEnd =  sizeof(LeafHeader) + (sizeof(LeafSlot) * leafHeader->numOfRecords);
-        short prevSlotsSize = prevSlotsEnd - prevSlotsStart;
-
-        //1.  Save the existing slot information starting from insertion point
-        if (prevSlotsSize > 0) {  //not inserting to the end of slots
-            char * prevSlotsInfo = (char*) malloc(prevSlotsSize);
-            memcpy(prevSlotsInfo, pageIn + prevSlotsStart, prevSlotsSize);  //copy the existing slot infomation to the left of new slot
-            memcpy(pageIn + prevSlotsStart + sizeof(LeafSlot), prevSlotsInfo, prevSlotsSize);  //SHIFT the old slots down by 1 slot
-            free(prevSlotsInfo);
-        }
-
-        //2.  Write the slot information for the new entry
-        LeafSlot * lSlot = goToLeafSlot(pageIn, newSlotNum);  //go to the new slot and write the information
-        lSlot->pageNum = rid.pageNum;
-        lSlot->slotNum = rid.slotNum;
-        short keyOffSetBegin = leafHeader->freeSpaceOffset - keyLength;
-        lSlot->offset = keyOffSetBegin;
-        lSlot->length = keyLength;
-
-        //3.  Write the entry to the bottom of the page (determined by freespace offset)
-        char * keyEntryStart = pageIn + keyOffSetBegin;
-
-        //4.  Copy the key to the page
-        memcpy(keyEntryStart, keyEntry, keyLength);
-
-        //5.  Update the header with the new values
-        leafHeader->numOfRecords++;
-        leafHeader->freeSpace = leafHeader->freeSpace - dataEntrySize;
-        leafHeader->freeSpaceOffset = leafHeader->freeSpaceOffset - keyLength;
-    }
-    free(keyEntry);
-    return 0;
+		if (returnValue == SUCCESS)
+			returnValue = writePage(fileHandle, pageNum, page);
+	}
+
+	free(page);
+	return returnValue == SUCCESS ? SUCCESS : -1;
+}
+
+/**
+ * An emptied page is unlinked and freed, a page left below UNDERFLOW_FILL_FACTOR takes in the next one when both fit
+ * in one page. An open scan holds a copy of the whole list, the pages of a list may change under it.
+ */
+RC IndexManager::removeOverflowPosting(FileHandle &fileHandle, unsigned &firstPage, const RID &rid, string &shortPostings) {
+	char *page = (char *)malloc(PAGE_SIZE);
+	OverflowHeader *header = (OverflowHeader *)page;
+	unsigned prevPageNum = NO_PAGE;
+	unsigned pageNum = firstPage;
+	int returnValue;
+
+	// the page which may hold rid
+	while ((returnValue = fileHandle.readPage(pageNum, page)) == SUCCESS && isRidLess(header->lastRid, rid)
+			&& header->nextOverFlowPage != NO_PAGE) {
+		prevPageNum = pageNum;
+		pageNum = header->nextOverFlowPage;
+	}
+
+	if (returnValue != SUCCESS) {
+		free(page);
+		return -1;
+	}
+
+	vector<Posting> postings;
+	decodePostings(page + sizeof(OverflowHeader), header->postingLength, postings);
+	if (!removePosting(postings, rid)) {
+		free(page);
+		return 3;
+	}
+
+	int capacity = PAGE_SIZE - sizeof(OverflowHeader);
+	unsigned nextPage = header->nextOverFlowPage;
+
+	if (postings.empty()) {
+		if (prevPageNum == NO_PAGE) {
+			firstPage = nextPage;
+		}
+		else {
+			returnValue = fileHandle.readPage(prevPageNum, page);
+			if (returnValue == SUCCESS) {
+				header->nextOverFlowPage = nextPage;
+				returnValue = writePage(fileHandle, prevPageNum, page);
+			}
+		}
+		if (returnValue == SUCCESS)
+			returnValue = freePage(fileHandle, pageNum);
+
+		// the page buffer holds the first page again
+		if (returnValue == SUCCESS && firstPage != NO_PAGE)
+			returnValue = fileHandle.readPage(firstPage, page);
+	}
+	else {
+		string encoded;
+		encodePostings(postings, 0, postings.size(), encoded);
+		unsigned mergedPage = NO_PAGE;
+
+		// the length of the next page is an upper bound, its first rid is encoded shorter after the last one of this page
+		if (nextPage != NO_PAGE && (int)encoded.size() * 100 < capacity * UNDERFLOW_FILL_FACTOR) {
+			returnValue = fileHandle.readPage(nextPage, page);
+			if (returnValue == SUCCESS && (int)encoded.size() + header->postingLength <= capacity) {
+				decodePostings(page + sizeof(OverflowHeader), header->postingLength, postings);
+				mergedPage = nextPage;
+				nextPage = header->nextOverFlowPage;
+			}
+		}
+
+		if (returnValue == SUCCESS) {
+			fillOverflowPage(page, postings, 0, postings.size(), capacity, nextPage);
+			returnValue = writePage(fileHandle, pageNum, page);
+		}
+		if (returnValue == SUCCESS && mergedPage != NO_PAGE)
+			returnValue = freePage(fileHandle, mergedPage);
+	}
+
+	// a list left on a single short page goes back to its leaf
+	if (returnValue == SUCCESS && firstPage != NO_PAGE && (pageNum == firstPage || postings.empty())
+			&& header->nextOverFlowPage == NO_PAGE && header->postingLength <= MAX_INLINE_POSTING_LENGTH / 2)
+		shortPostings.assign(page + sizeof(OverflowHeader), header->postingLength);
+
+	free(page);
+	return returnValue == SUCCESS ? SUCCESS : -1;
 }
 
 // key here contains four bytes to indicate the length of string
 RC IndexManager::insertEntryInIndexPage(char *pageIn, const void *key, IndexHeader *indexHeader, const Attribute &attribute, unsigned &pagePointer) {
 
     int keyLength = getKeyLength(key, attribute.type);
+
+    // fixed width keys: shift the tails of both arrays by one entry
+    if (isFixedWidth(attribute.type)) {
+        short newSlotNum = indexBinarySearch(key, pageIn, indexHeader->numOfRecords, attribute.type) + 1;
+        short numOfMoved = indexHeader->numOfRecords - newSlotNum;
+        char *keys = goToIndexKeys(pageIn);
+        unsigned *ptrs = goToIndexPtrs(pageIn);
+
+        memmove(keys + (newSlotNum + 1) * sizeof(int), keys + newSlotNum * sizeof(int), numOfMoved * sizeof(int));
+        memmove(ptrs + newSlotNum + 1, ptrs + newSlotNum, numOfMoved * sizeof(unsigned));
+        memcpy(keys + newSlotNum * sizeof(int), key, sizeof(int));
+        ptrs[newSlotNum] = pagePointer;
+
+        indexHeader->numOfRecords++;
+        indexHeader->freeSpace -= FIXED_INDEX_ENTRY_SIZE;
+        return 0;
+    }
+
     short dataEntrySize = sizeof(IndexSlot) + keyLength;
 
     void * keyEntry = malloc(keyLength);
@@ -589,60 +1429,27 @@ RC IndexManager::insertEntryInIndexPage(char *pageIn, const void *key, IndexHead
     return 0;
 }
 
+void IndexManager::appendEntryToIndexPage(char *page, const char *keyData, short keyLength, unsigned ptr, AttrType attrType) {
+	IndexHeader *indexHeader = (IndexHeader *)page;
 
-/**
- *  When a split on a leaf occurs, we need to copy all values from a starting point in the current page, to the new page.  This
- *  method handles that.
- **/
-void IndexManager::copyLeafKeysInOrder(char * leafPage, char * newLeafPage, unsigned currentPageNo, unsigned newPageNo, AttrType type) {
-
-	LeafHeader * leafHeader = (LeafHeader *)leafPage;
-
-	//create the leaf header for the new child
-	LeafHeader * newLeafHeader = (LeafHeader *)newLeafPage;
-	newLeafHeader->pageType = Leaf;
-	newLeafHeader->numOfRecords = 0;
-	newLeafHeader->nextOverFlowPage = NO_PAGE;
-	newLeafHeader->nextPage = leafHeader->nextPage;
-	newLeafHeader->prevPage = currentPageNo;
-	newLeafHeader->freeSpace = PAGE_SIZE - sizeof(LeafHeader);
-	newLeafHeader->freeSpaceOffset = PAGE_SIZE;
-
-	leafHeader->nextPage = newPageNo;
-
-	short numberOfRecords = leafHeader->numOfRecords;
-	short startSlot = numberOfRecords / 2;
-
-	short i = startSlot;
-	short j = 0;
-
-	// copy the bigger half of the page to new page
-	for(; i < numberOfRecords; i++, j++){
-		LeafSlot * leafSlot = goToLeafSlot(leafPage, i);
-		LeafSlot * newLeafSlot = goToLeafSlot(newLeafPage, j);
-
-		// copy information in slot
-		newLeafSlot->length = leafSlot->length;
-		newLeafSlot->offset = newLeafHeader->freeSpaceOffset - newLeafSlot->length; // should make some changes
-		newLeafSlot->pageNum = leafSlot->pageNum;
-		newLeafSlot->slotNum = leafSlot->slotNum;
-
-		// copy key value
-		memcpy(newLeafPage + newLeafSlot->offset, leafPage + leafSlot->offset, leafSlot->length);
-
-		// change info in header
-		newLeafHeader->numOfRecords++;
-		newLeafHeader->freeSpace -= sizeof(LeafSlot) + newLeafSlot->length;
-		newLeafHeader->freeSpaceOffset -= newLeafSlot->length;
+	if (isFixedWidth(attrType)) {
+		memcpy(goToIndexKeys(page) + indexHeader->numOfRecords * sizeof(int), keyData, sizeof(int));
+		goToIndexPtrs(page)[indexHeader->numOfRecords] = ptr;
+	}
+	else {
+		IndexSlot *indexSlot = goToIndexSlot(page, indexHeader->numOfRecords);
+		indexSlot->offset = indexHeader->freeSpaceOffset - keyLength;
+		indexSlot->length = keyLength;
+		indexSlot->ptr = ptr;
+		memcpy(page + indexSlot->offset, keyData, keyLength);
+		indexHeader->freeSpaceOffset -= keyLength;
 	}
 
-	// delete the bigger half of the old page
-	leafHeader->numOfRecords -= numberOfRecords - startSlot;
-	// reorganize the page to release free space
-	reorgLeafPage(leafPage);
-
+	indexHeader->numOfRecords++;
+	indexHeader->freeSpace -= getIndexEntrySize(keyLength, attrType);
 }
 
+
 /**
  *  When a split on a index page occurs, we need to copy all values from a starting point in the current page, to the new page.  This
  *  method handles that.
@@ -660,7 +1467,26 @@ void IndexManager::copyIndexEntriesInOrder(char * indexPage, char * newIndexPage
     short numOfRecords = indexHeader->numOfRecords;
     short startSlot = numOfRecords / 2;
 
-
+    // fixed width keys: the middle key moves up, the entries right of it move to the new page
+    if (isFixedWidth(attrType)) {
+        char *keys = goToIndexKeys(indexPage);
+        unsigned *ptrs = goToIndexPtrs(indexPage);
+        short numOfMoved = numOfRecords - startSlot - 1;
+
+        newIndexHeader->firstPtr = ptrs[startSlot];
+        splitInfo.handleSplit = true;
+        splitInfo.key = malloc(sizeof(int));
+        memcpy(splitInfo.key, keys + startSlot * sizeof(int), sizeof(int));
+
+        memcpy(goToIndexKeys(newIndexPage), keys + (startSlot + 1) * sizeof(int), numOfMoved * sizeof(int));
+        memcpy(goToIndexPtrs(newIndexPage), ptrs + startSlot + 1, numOfMoved * sizeof(unsigned));
+        newIndexHeader->numOfRecords = numOfMoved;
+        newIndexHeader->freeSpace -= numOfMoved * FIXED_INDEX_ENTRY_SIZE;
+
+        indexHeader->numOfRecords = startSlot;
+        indexHeader->freeSpace = PAGE_SIZE - sizeof(IndexHeader) - startSlot * FIXED_INDEX_ENTRY_SIZE;
+        return;
+    }
 
     // set the first pointer in the new index page to the pointer of middle slot
     IndexSlot *middleSlot = goToIndexSlot(indexPage, startSlot);
@@ -719,182 +1545,689 @@ int IndexManager::getKeyLength(const void *key, AttrType attrType) {
 }
 
 
+/**
+ * The entry is removed from its leaf. A page falling below UNDERFLOW_FILL_FACTOR is merged with a sibling when both
+ * fit in one page, otherwise it takes entries from its sibling. The freed pages go to the free list, and a root left
+ * with a single index child is replaced by that child.
+ */
 RC IndexManager::deleteEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid)
 {
-	int returnValue = SUCCESS;
-	RID recordId;
-	EID entryId;
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	if (latches == NULL)
+		return -1;
+	if (latches->indexType == HashIndex)
+		return HashIndexManager::instance()->deleteEntry(fileHandle, latches, attribute.type, key, rid);
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	bool isRootUnderflow = false;
+	int returnValue;
+
+	// a delete leaving its leaf above UNDERFLOW_FILL_FACTOR latches the leaf only
+	{
+		shared_lock<shared_mutex> structureGuard(latches->structureMutex);
+		LatchSet latchSet(latches);
+		vector<PathEntry> path;
+		uint64_t rootVersion;
+		bool isLocked = false;
+
+		returnValue = findPath(fileHandle, latches, attribute.type, key, path, rootVersion, page);
+		while (returnValue == SUCCESS && isSafeLeafDelete(page, key, attribute.type)
+				&& !(isLocked = latchSet.tryLock(path.back().pageNum, path.back().version)))
+			returnValue = findPath(fileHandle, latches, attribute.type, key, path, rootVersion, page);
+
+		if (returnValue == SUCCESS && isLocked)
+			returnValue = remove(fileHandle, attribute, key, rid, path.back().pageNum, isRootUnderflow);
+		if (returnValue != SUCCESS || isLocked) {
+			free(page);
+			return returnValue;
+		}
+	}
+
+	// pages may be merged: no other writer runs, and every page is latched before it is written
+	unique_lock<shared_mutex> structureGuard(latches->structureMutex);
+	LatchSet latchSet(latches);
+	latchSet.setLockOnWrite(true);
 
-	// find the entry by key
-	returnValue = searchEntry(fileHandle, attribute, key, recordId, entryId);
+	unsigned rootPageNum = latches->rootPage.load();
+	returnValue = remove(fileHandle, attribute, key, rid, rootPageNum, isRootUnderflow);
 	if (returnValue != SUCCESS) {
+		free(page);
 		return returnValue;
 	}
 
-	// search result doesn't match
-	if (recordId.pageNum != rid.pageNum || recordId.slotNum != rid.slotNum)
-		return 3;
+	// an empty root gives way to its child, unless the child is a leaf (the root of a small tree has no entries either)
+	while (returnValue == SUCCESS) {
+		returnValue = fileHandle.readPage(rootPageNum, page);
+		if (returnValue != SUCCESS || ((IndexHeader *)page)->numOfRecords != 0)
+			break;
+
+		unsigned childPageNum = ((IndexHeader *)page)->firstPtr;
+		returnValue = fileHandle.readPage(childPageNum, page);
+		if (returnValue != SUCCESS || *(PageType *)page != Index)
+			break;
+
+		latchSet.lockRoot();
+		returnValue = setRootPage(fileHandle, childPageNum);
+		if (returnValue == SUCCESS)
+			returnValue = freePage(fileHandle, rootPageNum);
+		rootPageNum = childPageNum;
+	}
+
+	free(page);
+	return returnValue;
+}
 
+RC IndexManager::remove(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid, unsigned pageNo,
+		bool &isUnderflow) {
 	char *page = (char *)malloc(PAGE_SIZE);
-	returnValue = fileHandle.readPage(entryId.pageNum, page);
+	int returnValue = fileHandle.readPage(pageNo, page);
+
 	if (returnValue != SUCCESS) {
 		free(page);
 		return returnValue;
 	}
 
-	LeafHeader *headerPtr = (LeafHeader *)page;
-	short numOfRecords = headerPtr->numOfRecords;
-	LeafSlot *deletedSlot = goToLeafSlot(page, entryId.slotNum);
-	short keyLength = deletedSlot->length;
+	if (*(PageType *)page == Root || *(PageType *)page == Index) {
+		IndexHeader *indexHeader = (IndexHeader *)page;
+		short slotNum = indexBinarySearch(key, page, indexHeader->numOfRecords, attribute.type);
+		bool isChildUnderflow = false;
 
-	// shift the all data entries behind entryId left by one
-	for (short i = entryId.slotNum; i < numOfRecords - 1; i++) {
-		char *slotPtr = page + sizeof(LeafHeader) + i * sizeof(LeafSlot);
-		char *copiedSlotPtr = page + sizeof(LeafHeader) + (i + 1) * sizeof(LeafSlot);
-		memcpy(slotPtr, copiedSlotPtr, sizeof(LeafSlot));
+		returnValue = remove(fileHandle, attribute, key, rid, getIndexChild(page, slotNum, attribute.type), isChildUnderflow);
+		if (returnValue == SUCCESS && isChildUnderflow) {
+			returnValue = handleUnderflow(fileHandle, attribute.type, page, slotNum);
+			if (returnValue == SUCCESS)
+				returnValue = writePage(fileHandle, pageNo, page);
+		}
 	}
+	else {
+		LeafHeader *leafHeader = (LeafHeader *)page;
+		bool isEqual;
+		short slotNum = leafBinarySearch(key, page, leafHeader->numOfRecords, attribute.type, isEqual);
+		LeafSlot *leafSlot = goToLeafSlot(page, slotNum);
 
-	headerPtr->numOfRecords--;
-	headerPtr->freeSpace += keyLength + sizeof(LeafSlot);
+		if (!isEqual) {
+			returnValue = 1;
+		}
+		else if (leafSlot->overflowPage != NO_PAGE) {
+			unsigned firstPage = leafSlot->overflowPage;
+			string shortPostings;
+			returnValue = removeOverflowPosting(fileHandle, firstPage, rid, shortPostings);
+
+			if (returnValue == SUCCESS) {
+				bool isChanged = true;
+				if (firstPage == NO_PAGE) {
+					removeLeafEntry(page, slotNum);
+				}
+				else if (!shortPostings.empty() && leafHeader->freeSpace >= (short)shortPostings.size()) {
+					replaceLeafPostings(page, slotNum, shortPostings, NO_PAGE);
+					returnValue = freePage(fileHandle, firstPage);
+				}
+				else {
+					isChanged = firstPage != leafSlot->overflowPage;
+					leafSlot->overflowPage = firstPage;
+				}
 
-	returnValue = fileHandle.writePage(entryId.pageNum, page);
-	free(page);
+				if (returnValue == SUCCESS && isChanged)
+					returnValue = writePage(fileHandle, pageNo, page);
+			}
+		}
+		else {
+			vector<Posting> postings;
+			decodePostings(page + leafSlot->offset + leafSlot->length, leafSlot->postingLength, postings);
+
+			// search result doesn't match
+			if (!removePosting(postings, rid)) {
+				returnValue = 3;
+			}
+			else {
+				if (postings.empty()) {
+					removeLeafEntry(page, slotNum);
+				}
+				else {
+					string encoded;
+					encodePostings(postings, 0, postings.size(), encoded);
+					replaceLeafPostings(page, slotNum, encoded, NO_PAGE);
+				}
+				returnValue = writePage(fileHandle, pageNo, page);
+			}
+		}
+	}
 
+	isUnderflow = returnValue == SUCCESS && isUnderfull(page);
+	free(page);
 	return returnValue;
 }
 
-RC IndexManager::searchEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, RID &rid, EID &entryId) {
-	int returnValue = 0;
-
-	bool isSuccess = false;
-	bool isNegOne = false;
-	LeafSlot *slotPtr = BTreeSearch(fileHandle, rootPageMap[fileHandle.getFileName()], attribute.type, key, entryId, isSuccess, isNegOne);
+bool IndexManager::isUnderfull(const char *page) {
+	int capacity, freeSpace;
 
-	if (isSuccess) { // successful search
-		rid.pageNum = slotPtr->pageNum;
-		rid.slotNum = slotPtr->slotNum;
+	if (*(PageType *)page == Leaf) {
+		capacity = PAGE_SIZE - sizeof(LeafHeader);
+		freeSpace = ((LeafHeader *)page)->freeSpace;
 	}
 	else {
-		returnValue = 1;
+		capacity = PAGE_SIZE - sizeof(IndexHeader);
+		freeSpace = ((IndexHeader *)page)->freeSpace;
 	}
 
-	delete slotPtr;
-	return returnValue;
+	return (capacity - freeSpace) * 100 < capacity * UNDERFLOW_FILL_FACTOR;
 }
 
-LeafSlot * IndexManager::BTreeSearch(FileHandle &fileHandle, unsigned pageNum, AttrType attrType, const void *key, EID &entryId, bool &isSuccess, bool &isNegOne) {
+/**
+ * The child at slotNum is paired with its left sibling, the first child with its right sibling. A child without a
+ * sibling (the parent has a single child) is left alone, its parent underflows in turn.
+ */
+RC IndexManager::handleUnderflow(FileHandle &fileHandle, AttrType attrType, char *parentPage, short slotNum) {
+	IndexEntries parent;
+	readIndexEntries(parentPage, attrType, parent);
 
-	void *page = malloc(PAGE_SIZE);
-	fileHandle.readPage(pageNum, page);
+	if (parent.keys.empty())
+		return SUCCESS;
 
-	LeafSlot *result;
+	unsigned separator = slotNum == -1 ? 0 : slotNum;
+	unsigned leftPageNum = separator == 0 ? parent.firstPtr : parent.ptrs[separator - 1];
+	unsigned rightPageNum = parent.ptrs[separator];
 
-	if (*(PageType *)page == Leaf || *(PageType *)page == Overflow) { // leaf page
-		LeafHeader *header = (LeafHeader *)page;
-		short numOfRecords = header->numOfRecords;
+	char *leftPage = (char *)malloc(PAGE_SIZE);
+	char *rightPage = (char *)malloc(PAGE_SIZE);
+	int returnValue = fileHandle.readPage(leftPageNum, leftPage);
+	if (returnValue == SUCCESS)
+		returnValue = fileHandle.readPage(rightPageNum, rightPage);
 
-		short slotNum = leafBinarySearch(key, page, numOfRecords, attrType, isSuccess);
+	if (returnValue == SUCCESS) {
+		if (*(PageType *)leftPage == Leaf)
+			returnValue = handleLeafUnderflow(fileHandle, attrType, parentPage, parent, separator, leftPage, rightPage, slotNum != -1);
+		else
+			returnValue = handleIndexUnderflow(fileHandle, attrType, parentPage, parent, separator, leftPage, rightPage);
+	}
 
-		result = new LeafSlot();
+	free(leftPage);
+	free(rightPage);
+	return returnValue;
+}
 
-		// isNegOne is only set to true when there is at least one data entry and the key is smaller than all data entries
-		if (slotNum == -1) {
-			slotNum++;
-			isNegOne = numOfRecords == 0 ? false : true;
-		}
-		else
-			isNegOne = false;
+/**
+ * Two leaves which fit in one page are merged into the left one. Otherwise an underflowing right leaf takes the last
+ * entries of the left one; entries never move to a leaf on the left, which a scan may have passed already. The new
+ * separator is not set when it is longer than the old one and the parent is full, the leaves are then left as they are.
+ */
+RC IndexManager::handleLeafUnderflow(FileHandle &fileHandle, AttrType attrType, char *parentPage, IndexEntries &parent,
+		unsigned separator, char *leftPage, char *rightPage, bool isRightUnderflow) {
+	unsigned leftPageNum = separator == 0 ? parent.firstPtr : parent.ptrs[separator - 1];
+	unsigned rightPageNum = parent.ptrs[separator];
+	LeafHeader *leftHeader = (LeafHeader *)leftPage;
+	LeafHeader *rightHeader = (LeafHeader *)rightPage;
+	int returnValue = SUCCESS;
 
-		// has at least one one slot
-		if (numOfRecords > 0) {
-			LeafSlot *slotPtr = goToLeafSlot((char *)page, slotNum);
-			result->length = slotPtr->length;
-			result->offset = slotPtr->offset;
-			result->pageNum = slotPtr->pageNum;
-			result->slotNum = slotPtr->slotNum;
-		}
-		else {
-			result->length = 0;
-			result->offset = 0;
-			result->pageNum = 0;
-			result->slotNum = 0;
+	vector<LeafEntry> entries;
+	readLeafEntries(leftPage, entries);
+	unsigned numOfLeftEntries = entries.size();
+	readLeafEntries(rightPage, entries);
+
+	// merge
+	if (getLeafEntriesSize(entries, 0, entries.size(), attrType) <= (int)(PAGE_SIZE - sizeof(LeafHeader))) {
+		unsigned nextPageNo = rightHeader->nextPage;
+		leftHeader->nextPage = nextPageNo;
+		writeLeafEntries(leftPage, entries, 0, entries.size(), attrType);
+
+		returnValue = writePage(fileHandle, leftPageNum, leftPage);
+		if (returnValue == SUCCESS && nextPageNo != NO_PAGE) {
+			returnValue = fileHandle.readPage(nextPageNo, rightPage);
+			if (returnValue == SUCCESS) {
+				rightHeader->prevPage = leftPageNum;
+				returnValue = writePage(fileHandle, nextPageNo, rightPage);
+			}
 		}
+		if (returnValue == SUCCESS)
+			returnValue = freePage(fileHandle, rightPageNum);
+		if (returnValue != SUCCESS)
+			return -1;
 
-		entryId.pageNum = pageNum;
-		entryId.slotNum = slotNum;
+		parent.keys.erase(parent.keys.begin() + separator);
+		parent.ptrs.erase(parent.ptrs.begin() + separator);
+		return writeIndexEntries(parentPage, attrType, parent);
 	}
-	if (*(PageType *)page == Root || *(PageType *)page == Index) { // index page
-		IndexHeader *header = (IndexHeader *)page;
-		short numOfRecords = header->numOfRecords;
-		short slotNum = indexBinarySearch(key, page, numOfRecords, attrType);
 
-		if (slotNum == -1) {
-			result = BTreeSearch(fileHandle, header->firstPtr, attrType, key, entryId, isSuccess, isNegOne);
-		}
-		else {
-			IndexSlot *slotPtr = goToIndexSlot((char *)page, slotNum);
-			result = BTreeSearch(fileHandle, slotPtr->ptr, attrType, key, entryId, isSuccess, isNegOne);
-		}
-	}
+	if (!isRightUnderflow)
+		return SUCCESS;
 
-	free(page);
-	return result;
+	// the right leaf starts at entries[begin], about half of the bytes
+	unsigned begin = getLeafSplit(entries, attrType);
+
+	if (begin >= numOfLeftEntries
+			|| getLeafEntriesSize(entries, begin, entries.size(), attrType) > (int)(PAGE_SIZE - sizeof(LeafHeader)))
+		return SUCCESS;
+
+	parent.keys[separator] = getSeparator(entries[begin - 1].key, entries[begin].key, attrType);
+	if (writeIndexEntries(parentPage, attrType, parent) != SUCCESS)
+		return SUCCESS;
+
+	writeLeafEntries(leftPage, entries, 0, begin, attrType);
+	writeLeafEntries(rightPage, entries, begin, entries.size(), attrType);
+
+	returnValue = writePage(fileHandle, leftPageNum, leftPage);
+	if (returnValue == SUCCESS)
+		returnValue = writePage(fileHandle, rightPageNum, rightPage);
+
+	return returnValue == SUCCESS ? SUCCESS : -1;
 }
 
 /**
- * this is a helper method used in scan initialization. if isInclusive is true, rid will be set to the smallest data
- * entry which is greater than or equal to key. if isInclusive is false, rid will be set to the smallest data entry
- * which is greater than key
+ * Two index pages which fit in one page, with the separator pulled down between them, are merged into the left one.
+ * Otherwise their entries are split about evenly and the middle one becomes the separator.
  */
+RC IndexManager::handleIndexUnderflow(FileHandle &fileHandle, AttrType attrType, char *parentPage, IndexEntries &parent,
+		unsigned separator, char *leftPage, char *rightPage) {
+	unsigned leftPageNum = separator == 0 ? parent.firstPtr : parent.ptrs[separator - 1];
+	unsigned rightPageNum = parent.ptrs[separator];
+	int returnValue = SUCCESS;
 
-RC IndexManager::findSuccessorForStart(FileHandle &fileHandle, const void *key, AttrType type, EID &entryId, bool isInclusive) {
-	int returnValue = 0;
-	LeafSlot *slotPtr;
-	bool isSuccess = false;
-	bool isNegOne = false;
+	IndexEntries entries;
+	IndexEntries right;
+	readIndexEntries(leftPage, attrType, entries);
+	readIndexEntries(rightPage, attrType, right);
+	entries.keys.push_back(parent.keys[separator]);
+	entries.ptrs.push_back(right.firstPtr);
+	entries.keys.insert(entries.keys.end(), right.keys.begin(), right.keys.end());
+	entries.ptrs.insert(entries.ptrs.end(), right.ptrs.begin(), right.ptrs.end());
+
+	// merge
+	if (writeIndexEntries(leftPage, attrType, entries) == SUCCESS) {
+		returnValue = writePage(fileHandle, leftPageNum, leftPage);
+		if (returnValue == SUCCESS)
+			returnValue = freePage(fileHandle, rightPageNum);
+		if (returnValue != SUCCESS)
+			return -1;
 
-	slotPtr = BTreeSearch(fileHandle, rootPageMap[fileHandle.getFileName()], type, key, entryId, isSuccess, isNegOne);
+		parent.keys.erase(parent.keys.begin() + separator);
+		parent.ptrs.erase(parent.ptrs.begin() + separator);
+		return writeIndexEntries(parentPage, attrType, parent);
+	}
 
+	// entries.keys[middle] moves up, about half of the bytes on each side
+	int totalSize = 0;
+	for (unsigned i = 0; i < entries.keys.size(); i++)
+		totalSize += getIndexEntrySize(entries.keys[i].size(), attrType);
 
-	if (isSuccess && !isInclusive) {
-		returnValue = findNextValidSlot(fileHandle, entryId);
+	unsigned middle = 0;
+	int leftSize = 0;
+	while (middle + 2 < entries.keys.size() && leftSize < totalSize / 2) {
+		leftSize += getIndexEntrySize(entries.keys[middle].size(), attrType);
+		middle++;
 	}
 
-	if (!isSuccess && !isNegOne) {
-		returnValue = findNextValidSlot(fileHandle, entryId);
+	IndexEntries left;
+	left.firstPtr = entries.firstPtr;
+	left.keys.assign(entries.keys.begin(), entries.keys.begin() + middle);
+	left.ptrs.assign(entries.ptrs.begin(), entries.ptrs.begin() + middle);
+	right.firstPtr = entries.ptrs[middle];
+	right.keys.assign(entries.keys.begin() + middle + 1, entries.keys.end());
+	right.ptrs.assign(entries.ptrs.begin() + middle + 1, entries.ptrs.end());
+
+	// every page must take its entries, or nothing changes
+	char *newParentPage = (char *)malloc(PAGE_SIZE);
+	memcpy(newParentPage, parentPage, PAGE_SIZE);
+	parent.keys[separator] = entries.keys[middle];
+
+	if (writeIndexEntries(newParentPage, attrType, parent) != SUCCESS || writeIndexEntries(leftPage, attrType, left) != SUCCESS
+			|| writeIndexEntries(rightPage, attrType, right) != SUCCESS) {
+		free(newParentPage);
+		return SUCCESS;
 	}
 
-	delete slotPtr;
-	return returnValue;
-}
+	returnValue = writePage(fileHandle, leftPageNum, leftPage);
+	if (returnValue == SUCCESS)
+		returnValue = writePage(fileHandle, rightPageNum, rightPage);
+	if (returnValue == SUCCESS)
+		memcpy(parentPage, newParentPage, PAGE_SIZE);
 
-RC IndexManager::findSuccessorForEnd(FileHandle &fileHandle, const void *key, AttrType type, EID &entryId, bool isInclusive) {
-	int returnValue = 0;
-	LeafSlot *slotPtr;
-	bool isSuccess = false;
-	bool isNegOne = false;
+	free(newParentPage);
+	return returnValue == SUCCESS ? SUCCESS : -1;
+}
 
-	slotPtr = BTreeSearch(fileHandle, rootPageMap[fileHandle.getFileName()], type, key, entryId, isSuccess, isNegOne);
+void IndexManager::readIndexEntries(const char *page, AttrType attrType, IndexEntries &entries) {
+	IndexHeader *indexHeader = (IndexHeader *)page;
+	entries.firstPtr = indexHeader->firstPtr;
+	entries.keys.clear();
+	entries.ptrs.clear();
 
+	for (short i = 0; i < indexHeader->numOfRecords; i++) {
+		if (isFixedWidth(attrType)) {
+			entries.keys.push_back(string(goToIndexKeys(page) + i * sizeof(int), sizeof(int)));
+			entries.ptrs.push_back(goToIndexPtrs(page)[i]);
+		}
+		else {
+			IndexSlot *indexSlot = goToIndexSlot(page, i);
+			entries.keys.push_back(string(page + indexSlot->offset, indexSlot->length));
+			entries.ptrs.push_back(indexSlot->ptr);
+		}
+	}
+}
+
+RC IndexManager::writeIndexEntries(char *page, AttrType attrType, const IndexEntries &entries) {
+	int size = 0;
+	for (unsigned i = 0; i < entries.keys.size(); i++)
+		size += getIndexEntrySize(entries.keys[i].size(), attrType);
+
+	if (size > (int)(PAGE_SIZE - sizeof(IndexHeader)))
+		return -1;
+
+	IndexHeader *indexHeader = (IndexHeader *)page;
+	indexHeader->numOfRecords = 0;
+	indexHeader->freeSpace = PAGE_SIZE - sizeof(IndexHeader);
+	indexHeader->freeSpaceOffset = PAGE_SIZE;
+	indexHeader->firstPtr = entries.firstPtr;
+
+	for (unsigned i = 0; i < entries.keys.size(); i++)
+		appendEntryToIndexPage(page, entries.keys[i].data(), entries.keys[i].size(), entries.ptrs[i], attrType);
+
+	return SUCCESS;
+}
+
+void IndexManager::readLeafEntries(const char *page, vector<LeafEntry> &entries) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+
+	for (short i = 0; i < leafHeader->numOfRecords; i++) {
+		LeafSlot *leafSlot = goToLeafSlot(page, i);
+		LeafEntry entry;
+		entry.key.assign(goToLeafPrefix(page), leafHeader->prefixLength);
+		entry.key.append(page + leafSlot->offset, leafSlot->length);
+		entry.postings.assign(page + leafSlot->offset + leafSlot->length, leafSlot->postingLength);
+		entry.overflowPage = leafSlot->overflowPage;
+		entries.push_back(entry);
+	}
+}
 
-	if (isSuccess && isInclusive) {
-		returnValue = findNextValidSlot(fileHandle, entryId);
+void IndexManager::writeLeafEntries(char *page, const vector<LeafEntry> &entries, unsigned begin, unsigned end, AttrType attrType) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	short prefixLength = end - begin > 1 ? getCommonPrefixLength(entries[begin].key, entries[end - 1].key, attrType) : 0;
+	leafHeader->numOfRecords = 0;
+	leafHeader->prefixLength = prefixLength;
+	leafHeader->freeSpace = PAGE_SIZE - sizeof(LeafHeader) - prefixLength;
+	leafHeader->freeSpaceOffset = PAGE_SIZE - prefixLength;
+	if (prefixLength > 0)
+		memcpy(goToLeafPrefix(page), entries[begin].key.data(), prefixLength);
+
+	for (unsigned i = begin; i < end; i++) {
+		short keyLength = entries[i].key.size() - prefixLength;
+		short postingLength = entries[i].postings.size();
+		LeafSlot *leafSlot = goToLeafSlot(page, leafHeader->numOfRecords);
+		leafSlot->offset = leafHeader->freeSpaceOffset - keyLength - postingLength;
+		leafSlot->length = keyLength;
+		leafSlot->postingLength = postingLength;
+		leafSlot->overflowPage = entries[i].overflowPage;
+		memcpy(page + leafSlot->offset, entries[i].key.data() + prefixLength, keyLength);
+		memcpy(page + leafSlot->offset + keyLength, entries[i].postings.data(), postingLength);
+
+		leafHeader->numOfRecords++;
+		leafHeader->freeSpace -= sizeof(LeafSlot) + keyLength + postingLength;
+		leafHeader->freeSpaceOffset -= keyLength + postingLength;
+	}
+}
+
+RC IndexManager::searchEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, RID &rid, EID &entryId) {
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	if (latches == NULL)
+		return -1;
+	if (latches->indexType == HashIndex)
+		return HashIndexManager::instance()->searchEntry(fileHandle, latches, attribute.type, key, rid, entryId);
+
+	bool isSuccess = false;
+	bool isNegOne = false;
+	uint64_t version;
+	int returnValue = BTreeSearch(fileHandle, latches, attribute.type, key, entryId, rid, isSuccess, isNegOne, version);
+
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// not found
+	if (!isSuccess)
+		return 1;
+
+	return SUCCESS;
+}
+
+/**
+ * Walks down from the root to the leaf which may hold key, reusing a single page buffer for all the levels.
+ * entryId is set to the slot of key in that leaf, or to its predecessor (slot 0 when key is smaller than every
+ * entry, isNegOne tells that case apart when the leaf is not empty). rid is the first rid of that slot.
+ */
+RC IndexManager::BTreeSearch(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, EID &entryId,
+		RID &rid, bool &isSuccess, bool &isNegOne, uint64_t &version) {
+	char *page = (char *)malloc(PAGE_SIZE);
+	vector<PathEntry> path;
+	uint64_t rootVersion;
+	bool isValid = false;
+
+	while (!isValid) {
+		if (findPath(fileHandle, latches, attrType, key, path, rootVersion, page) != SUCCESS) {
+			free(page);
+			return -1;
+		}
+
+		LeafHeader *header = (LeafHeader *)page;
+		short numOfRecords = header->numOfRecords;
+		short slotNum = leafBinarySearch(key, page, numOfRecords, attrType, isSuccess);
+
+		// isNegOne is only set to true when there is at least one data entry and the key is smaller than all data entries
+		isNegOne = slotNum == -1 && numOfRecords > 0;
+		if (slotNum == -1)
+			slotNum = 0;
+
+		entryId.pageNum = path.back().pageNum;
+		entryId.slotNum = slotNum;
+		version = path.back().version;
+		rid.pageNum = 0;
+		rid.slotNum = 0;
+		isValid = true;
+
+		// the first rid of the posting list, an overflow page is only valid while its leaf has not changed
+		if (numOfRecords > 0) {
+			LeafSlot *slotPtr = goToLeafSlot(page, slotNum);
+			const char *postingData = page + slotPtr->offset + slotPtr->length;
+
+			if (slotPtr->overflowPage != NO_PAGE) {
+				if (fileHandle.readPage(slotPtr->overflowPage, page) != SUCCESS) {
+					free(page);
+					return -1;
+				}
+				postingData = page + sizeof(OverflowHeader);
+				isValid = isLatchValid(getPageLatch(latches, entryId.pageNum), version);
+			}
+
+			const char *payload;
+			short payloadLength;
+			if (isValid)
+				readPosting(postingData, rid, payload, payloadLength);
+		}
+	}
+
+	free(page);
+	return SUCCESS;
+}
+
+/**
+ * The version of a child is noted while its parent still is as it was read, so the child is the one its parent pointed
+ * to; a page which changed while it was read sends the search back to the root.
+ */
+RC IndexManager::findPath(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		vector<PathEntry> &path, uint64_t &rootVersion, char *page) {
+	while (true) {
+		path.clear();
+		rootVersion = readLatch(latches->rootLatch);
+		PathEntry entry;
+		entry.pageNum = latches->rootPage.load(memory_order_acquire);
+		entry.version = readLatch(getPageLatch(latches, entry.pageNum));
+		bool isValid = isLatchValid(latches->rootLatch, rootVersion);
+
+		while (isValid) {
+			// a pinned copy at the version noted is the page as it is
+			unsigned level = path.size();
+			bool isPinned = level < PINNED_LEVELS && readPinnedPage(latches, entry.pageNum, entry.version, page);
+			if (!isPinned) {
+				if (fileHandle.readPage(entry.pageNum, page) != SUCCESS)
+					return -1;
+				if (!isLatchValid(getPageLatch(latches, entry.pageNum), entry.version))
+					break;
+			}
+
+			entry.freeSpace = ((IndexHeader *)page)->freeSpace;
+			path.push_back(entry);
+
+			PageType pageType = *(PageType *)page;
+			if (pageType != Root && pageType != Index)
+				return SUCCESS;
+			if (!isPinned && level < PINNED_LEVELS)
+				pinPage(latches, entry.pageNum, level, entry.version, page);
+
+			IndexHeader *header = (IndexHeader *)page;
+			short slotNum = indexBinarySearch(key, page, header->numOfRecords, attrType);
+			entry.pageNum = getIndexChild(page, slotNum, attrType);
+			entry.version = readLatch(getPageLatch(latches, entry.pageNum));
+			isValid = isLatchValid(getPageLatch(latches, path.back().pageNum), path.back().version);
+		}
+	}
+}
+
+/**
+ * An entry goes into a leaf without a split when its key shares the prefix of the page and the page has room for its
+ * slot, its key and a posting; a rid added to a key already there takes one posting more at most (see appendPosting).
+ */
+bool IndexManager::isSafeLeafInsert(const char *page, const void *key, AttrType attrType, short payloadLength) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	int keyLength = getKeyLength(key, attrType);
+	const char *keyData = attrType == TypeVarChar ? (const char *)key + sizeof(int) : (const char *)key;
+	short prefixLength = leafHeader->prefixLength;
+
+	if (keyLength < prefixLength || memcmp(keyData, goToLeafPrefix(page), prefixLength) != 0)
+		return false;
+
+	// the varints of the page and slot deltas take 5 bytes at most, the one of the payload length 3
+	int postingLength = 2 * 5 + (payloadLength > 0 ? 3 + payloadLength : 0);
+	return leafHeader->freeSpace >= (int)sizeof(LeafSlot) + keyLength - prefixLength + postingLength;
+}
+
+bool IndexManager::isSafeLeafDelete(const char *page, const void *key, AttrType attrType) {
+	LeafHeader *leafHeader = (LeafHeader *)page;
+	bool isEqual;
+	short slotNum = leafBinarySearch(key, (void *)page, leafHeader->numOfRecords, attrType, isEqual);
+	if (!isEqual)
+		return true;
+
+	// the page without the whole entry
+	LeafSlot *leafSlot = goToLeafSlot(page, slotNum);
+	int capacity = PAGE_SIZE - sizeof(LeafHeader);
+	int usedSpace = capacity - leafHeader->freeSpace - (sizeof(LeafSlot) + leafSlot->length + leafSlot->postingLength);
+	return usedSpace * 100 >= capacity * UNDERFLOW_FILL_FACTOR;
+}
+
+/**
+ * The index pages on the path to the leaf of key give the subtrees right of it, which are walked down left to right.
+ * Fewer leaves than asked for are found only at the end of the tree or past highKey; -1 is returned when a page of
+ * the path changed meanwhile. The leaves are only read ahead, so the pages below the path are not validated.
+ */
+RC IndexManager::getNextLeaves(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key,
+		const void *highKey, unsigned numOfLeaves, vector<unsigned> &leaves) {
+	char *page = (char *)malloc(PAGE_SIZE);
+	vector<PathEntry> path;
+	uint64_t rootVersion;
+	bool isAboveHighKey = false;
+	leaves.clear();
+
+	int returnValue = findPath(fileHandle, latches, attrType, key, path, rootVersion, page);
+
+	// from the parent of the leaf up, the children right of the path
+	for (int level = (int)path.size() - 2; returnValue == SUCCESS && level >= 0; level--) {
+		uint64_t version;
+		returnValue = readValidPage(fileHandle, latches, path[level].pageNum, page, version);
+		if (returnValue == SUCCESS && version != path[level].version)
+			returnValue = -1;
+		if (returnValue != SUCCESS)
+			break;
+
+		IndexEntries entries;
+		readIndexEntries(page, attrType, entries);
+		short slotNum = indexBinarySearch(key, page, ((IndexHeader *)page)->numOfRecords, attrType);
+
+		for (unsigned i = slotNum + 1; i < entries.keys.size() && leaves.size() < numOfLeaves && !isAboveHighKey; i++) {
+			if (highKey != NULL && compare(highKey, entries.keys[i].data(), attrType, entries.keys[i].size()) < 0)
+				isAboveHighKey = true;
+			else
+				returnValue = appendLeaves(fileHandle, latches, attrType, entries.ptrs[i], path.size() - 2 - level, highKey,
+						numOfLeaves, leaves, isAboveHighKey);
+		}
+
+		if (leaves.size() >= numOfLeaves || isAboveHighKey)
+			break;
+	}
+
+	free(page);
+	return returnValue;
+}
+
+RC IndexManager::appendLeaves(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, unsigned pageNum, int depth,
+		const void *highKey, unsigned numOfLeaves, vector<unsigned> &leaves, bool &isAboveHighKey) {
+	if (depth == 0) {
+		leaves.push_back(pageNum);
+		return SUCCESS;
+	}
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	uint64_t version;
+	int returnValue = readValidPage(fileHandle, latches, pageNum, page, version);
+	IndexEntries entries;
+	if (returnValue == SUCCESS && *(PageType *)page == Index)
+		readIndexEntries(page, attrType, entries);
+	free(page);
+
+	if (returnValue == SUCCESS && !entries.ptrs.empty())
+		returnValue = appendLeaves(fileHandle, latches, attrType, entries.firstPtr, depth - 1, highKey, numOfLeaves, leaves,
+				isAboveHighKey);
+
+	for (unsigned i = 0; returnValue == SUCCESS && i < entries.keys.size() && leaves.size() < numOfLeaves && !isAboveHighKey; i++) {
+		if (highKey != NULL && compare(highKey, entries.keys[i].data(), attrType, entries.keys[i].size()) < 0)
+			isAboveHighKey = true;
+		else
+			returnValue = appendLeaves(fileHandle, latches, attrType, entries.ptrs[i], depth - 1, highKey, numOfLeaves, leaves,
+					isAboveHighKey);
+	}
+
+	return returnValue;
+}
+
+/**
+ * this is a helper method used in scan initialization. if isInclusive is true, rid will be set to the smallest data
+ * entry which is greater than or equal to key. if isInclusive is false, rid will be set to the smallest data entry
+ * which is greater than key
+ */
+
+RC IndexManager::findSuccessorForStart(FileHandle &fileHandle, IndexLatches *latches, const void *key, AttrType type,
+		EID &entryId, bool isInclusive, uint64_t &version) {
+	RID rid;
+	bool isSuccess = false;
+	bool isNegOne = false;
+
+	int returnValue = BTreeSearch(fileHandle, latches, type, key, entryId, rid, isSuccess, isNegOne, version);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	if (isSuccess && !isInclusive) {
+		returnValue = findNextValidSlot(fileHandle, latches, entryId, version);
 	}
 
 	if (!isSuccess && !isNegOne) {
-		returnValue = findNextValidSlot(fileHandle, entryId);
+		returnValue = findNextValidSlot(fileHandle, latches, entryId, version);
 	}
 
-	delete slotPtr;
 	return returnValue;
 }
 
-RC IndexManager::findNextValidSlot(FileHandle &fileHandle, EID &entryId) {
+RC IndexManager::findNextValidSlot(FileHandle &fileHandle, IndexLatches *latches, EID &entryId, uint64_t &version) {
 	int returnValue = SUCCESS;
 	entryId.slotNum++;
 
 	char *page = (char *)malloc(PAGE_SIZE);
-	returnValue = fileHandle.readPage(entryId.pageNum, page);
+	returnValue = readValidPage(fileHandle, latches, entryId.pageNum, page, version);
 
 	if (returnValue != SUCCESS) {
 		free(page);
@@ -915,7 +2248,7 @@ RC IndexManager::findNextValidSlot(FileHandle &fileHandle, EID &entryId) {
 		else {
 			do {
 				entryId.pageNum = nextPage;
-				returnValue = fileHandle.readPage(entryId.pageNum, page);
+				returnValue = readValidPage(fileHandle, latches, entryId.pageNum, page, version);
 
 				if (returnValue != 0) {
 					free(page);
@@ -937,58 +2270,69 @@ RC IndexManager::findNextValidSlot(FileHandle &fileHandle, EID &entryId) {
 }
 
 
-int IndexManager::compare(const void *key, const void *data, AttrType attrType, int dataLength) {
-	// integer
-	if (attrType == TypeInt) {
-		int k = *(int *)key;
-		int v = *(int *)data;
-		return k - v;
-	}
-	// real
-	if (attrType == TypeReal) {
-		float k = *(float *)key;
-		float v = *(float *)data;
-
-		if (k - v > 0.00001)
-			return 1;
-		else if (k - v < -0.00001)
-			return -1;
-		else
-			return 0;
-	}
-	// var char
-	if (attrType == TypeVarChar) {
-		int stringLength;
-		memcpy(&stringLength, key, sizeof(int));
+/**
+ * Key comparators: "key" is a search key (varchars carry their length), "data" points at a key stored on a page
+ * (varchars without their length, which is "dataLength"). Keys on a page are not aligned, hence the memcpy.
+ */
+static inline int compareIntKey(const void *key, const char *data, int dataLength) {
+	int k, v;
+	memcpy(&k, key, sizeof(int));
+	memcpy(&v, data, sizeof(int));
+	return (k > v) - (k < v);
+}
 
-		string k((char *)key + sizeof(int), stringLength);
-		string v((char *)data, dataLength);
+static inline int compareRealKey(const void *key, const char *data, int dataLength) {
+	float k, v;
+	memcpy(&k, key, sizeof(float));
+	memcpy(&v, data, sizeof(float));
 
-		return k.compare(v);
-	}
+	if (k - v > 0.00001)
+		return 1;
+	else if (k - v < -0.00001)
+		return -1;
+	else
+		return 0;
+}
 
-	return -1;
+static inline int compareVarCharKey(const void *key, const char *data, int dataLength) {
+	int keyLength;
+	memcpy(&keyLength, key, sizeof(int));
+
+	int result = memcmp((const char *)key + sizeof(int), data, min(keyLength, dataLength));
+	if (result != 0)
+		return result;
+
+	return (keyLength > dataLength) - (keyLength < dataLength);
 }
 
+int IndexManager::compare(const void *key, const void *data, AttrType attrType, int dataLength) {
+	if (attrType == TypeInt)
+		return compareIntKey(key, (const char *)data, dataLength);
+	if (attrType == TypeReal)
+		return compareRealKey(key, (const char *)data, dataLength);
+	if (attrType == TypeVarChar)
+		return compareVarCharKey(key, (const char *)data, dataLength);
 
-short IndexManager::indexBinarySearch(const void *key, void *page, short numOfRecords, AttrType attrType) {
+	return -1;
+}
+
+/**
+ * Binary search over the slots of an index or leaf page, comparing against the keys in place. The comparator is
+ * a template argument so that each key type gets its own loop. Returns the slot of key, or its predecessor
+ * (-1 when key is smaller than every key on the page).
+ */
+template <class SlotType, int (*compareKey)(const void *, const char *, int)>
+static short binarySearch(const void *key, const char *page, size_t headerSize, short numOfRecords, bool &isEqual) {
+	const SlotType *slots = (const SlotType *)(page + headerSize);
 	short low = 0;
 	short high = numOfRecords - 1;
-	IndexSlot *midSlot;
 
 	while (low <= high) {
 		short mid = (low + high) / 2;
-
-		midSlot = goToIndexSlot((char *)page, mid);
-		int length = midSlot->length;
-
-		void *data = malloc(length);
-		memcpy(data, (char *)page + midSlot->offset, length);
-
-		int result = compare(key, data, attrType, length);
+		int result = compareKey(key, page + slots[mid].offset, slots[mid].length);
 
 		if (result == 0) {
-			free(data);
+			isEqual = true;
 			return mid;
 		}
 		else if (result < 0) {
@@ -997,47 +2341,114 @@ short IndexManager::indexBinarySearch(const void *key, void *page, short numOfRe
 		else {
 			low = mid + 1;
 		}
-
-		free(data);
 	}
 
+	isEqual = false;
 	return high;
 }
 
+template <class SlotType>
+static short binarySearch(const void *key, const char *page, size_t headerSize, short numOfRecords, AttrType attrType,
+		bool &isEqual) {
+	if (attrType == TypeInt)
+		return binarySearch<SlotType, compareIntKey>(key, page, headerSize, numOfRecords, isEqual);
+	if (attrType == TypeReal)
+		return binarySearch<SlotType, compareRealKey>(key, page, headerSize, numOfRecords, isEqual);
 
-short IndexManager::leafBinarySearch(const void *key, void *page, short numOfRecords, AttrType attrType, bool &isEqual) {
-	short low = 0;
-	short high = numOfRecords - 1;
-	LeafSlot *midSlot;
+	return binarySearch<SlotType, compareVarCharKey>(key, page, headerSize, numOfRecords, isEqual);
+}
 
-	while (low <= high) {
-		short mid = (low + high) / 2;
+// smallest float t such that (double)t >= -0.00001: k - v >= t is exactly "compareRealKey(k, v) >= 0" for floats
+static float realKeyThreshold() {
+	float threshold = -0.00001f;
+	if ((double)threshold < -0.00001)
+		threshold = nextafterf(threshold, 0.0f);
+	return threshold;
+}
 
-		midSlot = goToLeafSlot((char *)page, mid);
-		int length = midSlot->length;
+static const float REAL_KEY_THRESHOLD = realKeyThreshold();
 
-		void *data = malloc(length);
-		memcpy(data, (char *)page + midSlot->offset, length);
+/**
+ * Search of the sorted key array of a fixed width index page, with the same result as binarySearch: the number of
+ * keys not greater than key, minus one. Binary search narrows the range down to a few cache lines, whose keys are
+ * then counted four at a time with SSE2 compares, which every x86-64 has (a scalar loop elsewhere).
+ */
+template <class KeyType, int (*compareKey)(const void *, const char *, int)>
+static short fixedWidthSearch(const void *key, const char *keys, short numOfRecords) {
+	const short window = 32;
+	short low = 0;
+	short high = numOfRecords;
 
-		int result = compare(key, data, attrType, length);
+	// keys[0 .. low) are not greater than key, keys[high .. numOfRecords) are
+	while (high - low > window) {
+		short mid = (low + high) / 2;
+		if (compareKey(key, keys + mid * sizeof(KeyType), sizeof(KeyType)) >= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
 
-		if (result == 0) {
-			isEqual = true;
-			free(data);
-			return mid;
+	short count = low;
+	short i = low;
+#ifdef __SSE2__
+	if (is_integral<KeyType>::value) {
+		int k;
+		memcpy(&k, key, sizeof(int));
+		__m128i searchKey = _mm_set1_epi32(k);
+		for (; i + 4 <= high; i += 4) {
+			__m128i greater = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(keys + i * sizeof(int))), searchKey);
+			count += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(greater)));
 		}
-		else if (result < 0) {
-			high = mid - 1;
-		}
-		else {
-			low = mid + 1;
+	}
+	else {
+		float k;
+		memcpy(&k, key, sizeof(float));
+		__m128 searchKey = _mm_set1_ps(k);
+		__m128 threshold = _mm_set1_ps(REAL_KEY_THRESHOLD);
+		for (; i + 4 <= high; i += 4) {
+			__m128 difference = _mm_sub_ps(searchKey, _mm_loadu_ps((const float *)(keys + i * sizeof(float))));
+			count += __builtin_popcount(_mm_movemask_ps(_mm_cmpge_ps(difference, threshold)));
 		}
+	}
+#endif
+	for (; i < high; i++) {
+		if (compareKey(key, keys + i * sizeof(KeyType), sizeof(KeyType)) >= 0)
+			count++;
+	}
+
+	return count - 1;
+}
+
+short IndexManager::indexBinarySearch(const void *key, void *page, short numOfRecords, AttrType attrType) {
+	if (attrType == TypeInt)
+		return fixedWidthSearch<int, compareIntKey>(key, goToIndexKeys((char *)page), numOfRecords);
+	if (attrType == TypeReal)
+		return fixedWidthSearch<float, compareRealKey>(key, goToIndexKeys((char *)page), numOfRecords);
+
+	bool isEqual;
+	return binarySearch<IndexSlot>(key, (const char *)page, sizeof(IndexHeader), numOfRecords, attrType, isEqual);
+}
 
-		free(data);
+short IndexManager::leafBinarySearch(const void *key, void *page, short numOfRecords, AttrType attrType, bool &isEqual) {
+	short prefixLength = ((LeafHeader *)page)->prefixLength;
+	if (prefixLength == 0)
+		return binarySearch<LeafSlot>(key, (const char *)page, sizeof(LeafHeader), numOfRecords, attrType, isEqual);
+
+	// a key without the prefix of the page is before or after all of its keys, otherwise its rest is searched for
+	int keyLength;
+	memcpy(&keyLength, key, sizeof(int));
+	const char *keyData = (const char *)key + sizeof(int);
+	int result = memcmp(keyData, goToLeafPrefix((char *)page), min(keyLength, (int)prefixLength));
+
+	if (result != 0 || keyLength < prefixLength) {
+		isEqual = false;
+		return result > 0 ? numOfRecords - 1 : -1;
 	}
 
-	isEqual = false;
-	return high;
+	int suffixLength = keyLength - prefixLength;
+	string suffix((const char *)&suffixLength, sizeof(int));
+	suffix.append(keyData + prefixLength, suffixLength);
+	return binarySearch<LeafSlot>(suffix.data(), (const char *)page, sizeof(LeafHeader), numOfRecords, attrType, isEqual);
 }
 
 
@@ -1052,18 +2463,19 @@ void IndexManager::reorgLeafPage(void *page) {
 
 	LeafSlot *slotPtr = goToLeafSlot((char *)page, 0);
 	LeafSlot *copySlotPtr = goToLeafSlot(copyPage, 0);
-	short offset = PAGE_SIZE;
-	short freeSpace = PAGE_SIZE - sizeof(LeafHeader);
+	// below the prefix of the page
+	short offset = PAGE_SIZE - headerPtr->prefixLength;
+	short freeSpace = PAGE_SIZE - sizeof(LeafHeader) - headerPtr->prefixLength;
 
 	for (short i = 0; i < numOfRecords; i++) {
 		// decrement the free space offset
-		offset -= slotPtr->length;
-		// copy key
-		memcpy(copyPage + offset, (char *)page + slotPtr->offset, slotPtr->length);
+		offset -= slotPtr->length + slotPtr->postingLength;
+		// copy key and posting list
+		memcpy(copyPage + offset, (char *)page + slotPtr->offset, slotPtr->length + slotPtr->postingLength);
 		// change the start offset
 		copySlotPtr->offset = offset;
 		// update free space
-		freeSpace -= slotPtr->length + sizeof(LeafSlot);
+		freeSpace -= slotPtr->length + slotPtr->postingLength + sizeof(LeafSlot);
 
 		// increment the slot pointer
 		slotPtr++;
@@ -1090,7 +2502,7 @@ void IndexManager::reorgIndexPage(void *page) {
 	IndexSlot *slotPtr = goToIndexSlot((char *)page, 0);
 	IndexSlot *copySlotPtr = goToIndexSlot(copyPage, 0);
 	short offset = PAGE_SIZE;
-	short freeSpace = PAGE_SIZE - sizeof(LeafHeader);
+	short freeSpace = PAGE_SIZE - sizeof(IndexHeader);
 
 	for (short i = 0; i < numOfRecords; i++) {
 		// decrement the free space offset
@@ -1127,51 +2539,450 @@ RC IndexManager::scan(FileHandle &fileHandle,
     if(fileHandle.getFile() == NULL) {
         return -1;
     }
-    
-	int returnValue = 0;
-	EID startEid;
-	EID endEid;
 
-	/**
-	 * data entries scanned should be >= startRid && < endRid
-	 * which means startRid will be set to the first qualified eid
-	 * and endRid will be set to one eid after the last qualified eid
-	 *
-	 */
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	if (latches == NULL)
+		return -1;
 
-	// find the starting data entry
-	if (lowKey == NULL) {
-		startEid.pageNum = LEFT_MOST_PAGE_NUM;
-		startEid.slotNum = -1;
+	// the iterator finds the starting data entry and stops at the first entry above highKey
+	return ix_ScanIterator.initialize(fileHandle, latches, attribute.type, lowKey, lowKeyInclusive, highKey, highKeyInclusive);
+}
 
-		returnValue = findNextValidSlot(fileHandle, startEid);
+/**
+ * The entries of a sorter in the order bulkLoad builds posting lists from. The sorter orders reals exactly, then by rid,
+ * while the tree takes the reals within the tolerance of compareRealKey of the first one of a run as one key: the
+ * entries of such a run are returned ordered by rid, all with the key of the first one. Other keys pass through.
+ */
+class BulkLoadReader {
+public:
+	BulkLoadReader(IX_ExternalSorter &sorter, AttrType attrType) : sorter(sorter), attrType(attrType), nextPosting(0),
+			hasAhead(false) {}
+
+	bool getNextEntry(RID &rid, char *key, char *payload, short &payloadLength) {
+		if (attrType != TypeReal)
+			return sorter.getNextEntry(rid, key, payload, payloadLength) != IX_EOF;
+
+		if (nextPosting == run.size() && !readRun())
+			return false;
+
+		Posting &posting = run[nextPosting++];
+		rid = posting.rid;
+		memcpy(key, &runKey, sizeof(float));
+		payloadLength = posting.payload.size();
+		memcpy(payload, posting.payload.data(), payloadLength);
+		return true;
 	}
-	else {
-		returnValue = findSuccessorForStart(fileHandle, lowKey, attribute.type, startEid, lowKeyInclusive);
+
+private:
+	IX_ExternalSorter &sorter;
+	AttrType attrType;
+	vector<Posting> run;
+	unsigned nextPosting;
+	float runKey;
+
+	// the first entry after the run, read ahead
+	bool hasAhead;
+	Posting ahead;
+	float aheadKey;
+
+	bool readAhead() {
+		char payload[PAGE_SIZE];
+		short payloadLength;
+		hasAhead = sorter.getNextEntry(ahead.rid, (char *)&aheadKey, payload, payloadLength) != IX_EOF;
+		if (hasAhead)
+			ahead.payload.assign(payload, payloadLength);
+		return hasAhead;
 	}
 
-	if (returnValue != 0)
+	bool readRun() {
+		run.clear();
+		nextPosting = 0;
+		if (!hasAhead && !readAhead())
+			return false;
+
+		runKey = aheadKey;
+		do {
+			run.push_back(ahead);
+		} while (readAhead() && compareRealKey(&aheadKey, (const char *)&runKey, sizeof(float)) == 0);
+
+		std::stable_sort(run.begin(), run.end(), [](const Posting &a, const Posting &b) { return isRidLess(a.rid, b.rid); });
+		return true;
+	}
+};
+
+RC IndexManager::bulkLoad(FileHandle &fileHandle, const Attribute &attribute, IX_ExternalSorter &sorter, const short fillFactor) {
+	if (fileHandle.getFile() == NULL || fillFactor < MIN_FILL_FACTOR || fillFactor > 100)
+		return -1;
+
+	IndexLatches *latches = getLatches(fileHandle.getFileName());
+	if (latches == NULL)
+		return -1;
+
+	// a hash index has no order to build from, the entries are inserted
+	if (latches->indexType == HashIndex) {
+		HashIndexManager *hashIndexManager = HashIndexManager::instance();
+		char *key = (char *)malloc(PAGE_SIZE);
+		char *payload = (char *)malloc(PAGE_SIZE);
+		short payloadLength;
+		RID rid;
+		int returnValue = SUCCESS;
+
+		while (returnValue == SUCCESS && sorter.getNextEntry(rid, key, payload, payloadLength) != IX_EOF) {
+			returnValue = hashIndexManager->insertEntry(fileHandle, latches, attribute.type, key, rid, payload, payloadLength);
+			// the same entry twice is loaded once, as into a B+ tree
+			if (returnValue == 3)
+				returnValue = SUCCESS;
+		}
+
+		free(key);
+		free(payload);
 		return returnValue;
+	}
+
+	// only a just created index can be bulk loaded: root page 1 over the empty leftmost leaf
+	if (latches->rootPage.load() != 1 || fileHandle.getNumberOfPages() != LEFT_MOST_PAGE_NUM + 1)
+		return -1;
+
+	int returnValue = SUCCESS;
+	char *leafPage = (char *)malloc(PAGE_SIZE);
+	LeafHeader *leafHeader = (LeafHeader *)leafPage;
 
-	// find the ending data entry
-	if (highKey == NULL) {
-		endEid.pageNum = NO_PAGE;
-		endEid.slotNum = 0;
+	returnValue = fileHandle.readPage(LEFT_MOST_PAGE_NUM, leafPage);
+	if (returnValue != SUCCESS || leafHeader->numOfRecords != 0) {
+		free(leafPage);
+		return -1;
 	}
-	else {
-		returnValue = findSuccessorForEnd(fileHandle, highKey, attribute.type, endEid, highKeyInclusive);
+
+	short leafCapacity = (PAGE_SIZE - sizeof(LeafHeader)) * fillFactor / 100;
+	short overflowCapacity = (PAGE_SIZE - sizeof(OverflowHeader)) * fillFactor / 100;
+
+	// the leaves become the children of the first index level, each one keyed by its separator from the leaf before
+	vector<unsigned> children;
+	vector<string> keys;
+	unsigned currentPageNo = LEFT_MOST_PAGE_NUM;
+	children.push_back(currentPageNo);
+	keys.push_back(string());
+
+	char *key = (char *)malloc(PAGE_SIZE);
+	char *payload = (char *)malloc(PAGE_SIZE);
+	short payloadLength;
+	RID rid;
+
+	// the posting list of lastKey: on the leaf while it is short, then on overflow pages appended one after the other
+	// from firstOverflowPage, "postings" holding the page being filled
+	char *overflowPage = (char *)malloc(PAGE_SIZE);
+	OverflowHeader *overflowHeader = (OverflowHeader *)overflowPage;
+	string lastKey;
+	bool hasLastKey = false;
+	string postings;
+	RID prevRid;
+	short numOfRids = 0;
+	unsigned firstOverflowPage = NO_PAGE;
+
+	// the entries of the leaf being filled, leafSize bytes with their keys in full
+	vector<LeafEntry> leafEntries;
+	int leafSize = 0;
+
+	BulkLoadReader reader(sorter, attribute.type);
+	while (returnValue == SUCCESS) {
+		bool hasEntry = reader.getNextEntry(rid, key, payload, payloadLength);
+		int keyLength = hasEntry ? getKeyLength(key, attribute.type) : 0;
+		char *keyData = attribute.type == TypeVarChar ? key + sizeof(int) : key;
+
+		if (hasEntry && hasLastKey && compare(key, lastKey.data(), attribute.type, lastKey.size()) == 0) {
+			// the same entry twice: one rid under keys the tree takes as equal, as insertEntry would refuse it
+			if (!isRidLess(prevRid, rid))
+				continue;
+
+			string posting;
+			RID lastRid = prevRid;
+			appendPosting(posting, prevRid, rid, payload, payloadLength);
+
+			// the list is too long for the leaf, it becomes the first overflow page
+			if (firstOverflowPage == NO_PAGE && postings.size() + posting.size() > MAX_INLINE_POSTING_LENGTH)
+				firstOverflowPage = fileHandle.getNumberOfPages();
+
+			// the overflow page is full, the next one is appended right after it
+			if (firstOverflowPage != NO_PAGE && (int)(postings.size() + posting.size()) > overflowCapacity && numOfRids > 0) {
+				overflowHeader->pageType = Overflow;
+				overflowHeader->numOfRids = numOfRids;
+				overflowHeader->postingLength = postings.size();
+				overflowHeader->nextOverFlowPage = fileHandle.getNumberOfPages() + 1;
+				overflowHeader->lastRid = lastRid;
+				memcpy(overflowPage + sizeof(OverflowHeader), postings.data(), postings.size());
+				returnValue = fileHandle.appendPage(overflowPage);
+
+				postings.clear();
+				posting.clear();
+				numOfRids = 0;
+				prevRid.pageNum = 0;
+				prevRid.slotNum = 0;
+				appendPosting(posting, prevRid, rid, payload, payloadLength);
+			}
+
+			postings.append(posting);
+			numOfRids++;
+			continue;
+		}
+
+		// a new key (or the end): the entry of the last key goes to the leaf, after the last page of its list
+		if (hasLastKey && firstOverflowPage != NO_PAGE) {
+			overflowHeader->pageType = Overflow;
+			overflowHeader->numOfRids = numOfRids;
+			overflowHeader->postingLength = postings.size();
+			overflowHeader->nextOverFlowPage = NO_PAGE;
+			overflowHeader->lastRid = prevRid;
+			memcpy(overflowPage + sizeof(OverflowHeader), postings.data(), postings.size());
+			returnValue = fileHandle.appendPage(overflowPage);
+			postings.clear();
+		}
+
+		if (hasLastKey && returnValue == SUCCESS) {
+			LeafEntry entry;
+			entry.key = lastKey;
+			entry.postings = postings;
+			entry.overflowPage = firstOverflowPage;
+
+			// the keys of the leaf share the prefix of its first one and of lastKey, stored once
+			int dataEntrySize = getLeafEntrySize(entry, 0);
+			short prefixLength = leafEntries.empty() ? 0 : getCommonPrefixLength(leafEntries.front().key, lastKey, attribute.type);
+			int usedSpace = leafSize + dataEntrySize - leafEntries.size() * prefixLength;
+
+			// the leaf is full: it is written, linked to the next leaf whose page is appended now, before the
+			// overflow pages of its entries
+			if (!leafEntries.empty() && usedSpace > leafCapacity) {
+				unsigned nextPageNo = fileHandle.getNumberOfPages();
+				memset(overflowPage, 0, PAGE_SIZE);
+				returnValue = fileHandle.appendPage(overflowPage);
+
+				leafHeader->nextPage = nextPageNo;
+				writeLeafEntries(leafPage, leafEntries, 0, leafEntries.size(), attribute.type);
+				if (returnValue == SUCCESS)
+					returnValue = fileHandle.writePage(currentPageNo, leafPage);
+
+				leafHeader->pageType = Leaf;
+				leafHeader->nextOverFlowPage = NO_PAGE;
+				leafHeader->nextPage = NO_PAGE;
+				leafHeader->prevPage = currentPageNo;
+
+				currentPageNo = nextPageNo;
+				children.push_back(currentPageNo);
+				keys.push_back(getSeparator(leafEntries.back().key, lastKey, attribute.type));
+				leafEntries.clear();
+				leafSize = 0;
+			}
+
+			leafEntries.push_back(entry);
+			leafSize += dataEntrySize;
+		}
+
+		if (!hasEntry)
+			break;
+
+		lastKey.assign(keyData, keyLength);
+		hasLastKey = true;
+		postings.clear();
+		prevRid.pageNum = 0;
+		prevRid.slotNum = 0;
+		appendPosting(postings, prevRid, rid, payload, payloadLength);
+		numOfRids = 1;
+		firstOverflowPage = NO_PAGE;
 	}
 
-	if (returnValue != 0)
+	// the last leaf
+	if (returnValue == SUCCESS) {
+		writeLeafEntries(leafPage, leafEntries, 0, leafEntries.size(), attribute.type);
+		returnValue = fileHandle.writePage(currentPageNo, leafPage);
+	}
+
+	free(key);
+	free(payload);
+	free(overflowPage);
+	free(leafPage);
+
+	if (returnValue != SUCCESS)
 		return returnValue;
 
-	return ix_ScanIterator.initialize(fileHandle, startEid, endEid, attribute.type);
+	// the empty root may have been pinned
+	returnValue = buildIndexLevels(fileHandle, attribute.type, children, keys, fillFactor);
+	unpinAllPages(latches);
+	return returnValue;
 }
 
-IX_ScanIterator::IX_ScanIterator() : attrType(TypeInt)
+/**
+ * Builds the index levels above "children" (keys[i] is the smallest key under children[i], keys[0] is unused).
+ * Each level is packed up to fillFactor percent and appended; the first child of every node but the first one
+ * is pushed up with its key. The level which fits in a single node is written to the root page 1.
+ */
+RC IndexManager::buildIndexLevels(FileHandle &fileHandle, AttrType attrType, vector<unsigned> &children, vector<string> &keys,
+		short fillFactor) {
+	int returnValue = SUCCESS;
+	short capacity = (PAGE_SIZE - sizeof(IndexHeader)) * fillFactor / 100;
+	char *page = (char *)malloc(PAGE_SIZE);
+	IndexHeader *indexHeader = (IndexHeader *)page;
+
+	while (returnValue == SUCCESS) {
+		// split this level into nodes: node n holds children[nodeStarts[n]] .. children[nodeStarts[n + 1] - 1]
+		vector<unsigned> nodeStarts;
+		short usedSpace = 0;
+		for (unsigned i = 0; i < children.size(); i++) {
+			short dataEntrySize = getIndexEntrySize(keys[i].size(), attrType);
+
+			if (i == 0 || (usedSpace + dataEntrySize > capacity && i != nodeStarts.back() + 1)) {
+				nodeStarts.push_back(i);
+				usedSpace = 0;
+			}
+			else {
+				usedSpace += dataEntrySize;
+			}
+		}
+		nodeStarts.push_back(children.size());
+
+		bool isRoot = nodeStarts.size() == 2;
+		unsigned pageNo = fileHandle.getNumberOfPages();
+		vector<unsigned> parents;
+		vector<string> parentKeys;
+
+		for (unsigned n = 0; n + 1 < nodeStarts.size() && returnValue == SUCCESS; n++) {
+			indexHeader->pageType = Index;
+			indexHeader->numOfRecords = 0;
+			indexHeader->freeSpace = PAGE_SIZE - sizeof(IndexHeader);
+			indexHeader->freeSpaceOffset = PAGE_SIZE;
+			indexHeader->firstPtr = children[nodeStarts[n]];
+
+			for (unsigned i = nodeStarts[n] + 1; i < nodeStarts[n + 1]; i++)
+				appendEntryToIndexPage(page, keys[i].data(), keys[i].size(), children[i], attrType);
+
+			if (isRoot) {
+				returnValue = fileHandle.writePage(1, page);
+			}
+			else {
+				returnValue = fileHandle.appendPage(page);
+				parents.push_back(pageNo++);
+				parentKeys.push_back(keys[nodeStarts[n]]);
+			}
+		}
+
+		if (isRoot)
+			break;
+
+		children.swap(parents);
+		keys.swap(parentKeys);
+	}
+
+	free(page);
+	return returnValue;
+}
+
+/**
+ * A composite key is the concatenation of its encoded values. An int or a real takes 4 big-endian bytes with the sign
+ * bit flipped (every bit for a negative real), a varchar its characters with each 0 byte followed by 0xFF, then 0 0.
+ * Each value is ordered by its bytes and none is the beginning of another, so memcmp orders the keys by their values.
+ */
+Attribute IndexManager::getCompositeAttribute(const vector<Attribute> &attributes) {
+	Attribute compositeAttribute;
+	compositeAttribute.type = TypeVarChar;
+	compositeAttribute.length = 0;
+
+	for (unsigned i = 0; i < attributes.size(); i++) {
+		if (i > 0)
+			compositeAttribute.name += COMPOSITE_KEY_SEPARATOR;
+		compositeAttribute.name += attributes[i].name;
+		compositeAttribute.length += attributes[i].type == TypeVarChar ? 2 * attributes[i].length + 2 : sizeof(int);
+	}
+
+	return compositeAttribute;
+}
+
+RC IndexManager::prepareCompositeKey(const vector<Attribute> &attributes, const void *values, unsigned numOfValues,
+		bool isPrefixEnd, void *key) {
+	if (numOfValues > attributes.size())
+		return -1;
+
+	string encoded;
+	const char *value = (const char *)values;
+	for (unsigned i = 0; i < numOfValues; i++) {
+		if (attributes[i].type == TypeVarChar) {
+			int length = *(const int *)value;
+			value += sizeof(int);
+			for (int j = 0; j < length; j++) {
+				encoded += value[j];
+				if (value[j] == '\0')
+					encoded += (char)0xFF;
+			}
+			encoded.append(2, '\0');
+			value += length;
+			continue;
+		}
+
+		unsigned bits;
+		memcpy(&bits, value, sizeof(unsigned));
+		if (attributes[i].type == TypeInt) {
+			bits ^= 0x80000000;
+		}
+		else {
+			if (bits == 0x80000000) // -0.0
+				bits = 0;
+			bits = (bits & 0x80000000) ? ~bits : bits ^ 0x80000000;
+		}
+		for (int shift = 24; shift >= 0; shift -= 8)
+			encoded += (char)(bits >> shift);
+		value += sizeof(unsigned);
+	}
+
+	// the end of the prefix: its last byte below 0xFF incremented, the bytes after it dropped
+	if (isPrefixEnd) {
+		while (!encoded.empty() && (unsigned char)encoded.back() == 0xFF)
+			encoded.pop_back();
+		if (encoded.empty())
+			return -1;
+		encoded.back()++;
+	}
+
+	int keyLength = (int)encoded.size();
+	memcpy(key, &keyLength, sizeof(int));
+	memcpy((char *)key + sizeof(int), encoded.data(), keyLength);
+	return SUCCESS;
+}
+
+int IndexManager::readCompositeKey(const vector<Attribute> &attributes, const void *key, void *values) {
+	const unsigned char *encoded = (const unsigned char *)key + sizeof(int);
+	char *value = (char *)values;
+
+	for (unsigned i = 0; i < attributes.size(); i++) {
+		if (attributes[i].type == TypeVarChar) {
+			int length = 0;
+			for (; encoded[0] != 0 || encoded[1] != 0; encoded += encoded[0] == 0 ? 2 : 1)
+				value[sizeof(int) + length++] = encoded[0];
+			encoded += 2;
+			memcpy(value, &length, sizeof(int));
+			value += sizeof(int) + length;
+			continue;
+		}
+
+		unsigned bits = (unsigned)encoded[0] << 24 | (unsigned)encoded[1] << 16 | (unsigned)encoded[2] << 8 | encoded[3];
+		if (attributes[i].type == TypeInt)
+			bits ^= 0x80000000;
+		else
+			bits = (bits & 0x80000000) ? bits ^ 0x80000000 : ~bits;
+		memcpy(value, &bits, sizeof(unsigned));
+		encoded += sizeof(unsigned);
+		value += sizeof(unsigned);
+	}
+
+	return (int)(value - (char *)values);
+}
+
+IX_ScanIterator::IX_ScanIterator() : attrType(TypeInt), latches(NULL), pageVersion(0), keyData(NULL), keyLength(0),
+		postingData(NULL), postingEnd(NULL),
+		nextPageStart(0), nextPageData(NULL), hasResumeKey(false), resumeInclusive(false), startSlot(0), hasHighKey(false), highKeyInclusive(false),
+		nextLeaf(0), prefetchEnd(0), hasLastLeaf(false), isHash(false), bucketOffset(0), nextHashValue(0), endHashValue(0),
+		nextKeyHashValue(0)
 {
 	page = (char *)malloc(PAGE_SIZE);
 	headerPtr = (LeafHeader *)page;
+	currentEid.pageNum = NO_PAGE;
+	currentEid.slotNum = 0;
 }
 
 IX_ScanIterator::~IX_ScanIterator()
@@ -1181,65 +2992,310 @@ IX_ScanIterator::~IX_ScanIterator()
 
 RC IX_ScanIterator::getNextEntry(RID &rid, void *key)
 {
-	int returnValue = 0;
+	short payloadLength;
+	return getNextEntry(rid, key, NULL, payloadLength);
+}
 
-	// check to see if reaching the end of file
-	if (currentEid.pageNum == NO_PAGE)
-		return IX_EOF;
+RC IX_ScanIterator::getNextEntry(RID &rid, void *key, void *payload, short &payloadLength)
+{
+	if (isHash)
+		return getNextHashEntry(rid, key, payload, payloadLength);
+
+	while (postingData == postingEnd) {
+		// move to the next leaf which has an entry left
+		while (currentEid.pageNum != NO_PAGE && currentEid.slotNum >= (unsigned)headerPtr->numOfRecords) {
+			int returnValue = moveToNextPage();
+			if (returnValue != SUCCESS)
+				return returnValue;
+		}
 
-	if (currentEid.pageNum == stopEid.pageNum && currentEid.slotNum == stopEid.slotNum)
-		return IX_EOF;
+		// check to see if reaching the end of file
+		if (currentEid.pageNum == NO_PAGE)
+			return IX_EOF;
 
-	// read data entry
-	LeafSlot *slotPtr = (LeafSlot *)(page + sizeof(LeafHeader) + currentEid.slotNum * sizeof(LeafSlot));
-	short offset = slotPtr->offset;
-	short length = slotPtr->length;
+		// point at the key and the posting list of the slot, and move past the slot
+		LeafSlot *slotPtr = (LeafSlot *)(page + sizeof(LeafHeader) + currentEid.slotNum * sizeof(LeafSlot));
+		if (headerPtr->prefixLength == 0) {
+			keyData = page + slotPtr->offset;
+			keyLength = slotPtr->length;
+		}
+		else {
+			// currentKey starts with the prefix since the page was read
+			currentKey.replace(headerPtr->prefixLength, string::npos, page + slotPtr->offset, slotPtr->length);
+			keyData = currentKey.data();
+			keyLength = currentKey.size();
+		}
 
-	if (attrType == TypeInt) {
-		memcpy(key, page + offset, length);
-	}
-	if (attrType == TypeReal) {
-		memcpy(key, page + offset, length);
+		if (hasHighKey) {
+			int result = IndexManager::instance()->compare(highKey.data(), keyData, attrType, keyLength);
+			if (result < 0 || (result == 0 && !highKeyInclusive)) {
+				currentEid.pageNum = NO_PAGE;
+				return IX_EOF;
+			}
+		}
+
+		postingData = page + slotPtr->offset + slotPtr->length;
+		postingEnd = postingData + slotPtr->postingLength;
+		postingRid.pageNum = 0;
+		postingRid.slotNum = 0;
+		nextPageData = NULL;
+		currentEid.slotNum++;
+
+		if (slotPtr->overflowPage != NO_PAGE) {
+			int returnValue = readOverflowPostings(slotPtr->overflowPage);
+			if (returnValue != SUCCESS)
+				return returnValue;
+		}
 	}
+
 	if (attrType == TypeVarChar) {
-		int stringLength = length;
+		int stringLength = keyLength;
 		memcpy(key, &stringLength, sizeof(int));
-		memcpy((char *)key + sizeof(int), page + offset, stringLength);
+		memcpy((char *)key + sizeof(int), keyData, stringLength);
+	}
+	else {
+		memcpy(key, keyData, keyLength);
 	}
 
-	rid.pageNum = slotPtr->pageNum;
-	rid.slotNum = slotPtr->slotNum;
-
-	// move currentPtr to next valid position, update void *page and headerPtr
-	currentEid.slotNum++;
-	if (currentEid.slotNum >= (unsigned)headerPtr->numOfRecords) {
-		currentEid.slotNum = 0;
-		unsigned nextPage = headerPtr->nextPage;
+	// the next overflow page starts
+	if (postingData == nextPageData) {
+		postingRid.pageNum = 0;
+		postingRid.slotNum = 0;
+		nextPageStart++;
+		nextPageData = nextPageStart < pageStarts.size() ? overflowPostings.data() + pageStarts[nextPageStart] : NULL;
+	}
 
-		// a "real" page
-		if (nextPage != NO_PAGE) {
-			// find the first page which has nonzero data entry
-			do {
-				currentEid.pageNum = nextPage;
-				returnValue = fileHandle.readPage(currentEid.pageNum, page);
+	const char *payloadData;
+	postingData = readPosting(postingData, postingRid, payloadData, payloadLength);
+	rid = postingRid;
+	if (payload != NULL)
+		memcpy(payload, payloadData, payloadLength);
 
-				if (returnValue != 0)
-					return returnValue;
+	return SUCCESS;
+}
 
-				headerPtr = (LeafHeader *)page;
-				nextPage = headerPtr->nextPage;
+// the entries of a bucket are read at once, then those in the range are returned
+RC IX_ScanIterator::getNextHashEntry(RID &rid, void *key, void *payload, short &payloadLength)
+{
+	IndexManager *indexManager = IndexManager::instance();
+
+	while (true) {
+		while (bucketOffset >= bucketEntries.size()) {
+			uint64_t hashValue = nextHashValue;
+			if (!keyHashValues.empty()) {
+				if (nextKeyHashValue == keyHashValues.size())
+					return IX_EOF;
+				hashValue = keyHashValues[nextKeyHashValue++];
 			}
-			while (headerPtr->numOfRecords == 0 && nextPage != NO_PAGE);
+			else if (nextHashValue >= endHashValue)
+				return IX_EOF;
 
-			// if all the following pages have no data entries, reaches the end of the file
-			if (headerPtr->numOfRecords == 0 && nextPage == NO_PAGE)
-				currentEid.pageNum = NO_PAGE;
+			int returnValue = HashIndexManager::instance()->readBucket(fileHandle, latches, hashValue, bucketEntries,
+					nextHashValue);
+			if (returnValue != SUCCESS)
+				return returnValue;
+			bucketOffset = 0;
+		}
+
+		HashEntryHeader header;
+		memcpy(&header, bucketEntries.data() + bucketOffset, sizeof(HashEntryHeader));
+		const char *entryKey = bucketEntries.data() + bucketOffset + sizeof(HashEntryHeader);
+		bucketOffset += sizeof(HashEntryHeader) + header.keyLength + header.payloadLength;
+
+		// the bucket read for one hash value of the key may be the bucket of the other one too
+		if (!keyHashValues.empty() && header.hashValue != keyHashValues[nextKeyHashValue - 1])
+			continue;
+
+		if (hasResumeKey) {
+			int result = indexManager->compare(resumeKey.data(), entryKey, attrType, header.keyLength);
+			if (result > 0 || (result == 0 && !resumeInclusive))
+				continue;
+		}
+		if (hasHighKey) {
+			int result = indexManager->compare(highKey.data(), entryKey, attrType, header.keyLength);
+			if (result < 0 || (result == 0 && !highKeyInclusive))
+				continue;
+		}
+
+		if (attrType == TypeVarChar) {
+			int stringLength = header.keyLength;
+			memcpy(key, &stringLength, sizeof(int));
+			memcpy((char *)key + sizeof(int), entryKey, stringLength);
+		}
+		else {
+			memcpy(key, entryKey, header.keyLength);
+		}
+
+		rid = header.rid;
+		payloadLength = header.payloadLength;
+		if (payload != NULL)
+			memcpy(payload, entryKey + header.keyLength, payloadLength);
+		return SUCCESS;
+	}
+}
+
+// point at the posting list on the overflow pages from firstPage, or find the key again when its leaf changed meanwhile
+RC IX_ScanIterator::readOverflowPostings(unsigned firstPage)
+{
+	int returnValue = IndexManager::instance()->readOverflowPages(fileHandle, firstPage, overflowPostings, pageStarts);
+	if (returnValue == SUCCESS && !isLatchValid(getPageLatch(latches, currentEid.pageNum), pageVersion)) {
+		resumeKey.clear();
+		if (attrType == TypeVarChar)
+			resumeKey.assign((const char *)&keyLength, sizeof(int));
+		resumeKey.append(keyData, keyLength);
+		resumeInclusive = true;
+		hasResumeKey = true;
+		postingData = postingEnd = NULL;
+		return findResumeKey();
+	}
+
+	postingData = overflowPostings.data();
+	postingEnd = postingData + (returnValue == SUCCESS ? overflowPostings.size() : 0);
+	nextPageStart = 0;
+	if (!pageStarts.empty())
+		nextPageData = postingData + pageStarts[0];
+	return returnValue;
+}
+
+RC IX_ScanIterator::moveToNextPage()
+{
+	unsigned pageNum = currentEid.pageNum;
+	unsigned nextPage = headerPtr->nextPage;
+
+	if (currentEid.slotNum > startSlot) {
+		LeafSlot *slotPtr = (LeafSlot *)(page + sizeof(LeafHeader) + (currentEid.slotNum - 1) * sizeof(LeafSlot));
+		int length = headerPtr->prefixLength + slotPtr->length;
+		resumeKey.clear();
+		if (attrType == TypeVarChar)
+			resumeKey.assign((char *)&length, sizeof(int));
+		resumeKey.append(page + PAGE_SIZE - headerPtr->prefixLength, headerPtr->prefixLength);
+		resumeKey.append(page + slotPtr->offset, slotPtr->length);
+		resumeInclusive = false;
+		hasResumeKey = true;
+	}
+
+	if (nextPage == NO_PAGE) {
+		currentEid.pageNum = NO_PAGE;
+		return SUCCESS;
+	}
+
+	prefetchLeaves(nextPage);
+	int returnValue = readPage(nextPage, 0);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// still the next leaf: skip the entries already returned, a merge may have moved them here
+	if (headerPtr->pageType == Leaf && headerPtr->prevPage == pageNum) {
+		if (hasResumeKey && headerPtr->numOfRecords > 0) {
+			bool isEqual;
+			short slotNum = IndexManager::instance()->leafBinarySearch(resumeKey.data(), page, headerPtr->numOfRecords,
+					attrType, isEqual);
+			currentEid.slotNum = startSlot = isEqual && resumeInclusive ? slotNum : slotNum + 1;
+		}
+		return SUCCESS;
+	}
+
+	// the leaves changed since the current one was read, find the first entry not returned yet
+	return findResumeKey();
+}
+
+// nextPage comes at most SCAN_PREFETCH_GAP pages after pageNum
+static bool isNearLeaf(unsigned pageNum, unsigned nextPage)
+{
+	return nextPage > pageNum && nextPage - pageNum <= SCAN_PREFETCH_GAP + 1;
+}
+
+/**
+ * Keeps the reads of the SCAN_PREFETCH_LEAVES leaves after nextPage issued. The leaves are looked up again through
+ * their parents when fewer are left, starting from the last key returned; a list which does not go on with nextPage
+ * (the leaves changed) is dropped.
+ */
+void IX_ScanIterator::prefetchLeaves(unsigned nextPage)
+{
+	if (nextLeaf < nextLeaves.size() && nextLeaves[nextLeaf] == nextPage)
+		nextLeaf++;
+	else {
+		nextLeaves.clear();
+		nextLeaf = prefetchEnd = 0;
+		hasLastLeaf = false;
+	}
+
+	if (nextLeaves.size() - nextLeaf < SCAN_PREFETCH_LEAVES && !hasLastLeaf && hasResumeKey) {
+		vector<unsigned> leaves;
+		unsigned numOfLeaves = 4 * SCAN_PREFETCH_LEAVES;
+		RC returnValue = IndexManager::instance()->getNextLeaves(fileHandle, latches, attrType, resumeKey.data(),
+				hasHighKey ? highKey.data() : NULL, numOfLeaves, leaves);
+
+		if (returnValue == SUCCESS && !leaves.empty() && leaves[0] == nextPage) {
+			// the reads issued before stay issued
+			unsigned issued = nextLeaf == 0 ? 0 : prefetchEnd - (nextLeaf - 1);
+			nextLeaves.swap(leaves);
+			nextLeaf = 1;
+			prefetchEnd = max(issued, nextLeaf);
+			hasLastLeaf = nextLeaves.size() < numOfLeaves;
+		}
+	}
+
+	// reads are issued half a window at a time, so that leaves close to each other in the file take one read
+	if (prefetchEnd >= nextLeaf + SCAN_PREFETCH_LEAVES / 2)
+		return;
+
+	// a leaf right after the one before it in the file is left to the read-ahead of the file system, only the runs of
+	// leaves starting somewhere else are read
+	unsigned end = min((unsigned)nextLeaves.size(), nextLeaf + SCAN_PREFETCH_LEAVES);
+	for (unsigned i = max(prefetchEnd, nextLeaf); i < end; ) {
+		unsigned last = i;
+		while (last + 1 < end && isNearLeaf(nextLeaves[last], nextLeaves[last + 1]))
+			last++;
+		if (!isNearLeaf(nextLeaves[i - 1], nextLeaves[i]))
+			fileHandle.prefetchPages(nextLeaves[i], nextLeaves[last] - nextLeaves[i] + 1);
+		i = last + 1;
+	}
+	prefetchEnd = max(prefetchEnd, end);
+}
+
+// the leaf is read again until it is still as the search found it
+RC IX_ScanIterator::findResumeKey()
+{
+	IndexManager *indexManager = IndexManager::instance();
+
+	while (true) {
+		EID entryId;
+		uint64_t version;
+		int returnValue;
+
+		if (hasResumeKey) {
+			returnValue = indexManager->findSuccessorForStart(fileHandle, latches, resumeKey.data(), attrType, entryId,
+					resumeInclusive, version);
 		}
 		else {
+			entryId.pageNum = LEFT_MOST_PAGE_NUM;
+			entryId.slotNum = -1;
+			returnValue = indexManager->findNextValidSlot(fileHandle, latches, entryId, version);
+		}
+		if (returnValue != SUCCESS)
+			return returnValue;
+
+		if (entryId.pageNum == NO_PAGE) {
 			currentEid.pageNum = NO_PAGE;
+			return SUCCESS;
 		}
+
+		returnValue = readPage(entryId.pageNum, entryId.slotNum);
+		if (returnValue != SUCCESS || pageVersion == version)
+			return returnValue;
 	}
+}
 
+RC IX_ScanIterator::readPage(unsigned pageNum, unsigned slotNum)
+{
+	currentEid.pageNum = pageNum;
+	currentEid.slotNum = slotNum;
+	startSlot = slotNum;
+
+	int returnValue = IndexManager::instance()->readValidPage(fileHandle, latches, pageNum, page, pageVersion);
+	if (returnValue == SUCCESS && headerPtr->pageType == Leaf)
+		currentKey.assign(page + PAGE_SIZE - headerPtr->prefixLength, headerPtr->prefixLength);
 	return returnValue;
 }
 
@@ -1247,28 +3303,299 @@ RC IX_ScanIterator::close()
 {
 	currentEid.pageNum = NO_PAGE;
 	currentEid.slotNum = 0;
-	stopEid.pageNum = NO_PAGE;
-	stopEid.slotNum = 0;
 	attrType = TypeInt;
+	hasResumeKey = false;
+	hasHighKey = false;
+	resumeKey.clear();
+	highKey.clear();
+	postingData = postingEnd = NULL;
+	nextLeaves.clear();
+	nextLeaf = prefetchEnd = 0;
+	hasLastLeaf = false;
+	isHash = false;
+	bucketEntries.clear();
+	bucketOffset = 0;
+	keyHashValues.clear();
+	nextKeyHashValue = 0;
 
 	return 0;
 }
 
-RC IX_ScanIterator::initialize(FileHandle &fileHandle, const EID &startEid, const EID &endEid, AttrType type) {
-	currentEid.pageNum = startEid.pageNum;
-	currentEid.slotNum = startEid.slotNum;
-	stopEid.pageNum = endEid.pageNum;
-	stopEid.slotNum = endEid.slotNum;
+RC IX_ScanIterator::initialize(FileHandle &fileHandle, IndexLatches *latches, AttrType type, const void *lowKey,
+		bool lowKeyInclusive, const void *highKey, bool highKeyInclusive) {
 	attrType = type;
-
 	this->fileHandle = fileHandle;
-	int returnValue = fileHandle.readPage(currentEid.pageNum, page);
+	this->latches = latches;
+	postingData = postingEnd = NULL;
+	nextLeaves.clear();
+	nextLeaf = prefetchEnd = 0;
+	hasLastLeaf = false;
+
+	hasResumeKey = lowKey != NULL;
+	resumeInclusive = lowKeyInclusive;
+	if (lowKey != NULL)
+		resumeKey.assign((const char *)lowKey, type == TypeVarChar ? sizeof(int) + *(int *)lowKey : sizeof(int));
+
+	hasHighKey = highKey != NULL;
+	this->highKeyInclusive = highKeyInclusive;
+	if (highKey != NULL)
+		this->highKey.assign((const char *)highKey, type == TypeVarChar ? sizeof(int) + *(int *)highKey : sizeof(int));
+
+	// a hash index reads every bucket, or only the buckets of the key (getKeyHashValues) when lowKey and highKey are the
+	// same one
+	isHash = latches->indexType == HashIndex;
+	if (isHash) {
+		bucketEntries.clear();
+		bucketOffset = 0;
+		nextHashValue = 0;
+		endHashValue = (uint64_t)1 << 32;
+		keyHashValues.clear();
+		nextKeyHashValue = 0;
+
+		if (lowKey != NULL && highKey != NULL && lowKeyInclusive && highKeyInclusive) {
+			const char *highKeyData = type == TypeVarChar ? (const char *)highKey + sizeof(int) : (const char *)highKey;
+			int highKeyLength = type == TypeVarChar ? *(int *)highKey : sizeof(int);
+			if (IndexManager::instance()->compare(lowKey, highKeyData, type, highKeyLength) == 0) {
+				unsigned hashValues[2];
+				int numOfHashValues = HashIndexManager::instance()->getKeyHashValues(lowKey, type, hashValues);
+				keyHashValues.assign(hashValues, hashValues + numOfHashValues);
+			}
+		}
+		return SUCCESS;
+	}
+
+	return findResumeKey();
+}
+
+/**********EXTERNAL SORTER****************/
+static atomic<unsigned> numOfRunFiles(0); // run file names must stay unique when sorters run on several threads
+
+IX_ExternalSorter::IX_ExternalSorter(const Attribute &attribute, unsigned memoryLimit)
+	: attrType(attribute.type), memoryLimit(memoryLimit), isSorted(false), nextEntry(0)
+{
+}
 
-	if (returnValue == 0) {
-		headerPtr = (LeafHeader *)page;
+IX_ExternalSorter::~IX_ExternalSorter()
+{
+	for (unsigned i = 0; i < runs.size(); i++) {
+		if (runs[i] != NULL)
+			fclose(runs[i]);
 	}
 
-	return returnValue;
+	for (unsigned i = 0; i < runFiles.size(); i++)
+		remove(runFiles[i].c_str());
+}
+
+RC IX_ExternalSorter::addEntry(const void *key, const RID &rid, const void *payload, short payloadLength)
+{
+	if (isSorted)
+		return -1;
+
+	int keyLength = getKeyLength((const char *)key);
+	entryOffsets.push_back(buffer.size());
+	buffer.insert(buffer.end(), (const char *)key, (const char *)key + keyLength);
+	buffer.insert(buffer.end(), (const char *)&rid, (const char *)&rid + sizeof(RID));
+	buffer.insert(buffer.end(), (const char *)&payloadLength, (const char *)&payloadLength + sizeof(short));
+	buffer.insert(buffer.end(), (const char *)payload, (const char *)payload + payloadLength);
+
+	if (buffer.size() + entryOffsets.size() * sizeof(unsigned) >= memoryLimit)
+		return writeRun();
+
+	return SUCCESS;
+}
+
+RC IX_ExternalSorter::sort()
+{
+	if (isSorted)
+		return -1;
+
+	isSorted = true;
+	nextEntry = 0;
+
+	// everything fit in memory, entries are served from the buffer
+	if (runFiles.empty()) {
+		std::sort(entryOffsets.begin(), entryOffsets.end(), [this](unsigned a, unsigned b) {
+			return compareEntries(&buffer[a], &buffer[b]) < 0;
+		});
+		return SUCCESS;
+	}
+
+	if (!entryOffsets.empty()) {
+		RC returnValue = writeRun();
+		if (returnValue != SUCCESS)
+			return returnValue;
+	}
+
+	runs.resize(runFiles.size(), NULL);
+	runEntries.resize(runFiles.size());
+	for (unsigned i = 0; i < runFiles.size(); i++) {
+		runs[i] = fopen(runFiles[i].c_str(), "rb");
+		if (runs[i] == NULL)
+			return -1;
+
+		if (readRunEntry(i) == SUCCESS)
+			heap.push_back(i);
+	}
+
+	make_heap(heap.begin(), heap.end(), [this](int a, int b) { return isHeapGreater(a, b); });
+
+	return SUCCESS;
+}
+
+RC IX_ExternalSorter::getNextEntry(RID &rid, void *key)
+{
+	short payloadLength;
+	return getNextEntry(rid, key, NULL, payloadLength);
+}
+
+RC IX_ExternalSorter::getNextEntry(RID &rid, void *key, void *payload, short &payloadLength)
+{
+	if (!isSorted)
+		return -1;
+
+	const char *entry;
+	int run = -1;
+
+	if (runs.empty()) {
+		if (nextEntry >= entryOffsets.size())
+			return IX_EOF;
+		entry = &buffer[entryOffsets[nextEntry++]];
+	}
+	else {
+		if (heap.empty())
+			return IX_EOF;
+		pop_heap(heap.begin(), heap.end(), [this](int a, int b) { return isHeapGreater(a, b); });
+		run = heap.back();
+		heap.pop_back();
+		entry = runEntries[run].data();
+	}
+
+	int keyLength = getKeyLength(entry);
+	memcpy(key, entry, keyLength);
+	memcpy(&rid, entry + keyLength, sizeof(RID));
+	memcpy(&payloadLength, entry + keyLength + sizeof(RID), sizeof(short));
+	if (payload != NULL)
+		memcpy(payload, entry + keyLength + sizeof(RID) + sizeof(short), payloadLength);
+
+	// refill the heap from the run the entry came from
+	if (run != -1 && readRunEntry(run) == SUCCESS) {
+		heap.push_back(run);
+		push_heap(heap.begin(), heap.end(), [this](int a, int b) { return isHeapGreater(a, b); });
+	}
+
+	return SUCCESS;
+}
+
+// sort the buffered entries and write them to a new run file
+RC IX_ExternalSorter::writeRun()
+{
+	std::sort(entryOffsets.begin(), entryOffsets.end(), [this](unsigned a, unsigned b) {
+		return compareEntries(&buffer[a], &buffer[b]) < 0;
+	});
+
+	char runFileName[64];
+	sprintf(runFileName, "ix_sort_%d_%u.run", (int)getpid(), numOfRunFiles++);
+
+	FILE *file = fopen(runFileName, "wb");
+	if (file == NULL)
+		return -1;
+	runFiles.push_back(runFileName);
+
+	for (unsigned i = 0; i < entryOffsets.size(); i++) {
+		const char *entry = &buffer[entryOffsets[i]];
+		int entryLength = getEntryLength(entry);
+
+		if (fwrite(entry, 1, entryLength, file) != (size_t)entryLength) {
+			fclose(file);
+			return -1;
+		}
+	}
+
+	buffer.clear();
+	entryOffsets.clear();
+
+	return fclose(file) == 0 ? SUCCESS : -1;
+}
+
+RC IX_ExternalSorter::readRunEntry(int run)
+{
+	string &entry = runEntries[run];
+	int keyLength = sizeof(int);
+
+	entry.resize(sizeof(int));
+	if (fread(&entry[0], 1, sizeof(int), runs[run]) != sizeof(int))
+		return IX_EOF;
+
+	if (attrType == TypeVarChar) {
+		keyLength += *(int *)entry.data();
+		entry.resize(keyLength);
+		if (fread(&entry[sizeof(int)], 1, keyLength - sizeof(int), runs[run]) != keyLength - sizeof(int))
+			return -1;
+	}
+
+	entry.resize(keyLength + sizeof(RID) + sizeof(short));
+	if (fread(&entry[keyLength], 1, sizeof(RID) + sizeof(short), runs[run]) != sizeof(RID) + sizeof(short))
+		return -1;
+
+	short payloadLength = *(short *)(entry.data() + keyLength + sizeof(RID));
+	entry.resize(keyLength + sizeof(RID) + sizeof(short) + payloadLength);
+	if (fread(&entry[keyLength + sizeof(RID) + sizeof(short)], 1, payloadLength, runs[run]) != (size_t)payloadLength)
+		return -1;
+
+	return SUCCESS;
+}
+
+int IX_ExternalSorter::getKeyLength(const char *key)
+{
+	if (attrType == TypeVarChar)
+		return sizeof(int) + *(int *)key;
+
+	return sizeof(int);
+}
+
+int IX_ExternalSorter::getEntryLength(const char *entry)
+{
+	int keyLength = getKeyLength(entry);
+	return keyLength + sizeof(RID) + sizeof(short) + *(short *)(entry + keyLength + sizeof(RID));
+}
+
+// order by key, then by rid
+int IX_ExternalSorter::compareEntries(const char *a, const char *b)
+{
+	int keyLength = sizeof(int);
+
+	if (attrType == TypeInt) {
+		int A = *(int *)a;
+		int B = *(int *)b;
+		if (A != B)
+			return A < B ? -1 : 1;
+	}
+	else if (attrType == TypeReal) {
+		float A = *(float *)a;
+		float B = *(float *)b;
+		if (A != B)
+			return A < B ? -1 : 1;
+	}
+	else {
+		int lengthA = *(int *)a;
+		int lengthB = *(int *)b;
+		int result = memcmp(a + sizeof(int), b + sizeof(int), min(lengthA, lengthB));
+
+		if (result != 0)
+			return result;
+		if (lengthA != lengthB)
+			return lengthA < lengthB ? -1 : 1;
+		keyLength += lengthA;
+	}
+
+	const RID *ridA = (const RID *)(a + keyLength);
+	const RID *ridB = (const RID *)(b + keyLength);
+	if (ridA->pageNum != ridB->pageNum)
+		return ridA->pageNum < ridB->pageNum ? -1 : 1;
+	if (ridA->slotNum != ridB->slotNum)
+		return ridA->slotNum < ridB->slotNum ? -1 : 1;
+
+	return 0;
 }
 
 void IX_PrintError (RC rc)
@@ -1279,6 +3606,7 @@ void IX_PrintError (RC rc)
 	case 2: cout << "Fail to destroy file, some other FileHandle is handling this file!" << endl; break;
 	case 3: cout << "Wrong RID in Delete Operation! " << endl; break;
 	case 4: cout << "Key has already exists!" << endl;break;
+	case 5: cout << "Index file of an older format, the index has to be created again!" << endl; break;
 	default: cout << "PFM error!" << endl; break;
 	}
 }
@@ -4,6 +4,11 @@
 
 #include <vector>
 #include <string>
+#include <cstdio>
+#include <mutex>
+#include <atomic>
+#include <shared_mutex>
+#include <cstdint>
 
 #include "../rbf/rbfm.h"
 
@@ -12,14 +17,47 @@
 # define DEBUG 1
 # define SUCCESS 0
 # define LEFT_MOST_PAGE_NUM 2
+# define DEFAULT_INDEX_FILL_FACTOR 90 // percent of a page filled by bulkLoad, the rest absorbs later inserts
+# define SORT_MEMORY_LIMIT (16 * 1024 * 1024) // bytes of entries IX_ExternalSorter keeps before spilling a run
+# define UNDERFLOW_FILL_FACTOR 35 // percent of a page below which deleteEntry merges it with or refills it from a sibling
+# define MAX_INLINE_POSTING_LENGTH (PAGE_SIZE / 4) // bytes of a posting list kept on its leaf, longer lists go to overflow pages
+# define NUM_PAGE_LATCHES 4096 // latches of an open index, page n uses latch n % NUM_PAGE_LATCHES
+# define SCAN_PREFETCH_LEAVES 16 // leaves a scan keeps being read in the background ahead of the one it returns entries from
+# define SCAN_PREFETCH_GAP 4 // pages between two leaves read along with them rather than issuing two reads
+# define PINNED_LEVELS 4 // index levels from the root down whose pages an open index keeps in memory
+# define PINNED_PAGES 256 // pages an open index keeps in memory at most, the upper levels first
+# define COMPOSITE_KEY_SEPARATOR ',' // between the attribute names in the name of a composite index
+# define INDEX_FILE_MAGIC 0x58444e49 // "INDX", first bytes of an index file; older files have their root page number there
+# define INDEX_FILE_VERSION 2 // layout of the index pages and hash of the keys, openFile refuses a file of any other version
+
+typedef enum {Root=0, Index, Leaf, Overflow, Free, Directory, Bucket } PageType;
+
+// a B+ tree, or an extendible hash index (see HashIndexManager) for equality lookups
+typedef enum { BTreeIndex = 0, HashIndex } IndexType;
+
+// Page 0 of an index file: the format, the root page number, then the head of the list of freed pages (NO_PAGE when empty)
+struct FileHeader {
+	unsigned magic;
+	unsigned version;
+	unsigned rootPage;
+	unsigned freePage;
+	IndexType indexType;
+};
 
-typedef enum {Root=0, Index, Leaf, Overflow } PageType;
+// a page on the free list, reused by the next split before the file grows
+struct FreeHeader {
+	PageType pageType;
+	unsigned nextFreePage;
+};
 
+// The keys of a varchar leaf share a prefix of prefixLength bytes, stored once at the end of the page; the data entries
+// are below it, their keys without the prefix.
 struct LeafHeader {
 	PageType pageType;
 	short numOfRecords;
 	short freeSpace;
 	short freeSpaceOffset;
+	short prefixLength;
 	unsigned nextOverFlowPage;
 	unsigned nextPage;
 	unsigned prevPage;
@@ -27,11 +65,25 @@ struct LeafHeader {
 
 
 
+// A leaf entry is a distinct key followed by its posting list: the rids of the key in ascending order, each one with
+// the included (covered) values stored for it. Every rid is delta encoded from the previous one in varints (see
+// appendPosting), the first one from rid 0.0. A list longer than MAX_INLINE_POSTING_LENGTH moves to a chain of
+// Overflow pages, only the key stays on the leaf.
 struct LeafSlot {
 	short offset;
-	short length;
-	unsigned pageNum;
-	unsigned slotNum;
+	short length;         // bytes of the key after the prefix of the page
+	short postingLength;  // bytes of the posting list right after the key, 0 when it is on overflow pages
+	unsigned overflowPage; // first page of the posting list, NO_PAGE when it is on the leaf
+};
+
+// An Overflow page holds a part of a posting list from the end of its header on, encoded on its own (its first rid is a
+// delta from rid 0.0). The pages of a list are chained in rid order.
+struct OverflowHeader {
+	PageType pageType;
+	short numOfRids;
+	short postingLength;
+	unsigned nextOverFlowPage;
+	RID lastRid; // the largest rid of the page, insertEntry and deleteEntry pass the pages below a rid without decoding them
 };
 
 
@@ -52,6 +104,12 @@ struct IndexSlot {
 	unsigned ptr;
 };
 
+// Index pages of int and real keys have no slots: the header is followed by the sorted keys, keys[FIXED_INDEX_CAPACITY],
+// then by ptrs[FIXED_INDEX_CAPACITY], ptrs[i] being the child right of keys[i]. Every entry takes FIXED_INDEX_ENTRY_SIZE
+// bytes of freeSpace, so an empty index page has the same header in both layouts; freeSpaceOffset is not used.
+# define FIXED_INDEX_ENTRY_SIZE ((short)(sizeof(int) + sizeof(unsigned)))
+# define FIXED_INDEX_CAPACITY ((short)((PAGE_SIZE - sizeof(IndexHeader)) / FIXED_INDEX_ENTRY_SIZE))
+
 struct EID {
 	unsigned pageNum;
 	unsigned slotNum;
@@ -63,27 +121,137 @@ struct SplitInfo {
     unsigned pageNo;
 };
 
+// the entries of an index page, keys as stored on the page, ptrs[i] is the child right of keys[i]
+struct IndexEntries {
+	unsigned firstPtr;
+	vector<string> keys;
+	vector<unsigned> ptrs;
+};
+
+// a data entry of a leaf page, the whole key and the posting list as stored on the page
+struct LeafEntry {
+	string key;
+	string postings;
+	unsigned overflowPage;
+};
+
+// a rid of a posting list and the included values stored with it
+struct Posting {
+	RID rid;
+	string payload;
+};
+
+
+
+// the directory of an open hash index: the first page of the bucket of every entry, and the pages it is stored on
+struct HashDirectory {
+	unsigned globalDepth;
+	vector<unsigned> buckets;
+	vector<unsigned> pages;
+};
+
+// a copy of an index page of the upper levels, as it was at version
+struct PinnedPage {
+	uint64_t version;
+	unsigned level; // below the root
+	char data[PAGE_SIZE];
+};
+
+// A latch is a version: even while free, odd while a writer holds it, and two more once the writer released it. Readers
+// take no latch, they note the version of a page before reading it and start over when it changed meanwhile.
+// Overflow pages have no latch of their own, the latch of their leaf covers them.
+// The pinned pages are only used while their latch is still at the version they were copied at: a split or a merge
+// changing one of them makes the next search read it again and pin the new copy.
+struct IndexLatches {
+	atomic<unsigned> rootPage;
+	atomic<uint64_t> rootLatch;  // held while the root page number changes
+	atomic<uint64_t> pageLatches[NUM_PAGE_LATCHES];
+	mutex headerMutex;           // page 0: the root page number and the free list
+	shared_mutex structureMutex; // insertEntry and deleteEntry share it, deleteEntry takes it alone to merge pages
+
+	map<unsigned, PinnedPage> pinnedPages;
+	unsigned numOfPinned[PINNED_LEVELS]; // pinned pages of each level
+	shared_mutex pinnedMutex;
+
+	IndexType indexType;
+	HashDirectory hashDirectory; // hash index only
+
+	IndexLatches();
+};
+
+// a page on the way from the root to a leaf, its latch version when it was read
+struct PathEntry {
+	unsigned pageNum;
+	uint64_t version;
+	short freeSpace;
+};
+
+// The latches held by an insertEntry or deleteEntry, released together. While it is alive it is the latch set of its
+// thread, IndexManager::writePage latches a page on its first write when the set locks on write (deleteEntry merging
+// pages alone); otherwise the pages written without a latch are new ones or overflow pages.
+class LatchSet {
+public:
+	LatchSet(IndexLatches *latches);
+	~LatchSet();
+
+	// false when the latch is held by another writer or changed since version was read
+	bool tryLock(unsigned pageNum, uint64_t version);
+	// false when the latch is held by another writer
+	bool tryLock(unsigned pageNum);
+	bool tryLockRoot(uint64_t version);
+	// wait for the latch, only when no other writer runs
+	void lock(unsigned pageNum);
+	void lockRoot();
+	void release();
 
+	void setLockOnWrite(bool lockOnWrite) { this->lockOnWrite = lockOnWrite; }
+	bool isLockOnWrite() { return lockOnWrite; }
+
+	static thread_local LatchSet *current;
+
+private:
+	IndexLatches *latches;
+	bool lockOnWrite;
+	vector<atomic<uint64_t> *> held;
+	vector<uint64_t> heldVersions;
+
+	bool tryLock(atomic<uint64_t> &latch, uint64_t version);
+	void lock(atomic<uint64_t> &latch);
+};
 
 class IX_ScanIterator;
+class IX_ExternalSorter;
 
 class IndexManager {
 public:
 	static IndexManager* instance();
 
-	RC createFile(const string &fileName);
+	// a hash index takes the same calls, its scans return the entries in no particular order (see HashIndexManager)
+	RC createFile(const string &fileName, IndexType indexType = BTreeIndex);
 
 	RC destroyFile(const string &fileName);
 
+	// returns 5 for a file of an older format (no INDEX_FILE_MAGIC or another INDEX_FILE_VERSION), which is not opened:
+	// its pages cannot be read, the index has to be destroyed and created again from its table
 	RC openFile(const string &fileName, FileHandle &fileHandle);
 
 	RC closeFile(FileHandle &fileHandle);
 
+	// remove every entry: the open index file is truncated back to the empty tree of createFile
+	RC truncateFile(FileHandle &fileHandle);
+
+	// Entries may be inserted, deleted, searched and scanned from many threads at once, see IndexLatches: lookups and
+	// scans never wait for a latch, an insert latches the leaf it changes, and when it may split, the pages up to the
+	// lowest one with room for another entry. A delete which may merge pages runs alone.
+
 	// The following two functions are using the following format for the passed key value.
 	//  1) data is a concatenation of values of the attributes
 	//  2) For int and real: use 4 bytes to store the value;
 	//     For varchar: use 4 bytes to store the length of characters, then store the actual characters.
 	RC insertEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid);  // Insert new index entry
+	// same, the entry also carries "payload" (values of the included attributes), returned by IX_ScanIterator
+	RC insertEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid,
+			const void *payload, short payloadLength);
 	RC deleteEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid);  // Delete index entry
 	RC searchEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, RID &rid, EID &entryId);  // search index entry according to the key
 
@@ -103,10 +271,35 @@ public:
 			bool        highKeyInclusive,
 			IX_ScanIterator &ix_ScanIterator);
 
+	// Build the tree bottom-up from the sorted entries of "sorter": leaves are packed left to right up to
+	// fillFactor percent, then each index level is built on top of the one below, and the top node is
+	// written to the root page. The index must be empty (just created). The rids of a key are gathered
+	// into its posting list, long lists are written to overflow pages filled up to fillFactor percent too.
+	RC bulkLoad(FileHandle &fileHandle, const Attribute &attribute, IX_ExternalSorter &sorter,
+			const short fillFactor = DEFAULT_INDEX_FILL_FACTOR);
+
+	// Composite keys: an index on several attributes is an index on one varchar key holding their values, encoded so
+	// that the keys compare in the order of the first attribute, then of the second, and so on (reals compare exactly,
+	// without the tolerance of a real key). The attribute of such an index is named after its attributes, separated
+	// by COMPOSITE_KEY_SEPARATOR.
+	Attribute getCompositeAttribute(const vector<Attribute> &attributes);
+	// the key of the first numOfValues attributes, "values" holding them one after the other as in insertEntry. With
+	// fewer values than attributes the key is a prefix, which sorts before every key starting with it; with isPrefixEnd
+	// it is the first key after all of those instead, so a scan from the prefix (inclusive) to its end (exclusive)
+	// returns the keys starting with the values. -1 when there is no such end.
+	RC prepareCompositeKey(const vector<Attribute> &attributes, const void *values, unsigned numOfValues, bool isPrefixEnd,
+			void *key);
+	// the values of all the attributes of a composite key, one after the other; returns their length
+	int readCompositeKey(const vector<Attribute> &attributes, const void *key, void *values);
+
 private:
-	RC findNextValidSlot(FileHandle &fileHandle, EID &entryId);
-	RC findSuccessorForStart(FileHandle &fileHandle, const void *key, AttrType type, EID &entryId, bool isInclusive);
-	RC findSuccessorForEnd(FileHandle &fileHandle, const void *key, AttrType type, EID &entryId, bool isInclusive);
+	// version is the latch of the leaf of entryId when it was read
+	RC findNextValidSlot(FileHandle &fileHandle, IndexLatches *latches, EID &entryId, uint64_t &version);
+	RC findSuccessorForStart(FileHandle &fileHandle, IndexLatches *latches, const void *key, AttrType type, EID &entryId,
+			bool isInclusive, uint64_t &version);
+
+	friend class IX_ScanIterator;
+	friend class HashIndexManager;
 
 protected:
 	IndexManager   ();                            // Constructor
@@ -115,8 +308,81 @@ protected:
 private:
 	static IndexManager *_index_manager;
 	PagedFileManager *pfm;
-	map<string, unsigned> rootPageMap;
-
+	map<string, IndexLatches> openIndexes;
+	shared_mutex openIndexMutex; // index files are opened and closed from many threads
+
+	// the latches of an open index file, NULL when it is not open
+	IndexLatches *getLatches(const string &fileName);
+
+	// read a page no writer changed meanwhile, version is its latch
+	RC readValidPage(FileHandle &fileHandle, IndexLatches *latches, unsigned pageNum, void *page, uint64_t &version);
+	// a page of the tree written by insertEntry or deleteEntry, see LatchSet
+	RC writePage(FileHandle &fileHandle, unsigned pageNum, const void *data);
+	// copy the pinned page pageNum when it is still at version
+	bool readPinnedPage(IndexLatches *latches, unsigned pageNum, uint64_t version, void *page);
+	// keep a copy of the index page pageNum read at version, unless the pages pinned already are all above level
+	void pinPage(IndexLatches *latches, unsigned pageNum, unsigned level, uint64_t version, const void *page);
+	void unpinPage(IndexLatches *latches, unsigned pageNum);
+	void unpinAllPages(IndexLatches *latches);
+	// the pages from the root down to the leaf of key, page gets the leaf; no page changed while the next one was found
+	RC findPath(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, vector<PathEntry> &path,
+			uint64_t &rootVersion, char *page);
+	// the entry fits in the leaf whether its key is there or not
+	bool isSafeLeafInsert(const char *page, const void *key, AttrType attrType, short payloadLength);
+	// the leaf does not underflow whichever rid of key is deleted
+	bool isSafeLeafDelete(const char *page, const void *key, AttrType attrType);
+	// up to numOfLeaves leaves after the leaf of key, in order, leaving out the ones above highKey (when not NULL)
+	RC getNextLeaves(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, const void *highKey,
+			unsigned numOfLeaves, vector<unsigned> &leaves);
+	// the leaves of the subtree of pageNum, depth levels above them, while they are not above highKey
+	RC appendLeaves(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, unsigned pageNum, int depth,
+			const void *highKey, unsigned numOfLeaves, vector<unsigned> &leaves, bool &isAboveHighKey);
+
+	// append the header page, the root and the first leaf of an empty tree to an empty file
+	RC appendEmptyTree(FileHandle &fileHandle);
+
+	// take a page from the free list, or append one; the caller writes it
+	RC allocatePage(FileHandle &fileHandle, unsigned &pageNum);
+	// put a page unlinked from the tree on the free list
+	RC freePage(FileHandle &fileHandle, unsigned pageNum);
+	// the caller holds the root latch
+	RC setRootPage(FileHandle &fileHandle, unsigned rootPageNum);
+
+	// delete the entry below pageNo, isUnderflow tells the caller that the page fell below UNDERFLOW_FILL_FACTOR
+	RC remove(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid, unsigned pageNo, bool &isUnderflow);
+	// merge or redistribute the child of parentPage at slotNum (-1 for firstPtr) with a sibling, parentPage is changed in memory
+	RC handleUnderflow(FileHandle &fileHandle, AttrType attrType, char *parentPage, short slotNum);
+	// the children on both sides of parent.keys[separator]
+	RC handleLeafUnderflow(FileHandle &fileHandle, AttrType attrType, char *parentPage, IndexEntries &parent, unsigned separator,
+			char *leftPage, char *rightPage, bool isRightUnderflow);
+	RC handleIndexUnderflow(FileHandle &fileHandle, AttrType attrType, char *parentPage, IndexEntries &parent, unsigned separator,
+			char *leftPage, char *rightPage);
+	void readIndexEntries(const char *page, AttrType attrType, IndexEntries &entries);
+	// rebuild an index page from entries, -1 (and the page unchanged) when they do not fit
+	RC writeIndexEntries(char *page, AttrType attrType, const IndexEntries &entries);
+	void readLeafEntries(const char *page, vector<LeafEntry> &entries);
+	// rebuild a leaf page from entries[begin, end) with the prefix of their keys taken out, the sibling links are kept
+	void writeLeafEntries(char *page, const vector<LeafEntry> &entries, unsigned begin, unsigned end, AttrType attrType);
+	bool isUnderfull(const char *page);
+
+	// leaf entries are changed in place, the caller checks freeSpace first; keyData is the key after the prefix of the page
+	void insertLeafEntry(char *page, short slotNum, const char *keyData, short keyLength, const string &postings,
+			unsigned overflowPage);
+	void replaceLeafPostings(char *page, short slotNum, const string &postings, unsigned overflowPage);
+	void removeLeafEntry(char *page, short slotNum);
+	// split a leaf which cannot take "entries" (its entries with the changed one) into the page and a new right sibling
+	RC splitLeafPage(FileHandle &fileHandle, char *page, unsigned pageNo, const vector<LeafEntry> &entries, AttrType attrType,
+			SplitInfo &splitInfo);
+
+	// posting lists on overflow pages, firstPage is the head of the chain
+	RC writeOverflowPages(FileHandle &fileHandle, const vector<Posting> &postings, unsigned &firstPage);
+	// the data of the pages one after the other, pageStarts gets where each page but the first one starts
+	RC readOverflowPages(FileHandle &fileHandle, unsigned firstPage, string &postings, vector<unsigned> &pageStarts);
+	// 3 when the rid is already in the list
+	RC insertOverflowPosting(FileHandle &fileHandle, unsigned firstPage, const RID &rid, const void *payload, short payloadLength);
+	// 3 when the rid is not in the list; firstPage becomes NO_PAGE when the list is empty, or the next page when the first
+	// one was freed. shortPostings gets the list when it is left on a single page short enough for its leaf
+	RC removeOverflowPosting(FileHandle &fileHandle, unsigned &firstPage, const RID &rid, string &shortPostings);
 
 	int compare(const void *key, const void *data, AttrType attrType, int dataLength);
 	short indexBinarySearch(const void *key, void *page, short numOfRecords, AttrType attrType);
@@ -124,46 +390,184 @@ private:
 	void reorgLeafPage(void *page);
 	void reorgIndexPage(void *page);
 
-	LeafSlot * BTreeSearch(FileHandle &fileHandle, unsigned pageNum, AttrType attrType, const void *key, EID &entryId, bool &isSuccess, bool &isNegOne);
+	RC BTreeSearch(FileHandle &fileHandle, IndexLatches *latches, AttrType attrType, const void *key, EID &entryId, RID &rid,
+			bool &isSuccess, bool &isNegOne, uint64_t &version);
 
 	IndexSlot *goToIndexSlot(const char *page, short slotNum) {
 		return (IndexSlot *)(page + sizeof(IndexHeader) + slotNum * sizeof(IndexSlot));
 	}
 
+	bool isFixedWidth(AttrType attrType) {
+		return attrType != TypeVarChar;
+	}
+
+	char *goToIndexKeys(const char *page) {
+		return (char *)page + sizeof(IndexHeader);
+	}
+
+	unsigned *goToIndexPtrs(const char *page) {
+		return (unsigned *)(page + sizeof(IndexHeader) + FIXED_INDEX_CAPACITY * sizeof(int));
+	}
+
+	// child of an index page to follow after indexBinarySearch returned slotNum
+	unsigned getIndexChild(const char *page, short slotNum, AttrType attrType) {
+		if (slotNum == -1)
+			return ((IndexHeader *)page)->firstPtr;
+		return isFixedWidth(attrType) ? goToIndexPtrs(page)[slotNum] : goToIndexSlot(page, slotNum)->ptr;
+	}
+
+	// bytes of freeSpace taken by an index entry
+	short getIndexEntrySize(int keyLength, AttrType attrType) {
+		return isFixedWidth(attrType) ? FIXED_INDEX_ENTRY_SIZE : sizeof(IndexSlot) + keyLength;
+	}
+
 	LeafSlot *goToLeafSlot(const char *page, short slotNum) {
 		return (LeafSlot *)(page + sizeof(LeafHeader) + slotNum * sizeof(LeafSlot));
 	}
 
-	RC insert(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid, unsigned pageNo, SplitInfo &splitInfo);
+	char *goToLeafPrefix(const char *page) {
+		return (char *)page + PAGE_SIZE - ((LeafHeader *)page)->prefixLength;
+	}
+
+	RC insert(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid, const void *payload, short payloadLength,
+			unsigned pageNo, SplitInfo &splitInfo);
 	int getKeyLength(const void *key, AttrType attrType);
 
-	RC insertKeyInLeafPage(char * pageIn, const void * key, LeafHeader * leafHeader, const Attribute &attribute, const RID &rid);
 	RC insertEntryInIndexPage(char *pageIn, const void *key, IndexHeader *indexHeader, const Attribute &attribute, unsigned &pagePointer);
+	// add an entry after the last one of an index page, "keyData" is the key as stored on the page
+	void appendEntryToIndexPage(char *page, const char *keyData, short keyLength, unsigned ptr, AttrType attrType);
 
 
-	void copyLeafKeysInOrder(char * leafPage, char * newLeafPage, unsigned currentPageNo, unsigned newPageNo, AttrType type);
 	void copyIndexEntriesInOrder(char * indexPage, char * newIndexPage, AttrType attrType, SplitInfo &splitInfo);
+
+	RC buildIndexLevels(FileHandle &fileHandle, AttrType attrType, vector<unsigned> &children, vector<string> &keys,
+			short fillFactor);
+};
+
+// IX_ExternalSorter sorts (key, rid) entries by key then rid. Entries are buffered in memory; every time the
+// buffer exceeds memoryLimit it is sorted and written to a run file. sort() then merges the runs.
+//  IX_ExternalSorter sorter(attribute);
+//  sorter.addEntry(key, rid); ...
+//  sorter.sort();
+//  while (sorter.getNextEntry(rid, key) != IX_EOF) ...
+class IX_ExternalSorter {
+public:
+	IX_ExternalSorter(const Attribute &attribute, unsigned memoryLimit = SORT_MEMORY_LIMIT);
+	~IX_ExternalSorter(); // removes the run files
+
+	// "key" follows the same format as in IndexManager::insertEntry()
+	RC addEntry(const void *key, const RID &rid, const void *payload = NULL, short payloadLength = 0);
+	RC sort();
+	RC getNextEntry(RID &rid, void *key);
+	RC getNextEntry(RID &rid, void *key, void *payload, short &payloadLength);
+
+	unsigned getNumOfRuns() { return runFiles.size(); }
+
+private:
+	AttrType attrType;
+	unsigned memoryLimit;
+	bool isSorted;
+
+	// in-memory run: entries [key][RID][short payloadLength][payload] back to back, entryOffsets[i] is where entry i starts
+	vector<char> buffer;
+	vector<unsigned> entryOffsets;
+	unsigned nextEntry;
+
+	// spilled runs, merged with a heap of run numbers ordered by their current entry
+	vector<string> runFiles;
+	vector<FILE *> runs;
+	vector<string> runEntries;
+	vector<int> heap;
+
+	RC writeRun();
+	RC readRunEntry(int run);
+	int getKeyLength(const char *key);
+	int getEntryLength(const char *entry);
+	int compareEntries(const char *a, const char *b);
+	bool isHeapGreater(int a, int b) { return compareEntries(runEntries[a].data(), runEntries[b].data()) > 0; }
 };
 
+// The iterator walks a copy of the current leaf and follows its nextPage. Entries deleted meanwhile (deleteEntry may
+// merge leaves, always into the left one, and only refill a leaf from its left sibling) are found again from the last
+// returned key: the next leaf is trusted only when it is still a leaf linked back to the current one. The posting list
+// of the current key is copied as a whole, overflow pages included, before its first rid is returned; the copy is
+// dropped and the key found again when its leaf changed meanwhile. The reads of the SCAN_PREFETCH_LEAVES leaves after
+// the current one are issued ahead (FileHandle::prefetchPages), the leaves being found through their parents.
 class IX_ScanIterator {
 public:
 	IX_ScanIterator();  							// Constructor
 	~IX_ScanIterator(); 							// Destructor
 
 	RC getNextEntry(RID &rid, void *key);  		// Get next matching entry
+	RC getNextEntry(RID &rid, void *key, void *payload, short &payloadLength); // also copy the included values of the entry
 	RC close();             						// Terminate index scan
-	RC initialize(FileHandle &fileHandle, const EID &startEid, const EID &endEid, AttrType type);
+	RC initialize(FileHandle &fileHandle, IndexLatches *latches, AttrType type, const void *lowKey, bool lowKeyInclusive,
+			const void *highKey, bool highKeyInclusive);
 
 private:
 	EID currentEid;
-	EID stopEid;
 	AttrType attrType;
 
 	FileHandle fileHandle;
+	IndexLatches *latches;
 
+	// a copy of the current leaf, pageVersion is its latch when it was read
 	char *page;
 	LeafHeader *headerPtr;
-
+	uint64_t pageVersion;
+
+	// the key of the slot before currentEid, on the page or in currentKey when the page has a prefix, and its postings
+	// still to be returned; a list on overflow pages is copied to overflowPostings, the data of its pages one after the
+	// other, the rids starting over from rid 0.0 at each of pageStarts
+	const char *keyData;
+	short keyLength;
+	string currentKey;
+	const char *postingData;
+	const char *postingEnd;
+	RID postingRid;
+	string overflowPostings;
+	vector<unsigned> pageStarts;
+	unsigned nextPageStart;
+	const char *nextPageData;
+
+	// entries after resumeKey (or equal to it when resumeInclusive) are still to be returned, it is set from the last
+	// returned entry when leaving a page; entries from startSlot on were returned from the current page
+	bool hasResumeKey;
+	bool resumeInclusive;
+	string resumeKey;
+	unsigned startSlot;
+
+	bool hasHighKey;
+	bool highKeyInclusive;
+	string highKey;
+
+	// leaves after the current one, nextLeaf is the next one to be read, the reads up to prefetchEnd were issued;
+	// hasLastLeaf when they reach the end of the scan
+	vector<unsigned> nextLeaves;
+	unsigned nextLeaf;
+	unsigned prefetchEnd;
+	bool hasLastLeaf;
+
+	// hash index: the entries of the current bucket from bucketOffset on are still to be returned, the buckets of the
+	// hash values below nextHashValue were read and the scan ends at endHashValue. When lowKey and highKey are the same
+	// key, the buckets of its keyHashValues are read instead, the entries of one of them from each, up to
+	// nextKeyHashValue
+	bool isHash;
+	string bucketEntries;
+	unsigned bucketOffset;
+	uint64_t nextHashValue;
+	uint64_t endHashValue;
+	vector<unsigned> keyHashValues;
+	unsigned nextKeyHashValue;
+
+	RC getNextHashEntry(RID &rid, void *key, void *payload, short &payloadLength);
+	// called before nextPage is read
+	void prefetchLeaves(unsigned nextPage);
+	RC moveToNextPage();
+	// read the leaf of the first entry after resumeKey, or of the first entry when there is none
+	RC findResumeKey();
+	RC readPage(unsigned pageNum, unsigned slotNum);
+	RC readOverflowPostings(unsigned firstPage);
 };
 
 // print out the error message for a given return code
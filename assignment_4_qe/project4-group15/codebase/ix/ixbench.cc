@@ -0,0 +1,328 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ix.h"
+
+using namespace std;
+
+// Point lookups (searchEntry) and a full scan against a bulk loaded B+ tree, an int index, a varchar index and a varchar
+// index of urls, and a full scan of an int index of numOfKeys entries over 100 distinct keys. Then churn on an int index
+// built by insertEntry: full scan time and file size after loading, after deleting 90% of the keys and after inserting
+// them again. Scans are timed with the index in the page cache and again after dropping it (cold). Last, throughput of
+// 1 to maxThreads threads sharing the bulk loaded int index: lookups only, inserts only, and 95% lookups / 5% inserts.
+// usage: ixbench [numOfKeys] [numOfLookups] [numOfChurnKeys] [maxThreads]
+//
+// Keys are 0 .. numOfKeys - 1 (varchar keys are their zero padded decimal string, urls the same string after urlPrefix),
+// looked up in random order. Entry i has rid (i / 100 + 1, i % 100), its key is i % 100 in the index of 100 distinct keys.
+// Threads insert keys from numOfKeys on, each thread runs numOfLookups / maxThreads operations.
+
+IndexManager *indexManager = IndexManager::instance();
+const int success = 0;
+const int varCharLength = 16;
+const char *urlPrefix = "http://www.example.com/catalog/products/item?id=";
+
+int prepareKey(int i, const Attribute &attribute, void *key)
+{
+	if (attribute.type != TypeVarChar) {
+		memcpy(key, &i, sizeof(int));
+		return sizeof(int);
+	}
+
+	char data[PAGE_SIZE];
+	int length = sprintf(data, "%s%0*d", attribute.name == "Url" ? urlPrefix : "", varCharLength, i);
+	memcpy(key, &length, sizeof(int));
+	memcpy((char *)key + sizeof(int), data, length);
+	return sizeof(int) + length;
+}
+
+// levels from the root down to the leaves
+int getHeight(FileHandle &fileHandle)
+{
+	char page[PAGE_SIZE];
+	RC rc = fileHandle.readPage(0, page);
+	assert(rc == success);
+	unsigned pageNum = ((FileHeader *)page)->rootPage;
+
+	int height = 1;
+	for (;; height++) {
+		rc = fileHandle.readPage(pageNum, page);
+		assert(rc == success);
+		if (*(PageType *)page == Leaf)
+			return height;
+		pageNum = ((IndexHeader *)page)->firstPtr;
+	}
+}
+
+void createIndex(const string &indexFileName, const Attribute &attribute, int numOfKeys, int numOfDistinct,
+		FileHandle &fileHandle, IndexType indexType = BTreeIndex)
+{
+	indexManager->destroyFile(indexFileName);
+	RC rc = indexManager->createFile(indexFileName, indexType);
+	assert(rc == success);
+	rc = indexManager->openFile(indexFileName, fileHandle);
+	assert(rc == success);
+
+	IX_ExternalSorter sorter(attribute);
+	char key[PAGE_SIZE];
+	RID rid;
+	for (int i = 0; i < numOfKeys; i++) {
+		prepareKey(i % numOfDistinct, attribute, key);
+		rid.pageNum = i / 100 + 1;
+		rid.slotNum = i % 100;
+		rc = sorter.addEntry(key, rid);
+		assert(rc == success);
+	}
+	rc = sorter.sort();
+	assert(rc == success);
+	rc = indexManager->bulkLoad(fileHandle, attribute, sorter, 100);
+	assert(rc == success);
+}
+
+// lookups per second
+double runLookups(FileHandle &fileHandle, const Attribute &attribute, int numOfKeys, int numOfLookups)
+{
+	mt19937 random(1234);
+	uniform_int_distribution<int> keys(0, numOfKeys - 1);
+	char key[PAGE_SIZE];
+	RID rid;
+	EID eid;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int op = 0; op < numOfLookups; op++) {
+		int i = keys(random);
+		prepareKey(i, attribute, key);
+		RC rc = indexManager->searchEntry(fileHandle, attribute, key, rid, eid);
+		assert(rc == success && rid.pageNum == (unsigned)(i / 100 + 1) && rid.slotNum == (unsigned)(i % 100));
+	}
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	return numOfLookups / elapsed.count();
+}
+
+// milliseconds of a scan of the whole index, the pages of the index file dropped from the page cache first when isCold
+double runScan(FileHandle &fileHandle, const Attribute &attribute, int numOfKeys, bool isCold = false)
+{
+	IX_ScanIterator ix_ScanIterator;
+	char key[PAGE_SIZE];
+	RID rid;
+	int numOfEntries = 0;
+
+	if (isCold) {
+		int fd = fileno(fileHandle.getFile());
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	RC rc = indexManager->scan(fileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+	assert(rc == success);
+	while (ix_ScanIterator.getNextEntry(rid, key) == success)
+		numOfEntries++;
+	ix_ScanIterator.close();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	assert(numOfEntries == numOfKeys);
+	return elapsed.count();
+}
+
+void runChurn(const Attribute &attribute, int numOfKeys)
+{
+	string indexFileName = "ixbench_churn";
+	FileHandle fileHandle;
+	indexManager->destroyFile(indexFileName);
+	RC rc = indexManager->createFile(indexFileName);
+	assert(rc == success);
+	rc = indexManager->openFile(indexFileName, fileHandle);
+	assert(rc == success);
+
+	vector<int> keys;
+	for (int i = 0; i < numOfKeys; i++)
+		keys.push_back(i);
+	shuffle(keys.begin(), keys.end(), mt19937(1234));
+
+	char key[PAGE_SIZE];
+	RID rid;
+	int numOfDeleted = numOfKeys / 10 * 9;
+
+	cout << endl << numOfKeys << " keys inserted in random order, " << numOfDeleted << " deleted, then inserted again" << endl;
+	cout << setw(10) << "phase" << setw(10) << "pages" << setw(12) << "scan ms" << setw(12) << "cold ms" << endl;
+
+	for (int phase = 0; phase < 3; phase++) {
+		int begin = phase == 0 ? 0 : numOfKeys - numOfDeleted;
+		for (int i = begin; i < numOfKeys; i++) {
+			prepareKey(keys[i], attribute, key);
+			rid.pageNum = keys[i] / 100 + 1;
+			rid.slotNum = keys[i] % 100;
+			rc = phase == 1 ? indexManager->deleteEntry(fileHandle, attribute, key, rid)
+					: indexManager->insertEntry(fileHandle, attribute, key, rid);
+			assert(rc == success);
+		}
+
+		int numOfEntries = phase == 1 ? numOfKeys - numOfDeleted : numOfKeys;
+		cout << setw(10) << (phase == 0 ? "load" : phase == 1 ? "delete" : "reinsert") << setw(10)
+				<< fileHandle.getNumberOfPages() << fixed << setprecision(1) << setw(12)
+				<< runScan(fileHandle, attribute, numOfEntries) << setw(12) << runScan(fileHandle, attribute, numOfEntries, true)
+				<< endl;
+	}
+
+	rc = indexManager->closeFile(fileHandle);
+	assert(rc == success);
+	rc = indexManager->destroyFile(indexFileName);
+	assert(rc == success);
+}
+
+// opsPerThread lookups of loaded keys, or with insertProportion inserts of keys from nextKey on
+void runClient(FileHandle &fileHandle, const Attribute &attribute, int numOfKeys, double insertProportion, int opsPerThread,
+		atomic<int> &nextKey, unsigned seed)
+{
+	mt19937 random(seed);
+	uniform_int_distribution<int> keys(0, numOfKeys - 1);
+	uniform_real_distribution<double> operations(0.0, 1.0);
+	char key[PAGE_SIZE];
+	RID rid;
+	EID eid;
+
+	for (int op = 0; op < opsPerThread; op++) {
+		RC rc;
+		if (operations(random) < insertProportion) {
+			int i = nextKey++;
+			prepareKey(i, attribute, key);
+			rid.pageNum = i / 100 + 1;
+			rid.slotNum = i % 100;
+			rc = indexManager->insertEntry(fileHandle, attribute, key, rid);
+			assert(rc == success);
+		}
+		else {
+			int i = keys(random);
+			prepareKey(i, attribute, key);
+			rc = indexManager->searchEntry(fileHandle, attribute, key, rid, eid);
+			assert(rc == success && rid.pageNum == (unsigned)(i / 100 + 1) && rid.slotNum == (unsigned)(i % 100));
+		}
+	}
+}
+
+// operations per second of numOfThreads clients
+double runClients(FileHandle &fileHandle, const Attribute &attribute, int numOfKeys, double insertProportion,
+		int numOfThreads, int opsPerThread, atomic<int> &nextKey)
+{
+	vector<thread> clients;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < numOfThreads; i++) {
+		clients.push_back(thread(runClient, ref(fileHandle), cref(attribute), numOfKeys, insertProportion, opsPerThread,
+				ref(nextKey), 1234u + i));
+	}
+	for (int i = 0; i < numOfThreads; i++)
+		clients[i].join();
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	return numOfThreads * opsPerThread / elapsed.count();
+}
+
+void runConcurrency(const Attribute &attribute, int numOfKeys, int opsPerThread, int maxThreads)
+{
+	string indexFileName = "ixbench_concurrency";
+	FileHandle fileHandle;
+	createIndex(indexFileName, attribute, numOfKeys, numOfKeys, fileHandle);
+	atomic<int> nextKey(numOfKeys);
+
+	cout << endl << numOfKeys << " keys, " << opsPerThread << " operations per thread, " << thread::hardware_concurrency()
+			<< " hardware threads" << endl;
+	cout << setw(8) << "threads" << setw(16) << "lookups/s" << setw(16) << "inserts/s" << setw(16) << "95/5 ops/s" << endl;
+
+	for (int numOfThreads = 1; numOfThreads <= maxThreads; numOfThreads *= 2) {
+		cout << setw(8) << numOfThreads << fixed << setprecision(0)
+				<< setw(16) << runClients(fileHandle, attribute, numOfKeys, 0.0, numOfThreads, opsPerThread, nextKey)
+				<< setw(16) << runClients(fileHandle, attribute, numOfKeys, 1.0, numOfThreads, opsPerThread, nextKey)
+				<< setw(16) << runClients(fileHandle, attribute, numOfKeys, 0.05, numOfThreads, opsPerThread, nextKey) << endl;
+	}
+
+	RC rc = indexManager->closeFile(fileHandle);
+	assert(rc == success);
+	rc = indexManager->destroyFile(indexFileName);
+	assert(rc == success);
+}
+
+int main(int argc, char **argv)
+{
+	int numOfKeys = argc > 1 ? atoi(argv[1]) : 1000000;
+	int numOfLookups = argc > 2 ? atoi(argv[2]) : 200000;
+	int numOfChurnKeys = argc > 3 ? atoi(argv[3]) : numOfKeys / 10;
+	int maxThreads = argc > 4 ? atoi(argv[4]) : 8;
+
+	cout << numOfKeys << " keys, " << numOfLookups << " lookups" << endl;
+	cout << setw(12) << "key" << setw(10) << "pages" << setw(8) << "height" << setw(16) << "lookups/s" << setw(12)
+			<< "scan ms" << setw(12) << "cold ms" << endl;
+
+	const char *labels[3] = {"int", "varchar", "url"};
+	Attribute attributes[3];
+	attributes[0].name = "Key";
+	attributes[0].type = TypeInt;
+	attributes[0].length = (AttrLength)4;
+	attributes[1].name = "Name";
+	attributes[1].type = TypeVarChar;
+	attributes[1].length = (AttrLength)varCharLength;
+	attributes[2].name = "Url";
+	attributes[2].type = TypeVarChar;
+	attributes[2].length = (AttrLength)(strlen(urlPrefix) + varCharLength);
+
+	for (int i = 0; i < 3; i++) {
+		string indexFileName = "ixbench_" + attributes[i].name;
+		FileHandle fileHandle;
+		createIndex(indexFileName, attributes[i], numOfKeys, numOfKeys, fileHandle);
+
+		unsigned numOfPages = fileHandle.getNumberOfPages();
+		int height = getHeight(fileHandle);
+		double lookups = runLookups(fileHandle, attributes[i], numOfKeys, numOfLookups);
+		double scan = runScan(fileHandle, attributes[i], numOfKeys);
+		double coldScan = runScan(fileHandle, attributes[i], numOfKeys, true);
+		cout << setw(12) << labels[i] << setw(10) << numOfPages << setw(8) << height << fixed << setprecision(0)
+				<< setw(16) << lookups << setprecision(1) << setw(12) << scan << setw(12) << coldScan << endl;
+
+		RC rc = indexManager->closeFile(fileHandle);
+		assert(rc == success);
+		rc = indexManager->destroyFile(indexFileName);
+		assert(rc == success);
+	}
+
+	// the same keys in a hash index, its scans in no order
+	for (int i = 0; i < 2; i++) {
+		string indexFileName = "ixbench_hash_" + attributes[i].name;
+		FileHandle fileHandle;
+		createIndex(indexFileName, attributes[i], numOfKeys, numOfKeys, fileHandle, HashIndex);
+		cout << setw(12) << string(labels[i]) + "/hash" << setw(10) << fileHandle.getNumberOfPages() << setw(8) << "-"
+				<< fixed << setprecision(0) << setw(16) << runLookups(fileHandle, attributes[i], numOfKeys, numOfLookups)
+				<< setprecision(1) << setw(12) << runScan(fileHandle, attributes[i], numOfKeys) << setw(12)
+				<< runScan(fileHandle, attributes[i], numOfKeys, true) << endl;
+		RC rc = indexManager->closeFile(fileHandle);
+		assert(rc == success);
+		rc = indexManager->destroyFile(indexFileName);
+		assert(rc == success);
+	}
+
+	// duplicates: the same number of entries in 100 posting lists
+	string indexFileName = "ixbench_duplicates";
+	FileHandle fileHandle;
+	createIndex(indexFileName, attributes[0], numOfKeys, 100, fileHandle);
+	cout << setw(12) << "int/100" << setw(10) << fileHandle.getNumberOfPages() << setw(8) << getHeight(fileHandle)
+			<< setw(16) << "-" << fixed
+			<< setprecision(1) << setw(12) << runScan(fileHandle, attributes[0], numOfKeys) << setw(12)
+			<< runScan(fileHandle, attributes[0], numOfKeys, true) << endl;
+	RC rc = indexManager->closeFile(fileHandle);
+	assert(rc == success);
+	rc = indexManager->destroyFile(indexFileName);
+	assert(rc == success);
+
+	runChurn(attributes[0], numOfChurnKeys);
+
+	runConcurrency(attributes[0], numOfKeys, max(numOfLookups / maxThreads, 1), maxThreads);
+
+	return 0;
+}
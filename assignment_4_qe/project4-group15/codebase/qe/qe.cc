@@ -54,6 +54,25 @@ int getTupleLength(const void *tuple, vector<Attribute> attrs) {
 }
 
 
+RC exportIterator(Iterator &input, const string &fileName, const FileFormat format) {
+	vector<Attribute> attrs;
+	input.getAttributes(attrs);
+
+	RM_ExportWriter writer;
+	RC rc = writer.open(fileName, attrs, format);
+	if (rc != 0)
+		return rc;
+
+	void *data = malloc(PAGE_SIZE);
+	while (rc == 0 && input.getNextTuple(data) != QE_EOF)
+		rc = writer.addTuple(data);
+	free(data);
+
+	RC closeRc = writer.close();
+	return rc == 0 ? closeRc : rc;
+}
+
+
 // compare two attribute
 bool compareField(const void *attribute, const void *condition, AttrType type, CompOp compOp) {
 	if (condition == NULL)
@@ -10,6 +10,7 @@
 #include "../ix/ix.h"
 
 # define QE_EOF (-1)  // end of the index scan
+# define INDEX_SCAN_BATCH_SIZE 64  // number of index entries whose tuples are fetched together
 
 using namespace std;
 
@@ -37,6 +38,10 @@ struct Condition {
 };
 
 
+// get tuple length given tuple and descriptor
+int getTupleLength(const void *tuple, vector<Attribute> attrs);
+
+
 class Iterator {
     // All the relational operators and access methods are iterators.
     public:
@@ -46,6 +51,11 @@ class Iterator {
 };
 
 
+// write every tuple of input to fileName, see RelationManager::exportTable; the tuples are written in the order
+// of the iterator, one batch buffered at a time
+RC exportIterator(Iterator &input, const string &fileName, const FileFormat format);
+
+
 class TableScan : public Iterator
 {
     // A wrapper inheriting Iterator over RM_ScanIterator
@@ -58,11 +68,40 @@ class TableScan : public Iterator
         vector<string> attrNames;
         RID rid;
 
+        // condition pushed into the scan, see the constructor below
+        string conditionAttribute;
+        CompOp compOp;
+        void *value;
+
         TableScan(RelationManager &rm, const string &tableName, const char *alias = NULL):rm(rm)
+        {
+            initialize(tableName, "", NO_OP, NULL, alias);
+        };
+
+        // only the tuples matching "condition" (against a value) are returned; on a partitioned table the
+        // partitions which cannot match are not read. The value must stay valid while the scan is in use.
+        // A condition between two attributes is not pushed, all tuples are returned as by the constructor above.
+        TableScan(RelationManager &rm, const string &tableName, const Condition &condition, const char *alias = NULL):rm(rm)
+        {
+            if (condition.bRhsIsAttr) {
+                initialize(tableName, "", NO_OP, NULL, alias);
+                return;
+            }
+
+            // the attribute may be qualified with the table name or the alias
+            string attribute = condition.lhsAttr.substr(condition.lhsAttr.find('.') + 1);
+            initialize(tableName, attribute, condition.op, condition.rhsValue.data, alias);
+        };
+
+        void initialize(const string &tableName, const string &conditionAttribute, const CompOp compOp, void *value,
+                        const char *alias)
         {
         	//Set members
         	this->tableName = tableName;
         	this->originalTableName = tableName;
+        	this->conditionAttribute = conditionAttribute;
+        	this->compOp = compOp;
+        	this->value = value;
 
             // Get Attributes from RM
             rm.getAttributes(tableName, attrs);
@@ -77,7 +116,7 @@ class TableScan : public Iterator
 
             // Call rm scan to get iterator
             iter = new RM_ScanIterator();
-            rm.scan(tableName, "", NO_OP, NULL, attrNames, *iter);
+            rm.scan(tableName, conditionAttribute, compOp, value, attrNames, *iter);
 
             // Set alias
             if(alias) this->tableName = alias;
@@ -89,7 +128,7 @@ class TableScan : public Iterator
             iter->close();
             delete iter;
             iter = new RM_ScanIterator();
-            rm.scan(originalTableName, "", NO_OP, NULL, attrNames, *iter);
+            rm.scan(originalTableName, conditionAttribute, compOp, value, attrNames, *iter);
         };
 
         RC getNextTuple(void *data)
@@ -133,25 +172,87 @@ class IndexScan : public Iterator
         char key[PAGE_SIZE];
         RID rid;
 
+        // tuples are fetched in batches through readTuples, which reads every heap page once per batch
+        vector<RID> batchRids;
+        vector<void *> batchTuples;
+        unsigned batchPos;
+
+        // projected scan: attrs are the projected attributes, tableAttrs all attributes of the table
+        vector<string> projectedNames;
+        vector<Attribute> tableAttrs;
+        vector<unsigned> projectedPositions; // position in tableAttrs of every projected attribute
+        bool isCovering; // the index holds every projected attribute, the table is not read
+
         IndexScan(RelationManager &rm, const string &tableName, const string &attrName, const char *alias = NULL):rm(rm)
+        {
+            initialize(tableName, attrName, vector<string>(), alias);
+        };
+
+        // tuples projected to attrNames; when the index covers them (RelationManager::createIndex with included
+        // attributes) they are built from the index entries alone
+        IndexScan(RelationManager &rm, const string &tableName, const string &attrName, const vector<string> &attrNames,
+                  const char *alias = NULL):rm(rm)
+        {
+            initialize(tableName, attrName, attrNames, alias);
+        };
+
+        void initialize(const string &tableName, const string &attrName, const vector<string> &attrNames, const char *alias)
         {
         	// Set members
         	this->tableName = tableName;
         	this->originalTableName = tableName;
         	this->attrName = attrName;
+        	this->batchPos = 0;
+        	this->projectedNames = attrNames;
+        	this->isCovering = false;
+
+        	for (unsigned i = 0; i < INDEX_SCAN_BATCH_SIZE; i++)
+        		batchTuples.push_back(malloc(PAGE_SIZE));
 
 
             // Get Attributes from RM
-            rm.getAttributes(tableName, attrs);
+            rm.getAttributes(tableName, tableAttrs);
+            attrs = tableAttrs;
+
+            if(!projectedNames.empty())
+            {
+                attrs.clear();
+                for(unsigned i = 0; i < projectedNames.size(); i++)
+                {
+                    for(unsigned j = 0; j < tableAttrs.size(); j++)
+                    {
+                        if(tableAttrs[j].name == projectedNames[i])
+                        {
+                            attrs.push_back(tableAttrs[j]);
+                            projectedPositions.push_back(j);
+                            break;
+                        }
+                    }
+                }
+            }
 
-            // Call rm indexScan to get iterator
+            // Call rm indexScan to get iterator, an index-only scan whenever the index has every projected attribute
             iter = new RM_IndexScanIterator();
-            rm.indexScan(tableName, attrName, NULL, NULL, true, true, *iter);
+            if(!projectedNames.empty())
+                isCovering = rm.indexScan(tableName, attrName, NULL, NULL, true, true, projectedNames, *iter) == 0;
+            if(!isCovering)
+                rm.indexScan(tableName, attrName, NULL, NULL, true, true, *iter);
 
             // Set alias
             if(alias) this->tableName = alias;
         };
 
+        void openIterator(void *lowKey, void *highKey, bool lowKeyInclusive, bool highKeyInclusive)
+        {
+            iter = new RM_IndexScanIterator();
+            if(isCovering)
+                rm.indexScan(originalTableName, attrName, lowKey, highKey, lowKeyInclusive,
+                               highKeyInclusive, projectedNames, *iter);
+            else
+                rm.indexScan(originalTableName, attrName, lowKey, highKey, lowKeyInclusive,
+                               highKeyInclusive, *iter);
+        };
+
         // Start a new iterator given the new key range
         void setIterator(void* lowKey,
                          void* highKey,
@@ -160,18 +261,74 @@ class IndexScan : public Iterator
         {
             iter->close();
             delete iter;
-            iter = new RM_IndexScanIterator();
-            rm.indexScan(originalTableName, attrName, lowKey, highKey, lowKeyInclusive,
-                           highKeyInclusive, *iter);
+            openIterator(lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+
+            // drop what is left of the previous range
+            batchRids.clear();
+            batchPos = 0;
         };
 
         RC getNextTuple(void *data)
         {
-            int rc = iter->getNextEntry(rid, key);
-            if(rc == 0)
+            if(isCovering)
+                return iter->getNextTuple(rid, data) == 0 ? 0 : QE_EOF;
+
+            if(batchPos >= batchRids.size())
+            {
+                int rc = fetchBatch();
+                if(rc != 0)
+                    return rc;
+            }
+
+            rid = batchRids[batchPos];
+            if(projectedNames.empty())
+                memcpy(data, batchTuples[batchPos], getTupleLength(batchTuples[batchPos], attrs));
+            else
+                projectTuple(batchTuples[batchPos], data);
+            batchPos++;
+            return 0;
+        };
+
+        // copy the projected attributes of a table tuple
+        void projectTuple(const void *tuple, void *data)
+        {
+            vector<int> fieldOffsets(tableAttrs.size());
+            int offset = 0;
+            for(unsigned i = 0; i < tableAttrs.size(); i++)
+            {
+                fieldOffsets[i] = offset;
+                offset += tableAttrs[i].type == TypeVarChar ? sizeof(int) + *(int *)((char *)tuple + offset) : sizeof(int);
+            }
+
+            offset = 0;
+            for(unsigned i = 0; i < projectedPositions.size(); i++)
             {
-                rc = rm.readTuple(tableName.c_str(), rid, data);
+                const char *field = (const char *)tuple + fieldOffsets[projectedPositions[i]];
+                int fieldLength = attrs[i].type == TypeVarChar ? sizeof(int) + *(int *)field : sizeof(int);
+                memcpy((char *)data + offset, field, fieldLength);
+                offset += fieldLength;
             }
+        };
+
+        // read the next INDEX_SCAN_BATCH_SIZE entries of the index, then their tuples in one readTuples call
+        RC fetchBatch()
+        {
+            RID entryRid;
+            batchRids.clear();
+            batchPos = 0;
+
+            while(batchRids.size() < INDEX_SCAN_BATCH_SIZE && iter->getNextEntry(entryRid, key) == 0)
+            {
+                batchRids.push_back(entryRid);
+            }
+
+            if(batchRids.empty())
+                return QE_EOF;
+
+            vector<void *> tuples(batchTuples.begin(), batchTuples.begin() + batchRids.size());
+            int rc = rm.readTuples(originalTableName, batchRids, tuples);
+            if(rc != 0)
+                batchRids.clear();
             return rc;
         };
 
@@ -194,6 +351,9 @@ class IndexScan : public Iterator
         ~IndexScan()
         {
             iter->close();
+
+            for (unsigned i = 0; i < batchTuples.size(); i++)
+                free(batchTuples[i]);
         };
 };
 
@@ -1,5 +1,8 @@
 #include "pfm.h"
 
+#include <unistd.h>
+#include <fcntl.h>
+
 PagedFileManager* PagedFileManager::_pf_manager = 0;
 
 
@@ -55,8 +58,12 @@ RC PagedFileManager::createFile(const char *fileName)
  */
 RC PagedFileManager::destroyFile(const char *fileName)
 {
+	if (fileName == NULL)
+		return -1;
+
 	string name(fileName);
-	if (fileName != NULL && fileDirectory.find(name) == fileDirectory.end()) {
+	lock_guard<mutex> guard(directoryMutex);
+	if (fileDirectory.find(name) == fileDirectory.end()) {
 		return remove(fileName);
 	}
 	return -1;
@@ -93,6 +100,7 @@ RC PagedFileManager::openFile(const char *fileName, FileHandle &fileHandle)
 
 
 	string name(fileName);
+	lock_guard<mutex> guard(directoryMutex);
 	if (fileDirectory.find(name) != fileDirectory.end()) {
 		//if file name exists
 		fileDirectory[name]++;
@@ -128,6 +136,7 @@ RC PagedFileManager::closeFile(FileHandle &fileHandle)
 
 RC PagedFileManager::decrementFileCount(string fileName)
 {
+	lock_guard<mutex> guard(directoryMutex);
 	//make sure the map has entries and the file name exists
     if (fileDirectory.find(fileName) != fileDirectory.end()){
     	unsigned count = fileDirectory[fileName];
@@ -144,6 +153,7 @@ RC PagedFileManager::decrementFileCount(string fileName)
 }
 
 unsigned PagedFileManager::numOfFileHandle(string fileName) {
+	lock_guard<mutex> guard(directoryMutex);
 	if (fileDirectory.find(fileName) == fileDirectory.end())
 		return 0;
 
@@ -159,7 +169,7 @@ bool PagedFileManager::fexist(string filename)
     return true;
 }
 
-FileHandle::FileHandle() : file(NULL)
+FileHandle::FileHandle() : file(NULL), modified(false)
 {
 }
 
@@ -181,11 +191,7 @@ RC FileHandle::readPage(PageNum pageNum, void *data)
 	if (pageNum >= getNumberOfPages())
 		return -1;
 
-	//set file to the beginning of the page
-	if (fseek(file, PAGE_SIZE * pageNum, SEEK_SET) != 0)
-		return -1;
-
-	size_t result = fread(data, 1, PAGE_SIZE, file);
+	ssize_t result = pread(fileno(file), data, PAGE_SIZE, (off_t)PAGE_SIZE * pageNum);
 	return result == PAGE_SIZE ? 0 : -1;
 }
 
@@ -201,11 +207,8 @@ RC FileHandle::writePage(PageNum pageNum, const void *data)
 	if (pageNum >= getNumberOfPages())
 		return -1;
 
-	//set file to the beginning of the page
-	if (fseek(file, PAGE_SIZE * pageNum, SEEK_SET) != 0)
-		return -1;
-
-	size_t result = fwrite(data, 1, PAGE_SIZE, file);
+	modified = true;
+	ssize_t result = pwrite(fileno(file), data, PAGE_SIZE, (off_t)PAGE_SIZE * pageNum);
 	return result == PAGE_SIZE ? 0 : -1;
 }
 
@@ -217,10 +220,49 @@ RC FileHandle::appendPage(const void *data)
 	if (file == NULL)
 		return -1;
 
-    //set file to end
-	fseek(file, 0, SEEK_END);
-    int result = (int) fwrite(data, 1, PAGE_SIZE, file);
-    return result == PAGE_SIZE ? 0 : -1;
+	//write right after the last page
+	modified = true;
+	ssize_t result = pwrite(fileno(file), data, PAGE_SIZE, (off_t)PAGE_SIZE * getNumberOfPages());
+	return result == PAGE_SIZE ? 0 : -1;
+}
+
+/*
+ * This method appends numOfPages consecutive pages held in data with a single write.
+ */
+RC FileHandle::appendPages(const void *data, unsigned numOfPages)
+{
+	if (file == NULL)
+		return -1;
+
+	modified = true;
+	size_t length = (size_t)PAGE_SIZE * numOfPages;
+	ssize_t result = pwrite(fileno(file), data, length, (off_t)PAGE_SIZE * getNumberOfPages());
+	return result == (ssize_t)length ? 0 : -1;
+}
+
+/*
+ * This method shortens the file to its first numOfPages pages with ftruncate, the file and every handle on it stay open.
+ */
+RC FileHandle::truncate(PageNum numOfPages)
+{
+	if (file == NULL || numOfPages > getNumberOfPages())
+		return -1;
+
+	modified = true;
+	return ftruncate(fileno(file), (off_t)PAGE_SIZE * numOfPages) == 0 ? 0 : -1;
+}
+
+/*
+ * This method tells the kernel that the numOfPages pages from pageNum on are read soon, it reads them into its page cache
+ * in the background. It is only a hint: the pages are still read with readPage.
+ */
+RC FileHandle::prefetchPages(PageNum pageNum, unsigned numOfPages)
+{
+	if (file == NULL)
+		return -1;
+
+	int result = posix_fadvise(fileno(file), (off_t)PAGE_SIZE * pageNum, (off_t)PAGE_SIZE * numOfPages, POSIX_FADV_WILLNEED);
+	return result == 0 ? 0 : -1;
 }
 
 /*
@@ -232,9 +274,11 @@ unsigned FileHandle::getNumberOfPages()
 		return 0;
 	}
 
-	fseek(file, 0, SEEK_END);
-	long size = ftell(file);
-	return (unsigned) (size / PAGE_SIZE);
+	struct stat fileStat;
+	if (fstat(fileno(file), &fileStat) != 0)
+		return 0;
+
+	return (unsigned) (fileStat.st_size / PAGE_SIZE);
 }
 
 FILE * FileHandle::getFile() {
@@ -243,6 +287,7 @@ FILE * FileHandle::getFile() {
 
 void FileHandle::setFile(FILE *file) {
 	this->file = file;
+	modified = false;
 }
 
 void FileHandle::setFileName(const char *fileName) {
@@ -256,6 +301,15 @@ std::string FileHandle::getFileName() {
 void FileHandle::clearFile() {
 	fileName.clear();
 	file = NULL;
+	modified = false;
+}
+
+bool FileHandle::isModified() {
+	return modified;
+}
+
+void FileHandle::setModified() {
+	modified = true;
 }
 
 
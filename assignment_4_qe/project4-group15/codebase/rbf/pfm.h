@@ -5,6 +5,7 @@
 #include<map>
 #include<string>
 #include<stdlib.h>
+#include<mutex>
 #include <sys/stat.h>
 
 typedef int RC;
@@ -37,6 +38,7 @@ protected:
 private:
     static PagedFileManager *_pf_manager;
     std::map<std::string, unsigned> fileDirectory;
+    std::mutex directoryMutex;                                        // files are opened and closed from many threads
 };
 
 
@@ -49,17 +51,24 @@ public:
     RC readPage(PageNum pageNum, void *data);                           // Get a specific page
     RC writePage(PageNum pageNum, const void *data);                    // Write a specific page
     RC appendPage(const void *data);                                    // Append a specific page
+    RC appendPages(const void *data, unsigned numOfPages);              // Append numOfPages pages with one write
     unsigned getNumberOfPages();                                        // Get the number of pages in the file
+    RC truncate(PageNum numOfPages);                                    // Drop the pages from numOfPages on, the file stays open
+    RC prefetchPages(PageNum pageNum, unsigned numOfPages);             // Start reading numOfPages pages in the background
+    // pages are read and written with pread/pwrite: no shared file offset, so threads may use the same handle
 
     FILE * getFile();
     void setFile(FILE *file);
     void clearFile();
     void setFileName(const char *fileName);
     string getFileName();
+    bool isModified();                                                  // a page was written or appended through this handle
+    void setModified();
 
 private:
     FILE *file;														// ptr points to the file under handling
     string fileName;
+    bool modified;
 };
 
 #endif
@@ -48,6 +48,8 @@ RC RecordBasedFileManager::createFile(const string &fileName) {
 
 		void *page = malloc(PAGE_SIZE);
 		*(short *)page = 0; // number of pages
+		*(short *)((char *)page + FILL_FACTOR_OFFSET) = FILL_FACTOR_MAGIC;
+		*(short *)((char *)page + FILL_FACTOR_OFFSET + sizeof(short)) = DEFAULT_FILL_FACTOR;
 
 		returnValue = metaFileHandle.appendPage(page);
 
@@ -62,6 +64,7 @@ RC RecordBasedFileManager::createFile(const string &fileName) {
 }
 
 RC RecordBasedFileManager::destroyFile(const string &fileName) {
+	lock_guard<mutex> guard(directoryMutex);
     int returnValue = pfm->destroyFile(fileName.c_str());
 
     if (returnValue == 0) {
@@ -70,6 +73,8 @@ RC RecordBasedFileManager::destroyFile(const string &fileName) {
 
     if (returnValue == 0) { // if successfully destroy file through pfm
     	filePageDirectory.erase(fileName);
+    	fileFillFactor.erase(fileName);
+    	fileUpdateStats.erase(fileName);
     }
 
     //otherwise some other fileHandle may be open, cannot destroy the file
@@ -83,9 +88,11 @@ RC RecordBasedFileManager::destroyFile(const string &fileName) {
  * page sizes is loaded to the map.
  *
  * Format of meta file starting from byte 0:  [short numPagesInFile][short page 0 free size][short page 1 free size]...
+ * The last four bytes of header page 0 hold [short FILL_FACTOR_MAGIC][short fillFactor]
  */
 RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle) {
-	
+	// the whole open runs under the lock: another thread closing the last handle of this file must not drop the entry in between
+	lock_guard<mutex> guard(directoryMutex);
     int returnValue = pfm->openFile(fileName.c_str(), fileHandle);
 
 	if (returnValue == 0) { //successful file open
@@ -98,9 +105,10 @@ RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHand
 				return returnValue;
 
 			vector<short> * spaceLeft = new vector<short>();
+			short fillFactor = DEFAULT_FILL_FACTOR;
 
 			for (unsigned currentHeaderPage = 0; currentHeaderPage < metaFileHandle.getNumberOfPages(); currentHeaderPage++) {
-				returnValue = readHeaderPage(metaFileHandle, currentHeaderPage, spaceLeft);
+				returnValue = readHeaderPage(metaFileHandle, currentHeaderPage, spaceLeft, fillFactor);
 				if (returnValue != 0)
 					return returnValue;
 			}
@@ -108,6 +116,7 @@ RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHand
 			returnValue = pfm->closeFile(metaFileHandle);
 
 			filePageDirectory[fileName] = spaceLeft; //add the file/pageSize entry to the filePageDirectory map
+			fileFillFactor[fileName] = fillFactor;
 		}
 	}
 
@@ -116,8 +125,10 @@ RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHand
 
 /**
  * This method close the file handled by fileHandle, the pageSize vector is written back to its associated meta file
+ * if this handle changed the file.  A handle that only read leaves the meta file alone.
  */
 RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
+	lock_guard<mutex> guard(directoryMutex);
 	int returnValue = -1;
 
 	if (fileHandle.getFile() == NULL || filePageDirectory.find(fileHandle.getFileName()) == filePageDirectory.end()) {
@@ -125,15 +136,35 @@ RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
 	}
 
 	vector<short> * spaceLeft = filePageDirectory[fileHandle.getFileName()];
+
+	if (fileHandle.isModified()) {
+		returnValue = writeMetaFile(fileHandle.getFileName(), spaceLeft, fileFillFactor[fileHandle.getFileName()]);
+		if (returnValue != 0)
+			return returnValue;
+	}
+
+	// if is the only one fileHandle handling this particular file, remove file entry from file page directory;
+	if (pfm->numOfFileHandle(fileHandle.getFileName()) == 1) {
+		delete spaceLeft;
+		filePageDirectory.erase(fileHandle.getFileName());
+		fileFillFactor.erase(fileHandle.getFileName());
+	}
+
+	returnValue = pfm->closeFile(fileHandle);
+	return returnValue;
+}
+
+RC RecordBasedFileManager::writeMetaFile(const string &fileName, vector<short> *spaceLeft, short fillFactor) {
+	int returnValue = 0;
 	unsigned currentPage = 0;
 	unsigned numOfPages = (int)spaceLeft->size();
 	unsigned numOfHeaderPages = numOfPages / HEADER_PAGE_SLOT; // num of pages needed to store information in space left vector
-	if (numOfPages % HEADER_PAGE_SLOT != 0)
+	if (numOfPages % HEADER_PAGE_SLOT != 0 || numOfHeaderPages == 0) // header page 0 always holds the fill factor
 		numOfHeaderPages++;
 
-
 	FileHandle metaFileHandle;
-	pfm->openFile(("meta_" + fileHandle.getFileName()).c_str(), metaFileHandle);
+	if (pfm->openFile(("meta_" + fileName).c_str(), metaFileHandle) != 0)
+		return -1;
 
 	// append extra pages to hold all information in space left vector
 	char *page = (char *)malloc(PAGE_SIZE);
@@ -142,22 +173,37 @@ RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
 	free(page);
 
 	for (unsigned i = 0; i < numOfHeaderPages; i++) {
-		returnValue = writeHeaderPage(metaFileHandle, i, spaceLeft, currentPage);
+		returnValue = writeHeaderPage(metaFileHandle, i, spaceLeft, currentPage, fillFactor);
 
-		if (returnValue != 0)
+		if (returnValue != 0) {
+			pfm->closeFile(metaFileHandle);
 			return returnValue;
+		}
 	}
 
-	pfm->closeFile(metaFileHandle);
-
-	// if is the only one fileHandle handling this particular file, remove file entry from file page directory;
-	if (pfm->numOfFileHandle(fileHandle.getFileName()) == 1) {
-		delete spaceLeft;
-		filePageDirectory.erase(fileHandle.getFileName());
+	// the file got shorter (truncated), drop the header pages of the old pages
+	if (metaFileHandle.getNumberOfPages() > numOfHeaderPages && metaFileHandle.truncate(numOfHeaderPages) != 0) {
+		pfm->closeFile(metaFileHandle);
+		return -1;
 	}
 
-	returnValue = pfm->closeFile(fileHandle);
-	return returnValue;
+	return pfm->closeFile(metaFileHandle);
+}
+
+/**
+ * The directory maps are shared by every thread, entries are looked up under directoryMutex.  The space left vector of
+ * an open file stays in the map until its last handle is closed, its content is guarded by the caller (the RM table lock).
+ */
+bool RecordBasedFileManager::findFile(const string &fileName, vector<short> *&spaceLeft, short &fillFactor) {
+	lock_guard<mutex> guard(directoryMutex);
+
+	map<string, vector<short> * >::iterator it = filePageDirectory.find(fileName);
+	if (it == filePageDirectory.end())
+		return false;
+
+	spaceLeft = it->second;
+	fillFactor = fileFillFactor[fileName];
+	return true;
 }
 
 
@@ -169,7 +215,9 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const vector<Att
 		return returnValue;
 	}
 	//make sure the file entry exists in the directory
-	if(filePageDirectory.find(fileHandle.getFileName()) == filePageDirectory.end()) {
+	vector<short> * spaceLeftVect;
+	short fillFactor;
+	if (!findFile(fileHandle.getFileName(), spaceLeftVect, fillFactor)) {
 		return returnValue;
 	}
 
@@ -177,14 +225,15 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const vector<Att
 	void *record = malloc(recordLength);
 	encodeRecord(recordDescriptor, data, record); // translate record into our format
 
-	vector<short> * spaceLeftVect = filePageDirectory[fileHandle.getFileName()];
+	// bytes every page keeps free for in place growth of its records
+	short reservedSpace = PAGE_SIZE * (100 - fillFactor) / 100;
 
 	char *page = (char *)malloc(PAGE_SIZE);  //create buffer to hold the file's page
 
 	unsigned pageNum = 0;
 	for(; pageNum < spaceLeftVect->size(); pageNum++) {
-		//find the first page that has enough space to hold the record
-		if (recordLength <= (*spaceLeftVect)[pageNum]) {
+		//find the first page that has enough space to hold the record without eating into the reserved space
+		if (recordLength + reservedSpace <= (*spaceLeftVect)[pageNum]) {
 			fileHandle.readPage(pageNum, page);
 			const char *endOfPagePtr = page + PAGE_SIZE;
 			Footer *footerPtr = goToFooter(endOfPagePtr);
@@ -297,8 +346,9 @@ RC RecordBasedFileManager::appendPageWithOneRecord(FileHandle &fileHandle, const
 	// append the newly created page to the file
 	int returnValue = fileHandle.appendPage(page);
 
-	if(returnValue == 0) {
-		vector<short> * pageSizeVector = filePageDirectory[fileHandle.getFileName()];  //add the page to the directory
+	vector<short> * pageSizeVector;
+	short fillFactor;
+	if(returnValue == 0 && findFile(fileHandle.getFileName(), pageSizeVector, fillFactor)) {  //add the page to the directory
 		pageSizeVector->push_back(PAGE_SIZE - recordLength - FOOTER_OVERHEAD - RECORD_OVERHEAD * 2);  //update the available bytes of the page
 	}
 
@@ -306,6 +356,82 @@ RC RecordBasedFileManager::appendPageWithOneRecord(FileHandle &fileHandle, const
 	return returnValue;
 }
 
+/**
+ * Records are packed into a buffer of BULK_APPEND_PAGES pages, a page takes records while they fit with the space reserved
+ * by the fill factor, as insertRecord decides.  The space left of the buffered pages only joins the directory once they
+ * are written, so a failed write leaves the directory matching the file.
+ */
+RC RecordBasedFileManager::appendRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data,
+		const vector<int> &offsets, vector<RID> &rids) {
+	int returnValue = -1;
+	if (fileHandle.getFile() == NULL) {
+		return returnValue;
+	}
+
+	vector<short> *spaceLeftVect;
+	short fillFactor;
+	if (!findFile(fileHandle.getFileName(), spaceLeftVect, fillFactor)) {
+		return returnValue;
+	}
+
+	short reservedSpace = PAGE_SIZE * (100 - fillFactor) / 100;
+
+	char *pages = (char *)malloc(PAGE_SIZE * BULK_APPEND_PAGES);
+	void *record = malloc(PAGE_SIZE);
+	vector<short> pagesSpaceLeft; // space left of the buffered pages, the last one is being filled
+	vector<RID> bufferedRids;
+	unsigned firstPage = fileHandle.getNumberOfPages(); // of the buffer
+	RID rid;
+
+	rids.clear();
+	returnValue = 0;
+	for (unsigned i = 0; i < offsets.size() && returnValue == 0; i++) {
+		const char *tuple = (const char *)data + offsets[i];
+		short recordLength = getRecordLength(recordDescriptor, tuple);
+		encodeRecord(recordDescriptor, tuple, record);
+
+		if (!pagesSpaceLeft.empty() && recordLength + reservedSpace <= pagesSpaceLeft.back()) {
+			char *page = pages + PAGE_SIZE * (pagesSpaceLeft.size() - 1);
+			rid.pageNum = firstPage + pagesSpaceLeft.size() - 1;
+			rid.slotNum = goToFooter(page + PAGE_SIZE)->numOfSlots + 1;
+			appendRecord(page, record, recordLength, rid.slotNum);
+			bufferedRids.push_back(rid);
+			pagesSpaceLeft.back() -= recordLength + RECORD_OVERHEAD;
+			continue;
+		}
+
+		// the record starts a new page, write the buffer out first when it is full
+		if (pagesSpaceLeft.size() == BULK_APPEND_PAGES) {
+			returnValue = fileHandle.appendPages(pages, BULK_APPEND_PAGES);
+			if (returnValue != 0)
+				break;
+			spaceLeftVect->insert(spaceLeftVect->end(), pagesSpaceLeft.begin(), pagesSpaceLeft.end());
+			rids.insert(rids.end(), bufferedRids.begin(), bufferedRids.end());
+			firstPage += pagesSpaceLeft.size();
+			pagesSpaceLeft.clear();
+			bufferedRids.clear();
+		}
+
+		rid.pageNum = firstPage + pagesSpaceLeft.size();
+		rid.slotNum = 1;
+		prepareDataForNewPageWrite(record, pages + PAGE_SIZE * pagesSpaceLeft.size(), recordLength);
+		bufferedRids.push_back(rid);
+		pagesSpaceLeft.push_back(PAGE_SIZE - recordLength - FOOTER_OVERHEAD - RECORD_OVERHEAD * 2);
+	}
+
+	if (returnValue == 0 && !pagesSpaceLeft.empty()) {
+		returnValue = fileHandle.appendPages(pages, pagesSpaceLeft.size());
+		if (returnValue == 0) {
+			spaceLeftVect->insert(spaceLeftVect->end(), pagesSpaceLeft.begin(), pagesSpaceLeft.end());
+			rids.insert(rids.end(), bufferedRids.begin(), bufferedRids.end());
+		}
+	}
+
+	free(record);
+	free(pages);
+	return returnValue;
+}
+
 RC RecordBasedFileManager::prepareDataForNewPageWrite(const void *record, void *page, int recordLength){
 	memcpy(page, record, recordLength);  //write the record to the beginning of the file
 
@@ -359,11 +485,18 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 		return returnValue;
 	}
     
-	if(filePageDirectory.find(fileHandle.getFileName()) == filePageDirectory.end()) {
+	vector<short> *spaceLeftVect;
+	short fillFactor;
+	if(!findFile(fileHandle.getFileName(), spaceLeftVect, fillFactor)) {
 		return returnValue;
 	}
-    
-	vector<short> *spaceLeftVect = filePageDirectory[fileHandle.getFileName()];
+
+	ForwardingStats *updateStatsPtr;
+	{
+		lock_guard<mutex> guard(directoryMutex);
+		updateStatsPtr = &fileUpdateStats[fileHandle.getFileName()]; // map nodes do not move, the counters are updated under the table lock
+	}
+	ForwardingStats &updateStats = *updateStatsPtr;
     
 	unsigned pageNum = rid.pageNum;
 	unsigned slotNum = rid.slotNum;
@@ -376,6 +509,7 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 	char *page = (char *)malloc(PAGE_SIZE);
 	returnValue = fileHandle.readPage(pageNum, page);
 	if (returnValue != 0) {
+		free(updatedRecord);
 		free(page);
 		return returnValue;
 	}
@@ -385,6 +519,7 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 	Slot *slotPtr = goToSlot(endOfPagePtr, slotNum);
 	// make sure this record is not deleted
 	if (slotPtr->beginAddr < 0) {
+		free(updatedRecord);
 		free(page);
 		return -1;
 	}
@@ -399,6 +534,7 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 		replaceRid.slotNum = slotNum;
 		returnValue = deleteRecord(fileHandle, recordDescriptor, replaceRid);
 		if (returnValue != 0) {
+			free(updatedRecord);
 			free(page);
 			return returnValue;
 		}
@@ -412,12 +548,14 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 		(*spaceLeftVect)[oriPageNum] = temp;
         
 		if (returnValue != 0) {
+			free(updatedRecord);
 			free(page);
 			return returnValue;
 		}
         
 		// change the content in this tomb stone
 		setAsTomb(recordPtr, replaceRid.pageNum, replaceRid.slotNum);
+		updateStats.numOfForwardingUpdates++;
 	}
 	else {
 		short oriRecordLength = slotPtr->endAddr - slotPtr->beginAddr;
@@ -430,6 +568,38 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 			slotPtr->endAddr = slotPtr->beginAddr + updatedRecordLength;
 			// release free space
 			(*spaceLeftVect)[oriPageNum] += oriRecordLength - updatedRecordLength;
+			updateStats.numOfInPlaceUpdates++;
+		}
+		// the record grows, but its page still has room for it (e.g. the space reserved by the fill factor)
+		else if (updatedRecordLength - oriRecordLength <= (*spaceLeftVect)[oriPageNum]) {
+			Footer *footerPtr = goToFooter(endOfPagePtr);
+			short freeSpaceLeft = PAGE_SIZE - footerPtr->freeSpaceOffset - FOOTER_OVERHEAD - RECORD_OVERHEAD * footerPtr->numOfSlots;
+
+			if (freeSpaceLeft < updatedRecordLength) {
+				// release the old record so that reorganizePage compacts it away, the slot is kept for this record
+				slotPtr->beginAddr = -1 - slotPtr->beginAddr;
+				returnValue = fileHandle.writePage(oriPageNum, page);
+				if (returnValue == 0)
+					returnValue = reorganizePage(fileHandle, recordDescriptor, oriPageNum);
+				if (returnValue == 0)
+					returnValue = fileHandle.readPage(oriPageNum, page); // reload page
+				if (returnValue != 0) {
+					free(updatedRecord);
+					free(page);
+					return returnValue;
+				}
+
+				// reorganizePage has recomputed the free space without the old record
+				(*spaceLeftVect)[oriPageNum] -= updatedRecordLength;
+			}
+			else {
+				// the old record becomes a hole which will be reclaimed by the next reorganization
+				(*spaceLeftVect)[oriPageNum] -= updatedRecordLength - oriRecordLength;
+			}
+
+			// write the record in the free space zone and point its slot to the new place
+			appendRecord(page, updatedRecord, updatedRecordLength, slotNum);
+			updateStats.numOfInPlaceUpdates++;
 		}
 		else {
 			RID replaceRid;
@@ -440,6 +610,7 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
             
 			(*spaceLeftVect)[oriPageNum] = temp;
 			if (returnValue != 0) {
+				free(updatedRecord);
 				free(page);
 				return returnValue;
 			}
@@ -450,11 +621,14 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Att
 			slotPtr->endAddr = slotPtr->beginAddr + SMALLEST_RECORD_LENGTH;
 			// release free space
 			(*spaceLeftVect)[oriPageNum] += oriRecordLength - SMALLEST_RECORD_LENGTH;
+			updateStats.numOfForwardingUpdates++;
 		}
 	}
+	updateStats.numOfUpdates++;
     
 	returnValue = fileHandle.writePage(oriPageNum, page);
     
+	free(updatedRecord);
 	free(page);
 	return returnValue;
 }
@@ -506,6 +680,68 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const vector<Attri
 }
 
 
+/**
+ * rids are sorted by page and slot so that the pages are visited in file order and each page is read once.
+ * records which have been forwarded are collected and visited in the next round, again in file order.
+ */
+RC RecordBasedFileManager::readRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<RID> &rids, const vector<void *> &data) {
+	if (fileHandle.getFile() == NULL || rids.size() != data.size()) {
+		return -1;
+	}
+
+	// [pageNum << 32 | slotNum -> position in rids]
+	vector< pair<unsigned long long, unsigned> > pending;
+	vector< pair<unsigned long long, unsigned> > forwarded;
+	for (unsigned i = 0; i < rids.size(); i++)
+		pending.push_back(make_pair(((unsigned long long)rids[i].pageNum << 32) | rids[i].slotNum, i));
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	const char *endOfPagePtr = page + PAGE_SIZE;
+	bool isPageLoaded = false;
+	unsigned currentPageNum = 0;
+
+	while (!pending.empty()) {
+		sort(pending.begin(), pending.end());
+		forwarded.clear();
+
+		for (unsigned i = 0; i < pending.size(); i++) {
+			unsigned pageNum = (unsigned)(pending[i].first >> 32);
+			unsigned slotNum = (unsigned)(pending[i].first & 0xFFFFFFFF);
+
+			if (!isPageLoaded || pageNum != currentPageNum) {
+				if (fileHandle.readPage(pageNum, page) != 0) {
+					free(page);
+					return -1;
+				}
+				isPageLoaded = true;
+				currentPageNum = pageNum;
+			}
+
+			// make sure this slot exists and is not deleted
+			Footer *footerPtr = goToFooter(endOfPagePtr);
+			Slot *slotPtr = goToSlot(endOfPagePtr, slotNum);
+			if (slotNum == 0 || slotNum > (unsigned)footerPtr->numOfSlots || slotPtr->beginAddr < 0) {
+				free(page);
+				return -1;
+			}
+
+			char *recordPtr = page + slotPtr->beginAddr;
+			if (isTombStone(recordPtr, pageNum, slotNum)) {
+				forwarded.push_back(make_pair(((unsigned long long)pageNum << 32) | slotNum, pending[i].second));
+				continue;
+			}
+
+			decodeRecord(recordDescriptor, recordPtr, data[pending[i].second]);
+		}
+
+		pending.swap(forwarded);
+	}
+
+	free(page);
+	return 0;
+}
+
+
 RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string attributeName, void *data) {
 	int returnValue = -1;
 
@@ -518,7 +754,7 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<At
 	AttrType type;
 	for (; attributeNum < recordDescriptor.size(); attributeNum++) {
 		Attribute attr = recordDescriptor[attributeNum];
-		if (attr.name.compare(attributeName) == 0) {
+		if (!attr.isDropped && attr.name.compare(attributeName) == 0) {
 			type = attr.type;
 			break;
 		}
@@ -549,7 +785,10 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<At
 		char *recordPtr = page + slotPtr->beginAddr; // go to the record
 		isTomb = isTombStone(recordPtr, pageNum, slotNum); // read tomb flag
 
-		if (!isTomb) {
+		if (!isTomb && (short)attributeNum >= getNumOfFields(recordPtr)) {
+			memset(data, 0, sizeof(int)); // added after this record was written
+		}
+		else if (!isTomb) {
 			short attrBeginAddr = *((short *)(recordPtr + sizeof(short) * (attributeNum + 1))); // read attribute start address
 			short attrEndAddr = *((short *)(recordPtr + sizeof(short) * (attributeNum + 2))); // read attribute end address
 			int attrLength = (int)(attrEndAddr - attrBeginAddr);
@@ -579,12 +818,12 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Att
 		return returnValue;
 	}
 
-	if(filePageDirectory.find(fileHandle.getFileName()) == filePageDirectory.end()) {
+	vector<short> *spaceLeftVect;
+	short fillFactor;
+	if(!findFile(fileHandle.getFileName(), spaceLeftVect, fillFactor)) {
 		return returnValue;
 	}
 
-	vector<short> *spaceLeftVect = filePageDirectory[fileHandle.getFileName()];
-
 	unsigned pageNum = rid.pageNum;
 	unsigned slotNum = rid.slotNum;
 
@@ -626,23 +865,27 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Att
 	return returnValue;
 }
 
+/**
+ * Truncate the file in place: the file goes back to zero pages, its space left vector (shared by every open handle
+ * of the file) is emptied and the meta file is written right away.  Files, handles and the fill factor are kept.
+ */
 RC RecordBasedFileManager::deleteRecords(FileHandle & fileHandle) {
 	int returnValue = -1;
 
 	string fileName = fileHandle.getFileName();
-	if (closeFile(fileHandle) != 0)
+	vector<short> *spaceLeft;
+	short fillFactor;
+	if (fileHandle.getFile() == NULL || !findFile(fileName, spaceLeft, fillFactor))
 		return returnValue;
 
-	if (destroyFile(fileName) != 0)
+	if (fileHandle.truncate(0) != 0)
 		return returnValue;
 
-	if (createFile(fileName) != 0)
-		return returnValue;
-
-	if (openFile(fileName, fileHandle) != 0)
-		return returnValue;
+	lock_guard<mutex> guard(directoryMutex);
+	spaceLeft->clear();
+	fileUpdateStats.erase(fileName);
 
-	return 0;
+	return writeMetaFile(fileName, spaceLeft, fillFactor);
 }
 
 RC RecordBasedFileManager::reorganizePage(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const unsigned pageNumber) {
@@ -651,12 +894,12 @@ RC RecordBasedFileManager::reorganizePage(FileHandle &fileHandle, const vector<A
 		return returnValue;
 	}
 
-	if(filePageDirectory.find(fileHandle.getFileName()) == filePageDirectory.end()) {
+	vector<short> *spaceLeftVect;
+	short fillFactor;
+	if(!findFile(fileHandle.getFileName(), spaceLeftVect, fillFactor)) {
 		return returnValue;
 	}
 
-	vector<short> *spaceLeftVect = filePageDirectory[fileHandle.getFileName()];
-
 	char *page = (char *)malloc(PAGE_SIZE);
 	char *reorgPage = (char *)malloc(PAGE_SIZE);
 	returnValue = fileHandle.readPage(pageNumber, page);
@@ -709,6 +952,130 @@ RC RecordBasedFileManager::reorganizePage(FileHandle &fileHandle, const vector<A
 	return returnValue;
 };
 
+/**
+ * re-encodes the outdated records of one page with recordDescriptor through updateRecord;
+ * only a record which stays in its slot's page is rewritten, so no tomb stone is created by the upgrade
+ */
+RC RecordBasedFileManager::upgradePage(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const unsigned pageNumber) {
+	int returnValue = -1;
+	if(fileHandle.getFile() == NULL) {
+		return returnValue;
+	}
+
+	vector<short> *spaceLeftVect;
+	short fillFactor;
+	if(!findFile(fileHandle.getFileName(), spaceLeftVect, fillFactor)) {
+		return returnValue;
+	}
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	void *data = malloc(PAGE_SIZE);
+	returnValue = fileHandle.readPage(pageNumber, page);
+
+	const char *endOfPagePtr = page + PAGE_SIZE;
+	short numOfSlots = returnValue == 0 ? goToFooter(endOfPagePtr)->numOfSlots : 0;
+
+	for (short slotNum = 1; slotNum <= numOfSlots && returnValue == 0; slotNum++) {
+		Slot *slotPtr = goToSlot(endOfPagePtr, slotNum);
+		if (slotPtr->beginAddr < 0 || slotPtr->endAddr == 0) // deleted or recycled slot
+			continue;
+
+		char *recordPtr = page + slotPtr->beginAddr;
+		unsigned pageNum, replaceSlotNum;
+		if (isTombStone(recordPtr, pageNum, replaceSlotNum) || !isOutdated(recordDescriptor, recordPtr))
+			continue;
+
+		decodeRecord(recordDescriptor, recordPtr, data);
+		short recordLength = slotPtr->endAddr - slotPtr->beginAddr;
+		short updatedRecordLength = getRecordLength(recordDescriptor, data);
+		if (updatedRecordLength - recordLength > (*spaceLeftVect)[pageNumber])
+			continue;
+
+		RID rid;
+		rid.pageNum = pageNumber;
+		rid.slotNum = slotNum;
+		returnValue = updateRecord(fileHandle, recordDescriptor, data, rid);
+		if (returnValue == 0)
+			returnValue = fileHandle.readPage(pageNumber, page); // reload page
+	}
+
+	free(data);
+	free(page);
+	return returnValue;
+}
+
+RC RecordBasedFileManager::setFillFactor(FileHandle &fileHandle, const short fillFactor) {
+	lock_guard<mutex> guard(directoryMutex);
+	if (fileHandle.getFile() == NULL || filePageDirectory.find(fileHandle.getFileName()) == filePageDirectory.end())
+		return -1;
+
+	if (fillFactor < MIN_FILL_FACTOR || fillFactor > 100)
+		return -1;
+
+	// written back to the meta file on closeFile
+	fileFillFactor[fileHandle.getFileName()] = fillFactor;
+	fileHandle.setModified();
+	return 0;
+}
+
+RC RecordBasedFileManager::getFillFactor(FileHandle &fileHandle, short &fillFactor) {
+	lock_guard<mutex> guard(directoryMutex);
+	if (fileHandle.getFile() == NULL || fileFillFactor.find(fileHandle.getFileName()) == fileFillFactor.end())
+		return -1;
+
+	fillFactor = fileFillFactor[fileHandle.getFileName()];
+	return 0;
+}
+
+/**
+ * this method walks through every page of the file, counting live records and tomb stones.
+ * forwarding rate of the file is numOfForwarded / numOfRecords
+ */
+RC RecordBasedFileManager::getForwardingStats(FileHandle &fileHandle, ForwardingStats &stats) {
+	if (fileHandle.getFile() == NULL)
+		return -1;
+
+	// update counters are kept per file name for the life time of this process
+	unique_lock<mutex> guard(directoryMutex);
+	if (fileUpdateStats.find(fileHandle.getFileName()) != fileUpdateStats.end())
+		stats = fileUpdateStats[fileHandle.getFileName()];
+	else
+		memset(&stats, 0, sizeof(ForwardingStats));
+	guard.unlock();
+
+	stats.numOfPages = fileHandle.getNumberOfPages();
+	stats.numOfRecords = 0;
+	stats.numOfForwarded = 0;
+
+	char *page = (char *)malloc(PAGE_SIZE);
+	unsigned tombPageNum, tombSlotNum;
+
+	for (unsigned pageNum = 0; pageNum < stats.numOfPages; pageNum++) {
+		if (fileHandle.readPage(pageNum, page) != 0) {
+			free(page);
+			return -1;
+		}
+
+		const char *endOfPagePtr = page + PAGE_SIZE;
+		Footer *footerPtr = goToFooter(endOfPagePtr);
+		Slot *slotPtr = goToSlot(endOfPagePtr, 1);
+
+		for (short i = 0; i < footerPtr->numOfSlots; i++, slotPtr--) {
+			// deleted slot, or a slot recycled by reorganizePage
+			if (slotPtr->beginAddr < 0 || (slotPtr->beginAddr == 0 && slotPtr->endAddr == 0))
+				continue;
+
+			if (isTombStone(page + slotPtr->beginAddr, tombPageNum, tombSlotNum))
+				stats.numOfForwarded++;
+			else
+				stats.numOfRecords++;
+		}
+	}
+
+	free(page);
+	return 0;
+}
+
 
 
 RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor, const void *data) {
@@ -783,6 +1150,9 @@ short RecordBasedFileManager::getRecordLength(const vector<Attribute> &recordDes
 
 		Attribute attr = recordDescriptor[i];
 
+		if (attr.isDropped)
+			continue;
+
 		if (attr.type == TypeInt) {
 			length += attr.length;
 			offset += attr.length;
@@ -830,6 +1200,9 @@ RC RecordBasedFileManager::encodeRecord(const vector<Attribute> recordDescriptor
 
 		Attribute attr = recordDescriptor[i];
 
+		if (attr.isDropped) // empty field, keeps the position of the fields after it
+			continue;
+
 		if (attr.type == TypeInt) {
 			memcpy((char*)outputRecord + outputOffset, (char*)inputRecord + inputOffset, sizeof(int));
 			inputOffset += sizeof(int);
@@ -859,9 +1232,21 @@ RC RecordBasedFileManager::encodeRecord(const vector<Attribute> recordDescriptor
 RC RecordBasedFileManager::decodeRecord(const vector<Attribute> recordDescriptor, const void *inputRecord, void *outputRecord) {
 	short inputStart = 0;
 	short outputOffset = 0;
+	short numOfFields = getNumOfFields(inputRecord);
 
 	for (unsigned i = 0; i < recordDescriptor.size(); i++) {
 		Attribute attr = recordDescriptor[i];
+
+		if (attr.isDropped)
+			continue;
+
+		// added after this record was written
+		if ((short)i >= numOfFields) {
+			memset((char *)outputRecord + outputOffset, 0, sizeof(int));
+			outputOffset += sizeof(int);
+			continue;
+		}
+
 		inputStart = *((short *)inputRecord + i + 1);
 
 		if (attr.type == TypeInt) {
@@ -886,10 +1271,25 @@ RC RecordBasedFileManager::decodeRecord(const vector<Attribute> recordDescriptor
 	return 0;
 }
 
+/**
+ * true if the record was encoded with an older version of recordDescriptor
+ */
+bool RecordBasedFileManager::isOutdated(const vector<Attribute> &recordDescriptor, const void *record) {
+	short numOfFields = getNumOfFields(record);
+	if (numOfFields < (short)recordDescriptor.size())
+		return true;
+
+	for (short i = 0; i < numOfFields && i < (short)recordDescriptor.size(); i++) {
+		if (recordDescriptor[i].isDropped && *((short *)record + i + 2) != *((short *)record + i + 1))
+			return true;
+	}
+	return false;
+}
+
 /**
  * this method read one single page into vector "spaceLeft"
  */
-RC RecordBasedFileManager::readHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft) {
+RC RecordBasedFileManager::readHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft, short &fillFactor) {
 	char *page = (char *)malloc(PAGE_SIZE);
 
 	int returnValue = metaFileHandle.readPage(currentHeaderPage, page);
@@ -900,6 +1300,9 @@ RC RecordBasedFileManager::readHeaderPage(FileHandle &metaFileHandle, unsigned c
 
 		for (short i = 1; i <= numOfPages; i++)
 			spaceLeft->push_back(*((short *)(page + sizeof(short) * i)));
+
+		if (currentHeaderPage == 0)
+			fillFactor = readFillFactor(page);
 	}
 
 	free(page);
@@ -910,7 +1313,7 @@ RC RecordBasedFileManager::readHeaderPage(FileHandle &metaFileHandle, unsigned c
  * this method write free space information in vector "spaceLeft" to one single headerPage
  * NOTE: every header page is allow to store HEADER_PAGE_SLOT entries of free space information
  */
-RC RecordBasedFileManager::writeHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft, unsigned &currentPage) {
+RC RecordBasedFileManager::writeHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft, unsigned &currentPage, short fillFactor) {
 	int returnValue = -1;
 	char *page = (char *)malloc(PAGE_SIZE);
 	short numOfPage = 0;
@@ -925,12 +1328,31 @@ RC RecordBasedFileManager::writeHeaderPage(FileHandle &metaFileHandle, unsigned
 
 	*(short *)page = numOfPage; // write numOfPage info in the first two bytes
 
+	if (currentHeaderPage == 0) {
+		*(short *)(page + FILL_FACTOR_OFFSET) = FILL_FACTOR_MAGIC;
+		*(short *)(page + FILL_FACTOR_OFFSET + sizeof(short)) = fillFactor;
+	}
+
 	returnValue = metaFileHandle.writePage(currentHeaderPage, page);
 	free(page);
 
 	return returnValue;
 }
 
+/**
+ * meta files created before the fill factor was introduced do not carry the magic number, they get the default
+ */
+short RecordBasedFileManager::readFillFactor(const char *headerPage) {
+	if (*(short *)(headerPage + FILL_FACTOR_OFFSET) != FILL_FACTOR_MAGIC)
+		return DEFAULT_FILL_FACTOR;
+
+	short fillFactor = *(short *)(headerPage + FILL_FACTOR_OFFSET + sizeof(short));
+	if (fillFactor < MIN_FILL_FACTOR || fillFactor > 100)
+		return DEFAULT_FILL_FACTOR;
+
+	return fillFactor;
+}
+
 bool RecordBasedFileManager::fexist(string fileName) {
     return pfm->fexist(fileName);
 }
@@ -946,6 +1368,7 @@ RBFM_ScanIterator::RBFM_ScanIterator() {
     
 	pageNum = 0;
 	slotNum = 0;
+	endPageNum = (unsigned)-1;
     
 	page = NULL;
 	endOfPagePtr = NULL;
@@ -974,7 +1397,7 @@ RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data) {
 			pageNum++;
             
 			// all pages have been scanned
-			if (pageNum >= fileHandle.getNumberOfPages())
+			if (pageNum >= endPageNum || pageNum >= fileHandle.getNumberOfPages())
 				return RBFM_EOF;
             
 			// read next page
@@ -1051,6 +1474,7 @@ RC RBFM_ScanIterator::initialize(FileHandle &fileHandle,
 	this->fileHandle = fileHandle;
 	pageNum = 0;
 	slotNum = 0;
+	endPageNum = (unsigned)-1;
     
 	// read the first record page and set related pointers
 	page = (char *)malloc(PAGE_SIZE);
@@ -1062,6 +1486,9 @@ RC RBFM_ScanIterator::initialize(FileHandle &fileHandle,
     
 	for (unsigned i = 0, j = 0; i < recordDescriptor.size() && j < attributeNames.size(); i++) {
 		Attribute attr = recordDescriptor[i];
+		if (attr.isDropped)
+			continue;
+
 		// find the attribute number and type of condition attribute
 		if (attr.name.compare(conditionAttribute) == 0) {
 			conditionAttrType = attr.type;
@@ -1080,6 +1507,22 @@ RC RBFM_ScanIterator::initialize(FileHandle &fileHandle,
 }
 
 
+RC RBFM_ScanIterator::setPageRange(const unsigned firstPage, const unsigned endPage) {
+	if (page == NULL)
+		return -1;
+
+	pageNum = firstPage;
+	slotNum = 0;
+	endPageNum = endPage;
+
+	// a page out of the range reads as a page without slots
+	memset(page, 0, PAGE_SIZE);
+	if (pageNum < endPageNum)
+		fileHandle.readPage(pageNum, page);
+
+	return 0;
+}
+
 /*
  * this method compare the value of attribute with condition
  */
@@ -1154,6 +1597,13 @@ bool RBFM_ScanIterator::compare(void *attribute, const void *condition, AttrType
  * and save the length of this attribute in attrLength
  */
 RC RBFM_ScanIterator::readAttr(char *recordPtr, void *attribute, short attrNum, AttrType type, int &attrLength) {
+	// added after this record was written
+	if (attrNum >= getNumOfFields(recordPtr)) {
+		memset(attribute, 0, sizeof(int));
+		attrLength = sizeof(int);
+		return 0;
+	}
+
 	short attrBeginAddr = *(short *)(recordPtr + sizeof(short) * (attrNum + 1));
 	short attrEndAddr = *(short *)(recordPtr + sizeof(short) * (attrNum + 2));
 	attrLength = (int)(attrEndAddr - attrBeginAddr);
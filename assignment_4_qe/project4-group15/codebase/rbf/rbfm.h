@@ -5,7 +5,9 @@
 #include <string.h>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 #include <stdlib.h>
+#include <mutex>
 
 #include "../rbf/pfm.h"
 
@@ -29,6 +31,7 @@ struct Attribute {
 	string   name;     // attribute name
 	AttrType type;     // attribute type
 	AttrLength length; // attribute length
+	bool     isDropped = false; // dropped from the table, the field takes no bytes in the data and is left empty in records
 };
 
 struct Slot {
@@ -42,6 +45,22 @@ struct Footer {
 	short freeSpaceOffset;
 };
 
+// number of fields stored in a record; a record written before an attribute was added has fewer fields than the
+// descriptor, the missing ones read as 0 or an empty varchar
+inline short getNumOfFields(const void *record) {
+	return *((const short *)record + 1) / sizeof(short) - 2;
+}
+
+// forwarding statistics of a record file, used to tune the fill factor
+struct ForwardingStats {
+	unsigned numOfPages;
+	unsigned numOfRecords; // live records, a forwarded record is counted once
+	unsigned numOfForwarded; // records reached through a tomb stone
+	unsigned numOfUpdates; // updates issued since the file was first opened by this process
+	unsigned numOfInPlaceUpdates; // updates which kept the record in its home page
+	unsigned numOfForwardingUpdates; // updates which turned the record into a tomb stone
+};
+
 // Comparison Operator (NOT needed for part 1 of the project)
 typedef enum { EQ_OP = 0,  // =
 	LT_OP,      // <
@@ -63,6 +82,11 @@ typedef enum { EQ_OP = 0,  // =
 # define RECORD_OVERHEAD sizeof(Slot)
 # define FOOTER_OVERHEAD sizeof(Footer)
 # define SMALLEST_RECORD_LENGTH 10
+# define DEFAULT_FILL_FACTOR 100 // percentage of a page insertRecord is allowed to fill
+# define MIN_FILL_FACTOR 10
+# define FILL_FACTOR_MAGIC 0x4646 // marks a meta file which stores its fill factor
+# define FILL_FACTOR_OFFSET (PAGE_SIZE - 2 * sizeof(short)) // [short magic][short fillFactor] at the end of header page 0
+# define BULK_APPEND_PAGES 64 // pages appendRecords fills in memory before writing them
 //# define EMPTY_RECORD_PAGE_FREE_SPACE 4090
 
 
@@ -90,6 +114,10 @@ public:
                   const void *value,
                   const vector<string> &attributeNames,
                   const string &conditionAttribute);
+
+	// limit the scan to the pages [firstPage, endPage), called right after RecordBasedFileManager::scan; every live
+	// record is returned by the scan of the page it is stored in, so scans of disjoint ranges return it once
+	RC setPageRange(const unsigned firstPage, const unsigned endPage);
     
 private:
 	CompOp op;
@@ -99,6 +127,7 @@ private:
     
 	unsigned pageNum;
 	unsigned slotNum;
+	unsigned endPageNum;
     
 	FileHandle fileHandle;
     
@@ -147,6 +176,10 @@ public:
 	RC insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid);
     
 	RC readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data);
+
+	// read a batch of records, every page is read once no matter how many of the rids (or their tomb stones) point to it
+	// data[i] receives the record of rids[i], so the caller's order is kept
+	RC readRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<RID> &rids, const vector<void *> &data);
     
 	// This method will be mainly used for debugging/testing
 	RC printRecord(const vector<Attribute> &recordDescriptor, const void *data);
@@ -156,6 +189,13 @@ public:
      IMPORTANT, PLEASE READ: All methods below this comment (other than the constructor and destructor) are NOT required to be implemented for part 1 of the project
 	 ***************************************************************************************************************************************************************
 	 ***************************************************************************************************************************************************************/
+	// bulk insert: the records data + offsets[i] (insertRecord format) go to new pages at the end of the file, filled up to
+	// the fill factor and written BULK_APPEND_PAGES at a time; free space of existing pages is not reused. rids gets the rid
+	// of each record written, after an error only those of the pages which reached the file
+	RC appendRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, const vector<int> &offsets,
+			vector<RID> &rids);
+
+	// remove every record: the file is truncated to zero pages and fileHandle stays open
 	RC deleteRecords(FileHandle &fileHandle);
     
 	RC deleteRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid);
@@ -166,6 +206,18 @@ public:
 	RC readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string attributeName, void *data);
     
 	RC reorganizePage(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const unsigned pageNumber);
+
+	// rewrite the records of a page stored with an older descriptor (fewer fields, or data in a dropped field);
+	// a record which would have to leave the page keeps its old form until its next update
+	RC upgradePage(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const unsigned pageNumber);
+
+	// fill factor is the percentage of a page insertRecord may fill, the rest is kept for in place growth of updated records
+	RC setFillFactor(FileHandle &fileHandle, const short fillFactor);
+
+	RC getFillFactor(FileHandle &fileHandle, short &fillFactor);
+
+	// count live and forwarded records of the file, together with the update counters of this process
+	RC getForwardingStats(FileHandle &fileHandle, ForwardingStats &stats);
     
 	// scan returns an iterator to allow the caller to go through the results one by one.
 	RC scan(FileHandle &fileHandle,
@@ -192,19 +244,28 @@ private:
 	static RecordBasedFileManager *_rbf_manager;
 	PagedFileManager * pfm;
 	map<string, vector<short> * > filePageDirectory;
+	map<string, short> fileFillFactor;
+	map<string, ForwardingStats> fileUpdateStats;
+	mutex directoryMutex; // guards the three maps above, files are opened and closed from many threads
     
 	void readFooter(void *footerPtr, short &reorgFlag, short &freeSpaceOffset, short &numberOfRecords);
 	void initializeFooter(void *endOfPagePtr);
     
+	// space left vector and fill factor of an open file, false if the file is not open
+	bool findFile(const string &fileName, vector<short> *&spaceLeft, short &fillFactor);
+	RC writeMetaFile(const string &fileName, vector<short> *spaceLeft, short fillFactor);
+
 	RC prepareDataForNewPageWrite(const void *data, void *pageData, int dataLength);
 	RC appendPageWithOneRecord(FileHandle &fileHandle, const void *data, int dataLength);
 	// read one single header page, return the number of next header page, -1 if no next header page
-	RC readHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft);
-	RC writeHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft, unsigned &currentPage);
+	RC readHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft, short &fillFactor);
+	RC writeHeaderPage(FileHandle &metaFileHandle, unsigned currentHeaderPage, vector<short> * spaceLeft, unsigned &currentPage, short fillFactor);
+	short readFillFactor(const char *headerPage);
     
 	short getRecordLength(const vector<Attribute> &recordDescriptor, const void *data); //get length of a tuple from descriptor and data
 	RC encodeRecord(const vector<Attribute> recordDescriptor, const void *inputRecord, void *outputRecord);
 	RC decodeRecord(const vector<Attribute> recordDescriptor, const void *inputRecord, void *outputRecord);
+	bool isOutdated(const vector<Attribute> &recordDescriptor, const void *record);
 	RC appendRecord(char *page, const void *record, short recordLength, unsigned slotNum);
     
 	/**
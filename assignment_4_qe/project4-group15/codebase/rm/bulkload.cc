@@ -0,0 +1,36 @@
+#include <iostream>
+#include <chrono>
+
+#include "rm.h"
+
+using namespace std;
+
+// Load a CSV or binary file into a table of the catalog in the current directory, see RelationManager::bulkLoad.
+// usage: bulkload tableName fileName [csv|binary]
+
+int main(int argc, char **argv)
+{
+	if (argc < 3 || (argc > 3 && string(argv[3]) != "csv" && string(argv[3]) != "binary")) {
+		cout << "usage: " << argv[0] << " tableName fileName [csv|binary]" << endl;
+		return 1;
+	}
+
+	string tableName = argv[1];
+	string fileName = argv[2];
+	FileFormat format = argc > 3 && string(argv[3]) == "binary" ? BinaryFile : CSVFile;
+
+	RelationManager *rm = RelationManager::instance();
+	unsigned numOfTuples = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	RC rc = rm->bulkLoad(tableName, fileName, format, numOfTuples);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	cout << numOfTuples << " tuples loaded into " << tableName << " in " << elapsed.count() << " s" << endl;
+	if (rc != 0) {
+		cout << "bulk load of " << fileName << " failed" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,8 +1,57 @@
 
 #include "rm.h"
 #include <iostream>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <climits>
+#include <cerrno>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 RelationManager* RelationManager::_rm = 0;
 
+/**************************************************************************************************************
+ * Locking: DDL holds catalogLock exclusively, every other call holds it shared and then takes the lock of its
+ * table, shared to read and exclusive to write.  Iterators and table handles only take the table lock.
+ * RM calls nest (createIndex -> scan -> getAttributes), so a thread skips a lock it already holds; no call
+ * asks exclusively for a lock its own thread holds shared.
+**************************************************************************************************************/
+static thread_local vector<shared_mutex *> heldLocks;
+
+class RM_LockGuard {
+public:
+	RM_LockGuard(shared_mutex *lock, bool exclusive) : lock(lock), exclusive(exclusive), acquired(false) {
+		if (lock == NULL || find(heldLocks.begin(), heldLocks.end(), lock) != heldLocks.end())
+			return;
+
+		if (exclusive)
+			lock->lock();
+		else
+			lock->lock_shared();
+		heldLocks.push_back(lock);
+		acquired = true;
+	}
+
+	~RM_LockGuard() {
+		if (!acquired)
+			return;
+
+		heldLocks.erase(find(heldLocks.begin(), heldLocks.end(), lock));
+		if (exclusive)
+			lock->unlock();
+		else
+			lock->unlock_shared();
+	}
+
+private:
+	shared_mutex *lock;
+	bool exclusive;
+	bool acquired;
+};
+
 /**************************************************************************************************************
  * Checks the value of _rm and if it is 0, creates a new instance
  * of this class.
@@ -22,20 +71,10 @@ RelationManager::~RelationManager()
     _rm = NULL;
 
     // delete information in tableMap and columnMap
-    for (map<string, map<int, RID> *>::iterator it = tablesMap.begin(); it != tablesMap.end(); ++it) {
-    	delete it->second;
-    }
-
-    for (map<int, map<int, RID> *>::iterator it = columnsMap.begin(); it != columnsMap.end(); ++it) {
-    	delete it->second;
-    }
-
-    for (map<int, map<int, RID> *>::iterator it = indexMap.begin(); it != indexMap.end(); ++it) {
-    	delete it->second;
-    }
+    clearCatalogMaps();
 }
 
-RelationManager::RelationManager() : TABLE_ID_COUNTER(1)
+RelationManager::RelationManager() : TABLE_ID_COUNTER(1), snapshotExists(false)
 {
     //get the instance
     rbfm = RecordBasedFileManager::instance();
@@ -98,6 +137,18 @@ RelationManager::RelationManager() : TABLE_ID_COUNTER(1)
     attr.length = 4;
     attr.type = TypeInt;
     columnVec.push_back(attr);
+
+    // schema version the column was added in and dropped in (0 while it is live),
+    // the schema version of a table is the largest of them
+    attr.name = "SchemaVersion";
+    attr.length = 4;
+    attr.type = TypeInt;
+    columnVec.push_back(attr);
+
+    attr.name = "DroppedVersion";
+    attr.length = 4;
+    attr.type = TypeInt;
+    columnVec.push_back(attr);
     
     attr.name = "TableID";
     attr.length = 4;
@@ -119,15 +170,124 @@ RelationManager::RelationManager() : TABLE_ID_COUNTER(1)
     attr.type = TypeVarChar;
     indexVec.push_back(attr);
 
+    // positions of the columns stored in the entries, separated by ','
+    attr.name = "IncludedColumns";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    indexVec.push_back(attr);
+
+    // positions of the key columns of a composite index separated by ',', empty for an index on one column
+    attr.name = "KeyColumns";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    indexVec.push_back(attr);
+
+    attr.name = "TableId";
+    attr.length = 4;
+    attr.type = TypeInt;
+    statisticsVec.push_back(attr);
+
+    attr.name = "TableName";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    statisticsVec.push_back(attr);
+
+    attr.name = "ColumnPosition";
+    attr.length = 4;
+    attr.type = TypeInt;
+    statisticsVec.push_back(attr);
+
+    attr.name = "ColumnName";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    statisticsVec.push_back(attr);
+
+    attr.name = "NumOfRows";
+    attr.length = 4;
+    attr.type = TypeInt;
+    statisticsVec.push_back(attr);
+
+    attr.name = "NumOfPages";
+    attr.length = 4;
+    attr.type = TypeInt;
+    statisticsVec.push_back(attr);
+
+    attr.name = "NumOfDistinct";
+    attr.length = 4;
+    attr.type = TypeInt;
+    statisticsVec.push_back(attr);
+
+    // min and max keep the raw bytes of the value, whatever the column type is
+    attr.name = "MinValue";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    statisticsVec.push_back(attr);
+
+    attr.name = "MaxValue";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    statisticsVec.push_back(attr);
+
+    // [int numOfBuckets][int numOfRows, upper bound]...
+    attr.name = "Histogram";
+    attr.length = MAX_HISTOGRAM_LENGTH;
+    attr.type = TypeVarChar;
+    statisticsVec.push_back(attr);
+
+    attr.name = "TableId";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
+
+    attr.name = "TableName";
+    attr.length = 256;
+    attr.type = TypeVarChar;
+    partitionsVec.push_back(attr);
+
+    attr.name = "PartitionNumber";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
+
+    attr.name = "PartitionType";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
+
+    attr.name = "ColumnPosition";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
+
+    attr.name = "NumOfPartitions";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
+
+    // bounds of a range partition, INT_MIN and INT_MAX for a hash partition
+    attr.name = "LowKey";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
+
+    attr.name = "HighKey";
+    attr.length = 4;
+    attr.type = TypeInt;
+    partitionsVec.push_back(attr);
 
     //this is not the first time the database has been initialized, load up the maps
     if (rbfm->fexist("tables.tbl")) {
-        loadSystem();
+        // scanning the system tables is only needed when the snapshot is missing or stale
+        if (loadSnapshot() != SUCCESS && loadSystem() == SUCCESS)
+            writeSnapshot();
+        loadPartitions();
     }
     else {
         createTableHelper("tables", tableVec, "System");
         createTableHelper("columns", columnVec, "System");
         createTableHelper("indices", indexVec, "System");
+        createTableHelper("statistics", statisticsVec, "System");
+        createTableHelper("partitions", partitionsVec, "System");
     }
 }
 
@@ -232,142 +392,569 @@ RC RelationManager::loadSystem() {
     }
     rmsi.close();
 
+    // records of columns.tbl written before SchemaVersion and DroppedVersion, of indices.tbl before IncludedColumns
+    // or KeyColumns
+    if (upgradeSystemTable("columns", columnVec, columnsMap) != SUCCESS
+    		|| upgradeSystemTable("indices", indexVec, indexMap) != SUCCESS) {
+    	free(beginOfData);
+    	return -1;
+    }
+
+    // databases created before statistics.tbl existed get it here
+    if (!rbfm->fexist("statistics.tbl")) {
+    	free(beginOfData);
+    	return createTableHelper("statistics", statisticsVec, "System");
+    }
+
+    // load statistics.tbl into statisticsMap
+    attributeNames.clear();
+    attributeNames.push_back(statisticsVec[0].name); //table id
+    attributeNames.push_back(statisticsVec[2].name); //column position
+    scan("statistics", statisticsVec[0].name , NO_OP, NULL, attributeNames, rmsi);
+    while(rmsi.getNextTuple(rid, data) != RM_EOF) {
+    	memcpy(&tableId, data, sizeof(int));
+    	memcpy(&columnPosition, data + sizeof(int), sizeof(int));
+
+    	if(statisticsMap.find(tableId) == statisticsMap.end()) {
+    		statisticsMap[tableId] = new map<int, RID>();
+    	}
+    	(*statisticsMap[tableId])[columnPosition] = rid;
+    }
+    rmsi.close();
+
     free(beginOfData);
     
     return 0;
 }
 
-RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs)
-{
-	if (tableName.compare("tables") == 0 || tableName.compare("columns") == 0 || tableName.compare("indices") == 0) {
-		std::cout << "Table name has been used by the system, please change table name!" << std::endl;
-		return -1;
-	}
-
-    return createTableHelper(tableName, attrs, "user");
-}
 
+/**************************************************************************************************************
+ * Brings a system table created by an older version up to recordDescriptor. columns.tbl describes the system
+ * tables as well, so one with fewer entries there than recordDescriptor has fields predates the last of them:
+ * each of its records is read back (a missing field reads as 0 or an empty varchar) and rewritten in full, then
+ * the entries of the new fields go to columns.tbl and NumOfColumns in tables.tbl follows. The entries are added
+ * last, so an upgrade stopped half way is done again on the next start.
+**************************************************************************************************************/
+RC RelationManager::upgradeSystemTable(const string &tableName, const vector<Attribute> &recordDescriptor,
+		map<int, map<int, RID> *> &entryMap) {
+	int tableID = tablesMap[tableName]->begin()->first;
+	RID tableRid = tablesMap[tableName]->begin()->second;
+	int numOfColumns = (int)columnsMap[tableID]->size();
+	if (numOfColumns >= (int)recordDescriptor.size())
+		return SUCCESS;
 
-// a helper method to create table
-RC RelationManager::createTableHelper(const string &tableName, const vector<Attribute> & attrs, const string & type) {
-    
-	int returnValue = -1;
 	FileHandle fileHandle;
-	string fileName = tableName + ".tbl";
-	RID rid;
+	int returnValue = rbfm->openFile(tableName + ".tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
 
-	if (fileName.compare("columns.tbl") != 0) {
-		returnValue = rbfm->createFile(fileName);
-		if (returnValue != SUCCESS) {
-			return -1;
+	char *record = (char *)malloc(determineMemoryNeeded(recordDescriptor));
+	for (map<int, map<int, RID> *>::iterator it = entryMap.begin(); it != entryMap.end() && returnValue == SUCCESS; ++it) {
+		for (map<int, RID>::iterator itr = it->second->begin(); itr != it->second->end() && returnValue == SUCCESS; ++itr) {
+			returnValue = rbfm->readRecord(fileHandle, recordDescriptor, itr->second, record);
+			if (returnValue == SUCCESS)
+				returnValue = rbfm->updateRecord(fileHandle, recordDescriptor, record, itr->second);
 		}
 	}
+	free(record);
 
-	if (fileName.compare("tables.tbl") == 0) {
-		returnValue = rbfm->createFile("columns.tbl");
-		if(returnValue != SUCCESS) {
-			return -1;
-		}
+	RC closeValue = rbfm->closeFile(fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+	if (closeValue != SUCCESS)
+		return closeValue;
+
+	returnValue = rbfm->openFile("columns.tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	RID rid;
+	for (int i = numOfColumns; i < (int)recordDescriptor.size() && returnValue == SUCCESS; i++) {
+		returnValue = insertColumnsEntry(tableID, tableName, recordDescriptor[i].name, fileHandle, i + 1,
+				recordDescriptor[i].length, rid, recordDescriptor[i].type, 1);
+		if (returnValue == SUCCESS)
+			populateColumnsMap(tableID, rid, i + 1);
 	}
+	invalidateAttributes(tableID);
+
+	closeValue = rbfm->closeFile(fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+	if (closeValue != SUCCESS)
+		return closeValue;
 
 	returnValue = rbfm->openFile("tables.tbl", fileHandle);
-	if(returnValue != SUCCESS) {
-		return -1;
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	numOfColumns = (int)recordDescriptor.size();
+	record = (char *)malloc(determineMemoryNeeded(tableVec));
+	returnValue = rbfm->readRecord(fileHandle, tableVec, tableRid, record);
+	if (returnValue == SUCCESS) {
+		memcpy(record + readFieldOffset(record, 5, tableVec), &numOfColumns, sizeof(int));
+		returnValue = rbfm->updateRecord(fileHandle, tableVec, record, tableRid);
 	}
+	free(record);
 
-	int numOfCol = (int)attrs.size();
-	//insert the entry for the new table in table.tbl
-	returnValue = insertTablesEntry(tableName, type, fileName, fileHandle, numOfCol, rid);
+	closeValue = rbfm->closeFile(fileHandle);
+	return returnValue != SUCCESS ? returnValue : closeValue;
+}
 
-	map<int, RID> * tableIDToRidMap = new map<int, RID>;
-	(*tableIDToRidMap)[TABLE_ID_COUNTER] = rid;
-	tablesMap[tableName] = tableIDToRidMap;
 
-	if(returnValue != SUCCESS) {
+// partitions.tbl is small and not part of the snapshot, it is read on every start
+RC RelationManager::loadPartitions() {
+    // databases created before partitions.tbl existed get it here
+    if (!rbfm->fexist("partitions.tbl"))
+        return createTableHelper("partitions", partitionsVec, "System");
+
+    RM_ScanIterator rmsi;
+    vector<string> attributeNames;
+    RID rid;
+
+    // every column but the table name, all ints
+    for (unsigned i = 0; i < partitionsVec.size(); i++) {
+        if (partitionsVec[i].type == TypeInt)
+            attributeNames.push_back(partitionsVec[i].name);
+    }
+
+    int returnValue = scan("partitions", partitionsVec[0].name, NO_OP, NULL, attributeNames, rmsi);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    int fields[7];
+    while (rmsi.getNextTuple(rid, fields) != RM_EOF) {
+        TablePartitions &partitioning = partitionsMap[fields[0]];
+        partitioning.type = (PartitionType)fields[2];
+        partitioning.columnPosition = fields[3];
+        partitioning.numOfPartitions = fields[4];
+
+        PartitionEntry &entry = partitioning.partitions[fields[1]];
+        entry.lowKey = fields[5];
+        entry.highKey = fields[6];
+        entry.rid = rid;
+    }
+
+    return rmsi.close();
+}
+
+
+/**************************************************************************************************************
+ * Fills the maps from catalog.snapshot instead of scanning the system tables. The snapshot is only trusted when
+ * its magic and version match and the size and modification time of every system table are the ones recorded
+ * when it was written; otherwise the caller falls back to loadSystem.
+**************************************************************************************************************/
+RC RelationManager::loadSnapshot() {
+	int fd = open(CATALOG_SNAPSHOT_FILE, O_RDONLY);
+	if (fd < 0)
 		return -1;
-	}
 
-	// close the file Handle for "tables.tbl"
-	returnValue = rbfm->closeFile(fileHandle);
-	if(returnValue != SUCCESS) {
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(SnapshotHeader)) {
+		close(fd);
 		return -1;
 	}
 
-	returnValue = rbfm->openFile("columns.tbl", fileHandle);
-	if(returnValue != SUCCESS) {
+	size_t fileSize = fileStat.st_size;
+	char *snapshot = (char *)mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (snapshot == MAP_FAILED)
+		return -1;
+
+	SnapshotHeader header;
+	memcpy(&header, snapshot, sizeof(SnapshotHeader));
+
+	SystemFileStamp stamps[NUM_OF_SYSTEM_TABLES];
+	if (stampSystemFiles(stamps) != SUCCESS || header.magic != CATALOG_SNAPSHOT_MAGIC
+			|| header.version != CATALOG_SNAPSHOT_VERSION || memcmp(header.stamps, stamps, sizeof(stamps)) != 0) {
+		munmap(snapshot, fileSize);
 		return -1;
 	}
 
-	//create the columns entries for the columns.tbl
-	for (int i = 0; i < numOfCol; i++){
-		int columnPosition = i + 1;
-		insertColumnsEntry(tableName, attrs[i].name, fileHandle, columnPosition, attrs[i].length, rid, attrs[i].type);
-		populateColumnsMap(rid, columnPosition);
+	bool valid = true;
+	size_t offset = sizeof(SnapshotHeader);
+	SnapshotEntry entry;
+	RID rid;
+
+	// tables: [entry][int nameLength][name]
+	for (unsigned i = 0; valid && i < header.numOfTables; i++) {
+		int nameLength;
+		if (offset + sizeof(SnapshotEntry) + sizeof(int) > fileSize) {
+			valid = false;
+			break;
+		}
+		memcpy(&entry, snapshot + offset, sizeof(SnapshotEntry));
+		memcpy(&nameLength, snapshot + offset + sizeof(SnapshotEntry), sizeof(int));
+		offset += sizeof(SnapshotEntry) + sizeof(int);
+
+		if (nameLength < 0 || offset + nameLength > fileSize) {
+			valid = false;
+			break;
+		}
+
+		rid.pageNum = entry.pageNum;
+		rid.slotNum = entry.slotNum;
+		map<int, RID> * tableIDToRidMap = new map<int, RID>();
+		(*tableIDToRidMap)[entry.tableId] = rid;
+		tablesMap[string(snapshot + offset, nameLength)] = tableIDToRidMap;
+		offset += nameLength;
 	}
 
-	if(returnValue == SUCCESS) {
-		TABLE_ID_COUNTER += 1;
+	// columns, indices and statistics: [entry]...
+	map<int, map<int, RID> *> *entryMaps[3] = {&columnsMap, &indexMap, &statisticsMap};
+	unsigned numOfEntries[3] = {header.numOfColumns, header.numOfIndexes, header.numOfStatistics};
+	for (int m = 0; valid && m < 3; m++) {
+		if (offset + (size_t)numOfEntries[m] * sizeof(SnapshotEntry) > fileSize) {
+			valid = false;
+			break;
+		}
+
+		for (unsigned i = 0; i < numOfEntries[m]; i++) {
+			memcpy(&entry, snapshot + offset, sizeof(SnapshotEntry));
+			offset += sizeof(SnapshotEntry);
+
+			rid.pageNum = entry.pageNum;
+			rid.slotNum = entry.slotNum;
+			if (entryMaps[m]->find(entry.tableId) == entryMaps[m]->end())
+				(*entryMaps[m])[entry.tableId] = new map<int, RID>();
+			(*(*entryMaps[m])[entry.tableId])[entry.position] = rid;
+		}
 	}
-	return rbfm->closeFile(fileHandle);
-}
 
+	munmap(snapshot, fileSize);
 
-void RelationManager::populateColumnsMap(RID &rid, int columnPosition)
-{
-    if(columnsMap.find(TABLE_ID_COUNTER) != columnsMap.end()) {
-        (*columnsMap[TABLE_ID_COUNTER])[columnPosition] = rid;
-    }
-    else {
-    	map<int, RID> * colEntryMap = new map<int, RID>();
-    	(*colEntryMap)[columnPosition] = rid;
-    	(columnsMap[TABLE_ID_COUNTER]) = colEntryMap;
-    }
+	if (!valid || offset != fileSize) {
+		clearCatalogMaps();
+		return -1;
+	}
+
+	TABLE_ID_COUNTER = header.tableIdCounter;
+	snapshotExists = true;
+
+	return SUCCESS;
 }
 
+// write the maps to a temporary file and rename it over catalog.snapshot
+RC RelationManager::writeSnapshot() {
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(SnapshotHeader));
+	if (stampSystemFiles(header.stamps) != SUCCESS)
+		return -1;
 
+	header.magic = CATALOG_SNAPSHOT_MAGIC;
+	header.version = CATALOG_SNAPSHOT_VERSION;
+	header.tableIdCounter = TABLE_ID_COUNTER;
+	header.numOfTables = tablesMap.size();
+
+	string snapshot;
+	snapshot.append((char *)&header, sizeof(SnapshotHeader));
+
+	SnapshotEntry entry;
+	for (map<string, map<int, RID> *>::iterator it = tablesMap.begin(); it != tablesMap.end(); ++it) {
+		int nameLength = it->first.size();
+		entry.tableId = it->second->begin()->first;
+		entry.position = 0;
+		entry.pageNum = it->second->begin()->second.pageNum;
+		entry.slotNum = it->second->begin()->second.slotNum;
+
+		snapshot.append((char *)&entry, sizeof(SnapshotEntry));
+		snapshot.append((char *)&nameLength, sizeof(int));
+		snapshot.append(it->first);
+	}
 
-/**************************************************************************************************************
- * This method will insert a single entry into the TABLES table.  It takes the given attribute vector
- * describing the record that will be inserted, mallocs the size of memory needed to house this record based on
- * the attribute vector, then lays the values of the attribute in the memory.  It then uses the RBFM to insert
- * a single entry into the table.
-**************************************************************************************************************/
-RC RelationManager::insertTablesEntry(string tableName, string tableType, string fileName, FileHandle &fileHandle, int numOfCol, RID &rid)
-{
-    char * recordBuffer = (char*) malloc(determineMemoryNeeded(tableVec));  //get a pointer to some raw memory
+	map<int, map<int, RID> *> *entryMaps[3] = {&columnsMap, &indexMap, &statisticsMap};
+	unsigned numOfEntries[3] = {0, 0, 0};
+	for (int m = 0; m < 3; m++) {
+		for (map<int, map<int, RID> *>::iterator it = entryMaps[m]->begin(); it != entryMaps[m]->end(); ++it) {
+			for (map<int, RID>::iterator itr = it->second->begin(); itr != it->second->end(); ++itr) {
+				entry.tableId = it->first;
+				entry.position = itr->first;
+				entry.pageNum = itr->second.pageNum;
+				entry.slotNum = itr->second.slotNum;
+
+				snapshot.append((char *)&entry, sizeof(SnapshotEntry));
+				numOfEntries[m]++;
+			}
+		}
+	}
 
-    int offset = 0;
-    appendData(tableVec[0].length, offset, recordBuffer, (char*) &TABLE_ID_COUNTER, tableVec[0].type); //copy table id to buffer
-    appendData((int)tableName.size(), offset, recordBuffer, tableName.c_str(), tableVec[1].type); //copy the table name to buffer
-    appendData((int)tableType.size(), offset, recordBuffer, tableType.c_str(), tableVec[2].type);  //copy table type to buffer
-    appendData((int)fileName.size(), offset, recordBuffer, fileName.c_str(), tableVec[3].type);  //copy the file name of the table to buffer
-    appendData(tableVec[4].length, offset, recordBuffer, (char*) &numOfCol, tableVec[4].type); //copy number of columns fortable to buffer
+	header.numOfColumns = numOfEntries[0];
+	header.numOfIndexes = numOfEntries[1];
+	header.numOfStatistics = numOfEntries[2];
+	snapshot.replace(0, sizeof(SnapshotHeader), (char *)&header, sizeof(SnapshotHeader));
 
-    int returnValue = rbfm->insertRecord(fileHandle, tableVec, recordBuffer, rid);
+	string tempFileName = string(CATALOG_SNAPSHOT_FILE) + ".tmp";
+	FILE *file = fopen(tempFileName.c_str(), "wb");
+	if (file == NULL)
+		return -1;
 
-    if(returnValue != SUCCESS) {
-        free(recordBuffer);  //release the memory
-        return -1;
-    }
+	size_t written = fwrite(snapshot.data(), 1, snapshot.size(), file);
+	if (fclose(file) != 0 || written != snapshot.size() || rename(tempFileName.c_str(), CATALOG_SNAPSHOT_FILE) != 0) {
+		remove(tempFileName.c_str());
+		return -1;
+	}
 
-    free(recordBuffer);  //release the memory
+	snapshotExists = true;
 
-    return returnValue;
+	return SUCCESS;
 }
 
+// called by every DDL, the next start rebuilds the maps from the system tables and writes a new snapshot
+void RelationManager::invalidateSnapshot() {
+	if (snapshotExists) {
+		remove(CATALOG_SNAPSHOT_FILE);
+		snapshotExists = false;
+	}
+}
 
-RC RelationManager::insertColumnsEntry(string tableName, string columnName, FileHandle &fileHandle, int colPosition, int maxLength, RID &rid, AttrType colType)
-{
-    int memorySize = determineMemoryNeeded(columnVec);
-    char * recordBuffer = (char*) malloc(memorySize);
-    
-    int offset = 0;
-    
-    appendData(columnVec[0].length, offset, recordBuffer, (char*)&TABLE_ID_COUNTER, columnVec[0].type);  //table_id
-    appendData((int)tableName.size(), offset, recordBuffer, tableName.c_str(), columnVec[1].type); //table_name
-    appendData((int)columnName.size(), offset, recordBuffer, columnName.c_str(), columnVec[2].type); //column_name
+RC RelationManager::stampSystemFiles(SystemFileStamp *stamps) {
+	const char *fileNames[NUM_OF_SYSTEM_TABLES] = {"tables.tbl", "columns.tbl", "indices.tbl", "statistics.tbl"};
 
-    string type;
+	for (int i = 0; i < NUM_OF_SYSTEM_TABLES; i++) {
+		struct stat fileStat;
+		if (stat(fileNames[i], &fileStat) != 0)
+			return -1;
+
+		stamps[i].size = fileStat.st_size;
+		stamps[i].mtimeSec = fileStat.st_mtim.tv_sec;
+		stamps[i].mtimeNsec = fileStat.st_mtim.tv_nsec;
+	}
+
+	return SUCCESS;
+}
+
+void RelationManager::clearCatalogMaps() {
+    for (map<string, map<int, RID> *>::iterator it = tablesMap.begin(); it != tablesMap.end(); ++it) {
+    	delete it->second;
+    }
+
+    for (map<int, map<int, RID> *>::iterator it = columnsMap.begin(); it != columnsMap.end(); ++it) {
+    	delete it->second;
+    }
+
+    for (map<int, map<int, RID> *>::iterator it = indexMap.begin(); it != indexMap.end(); ++it) {
+    	delete it->second;
+    }
+
+    for (map<int, map<int, RID> *>::iterator it = statisticsMap.begin(); it != statisticsMap.end(); ++it) {
+    	delete it->second;
+    }
+
+    tablesMap.clear();
+    columnsMap.clear();
+    indexMap.clear();
+    statisticsMap.clear();
+    partitionsMap.clear();
+}
+
+
+RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs)
+{
+	RM_LockGuard catalogGuard(&catalogLock, true);
+
+	if (isSystemTable(tableName)) {
+		std::cout << "Table name has been used by the system, please change table name!" << std::endl;
+		return -1;
+	}
+
+	// the separator is kept for the names of the partitions
+	if (isPartitionTable(tableName) || tablesMap.find(tableName) != tablesMap.end())
+		return -1;
+
+    return createTableHelper(tableName, attrs, "user");
+}
+
+/**************************************************************************************************************
+ * Creates the table, which only keeps the schema and stays empty, then one table per partition and its entry in
+ * PARTITIONS. The tuples go to the partition tables, their rids carry the partition number (PARTITION_SHIFT).
+**************************************************************************************************************/
+RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs, const PartitionScheme &scheme)
+{
+	RM_LockGuard catalogGuard(&catalogLock, true);
+
+	if (scheme.numOfPartitions < 1 || scheme.numOfPartitions > MAX_PARTITIONS)
+		return -1;
+
+	TablePartitions partitioning;
+	partitioning.type = scheme.type;
+	partitioning.numOfPartitions = scheme.numOfPartitions;
+	partitioning.columnPosition = 0;
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		if (attrs[i].name == scheme.attributeName)
+			partitioning.columnPosition = i + 1;
+	}
+
+	if (partitioning.columnPosition == 0)
+		return -1;
+
+	// range bounds: ascending ints, INT_MIN and INT_MAX are kept for the unbounded ends
+	if (scheme.type == RangePartitioning) {
+		const vector<int> &bounds = scheme.rangeBounds;
+		if (attrs[partitioning.columnPosition - 1].type != TypeInt || (int)bounds.size() != scheme.numOfPartitions - 1)
+			return -1;
+
+		for (unsigned i = 0; i < bounds.size(); i++) {
+			if (bounds[i] == INT_MIN || bounds[i] == INT_MAX || (i > 0 && bounds[i] <= bounds[i - 1]))
+				return -1;
+		}
+	}
+
+	int returnValue = createTable(tableName, attrs);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	int table_ID = tablesMap[tableName]->begin()->first;
+
+	FileHandle fileHandle;
+	returnValue = rbfm->openFile("partitions.tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return -1;
+
+	for (int i = 0; i < scheme.numOfPartitions && returnValue == SUCCESS; i++) {
+		PartitionEntry entry;
+		entry.lowKey = scheme.type == HashPartitioning || i == 0 ? INT_MIN : scheme.rangeBounds[i - 1];
+		entry.highKey = scheme.type == HashPartitioning || i == scheme.numOfPartitions - 1 ? INT_MAX : scheme.rangeBounds[i];
+
+		returnValue = createTableHelper(getPartitionName(tableName, i), attrs, "partition");
+		if (returnValue == SUCCESS)
+			returnValue = insertPartitionEntry(tableName, table_ID, i, partitioning, entry, fileHandle);
+		if (returnValue == SUCCESS)
+			partitioning.partitions[i] = entry;
+	}
+
+	// the partitions created so far are kept so deleteTable removes them
+	partitionsMap[table_ID] = partitioning;
+
+	if (rbfm->closeFile(fileHandle) != SUCCESS)
+		return -1;
+
+	return returnValue;
+}
+
+
+// a helper method to create table
+RC RelationManager::createTableHelper(const string &tableName, const vector<Attribute> & attrs, const string & type) {
+    
+	int returnValue = -1;
+	FileHandle fileHandle;
+	string fileName = tableName + ".tbl";
+	RID rid;
+
+	invalidateSnapshot();
+
+	if (fileName.compare("columns.tbl") != 0) {
+		returnValue = rbfm->createFile(fileName);
+		if (returnValue != SUCCESS) {
+			return -1;
+		}
+	}
+
+	if (fileName.compare("tables.tbl") == 0) {
+		returnValue = rbfm->createFile("columns.tbl");
+		if(returnValue != SUCCESS) {
+			return -1;
+		}
+	}
+
+	returnValue = rbfm->openFile("tables.tbl", fileHandle);
+	if(returnValue != SUCCESS) {
+		return -1;
+	}
+
+	int numOfCol = (int)attrs.size();
+	//insert the entry for the new table in table.tbl
+	returnValue = insertTablesEntry(tableName, type, fileName, fileHandle, numOfCol, rid);
+
+	map<int, RID> * tableIDToRidMap = new map<int, RID>;
+	(*tableIDToRidMap)[TABLE_ID_COUNTER] = rid;
+	tablesMap[tableName] = tableIDToRidMap;
+	invalidateAttributes(TABLE_ID_COUNTER);
+
+	if(returnValue != SUCCESS) {
+		return -1;
+	}
+
+	// close the file Handle for "tables.tbl"
+	returnValue = rbfm->closeFile(fileHandle);
+	if(returnValue != SUCCESS) {
+		return -1;
+	}
+
+	returnValue = rbfm->openFile("columns.tbl", fileHandle);
+	if(returnValue != SUCCESS) {
+		return -1;
+	}
+
+	//create the columns entries for the columns.tbl
+	for (int i = 0; i < numOfCol; i++){
+		int columnPosition = i + 1;
+		insertColumnsEntry(TABLE_ID_COUNTER, tableName, attrs[i].name, fileHandle, columnPosition, attrs[i].length, rid, attrs[i].type, 1);
+		populateColumnsMap(TABLE_ID_COUNTER, rid, columnPosition);
+	}
+
+	if(returnValue == SUCCESS) {
+		TABLE_ID_COUNTER += 1;
+	}
+	return rbfm->closeFile(fileHandle);
+}
+
+
+void RelationManager::populateColumnsMap(int tableID, RID &rid, int columnPosition)
+{
+    if(columnsMap.find(tableID) != columnsMap.end()) {
+        (*columnsMap[tableID])[columnPosition] = rid;
+    }
+    else {
+    	map<int, RID> * colEntryMap = new map<int, RID>();
+    	(*colEntryMap)[columnPosition] = rid;
+    	(columnsMap[tableID]) = colEntryMap;
+    }
+}
+
+
+
+/**************************************************************************************************************
+ * This method will insert a single entry into the TABLES table.  It takes the given attribute vector
+ * describing the record that will be inserted, mallocs the size of memory needed to house this record based on
+ * the attribute vector, then lays the values of the attribute in the memory.  It then uses the RBFM to insert
+ * a single entry into the table.
+**************************************************************************************************************/
+RC RelationManager::insertTablesEntry(string tableName, string tableType, string fileName, FileHandle &fileHandle, int numOfCol, RID &rid)
+{
+    char * recordBuffer = (char*) malloc(determineMemoryNeeded(tableVec));  //get a pointer to some raw memory
+
+    int offset = 0;
+    appendData(tableVec[0].length, offset, recordBuffer, (char*) &TABLE_ID_COUNTER, tableVec[0].type); //copy table id to buffer
+    appendData((int)tableName.size(), offset, recordBuffer, tableName.c_str(), tableVec[1].type); //copy the table name to buffer
+    appendData((int)tableType.size(), offset, recordBuffer, tableType.c_str(), tableVec[2].type);  //copy table type to buffer
+    appendData((int)fileName.size(), offset, recordBuffer, fileName.c_str(), tableVec[3].type);  //copy the file name of the table to buffer
+    appendData(tableVec[4].length, offset, recordBuffer, (char*) &numOfCol, tableVec[4].type); //copy number of columns fortable to buffer
+
+    int returnValue = rbfm->insertRecord(fileHandle, tableVec, recordBuffer, rid);
+
+    if(returnValue != SUCCESS) {
+        free(recordBuffer);  //release the memory
+        return -1;
+    }
+
+    free(recordBuffer);  //release the memory
+
+    return returnValue;
+}
+
+
+RC RelationManager::insertColumnsEntry(int tableID, string tableName, string columnName, FileHandle &fileHandle, int colPosition, int maxLength, RID &rid,
+		AttrType colType, int schemaVersion)
+{
+    int memorySize = determineMemoryNeeded(columnVec);
+    char * recordBuffer = (char*) malloc(memorySize);
+    
+    int offset = 0;
+    
+    appendData(columnVec[0].length, offset, recordBuffer, (char*)&tableID, columnVec[0].type);  //table_id
+    appendData((int)tableName.size(), offset, recordBuffer, tableName.c_str(), columnVec[1].type); //table_name
+    appendData((int)columnName.size(), offset, recordBuffer, columnName.c_str(), columnVec[2].type); //column_name
+
+    string type;
     if (colType == TypeVarChar) {
         type = "var_char";
     }
@@ -381,6 +968,10 @@ RC RelationManager::insertColumnsEntry(string tableName, string columnName, File
     appendData((int)type.size(), offset, recordBuffer, type.c_str(), columnVec[3].type); //column_type
     appendData(columnVec[4].length, offset, recordBuffer, (char*)&colPosition, columnVec[4].type); //column_position
     appendData(columnVec[5].length, offset, recordBuffer,  (char*) &maxLength, columnVec[5].type); //column_length
+
+    int droppedVersion = 0;
+    appendData(columnVec[6].length, offset, recordBuffer, (char*) &schemaVersion, columnVec[6].type); //schema_version
+    appendData(columnVec[7].length, offset, recordBuffer, (char*) &droppedVersion, columnVec[7].type); //dropped_version
     
     int returnValue = rbfm->insertRecord(fileHandle, columnVec, recordBuffer, rid);
 
@@ -389,15 +980,26 @@ RC RelationManager::insertColumnsEntry(string tableName, string columnName, File
     return returnValue;
 }
 
-RC RelationManager::insertIndexEntry(string tableName, string columnName, int tableID, int columnPos, FileHandle &fileHandle, RID &rid) {
+RC RelationManager::insertIndexEntry(string tableName, string columnName, int tableID, int columnPos, const vector<int> &keyPositions,
+		const vector<int> &includedPositions, FileHandle &fileHandle, RID &rid) {
 	char * recordBuffer = (char *)malloc(determineMemoryNeeded(indexVec));
 
+	string includedColumns;
+	for (unsigned i = 0; i < includedPositions.size(); i++)
+		includedColumns += (i == 0 ? "" : ",") + to_string(includedPositions[i]);
+
+	string keyColumns;
+	for (unsigned i = 0; i < keyPositions.size(); i++)
+		keyColumns += (i == 0 ? "" : ",") + to_string(keyPositions[i]);
+
 	int offset = 0;
 
 	appendData(indexVec[0].length, offset, recordBuffer, (char *)&tableID, indexVec[0].type); //table id
 	appendData(tableName.size(), offset, recordBuffer, tableName.c_str(), indexVec[1].type); //table name
 	appendData(indexVec[2].length, offset, recordBuffer, (char *)&columnPos, indexVec[2].type); // column Position
 	appendData(columnName.size(), offset, recordBuffer, columnName.c_str(), indexVec[3].type); // column name
+	appendData(includedColumns.size(), offset, recordBuffer, includedColumns.c_str(), indexVec[4].type); // included columns
+	appendData(keyColumns.size(), offset, recordBuffer, keyColumns.c_str(), indexVec[5].type); // key columns
 
 	int returnValue = rbfm->insertRecord(fileHandle, indexVec, recordBuffer, rid);
 
@@ -407,8 +1009,123 @@ RC RelationManager::insertIndexEntry(string tableName, string columnName, int ta
 }
 
 
+RC RelationManager::insertStatisticsEntry(string tableName, string columnName, int tableID, int columnPos, const ColumnStatistics &stats,
+		AttrType colType, FileHandle &fileHandle, RID &rid) {
+	char * recordBuffer = (char *)malloc(determineMemoryNeeded(statisticsVec));
+	char * histogram = (char *)malloc(MAX_HISTOGRAM_LENGTH);
+
+	// an empty table has no min/max value
+	int minLength = stats.numOfRows == 0 ? 0 : getFieldLength(stats.minValue, colType);
+	int maxLength = stats.numOfRows == 0 ? 0 : getFieldLength(stats.maxValue, colType);
+	const char * minValue = stats.minValue;
+	const char * maxValue = stats.maxValue;
+	if (colType == TypeVarChar && stats.numOfRows != 0) {
+		minLength -= sizeof(int);
+		maxLength -= sizeof(int);
+		minValue += sizeof(int);
+		maxValue += sizeof(int);
+	}
+
+	int histogramLength = 0;
+	int numOfBuckets = (int)stats.histogram.size();
+	memcpy(histogram, &numOfBuckets, sizeof(int));
+	histogramLength += sizeof(int);
+	for (int i = 0; i < numOfBuckets; i++) {
+		memcpy(histogram + histogramLength, &stats.histogram[i].numOfRows, sizeof(int));
+		histogramLength += sizeof(int);
+
+		int boundLength = getFieldLength(stats.histogram[i].upperBound, colType);
+		memcpy(histogram + histogramLength, stats.histogram[i].upperBound, boundLength);
+		histogramLength += boundLength;
+	}
+
+	int offset = 0;
+
+	appendData(statisticsVec[0].length, offset, recordBuffer, (char *)&tableID, statisticsVec[0].type); //table id
+	appendData(tableName.size(), offset, recordBuffer, tableName.c_str(), statisticsVec[1].type); //table name
+	appendData(statisticsVec[2].length, offset, recordBuffer, (char *)&columnPos, statisticsVec[2].type); //column position
+	appendData(columnName.size(), offset, recordBuffer, columnName.c_str(), statisticsVec[3].type); //column name
+	appendData(statisticsVec[4].length, offset, recordBuffer, (char *)&stats.numOfRows, statisticsVec[4].type);
+	appendData(statisticsVec[5].length, offset, recordBuffer, (char *)&stats.numOfPages, statisticsVec[5].type);
+	appendData(statisticsVec[6].length, offset, recordBuffer, (char *)&stats.numOfDistinct, statisticsVec[6].type);
+	appendData(minLength, offset, recordBuffer, minValue, statisticsVec[7].type);
+	appendData(maxLength, offset, recordBuffer, maxValue, statisticsVec[8].type);
+	appendData(histogramLength, offset, recordBuffer, histogram, statisticsVec[9].type);
+
+	int returnValue = rbfm->insertRecord(fileHandle, statisticsVec, recordBuffer, rid);
+
+	free(histogram);
+	free(recordBuffer);
+
+	return returnValue;
+}
+
+RC RelationManager::insertPartitionEntry(string tableName, int tableID, int partition, const TablePartitions &partitioning,
+		PartitionEntry &entry, FileHandle &fileHandle)
+{
+	char *recordBuffer = (char *)malloc(determineMemoryNeeded(partitionsVec));
+	int type = partitioning.type;
+
+	int offset = 0;
+	appendData(partitionsVec[0].length, offset, recordBuffer, (char *)&tableID, partitionsVec[0].type); //table id
+	appendData(tableName.size(), offset, recordBuffer, tableName.c_str(), partitionsVec[1].type); //table name
+	appendData(partitionsVec[2].length, offset, recordBuffer, (char *)&partition, partitionsVec[2].type);
+	appendData(partitionsVec[3].length, offset, recordBuffer, (char *)&type, partitionsVec[3].type);
+	appendData(partitionsVec[4].length, offset, recordBuffer, (char *)&partitioning.columnPosition, partitionsVec[4].type);
+	appendData(partitionsVec[5].length, offset, recordBuffer, (char *)&partitioning.numOfPartitions, partitionsVec[5].type);
+	appendData(partitionsVec[6].length, offset, recordBuffer, (char *)&entry.lowKey, partitionsVec[6].type);
+	appendData(partitionsVec[7].length, offset, recordBuffer, (char *)&entry.highKey, partitionsVec[7].type);
+
+	int returnValue = rbfm->insertRecord(fileHandle, partitionsVec, recordBuffer, entry.rid);
+
+	free(recordBuffer);
+
+	return returnValue;
+}
+
+
 RC RelationManager::deleteTable(const string &tableName)
 {
+    RM_LockGuard catalogGuard(&catalogLock, true);
+
+    // a partition is deleted through dropPartition
+    if (isPartitionTable(tableName) || tablesMap.find(tableName) == tablesMap.end()) {
+        return -1;
+    }
+
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning == NULL) {
+        return deleteTableHelper(tableName);
+    }
+
+    int table_ID = tablesMap[tableName]->begin()->first;
+
+    map<int, PartitionEntry> &partitions = partitioning->partitions;
+    for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+        if (hasOpenHandles(getPartitionName(tableName, itr->first))) {
+            return -1;
+        }
+    }
+
+    for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+        int returnValue = deleteTableHelper(getPartitionName(tableName, itr->first));
+        if (returnValue == SUCCESS) {
+            returnValue = deleteTuple("partitions", itr->second.rid);
+        }
+        if (returnValue != SUCCESS) {
+            return -1;
+        }
+    }
+
+    partitionsMap.erase(table_ID);
+
+    return deleteTableHelper(tableName);
+}
+
+RC RelationManager::deleteTableHelper(const string &tableName)
+{
+    RM_LockGuard catalogGuard(&catalogLock, true);
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
     int returnValue = -1;
     
     if (isSystemTableRequest(tableName)) {
@@ -417,7 +1134,7 @@ RC RelationManager::deleteTable(const string &tableName)
     }
 
     //check if table does not exist in the map
-    if (tablesMap.find(tableName) == tablesMap.end()) {
+    if (tablesMap.find(tableName) == tablesMap.end() || hasOpenHandles(tableName)) {
     	return returnValue;
     }
 
@@ -429,11 +1146,13 @@ RC RelationManager::deleteTable(const string &tableName)
     RID rid;
     FileHandle fileHandle;
 
+    invalidateSnapshot();
+
     //********operations for deleting associated index files, delete tuples in indices.tbl and clear indexMap*********
 
 
     vector<Attribute> recordDescriptor;
-    returnValue = getAttributes(tableName, recordDescriptor);
+    returnValue = getRecordDescriptor(tableName, recordDescriptor);
 
     if (returnValue != SUCCESS)
     	return returnValue;
@@ -441,6 +1160,12 @@ RC RelationManager::deleteTable(const string &tableName)
     if (indexMap.find(table_ID) != indexMap.end()) { // if this table has index file(s)
     	map<int, RID> * indexEntry = indexMap[table_ID];
 
+    	map<int, vector<int> > keyColumns;
+    	map<int, vector<int> > includedColumns;
+    	returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+    	if (returnValue != SUCCESS)
+    		return returnValue;
+
     	returnValue = rbfm->openFile("indices.tbl", fileHandle);
         
         if(returnValue != SUCCESS) {
@@ -451,8 +1176,8 @@ RC RelationManager::deleteTable(const string &tableName)
     		int position = itr->first;
     		rid = itr->second;
 
-    		string columnName = recordDescriptor[position - 1].name;
-    		string indexFileName = tableName + "_" + columnName + ".idx";
+    		string indexName = getIndexAttribute(recordDescriptor, keyColumns[position]).name;
+    		string indexFileName = tableName + "_" + indexName + ".idx";
 
     		// destroy index file
     		returnValue = ix->destroyFile(indexFileName);
@@ -478,6 +1203,12 @@ RC RelationManager::deleteTable(const string &tableName)
     	}
     }
 
+    //*******************operations for deleting tuples in statistics.tbl and clear statisticsMap***************
+    returnValue = deleteStatisticsEntries(table_ID);
+    if (returnValue != SUCCESS) {
+    	return -1;
+    }
+
     //*******************operations for deleting tuples in columns.tbl and clear columnsMap******************
     //get the map of all the columns for a particular table id
     map<int, RID> * columnsEntries = columnsMap[table_ID];
@@ -535,6 +1266,7 @@ RC RelationManager::deleteTable(const string &tableName)
     //delete entry from table map
     delete(tableID);
     tablesMap.erase(tableName);
+    invalidateAttributes(table_ID);
 
     returnValue = rbfm->closeFile(fileHandle);
 
@@ -549,27 +1281,95 @@ RC RelationManager::deleteTable(const string &tableName)
     return returnValue;
 }
 
-RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &attrs)
+// retention of a range partitioned table: the files of the partition are deleted, no tuple is touched
+RC RelationManager::dropPartition(const string &tableName, const int partition)
 {
-    int returnValue = -1;
-    
-    attrs.clear();
+    RM_LockGuard catalogGuard(&catalogLock, true);
 
-    if (tablesMap.find(tableName) != tablesMap.end())  //check if table exists in the map
-    {
-        map<int, RID> * tableID = tablesMap[tableName];
-        
-        int table_ID = (*tableID).begin()->first;
-        
-        //get the map of all the columns for a particular table id
-        map<int, RID> * columnsEntries = columnsMap[table_ID];
-        
-        //open the columns table to get the handle
-        FileHandle fileHandle;
-        returnValue = rbfm->openFile("columns.tbl", fileHandle);
+    TablePartitions *partitioning = getPartitioning(tableName);
 
-        if (returnValue == SUCCESS) {
-            
+    // the last partition is kept, PARTITIONS would no longer tell the table is partitioned
+    if (partitioning == NULL || partitioning->type != RangePartitioning
+            || partitioning->partitions.find(partition) == partitioning->partitions.end()
+            || partitioning->partitions.size() == 1) {
+        return -1;
+    }
+
+    int returnValue = deleteTableHelper(getPartitionName(tableName, partition));
+    if (returnValue != SUCCESS) {
+        return returnValue;
+    }
+
+    returnValue = deleteTuple("partitions", partitioning->partitions[partition].rid);
+    partitioning->partitions.erase(partition);
+
+    return returnValue;
+}
+
+RC RelationManager::getPartitions(const string &tableName, vector<int> &partitions)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning == NULL) {
+        return -1;
+    }
+
+    partitions.clear();
+    for (map<int, PartitionEntry>::iterator itr = partitioning->partitions.begin(); itr != partitioning->partitions.end(); ++itr) {
+        partitions.push_back(itr->first);
+    }
+
+    return SUCCESS;
+}
+
+RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &attrs)
+{
+    int returnValue = getRecordDescriptor(tableName, attrs);
+
+    // the dropped attributes are only kept for the layout of the records
+    for (unsigned i = 0; i < attrs.size(); ) {
+        if (attrs[i].isDropped)
+            attrs.erase(attrs.begin() + i);
+        else
+            i++;
+    }
+
+    return returnValue;
+}
+
+RC RelationManager::getRecordDescriptor(const string &tableName, vector<Attribute> &attrs)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+    int returnValue = -1;
+    
+    attrs.clear();
+
+    if (tablesMap.find(tableName) != tablesMap.end())  //check if table exists in the map
+    {
+        map<int, RID> * tableID = tablesMap[tableName];
+        
+        int table_ID = (*tableID).begin()->first;
+
+        // the descriptor only changes with DDL, serve it from memory when possible
+        {
+            lock_guard<mutex> guard(cacheMutex);
+            map<int, vector<Attribute> >::iterator cached = attributesCache.find(table_ID);
+            if (cached != attributesCache.end()) {
+                attrs = cached->second;
+                return SUCCESS;
+            }
+        }
+        
+        //get the map of all the columns for a particular table id
+        map<int, RID> * columnsEntries = columnsMap[table_ID];
+        
+        //open the columns table to get the handle
+        FileHandle fileHandle;
+        returnValue = rbfm->openFile("columns.tbl", fileHandle);
+
+        if (returnValue == SUCCESS) {
+            
             RID rid;
             
             char * columnsRecord = (char*) malloc(MAX_COLUMNS_RECORD_SIZE);
@@ -616,6 +1416,11 @@ RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &at
                     unsigned length;
                     memcpy(&length, columnsRecord, sizeof(AttrLength)); //copy the col type
                     attr.length = length;
+
+                    int droppedVersion;
+                    columnsRecord = columnsRecord + sizeof(AttrLength) + sizeof(int); //skip over the col length and schema version
+                    memcpy(&droppedVersion, columnsRecord, sizeof(int));
+                    attr.isDropped = droppedVersion != 0;
                     
                     attrs.push_back(attr);
 
@@ -625,6 +1430,11 @@ RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &at
             free(beginOfData);
         }
         rbfm->closeFile(fileHandle);
+
+        if (returnValue == SUCCESS) {
+            lock_guard<mutex> guard(cacheMutex);
+            attributesCache[table_ID] = attrs;
+        }
     }
     return returnValue;
 
@@ -632,6 +1442,29 @@ RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &at
 
 RC RelationManager::insertTuple(const string &tableName, const void *data, RID &rid)
 {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    // the tuple goes to its partition, only the lock of the partition is taken
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning != NULL) {
+        vector<Attribute> recordDescriptor;
+        getRecordDescriptor(tableName, recordDescriptor);
+
+        int partition = routeTuple(*partitioning, data, recordDescriptor);
+        if (partition == -1 || insertTuple(getPartitionName(tableName, partition), data, rid) != SUCCESS) {
+            return -1;
+        }
+
+        rid.pageNum |= (unsigned)partition << PARTITION_SHIFT;
+        return SUCCESS;
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+    if (tablesMap.find(tableName) == tablesMap.end()) {
+        return -1;
+    }
+
     if(isSystemTableRequest(tableName)) {
         cout << "Invalid request to insert tuple into system table: " + tableName << endl;
         return -1;
@@ -644,7 +1477,7 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     map<int, RID> * tableID = tablesMap[tableName];
     int table_ID = tableID->begin()->first;
     
-    getAttributes(tableName, recordDescriptor);
+    getRecordDescriptor(tableName, recordDescriptor);
     string fileName = tableName + ".tbl";
     
     int returnValue = rbfm->openFile(fileName, fileHandle);
@@ -668,9 +1501,18 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     if (indexMap.find(table_ID) == indexMap.end())
     	return returnValue;
 
+    map<int, vector<int> > keyColumns;
+    map<int, vector<int> > includedColumns;
+    returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+    if (returnValue != SUCCESS)
+    	return returnValue;
+
+    char payload[MAX_INCLUDED_LENGTH];
+    char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+
     for (map<int, RID>::iterator itr = indexMap[table_ID]->begin(); itr != indexMap[table_ID]->end(); ++itr) {
     	int position = itr->first;
-    	Attribute keyAttribute = recordDescriptor[position - 1];
+    	Attribute keyAttribute = getIndexAttribute(recordDescriptor, keyColumns[position]);
 
     	string indexFileName = tableName + "_" + keyAttribute.name + ".idx";
     	FileHandle indexFileHandle;
@@ -679,10 +1521,11 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     	if (returnValue != SUCCESS)
     		return returnValue;
 
-    	// insert key
-    	int startOffset = readFieldOffset(data, position, recordDescriptor);
+    	// insert key, with the values of the included columns
+    	const char *key = readIndexKey(data, recordDescriptor, keyColumns[position], keyBuffer);
+    	short payloadLength = buildPayload(data, recordDescriptor, includedColumns[position], payload);
 
-    	returnValue = ix->insertEntry(indexFileHandle, keyAttribute, (char *)data + startOffset, rid);
+    	returnValue = ix->insertEntry(indexFileHandle, keyAttribute, key, rid, payload, payloadLength);
     	if (returnValue != SUCCESS) {
     		ix->closeFile(indexFileHandle);
     		return returnValue;
@@ -700,10 +1543,29 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     
 RC RelationManager::deleteTuples(const string &tableName)
 {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning != NULL) {
+        map<int, PartitionEntry> &partitions = partitioning->partitions;
+        for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+            if (deleteTuples(getPartitionName(tableName, itr->first)) != SUCCESS) {
+                return -1;
+            }
+        }
+        return SUCCESS;
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
     if(isSystemTableRequest(tableName)) {
         cout << "Invalid request to delete tuples in system table: " + tableName << endl;
         return -1;
     }
+
+    if (hasOpenHandles(tableName)) {
+        return -1;
+    }
     
     string fileName = tableName + ".tbl";
     FileHandle fileHandle;
@@ -726,28 +1588,41 @@ RC RelationManager::deleteTuples(const string &tableName)
     }
 
     //*********operations for associated index files***********
-    // delete associated index files and then create them again
+    // truncate associated index files back to an empty tree
     int table_ID = tablesMap[tableName]->begin()->first;
 
     if (indexMap.find(table_ID) == indexMap.end())
     	return returnValue;
 
     vector<Attribute> recordDescriptor;
-    returnValue = getAttributes(tableName, recordDescriptor);
+    returnValue = getRecordDescriptor(tableName, recordDescriptor);
+    if (returnValue != SUCCESS)
+    	return returnValue;
+
+    map<int, vector<int> > keyColumns;
+    map<int, vector<int> > includedColumns;
+    returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
     if (returnValue != SUCCESS)
     	return returnValue;
 
     map<int, RID> *indexEntry = indexMap[table_ID];
     for (map<int, RID>::iterator itr = indexEntry->begin(); itr != indexEntry->end(); itr++) {
     	int position = itr->first;
-    	string columnName = recordDescriptor[position - 1].name;
-    	string fileName = tableName + "_" + columnName + ".idx";
+    	string indexName = getIndexAttribute(recordDescriptor, keyColumns[position]).name;
+    	string fileName = tableName + "_" + indexName + ".idx";
 
-    	returnValue = ix->destroyFile(fileName);
+    	FileHandle indexFileHandle;
+    	returnValue = ix->openFile(fileName, indexFileHandle);
     	if (returnValue != SUCCESS)
     		return returnValue;
 
-    	returnValue = ix->createFile(fileName);
+    	returnValue = ix->truncateFile(indexFileHandle);
+    	if (returnValue != SUCCESS) {
+    		ix->closeFile(indexFileHandle);
+    		return returnValue;
+    	}
+
+    	returnValue = ix->closeFile(indexFileHandle);
     	if (returnValue != SUCCESS)
     		return returnValue;
     }
@@ -757,6 +1632,23 @@ RC RelationManager::deleteTuples(const string &tableName)
 
 RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
 {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    if (getPartitioning(tableName) != NULL) {
+        string partitionName;
+        RID partitionRid;
+        if (findPartition(tableName, rid, partitionName, partitionRid) != SUCCESS) {
+            return -1;
+        }
+        return deleteTuple(partitionName, partitionRid);
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+    if (tablesMap.find(tableName) == tablesMap.end()) {
+        return -1;
+    }
+
     if(isSystemTableRequest(tableName)) {
         cout << "Invalid request to delete tuple in system table: " + tableName << endl;
         return -1;
@@ -769,7 +1661,7 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
     FileHandle fileHandle;
     
     vector<Attribute> recordDescriptor;
-    getAttributes(tableName, recordDescriptor);
+    getRecordDescriptor(tableName, recordDescriptor);
     
     string fileName = tableName + ".tbl";
     int returnValue = rbfm->openFile(fileName, fileHandle);
@@ -810,9 +1702,19 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
     	return returnValue;
     }
 
+    map<int, vector<int> > keyColumns;
+    map<int, vector<int> > includedColumns;
+    returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+    if (returnValue != SUCCESS) {
+    	free(data);
+    	return returnValue;
+    }
+
+    char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+
     for (map<int, RID>::iterator itr = indexMap[table_ID]->begin(); itr != indexMap[table_ID]->end(); ++itr) {
     	int position = itr->first;
-    	Attribute keyAttribute = recordDescriptor[position - 1];
+    	Attribute keyAttribute = getIndexAttribute(recordDescriptor, keyColumns[position]);
 
     	string indexFileName = tableName + "_" + keyAttribute.name + ".idx";
     	FileHandle indexFileHandle;
@@ -824,9 +1726,9 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
     	}
 
     	// prepare key
-    	int startOffset = readFieldOffset(data, position, recordDescriptor);
+    	const char *key = readIndexKey(data, recordDescriptor, keyColumns[position], keyBuffer);
 
-    	returnValue = ix->deleteEntry(indexFileHandle, keyAttribute, (char *)data + startOffset, rid);
+    	returnValue = ix->deleteEntry(indexFileHandle, keyAttribute, key, rid);
     	if (returnValue != SUCCESS) {
     		free(data);
     		ix->closeFile(indexFileHandle);
@@ -847,6 +1749,29 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
 
 RC RelationManager::updateTuple(const string &tableName, const void *data, const RID &rid)
 {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    // the rid keeps its partition, an update which would move the tuple to another partition is rejected
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning != NULL) {
+        string partitionName;
+        RID partitionRid;
+        vector<Attribute> recordDescriptor;
+        getRecordDescriptor(tableName, recordDescriptor);
+
+        if (findPartition(tableName, rid, partitionName, partitionRid) != SUCCESS
+                || routeTuple(*partitioning, data, recordDescriptor) != (int)(rid.pageNum >> PARTITION_SHIFT)) {
+            return -1;
+        }
+        return updateTuple(partitionName, data, partitionRid);
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+    if (tablesMap.find(tableName) == tablesMap.end()) {
+        return -1;
+    }
+
     if(isSystemTableRequest(tableName)) {
         cout << "Invalid request to update tuple in system table: " + tableName << endl;
         return -1;
@@ -858,7 +1783,7 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     FileHandle fileHandle;
     
     vector<Attribute> recordDescriptor;
-    getAttributes(tableName, recordDescriptor);
+    getRecordDescriptor(tableName, recordDescriptor);
     
     string fileName = tableName + ".tbl";
     int returnValue = rbfm->openFile(fileName, fileHandle);
@@ -896,16 +1821,33 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     	return returnValue;
     }
 
-    //compare the new key with old key, if different, delete old one, then insert new one
+    map<int, vector<int> > keyColumns;
+    map<int, vector<int> > includedColumns;
+    returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+    if (returnValue != SUCCESS) {
+    	free(oldData);
+    	return returnValue;
+    }
+
+    char oldPayload[MAX_INCLUDED_LENGTH];
+    char payload[MAX_INCLUDED_LENGTH];
+    char oldKeyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+    char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+
+    //compare the new key and included values with the old ones, if different, delete old entry, then insert new one
     for (map<int, RID>::iterator itr = indexMap[table_ID]->begin(); itr != indexMap[table_ID]->end(); ++itr) {
     	int position = itr->first;
-    	Attribute keyAttribute = recordDescriptor[position - 1];
+    	Attribute keyAttribute = getIndexAttribute(recordDescriptor, keyColumns[position]);
 
     	// prepare key
-    	int oldKeyStartOffset = readFieldOffset(oldData, position, recordDescriptor);
-    	int newKeyStartOffset = readFieldOffset(oldData, position, recordDescriptor);
+    	const char *oldKey = readIndexKey(oldData, recordDescriptor, keyColumns[position], oldKeyBuffer);
+    	const char *newKey = readIndexKey(data, recordDescriptor, keyColumns[position], keyBuffer);
+
+    	short oldPayloadLength = buildPayload(oldData, recordDescriptor, includedColumns[position], oldPayload);
+    	short payloadLength = buildPayload(data, recordDescriptor, includedColumns[position], payload);
+    	bool isPayloadEqual = oldPayloadLength == payloadLength && memcmp(oldPayload, payload, payloadLength) == 0;
 
-    	if (!isFieldEqual((char *)oldData + oldKeyStartOffset, (char *)data + newKeyStartOffset, keyAttribute.type)) {
+    	if (!isFieldEqual(oldKey, newKey, keyAttribute.type) || !isPayloadEqual) {
     		string indexFileName = tableName + "_" + keyAttribute.name + ".idx";
     		FileHandle indexFileHandle;
 
@@ -915,14 +1857,14 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     			return returnValue;
     		}
 
-    		returnValue = ix->deleteEntry(indexFileHandle, keyAttribute, (char *)oldData + oldKeyStartOffset, rid);
+    		returnValue = ix->deleteEntry(indexFileHandle, keyAttribute, oldKey, rid);
     		if (returnValue != SUCCESS) {
     			free(oldData);
     			ix->closeFile(indexFileHandle);
     			return returnValue;
     		}
 
-    		returnValue = ix->insertEntry(indexFileHandle, keyAttribute, (char *)data + newKeyStartOffset, rid);
+    		returnValue = ix->insertEntry(indexFileHandle, keyAttribute, newKey, rid, payload, payloadLength);
     		if (returnValue != SUCCESS) {
     			free(oldData);
     			ix->closeFile(indexFileHandle);
@@ -945,7 +1887,19 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
 
 RC RelationManager::readTuple(const string &tableName, const RID &rid, void *data)
 {
-    
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    if (getPartitioning(tableName) != NULL) {
+        string partitionName;
+        RID partitionRid;
+        if (findPartition(tableName, rid, partitionName, partitionRid) != SUCCESS) {
+            return -1;
+        }
+        return readTuple(partitionName, partitionRid, data);
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), false);
+
     if (tablesMap.find(tableName) == tablesMap.end())  //check if table exists in the map
     {
         return -1;
@@ -955,7 +1909,7 @@ RC RelationManager::readTuple(const string &tableName, const RID &rid, void *dat
     string fileName = tableName + ".tbl";
     vector<Attribute> recordDescriptor;
     
-    int returnValue = getAttributes(tableName, recordDescriptor);
+    int returnValue = getRecordDescriptor(tableName, recordDescriptor);
     
     if (returnValue != SUCCESS) {
         return -1;
@@ -977,13 +1931,84 @@ RC RelationManager::readTuple(const string &tableName, const RID &rid, void *dat
     return rbfm->closeFile(fileHandle);
 }
 
+RC RelationManager::readTuples(const string &tableName, const vector<RID> &rids, const vector<void *> &data)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    // one batch per partition
+    if (getPartitioning(tableName) != NULL) {
+        map<string, pair<vector<RID>, vector<void *> > > batches;
+        for (unsigned i = 0; i < rids.size(); i++) {
+            string partitionName;
+            RID partitionRid;
+            if (findPartition(tableName, rids[i], partitionName, partitionRid) != SUCCESS) {
+                return -1;
+            }
+            batches[partitionName].first.push_back(partitionRid);
+            batches[partitionName].second.push_back(data[i]);
+        }
+
+        for (map<string, pair<vector<RID>, vector<void *> > >::iterator itr = batches.begin(); itr != batches.end(); ++itr) {
+            if (readTuples(itr->first, itr->second.first, itr->second.second) != SUCCESS) {
+                return -1;
+            }
+        }
+        return SUCCESS;
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), false);
+
+    if (tablesMap.find(tableName) == tablesMap.end())  //check if table exists in the map
+    {
+        return -1;
+    }
+
+    FileHandle fileHandle;
+    string fileName = tableName + ".tbl";
+    vector<Attribute> recordDescriptor;
+
+    int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+
+    if (returnValue != SUCCESS) {
+        return -1;
+    }
+
+    returnValue = rbfm->openFile(fileName, fileHandle);
+
+    if (returnValue != SUCCESS) {
+        return -1;
+    }
+
+    returnValue = rbfm->readRecords(fileHandle, recordDescriptor, rids, data);
+
+    if (returnValue != SUCCESS) {
+        rbfm->closeFile(fileHandle);
+        return -1;
+    }
+
+    return rbfm->closeFile(fileHandle);
+}
+
 RC RelationManager::readAttribute(const string &tableName, const RID &rid, const string &attributeName, void *data)
 {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    if (getPartitioning(tableName) != NULL) {
+        string partitionName;
+        RID partitionRid;
+        if (findPartition(tableName, rid, partitionName, partitionRid) != SUCCESS) {
+            return -1;
+        }
+        return readAttribute(partitionName, partitionRid, attributeName, data);
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), false);
+
     FileHandle fileHandle;
     string fileName = tableName + ".tbl";
     vector<Attribute> recordDescriptor;
     
-    int returnValue = getAttributes(tableName, recordDescriptor);
+    int returnValue = getRecordDescriptor(tableName, recordDescriptor);
     
     if (returnValue != SUCCESS) {
         return -1;
@@ -1005,8 +2030,102 @@ RC RelationManager::readAttribute(const string &tableName, const RID &rid, const
     return rbfm->closeFile(fileHandle);
 }
 
+RC RelationManager::openTable(const string &tableName, RM_TableHandle &tableHandle)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+    if (tableHandle.isOpen || tablesMap.find(tableName) == tablesMap.end() || getPartitioning(tableName) != NULL) {
+        return -1;
+    }
+
+    int table_ID = tablesMap[tableName]->begin()->first;
+
+    int returnValue = getRecordDescriptor(tableName, tableHandle.recordDescriptor);
+    if (returnValue == SUCCESS) {
+        returnValue = getAttributes(tableName, tableHandle.attributes);
+    }
+    if (returnValue != SUCCESS) {
+        return -1;
+    }
+
+    returnValue = rbfm->openFile(tableName + ".tbl", tableHandle.fileHandle);
+    if (returnValue != SUCCESS) {
+        return -1;
+    }
+
+    returnValue = getIndexColumns(table_ID, tableHandle.keyColumns, tableHandle.includedColumns);
+    if (returnValue != SUCCESS) {
+        rbfm->closeFile(tableHandle.fileHandle);
+        return -1;
+    }
+
+    tableHandle.indexFileHandles.clear();
+    if (indexMap.find(table_ID) != indexMap.end()) {
+        for (map<int, RID>::iterator itr = indexMap[table_ID]->begin(); itr != indexMap[table_ID]->end(); ++itr) {
+            int position = itr->first;
+            string indexName = getIndexAttribute(tableHandle.recordDescriptor, tableHandle.keyColumns[position]).name;
+            string indexFileName = tableName + "_" + indexName + ".idx";
+
+            returnValue = ix->openFile(indexFileName, tableHandle.indexFileHandles[position]);
+            if (returnValue != SUCCESS) {
+                tableHandle.indexFileHandles.erase(position);
+                for (map<int, FileHandle>::iterator it = tableHandle.indexFileHandles.begin(); it != tableHandle.indexFileHandles.end(); ++it) {
+                    ix->closeFile(it->second);
+                }
+                tableHandle.indexFileHandles.clear();
+                rbfm->closeFile(tableHandle.fileHandle);
+                return -1;
+            }
+        }
+    }
+
+    tableHandle.tableName = tableName;
+    tableHandle.tableID = table_ID;
+    tableHandle.tableLock = getTableLock(table_ID);
+    tableHandle.isOpen = true;
+
+    lock_guard<mutex> guard(cacheMutex);
+    openTableHandles[table_ID]++;
+
+    return SUCCESS;
+}
+
+RC RelationManager::closeTable(RM_TableHandle &tableHandle)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+    if (!tableHandle.isOpen) {
+        return -1;
+    }
+
+    int returnValue = SUCCESS;
+    for (map<int, FileHandle>::iterator itr = tableHandle.indexFileHandles.begin(); itr != tableHandle.indexFileHandles.end(); ++itr) {
+        if (ix->closeFile(itr->second) != SUCCESS) {
+            returnValue = -1;
+        }
+    }
+    tableHandle.indexFileHandles.clear();
+
+    if (rbfm->closeFile(tableHandle.fileHandle) != SUCCESS) {
+        returnValue = -1;
+    }
+
+    lock_guard<mutex> guard(cacheMutex);
+    if (--openTableHandles[tableHandle.tableID] == 0) {
+        openTableHandles.erase(tableHandle.tableID);
+    }
+    tableHandle.isOpen = false;
+
+    return returnValue;
+}
+
 RC RelationManager::reorganizePage(const string &tableName, const unsigned pageNumber)
 {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+    if (getPartitioning(tableName) != NULL) {
+        return -1;
+    }
+
     FileHandle fileHandle;
     string fileName = tableName + ".tbl";
     rbfm->openFile(fileName, fileHandle);
@@ -1014,7 +2133,7 @@ RC RelationManager::reorganizePage(const string &tableName, const unsigned pageN
     //getTable Record Descriptor
     vector<Attribute> recordDescriptor;
    
-    int returnValue = getAttributes(tableName, recordDescriptor);
+    int returnValue = getRecordDescriptor(tableName, recordDescriptor);
     
     if (returnValue == SUCCESS) {
         returnValue = rbfm->reorganizePage(fileHandle, recordDescriptor, pageNumber);
@@ -1028,67 +2147,203 @@ RC RelationManager::reorganizePage(const string &tableName, const unsigned pageN
 }
 
 
+RC RelationManager::setFillFactor(const string &tableName, const short fillFactor)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning != NULL) {
+        map<int, PartitionEntry> &partitions = partitioning->partitions;
+        for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+            if (setFillFactor(getPartitionName(tableName, itr->first), fillFactor) != SUCCESS) {
+                return -1;
+            }
+        }
+        return SUCCESS;
+    }
 
-RC RelationManager::createIndex(const string & tableName, const string & attributeName) {
-	int returnValue = -1;
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
 
-	string indexFileName = tableName + "_" + attributeName + ".idx";
+    if (tablesMap.find(tableName) == tablesMap.end()) {
+        return -1;
+    }
 
-	// STEP1: check whether "tableName" and "attributeName" are valid
-	// if is valid, get tableId for tableName and attribute position for attributeName
-	if (tablesMap.find(tableName) == tablesMap.end())
-		return returnValue;
+    FileHandle fileHandle;
+    string fileName = tableName + ".tbl";
 
-	// get tableId
-	map<int, RID> * tableIDMap = tablesMap[tableName];
-	int table_ID = (*tableIDMap).begin()->first;
+    int returnValue = rbfm->openFile(fileName, fileHandle);
 
-	// get attribute position
-	vector<Attribute> recordDescriptor;
-	returnValue = getAttributes(tableName, recordDescriptor);
-	if (returnValue != SUCCESS)
-		return returnValue;
+    if (returnValue != SUCCESS) {
+        return -1;
+    }
 
-	int attrPos = 1;
-	for (; attrPos <= (int)recordDescriptor.size(); attrPos++) {
-		if (recordDescriptor[attrPos - 1].name.compare(attributeName) == 0)
-			break;
-	}
+    returnValue = rbfm->setFillFactor(fileHandle, fillFactor);
 
-	// "attributeName" in "tableName" is not found, return error
-	if (attrPos > (int)recordDescriptor.size())
-		return -1;
+    if (returnValue != SUCCESS) {
+        rbfm->closeFile(fileHandle);
+        return -1;
+    }
 
-	// STEP2: check whether index file has already been created
-	// if not, create entry[attribute position, RID] and put this entry in [tableId]
-	map<int, RID> *indexEntryMap;
-	if (indexMap.find(table_ID) == indexMap.end()) {
-		indexEntryMap = new map<int, RID>();
-		indexMap[table_ID] = indexEntryMap;
-	}
-	else {
-		indexEntryMap = indexMap[table_ID];
+    // the fill factor is persisted in the meta file when the file is closed
+    return rbfm->closeFile(fileHandle);
+}
 
-		if (indexEntryMap->find(attrPos) != indexEntryMap->end()) {
-			cout << "This index has already been created!";
-			return -1;
-		}
-	}
+RC RelationManager::getForwardingStats(const string &tableName, ForwardingStats &stats)
+{
+    RM_LockGuard catalogGuard(&catalogLock, false);
+    RM_LockGuard tableGuard(getTableLock(tableName), false);
 
-	// STEP3: create .idx file
-	returnValue = ix->createFile(indexFileName);
-	if (returnValue != SUCCESS)
-		return returnValue;
+    if (tablesMap.find(tableName) == tablesMap.end() || getPartitioning(tableName) != NULL) {
+        return -1;
+    }
+
+    FileHandle fileHandle;
+    string fileName = tableName + ".tbl";
+
+    int returnValue = rbfm->openFile(fileName, fileHandle);
+
+    if (returnValue != SUCCESS) {
+        return -1;
+    }
+
+    returnValue = rbfm->getForwardingStats(fileHandle, stats);
+
+    if (returnValue != SUCCESS) {
+        rbfm->closeFile(fileHandle);
+        return -1;
+    }
+
+    return rbfm->closeFile(fileHandle);
+}
+
+
+RC RelationManager::createIndex(const string & tableName, const string & attributeName) {
+	return createIndexes(tableName, vector<string>(1, attributeName));
+}
+
+RC RelationManager::createIndex(const string &tableName, const string &attributeName, const vector<string> &includedAttributes) {
+	return createIndexes(tableName, vector<string>(1, attributeName), vector<vector<string> >(1, includedAttributes));
+}
+
+RC RelationManager::createIndex(const string &tableName, const string &attributeName, IndexType indexType) {
+	return createIndexes(tableName, vector<string>(1, attributeName), vector<vector<string> >(), indexType);
+}
+
+/**************************************************************************************************************
+ * Creates one index per attribute with a single scan of the table. Every projected tuple is fanned out to one
+ * IX_ExternalSorter per index, then the sorts and bulk loads run concurrently on a pool of worker threads, one
+ * index at a time per worker. The catalog and the files are only touched from the calling thread.
+ * The values of the included attributes of an index go into the payload of its entries.
+**************************************************************************************************************/
+RC RelationManager::createIndexes(const string &tableName, const vector<string> &attributeNames,
+		const vector<vector<string> > &includedAttributes, IndexType indexType) {
+	RM_LockGuard catalogGuard(&catalogLock, true);
+
+	// every partition gets the same indexes
+	TablePartitions *partitioning = getPartitioning(tableName);
+	if (partitioning != NULL) {
+		map<int, PartitionEntry> &partitions = partitioning->partitions;
+		for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+			if (createIndexes(getPartitionName(tableName, itr->first), attributeNames, includedAttributes, indexType) != SUCCESS)
+				return -1;
+		}
+		return SUCCESS;
+	}
+
+	RM_LockGuard tableGuard(getTableLock(tableName), true);
+	int returnValue = -1;
+
+	// STEP1: check whether "tableName" and every attribute are valid and not indexed yet
+	if (attributeNames.empty() || tablesMap.find(tableName) == tablesMap.end() || hasOpenHandles(tableName))
+		return returnValue;
+
+	if (!includedAttributes.empty() && includedAttributes.size() != attributeNames.size())
+		return -1;
+
+	// get tableId
+	map<int, RID> * tableIDMap = tablesMap[tableName];
+	int table_ID = (*tableIDMap).begin()->first;
+
+	vector<Attribute> recordDescriptor;
+	returnValue = getRecordDescriptor(tableName, recordDescriptor);
+	if (returnValue != SUCCESS)
+		return returnValue;
 
+	// attribute positions, in the order of the record descriptor so they follow the projected tuple
+	vector<int> positions;
+	for (int attrPos = 1; attrPos <= (int)recordDescriptor.size(); attrPos++) {
+		if (recordDescriptor[attrPos - 1].isDropped
+				|| find(attributeNames.begin(), attributeNames.end(), recordDescriptor[attrPos - 1].name) == attributeNames.end())
+			continue;
+
+		if (indexMap.find(table_ID) != indexMap.end() && indexMap[table_ID]->find(attrPos) != indexMap[table_ID]->end()) {
+			cout << "This index has already been created!";
+			return -1;
+		}
+		positions.push_back(attrPos);
+	}
+
+	// an attribute is not found or is listed twice
+	if (positions.size() != attributeNames.size())
+		return -1;
+
+	int numOfIndexes = (int)positions.size();
+
+	// included attribute positions of every index; a value is stored in every entry, so their size is bounded
+	vector<vector<int> > includedPositions(numOfIndexes);
+	for (int i = 0; i < numOfIndexes && !includedAttributes.empty(); i++) {
+		int nameIndex = find(attributeNames.begin(), attributeNames.end(), recordDescriptor[positions[i] - 1].name) - attributeNames.begin();
+		const vector<string> &includedNames = includedAttributes[nameIndex];
+		int maxPayloadLength = 0;
+
+		for (unsigned j = 0; j < includedNames.size(); j++) {
+			int attrPos = 1;
+			while (attrPos <= (int)recordDescriptor.size()
+					&& (recordDescriptor[attrPos - 1].isDropped || recordDescriptor[attrPos - 1].name != includedNames[j]))
+				attrPos++;
+
+			// not found, the key itself or listed twice
+			if (attrPos > (int)recordDescriptor.size() || attrPos == positions[i]
+					|| find(includedPositions[i].begin(), includedPositions[i].end(), attrPos) != includedPositions[i].end())
+				return -1;
+
+			includedPositions[i].push_back(attrPos);
+			Attribute includedAttribute = recordDescriptor[attrPos - 1];
+			maxPayloadLength += includedAttribute.type == TypeVarChar ? sizeof(int) + includedAttribute.length : sizeof(int);
+		}
+
+		if (maxPayloadLength > MAX_INCLUDED_LENGTH)
+			return -1;
+	}
+
+	// STEP2: create the .idx files, insert them in indices.tbl and update indexMap
+	invalidateSnapshot();
+
+	if (indexMap.find(table_ID) == indexMap.end())
+		indexMap[table_ID] = new map<int, RID>();
+	map<int, RID> *indexEntryMap = indexMap[table_ID];
 
-	// STEP4: insert this index in indices.tbl and update indexMap
 	FileHandle fileHandle;
 	returnValue = rbfm->openFile("indices.tbl", fileHandle);
 	if (returnValue != SUCCESS)
 		return returnValue;
 
-	RID indexRid;
-	returnValue = insertIndexEntry(tableName, attributeName, table_ID, attrPos, fileHandle, indexRid);
+	for (int i = 0; i < numOfIndexes && returnValue == SUCCESS; i++) {
+		string attributeName = recordDescriptor[positions[i] - 1].name;
+
+		returnValue = ix->createFile(tableName + "_" + attributeName + ".idx", indexType);
+		if (returnValue != SUCCESS)
+			break;
+
+		RID indexRid;
+		returnValue = insertIndexEntry(tableName, attributeName, table_ID, positions[i], vector<int>(), includedPositions[i],
+				fileHandle, indexRid);
+		if (returnValue == SUCCESS)
+			(*indexEntryMap)[positions[i]] = indexRid;
+	}
+
+	invalidateAttributes(table_ID);
+
 	if (returnValue != SUCCESS) {
 		rbfm->closeFile(fileHandle);
 		return returnValue;
@@ -1098,96 +2353,1622 @@ RC RelationManager::createIndex(const string & tableName, const string & attribu
 	if (returnValue != SUCCESS)
 		return returnValue;
 
-	// update the index map
-	(*indexEntryMap)[attrPos] = indexRid;
+	vector<vector<int> > keyColumns;
+	for (int i = 0; i < numOfIndexes; i++)
+		keyColumns.push_back(vector<int>(1, positions[i]));
+
+	return buildIndexes(tableName, recordDescriptor, keyColumns, includedPositions);
+}
+
+/**************************************************************************************************************
+ * A composite index is an index on one varchar key holding the values of its attributes, see
+ * IndexManager::getCompositeAttribute. It takes the next free negative position in indexMap, and its key
+ * column positions go into indices.tbl; it is built like the other indexes.
+**************************************************************************************************************/
+RC RelationManager::createIndex(const string &tableName, const vector<string> &attributeNames) {
+	if (attributeNames.size() == 1)
+		return createIndex(tableName, attributeNames[0]);
+
+	RM_LockGuard catalogGuard(&catalogLock, true);
+
+	TablePartitions *partitioning = getPartitioning(tableName);
+	if (partitioning != NULL) {
+		map<int, PartitionEntry> &partitions = partitioning->partitions;
+		for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+			if (createIndex(getPartitionName(tableName, itr->first), attributeNames) != SUCCESS)
+				return -1;
+		}
+		return SUCCESS;
+	}
+
+	RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+	if (attributeNames.empty() || tablesMap.find(tableName) == tablesMap.end() || hasOpenHandles(tableName))
+		return -1;
+
+	int table_ID = tablesMap[tableName]->begin()->first;
+
+	vector<Attribute> recordDescriptor;
+	int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// key column positions, in the order of attributeNames
+	vector<int> keyPositions;
+	for (unsigned i = 0; i < attributeNames.size(); i++) {
+		int attrPos = 1;
+		while (attrPos <= (int)recordDescriptor.size()
+				&& (recordDescriptor[attrPos - 1].isDropped || recordDescriptor[attrPos - 1].name != attributeNames[i]))
+			attrPos++;
+
+		// not found or listed twice
+		if (attrPos > (int)recordDescriptor.size() || find(keyPositions.begin(), keyPositions.end(), attrPos) != keyPositions.end())
+			return -1;
+		keyPositions.push_back(attrPos);
+	}
+
+	Attribute keyAttribute = getIndexAttribute(recordDescriptor, keyPositions);
+	if (keyAttribute.length > MAX_COMPOSITE_KEY_LENGTH)
+		return -1;
+
+	if (findIndex(table_ID, recordDescriptor, keyAttribute.name) != 0) {
+		cout << "This index has already been created!";
+		return -1;
+	}
+
+	invalidateSnapshot();
+
+	if (indexMap.find(table_ID) == indexMap.end())
+		indexMap[table_ID] = new map<int, RID>();
+	map<int, RID> *indexEntryMap = indexMap[table_ID];
+	int indexPos = indexEntryMap->empty() || indexEntryMap->begin()->first > 0 ? -1 : indexEntryMap->begin()->first - 1;
+
+	returnValue = ix->createFile(tableName + "_" + keyAttribute.name + ".idx");
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	FileHandle fileHandle;
+	returnValue = rbfm->openFile("indices.tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	RID indexRid;
+	returnValue = insertIndexEntry(tableName, keyAttribute.name, table_ID, indexPos, keyPositions, vector<int>(), fileHandle,
+			indexRid);
+	if (returnValue == SUCCESS)
+		(*indexEntryMap)[indexPos] = indexRid;
+
+	invalidateAttributes(table_ID);
 
-	// STEP5: scan the file and insert [attribute, RID] in the new created .idx file
-	FileHandle indexFileHandle;
-	returnValue = ix->openFile(indexFileName, indexFileHandle);
+	RC closeValue = rbfm->closeFile(fileHandle);
 	if (returnValue != SUCCESS)
 		return returnValue;
+	if (closeValue != SUCCESS)
+		return closeValue;
 
+	return buildIndexes(tableName, recordDescriptor, vector<vector<int> >(1, keyPositions), vector<vector<int> >(1));
+}
+
+/**
+ * One scan of the table projected to the keys and included attributes feeds an external sorter per index, then the
+ * sorters are sorted and bulk loaded on worker threads.  The index files must exist and be empty.
+ */
+RC RelationManager::buildIndexes(const string &tableName, const vector<Attribute> &recordDescriptor, const vector<vector<int> > &keyColumns,
+		const vector<vector<int> > &includedPositions) {
+	int returnValue = SUCCESS;
+	int numOfIndexes = (int)keyColumns.size();
+
+	// one scan of the table projected to the keys and included attributes, each entry goes to the sorter of its index
+	vector<Attribute> keyAttributes;
+	vector<FileHandle> indexFileHandles(numOfIndexes);
+	vector<IX_ExternalSorter *> sorters;
+
+	for (int i = 0; i < numOfIndexes; i++) {
+		Attribute keyAttribute = getIndexAttribute(recordDescriptor, keyColumns[i]);
+		keyAttributes.push_back(keyAttribute);
+		sorters.push_back(new IX_ExternalSorter(keyAttribute, SORT_MEMORY_LIMIT / numOfIndexes));
+	}
+
+	// [column position -> position in the projected tuple]
+	map<int, int> projectedPositions;
+	vector<Attribute> projectedDescriptor;
+	vector<string> projectedNames;
+	for (int attrPos = 1; attrPos <= (int)recordDescriptor.size(); attrPos++) {
+		bool isProjected = false;
+		for (int i = 0; i < numOfIndexes && !isProjected; i++)
+			isProjected = find(keyColumns[i].begin(), keyColumns[i].end(), attrPos) != keyColumns[i].end()
+					|| find(includedPositions[i].begin(), includedPositions[i].end(), attrPos) != includedPositions[i].end();
+
+		if (!isProjected)
+			continue;
+
+		projectedDescriptor.push_back(recordDescriptor[attrPos - 1]);
+		projectedNames.push_back(recordDescriptor[attrPos - 1].name);
+		projectedPositions[attrPos] = (int)projectedDescriptor.size();
+	}
+
+	vector<vector<int> > keyPositions(numOfIndexes);
+	vector<vector<int> > payloadPositions(numOfIndexes);
+	for (int i = 0; i < numOfIndexes; i++) {
+		for (unsigned j = 0; j < keyColumns[i].size(); j++)
+			keyPositions[i].push_back(projectedPositions[keyColumns[i][j]]);
+		for (unsigned j = 0; j < includedPositions[i].size(); j++)
+			payloadPositions[i].push_back(projectedPositions[includedPositions[i][j]]);
+	}
 
 	RM_ScanIterator rmsi;
-	// get key attribute
-	Attribute keyAttribute = recordDescriptor[attrPos - 1];
+	returnValue = scan(tableName, projectedNames[0], NO_OP, NULL, projectedNames, rmsi);
+
+	if (returnValue == SUCCESS) {
+		char *data = (char *) malloc(PAGE_SIZE);
+		char payload[MAX_INCLUDED_LENGTH];
+		char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+		RID rid;
+
+		while (returnValue == SUCCESS && rmsi.getNextTuple(rid, data) != RM_EOF) {
+			for (int i = 0; i < numOfIndexes && returnValue == SUCCESS; i++) {
+				const char *key = readIndexKey(data, projectedDescriptor, keyPositions[i], keyBuffer);
+				short payloadLength = buildPayload(data, projectedDescriptor, payloadPositions[i], payload);
+				returnValue = sorters[i]->addEntry(key, rid, payload, payloadLength);
+			}
+		}
+
+		rmsi.close();
+		free(data);
+	}
+
+	// sort and bulk load the indexes on the worker threads
+	int numOfOpened = 0;
+	for (; numOfOpened < numOfIndexes && returnValue == SUCCESS; numOfOpened++) {
+		returnValue = ix->openFile(tableName + "_" + keyAttributes[numOfOpened].name + ".idx", indexFileHandles[numOfOpened]);
+		if (returnValue != SUCCESS)
+			break;
+	}
+
+	if (returnValue == SUCCESS) {
+		vector<RC> results(numOfIndexes, SUCCESS);
+		atomic<int> nextIndex(0);
+
+		int numOfWorkers = min((int)thread::hardware_concurrency(), numOfIndexes);
+		if (numOfWorkers < 1)
+			numOfWorkers = 1;
+
+		vector<thread> workers;
+		for (int w = 0; w < numOfWorkers; w++) {
+			workers.push_back(thread([&]() {
+				for (int i = nextIndex++; i < numOfIndexes; i = nextIndex++) {
+					results[i] = sorters[i]->sort();
+					if (results[i] == SUCCESS)
+						results[i] = ix->bulkLoad(indexFileHandles[i], keyAttributes[i], *sorters[i]);
+				}
+			}));
+		}
+
+		for (int w = 0; w < numOfWorkers; w++)
+			workers[w].join();
+
+		for (int i = 0; i < numOfIndexes && returnValue == SUCCESS; i++)
+			returnValue = results[i];
+	}
+
+	for (int i = 0; i < numOfOpened; i++) {
+		RC closeValue = ix->closeFile(indexFileHandles[i]);
+		if (returnValue == SUCCESS)
+			returnValue = closeValue;
+	}
+
+	for (int i = 0; i < numOfIndexes; i++)
+		delete sorters[i];
+
+	return returnValue;
+}
+
+
+// input of one parsing thread of bulkLoad, and the tuples it produced
+struct BulkLoadChunk {
+	vector<char> input;
+	vector<char> tuples; // insertTuple format, tuple i starts at offsets[i]
+	vector<int> offsets;
+	int numOfLines;      // lines (tuples for a binary file) of the input read
+	int errorLine;       // line of the first bad tuple, 0 if none
+};
+
+// length of the tuple at data in insertTuple format, 0 if it runs past end, -1 if a varchar length is out of range
+static int getTupleLength(const char *data, const char *end, const vector<Attribute> &attrs) {
+	const char *field = data;
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		if (end - field < (int)sizeof(int))
+			return 0;
+
+		int fieldLength = sizeof(int);
+		if (attrs[i].type == TypeVarChar) {
+			int length = *(const int *)field;
+			if (length < 0 || length > (int)attrs[i].length)
+				return -1;
+			fieldLength += length;
+		}
+
+		if (end - field < fieldLength)
+			return 0;
+		field += fieldLength;
+	}
+	return (int)(field - data);
+}
+
+// one field of a csv line into "field", pos is left on the character after it
+static bool readCSVField(const char *&pos, const char *end, string &field) {
+	field.clear();
+	if (pos == end || *pos != '"') {
+		const char *start = pos;
+		while (pos < end && *pos != ',')
+			pos++;
+		field.assign(start, pos);
+		return true;
+	}
+
+	for (pos++; pos < end; pos++) {
+		if (*pos != '"') {
+			field += *pos;
+		}
+		else if (pos + 1 < end && pos[1] == '"') {
+			field += '"';
+			pos++;
+		}
+		else {
+			pos++;
+			return pos == end || *pos == ',';
+		}
+	}
+	return false; // no closing quote
+}
+
+// one csv line appended to "tuples" in insertTuple format
+static bool parseCSVLine(const char *line, const char *end, const vector<Attribute> &attrs, string &field, vector<char> &tuples) {
+	const char *pos = line;
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		if (i > 0) {
+			if (pos == end || *pos != ',')
+				return false;
+			pos++;
+		}
+
+		if (!readCSVField(pos, end, field))
+			return false;
+
+		char *endPtr;
+		if (attrs[i].type == TypeInt) {
+			errno = 0;
+			long value = strtol(field.c_str(), &endPtr, 10);
+			if (field.empty() || *endPtr != '\0' || errno != 0 || value < INT_MIN || value > INT_MAX)
+				return false;
+			int intValue = (int)value;
+			tuples.insert(tuples.end(), (char *)&intValue, (char *)&intValue + sizeof(int));
+		}
+		else if (attrs[i].type == TypeReal) {
+			float value = strtof(field.c_str(), &endPtr);
+			if (field.empty() || *endPtr != '\0')
+				return false;
+			tuples.insert(tuples.end(), (char *)&value, (char *)&value + sizeof(float));
+		}
+		else {
+			int length = (int)field.size();
+			if (length > (int)attrs[i].length)
+				return false;
+			tuples.insert(tuples.end(), (char *)&length, (char *)&length + sizeof(int));
+			tuples.insert(tuples.end(), field.begin(), field.end());
+		}
+	}
+	return pos == end;
+}
+
+// the '\n' ending the csv line at pos, or end; a '\n' inside a quoted field is part of the value and only counted in
+// numOfLines. As in readCSVField a field is quoted when it starts with '"', and it ends at a '"' which is not doubled.
+static const char *findCSVLineEnd(const char *pos, const char *end, int &numOfLines) {
+	bool isQuoted = false;
+	bool isFieldStart = true;
+	for (; pos < end; pos++) {
+		if (isQuoted) {
+			if (*pos == '"' && pos + 1 < end && pos[1] == '"')
+				pos++;
+			else if (*pos == '"')
+				isQuoted = false;
+			else if (*pos == '\n')
+				numOfLines++;
+		}
+		else if (*pos == '\n') {
+			return pos;
+		}
+		else {
+			isQuoted = isFieldStart && *pos == '"';
+			isFieldStart = *pos == ',';
+		}
+	}
+	return end;
+}
+
+static void parseCSVChunk(BulkLoadChunk &chunk, const vector<Attribute> &attrs) {
+	string field;
+	const char *pos = chunk.input.data();
+	const char *end = pos + chunk.input.size();
+
+	while (pos < end) {
+		const char *lineEnd = findCSVLineEnd(pos, end, chunk.numOfLines);
+		chunk.numOfLines++;
+
+		const char *lineStop = lineEnd;
+		if (lineStop > pos && lineStop[-1] == '\r')
+			lineStop--;
+
+		if (lineStop > pos) { // empty lines are skipped
+			size_t tupleOffset = chunk.tuples.size();
+			if (!parseCSVLine(pos, lineStop, attrs, field, chunk.tuples)) {
+				chunk.tuples.resize(tupleOffset);
+				chunk.errorLine = chunk.numOfLines;
+				return;
+			}
+			chunk.offsets.push_back((int)tupleOffset);
+		}
+		pos = lineEnd + 1;
+	}
+}
+
+// the tuples are already in their format, only their bounds are checked
+static void parseBinaryChunk(BulkLoadChunk &chunk, const vector<Attribute> &attrs) {
+	chunk.tuples.swap(chunk.input);
+	const char *data = chunk.tuples.data();
+	const char *end = data + chunk.tuples.size();
+	int offset = 0;
+
+	while (data + offset < end) {
+		chunk.numOfLines++;
+		int tupleLength = getTupleLength(data + offset, end, attrs);
+		if (tupleLength <= 0) {
+			chunk.errorLine = chunk.numOfLines;
+			return;
+		}
+		chunk.offsets.push_back(offset);
+		offset += tupleLength;
+	}
+}
+
+// read the next chunk of the file after "carry" (the unfinished tail of the previous chunk), cut at the end of its last
+// complete line or tuple; the rest goes back to carry. Returns false at the end of the file.
+static bool readChunk(FILE *file, const FileFormat format, const vector<Attribute> &attrs, vector<char> &carry, vector<char> &input) {
+	input.swap(carry);
+	carry.clear();
+
+	bool hasMore = true;
+	size_t cut = 0;
+	while (cut == 0) {
+		size_t oldSize = input.size();
+		input.resize(oldSize + BULK_LOAD_CHUNK_SIZE);
+		size_t numOfRead = fread(input.data() + oldSize, 1, BULK_LOAD_CHUNK_SIZE, file);
+		input.resize(oldSize + numOfRead);
+
+		if (numOfRead < BULK_LOAD_CHUNK_SIZE) {
+			hasMore = false;
+			break;
+		}
+
+		if (format == CSVFile) {
+			// input starts on a line, so the lines are followed from there to know which '\n' are in quoted fields
+			const char *data = input.data();
+			const char *end = data + input.size();
+			int numOfLines = 0;
+			const char *lineEnd;
+			while ((lineEnd = findCSVLineEnd(data + cut, end, numOfLines)) < end)
+				cut = lineEnd + 1 - data;
+		}
+		else {
+			const char *data = input.data();
+			const char *end = data + input.size();
+			int tupleLength;
+			while ((tupleLength = getTupleLength(data + cut, end, attrs)) > 0)
+				cut += tupleLength;
+			if (tupleLength < 0) // bad tuple, left to the parser to report
+				cut = input.size();
+		}
+	}
+
+	if (hasMore) {
+		carry.assign(input.begin() + cut, input.end());
+		input.resize(cut);
+	}
+	return hasMore;
+}
+
+/**
+ * The reader cuts the file into chunks, one per worker thread, the workers parse their chunk into tuples, then the chunks
+ * are appended in file order with RecordBasedFileManager::appendRecords.  Into a table which has tuples the entries of each
+ * chunk are inserted as it is appended (appendTuples).  A table loaded from empty gets its indexes built from one scan at
+ * the end instead, as createIndexes builds them; when that fails the table is emptied again so the indexes stay correct.
+ */
+RC RelationManager::bulkLoad(const string &tableName, const string &fileName, const FileFormat format, unsigned &numOfTuples) {
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(tableName), true);
+	numOfTuples = 0;
+
+	if (tablesMap.find(tableName) == tablesMap.end() || isSystemTable(tableName) || hasOpenHandles(tableName)
+			|| getPartitioning(tableName) != NULL)
+		return -1;
+
+	int table_ID = tablesMap[tableName]->begin()->first;
+
+	vector<Attribute> recordDescriptor, attrs;
+	int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+	if (returnValue == SUCCESS)
+		returnValue = getAttributes(tableName, attrs);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	vector<BulkLoadIndex> indexes;
+	if (indexMap.find(table_ID) != indexMap.end()) {
+		map<int, vector<int> > keyColumns;
+		map<int, vector<int> > includedColumns;
+		returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+		if (returnValue != SUCCESS)
+			return returnValue;
+
+		for (map<int, RID>::iterator itr = indexMap[table_ID]->begin(); itr != indexMap[table_ID]->end(); ++itr) {
+			BulkLoadIndex index;
+			index.keyAttribute = getIndexAttribute(recordDescriptor, keyColumns[itr->first]);
+			index.keyColumns = keyColumns[itr->first];
+			index.includedColumns = includedColumns[itr->first];
+			indexes.push_back(index);
+		}
+	}
+
+	FileHandle fileHandle;
+	returnValue = rbfm->openFile(tableName + ".tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// the indexes of a table loaded from empty are built at the end, those of any other table get the entries per chunk
+	bool isRebuilt = fileHandle.getNumberOfPages() == 0;
+	vector<BulkLoadIndex> openIndexes;
+	for (unsigned i = 0; i < indexes.size() && !isRebuilt && returnValue == SUCCESS; i++) {
+		returnValue = ix->openFile(tableName + "_" + indexes[i].keyAttribute.name + ".idx", indexes[i].fileHandle);
+		if (returnValue == SUCCESS)
+			openIndexes.push_back(indexes[i]);
+	}
+
+	if (returnValue == SUCCESS && format == ColumnarFile) {
+		returnValue = appendColumnarFile(fileName, attrs, recordDescriptor, fileHandle, openIndexes, numOfTuples);
+	}
+	else if (returnValue == SUCCESS) {
+		FILE *file = fopen(fileName.c_str(), "rb");
+		if (file == NULL)
+			returnValue = -1;
+
+		int numOfWorkers = thread::hardware_concurrency();
+		if (numOfWorkers < 1)
+			numOfWorkers = 1;
+
+		vector<BulkLoadChunk> chunks(numOfWorkers);
+		vector<char> carry;
+		bool hasMore = true;
+		int numOfLines = 0;
+
+		while (hasMore && returnValue == SUCCESS) {
+			int numOfChunks = 0;
+			for (; numOfChunks < numOfWorkers && hasMore; numOfChunks++) {
+				BulkLoadChunk &chunk = chunks[numOfChunks];
+				chunk.tuples.clear();
+				chunk.offsets.clear();
+				chunk.numOfLines = 0;
+				chunk.errorLine = 0;
+				hasMore = readChunk(file, format, attrs, carry, chunk.input);
+			}
+
+			vector<thread> workers;
+			for (int w = 0; w < numOfChunks; w++) {
+				workers.push_back(thread([&, w]() {
+					if (format == CSVFile)
+						parseCSVChunk(chunks[w], attrs);
+					else
+						parseBinaryChunk(chunks[w], attrs);
+				}));
+			}
+			for (int w = 0; w < numOfChunks; w++)
+				workers[w].join();
+
+			for (int w = 0; w < numOfChunks && returnValue == SUCCESS; w++) {
+				BulkLoadChunk &chunk = chunks[w];
+				returnValue = appendTuples(fileHandle, recordDescriptor, chunk.tuples.data(), chunk.offsets, openIndexes, numOfTuples);
+				if (returnValue != SUCCESS)
+					break;
+
+				if (chunk.errorLine != 0) {
+					cout << "bulkLoad: bad " << (format == CSVFile ? "line " : "tuple ") << numOfLines + chunk.errorLine
+							<< " in " << fileName << endl;
+					returnValue = -1;
+				}
+				numOfLines += chunk.numOfLines;
+			}
+		}
+
+		if (file != NULL)
+			fclose(file);
+	}
+
+	RC closeValue = rbfm->closeFile(fileHandle);
+	if (returnValue == SUCCESS)
+		returnValue = closeValue;
+
+	for (unsigned i = 0; i < openIndexes.size(); i++) {
+		closeValue = ix->closeFile(openIndexes[i].fileHandle);
+		if (returnValue == SUCCESS)
+			returnValue = closeValue;
+	}
+
+	// the loaded tuples are in the table even after an error, the indexes have to cover them
+	if (!isRebuilt || numOfTuples == 0 || indexes.empty())
+		return returnValue;
+
+	vector<vector<int> > keyPositions;
+	vector<vector<int> > includedPositions;
+	RC indexValue = SUCCESS;
+	for (unsigned i = 0; i < indexes.size() && indexValue == SUCCESS; i++) {
+		keyPositions.push_back(indexes[i].keyColumns);
+		includedPositions.push_back(indexes[i].includedColumns);
+
+		FileHandle indexFileHandle;
+		indexValue = ix->openFile(tableName + "_" + indexes[i].keyAttribute.name + ".idx", indexFileHandle);
+		if (indexValue != SUCCESS)
+			break;
+
+		indexValue = ix->truncateFile(indexFileHandle);
+		closeValue = ix->closeFile(indexFileHandle);
+		if (indexValue == SUCCESS)
+			indexValue = closeValue;
+	}
+
+	if (indexValue == SUCCESS)
+		indexValue = buildIndexes(tableName, recordDescriptor, keyPositions, includedPositions);
+
+	// the table was empty, emptying it again leaves the indexes matching it
+	if (indexValue != SUCCESS && deleteTuples(tableName) == SUCCESS)
+		numOfTuples = 0;
+
+	return returnValue == SUCCESS ? indexValue : returnValue;
+}
+
+RC RelationManager::appendTuples(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *tuples,
+		const vector<int> &offsets, vector<BulkLoadIndex> &indexes, unsigned &numOfTuples) {
+	vector<RID> rids;
+	int returnValue = rbfm->appendRecords(fileHandle, recordDescriptor, tuples, offsets, rids);
+
+	char payload[MAX_INCLUDED_LENGTH];
+	char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	RC indexValue = SUCCESS;
+	unsigned numOfIndexed = 0;
+
+	while (numOfIndexed < rids.size() && indexValue == SUCCESS) {
+		const char *tuple = tuples + offsets[numOfIndexed];
+		unsigned i = 0;
+		for (; i < indexes.size() && indexValue == SUCCESS; i++) {
+			const char *key = readIndexKey(tuple, recordDescriptor, indexes[i].keyColumns, keyBuffer);
+			short payloadLength = buildPayload(tuple, recordDescriptor, indexes[i].includedColumns, payload);
+			indexValue = ix->insertEntry(indexes[i].fileHandle, indexes[i].keyAttribute, key, rids[numOfIndexed], payload, payloadLength);
+		}
+
+		if (indexValue == SUCCESS) {
+			numOfIndexed++;
+			continue;
+		}
+
+		// take the entries the tuple got out again
+		for (unsigned j = 0; j + 1 < i; j++) {
+			const char *key = readIndexKey(tuple, recordDescriptor, indexes[j].keyColumns, keyBuffer);
+			ix->deleteEntry(indexes[j].fileHandle, indexes[j].keyAttribute, key, rids[numOfIndexed]);
+		}
+	}
+
+	for (unsigned i = numOfIndexed; i < rids.size(); i++)
+		rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+
+	numOfTuples += numOfIndexed;
+	return returnValue == SUCCESS ? indexValue : returnValue;
+}
+
+/**
+ * A columnar file is read a row group at a time with RM_ColumnarReader, each row group is appended with one call.  The
+ * columns of the file must have the types of the table; a damaged row group ends the load as the end of the file does.
+ */
+RC RelationManager::appendColumnarFile(const string &fileName, const vector<Attribute> &attrs, const vector<Attribute> &recordDescriptor,
+		FileHandle &fileHandle, vector<BulkLoadIndex> &indexes, unsigned &numOfTuples) {
+	RM_ColumnarReader reader;
+	if (reader.open(fileName) != SUCCESS)
+		return -1;
+
+	vector<Attribute> fileAttrs;
+	reader.getAttributes(fileAttrs);
+	int returnValue = fileAttrs.size() == attrs.size() ? SUCCESS : -1;
+	for (unsigned i = 0; i < attrs.size() && returnValue == SUCCESS; i++) {
+		if (fileAttrs[i].type != attrs[i].type || fileAttrs[i].length > attrs[i].length)
+			returnValue = -1;
+	}
+
+	vector<char> tuples;
+	vector<int> offsets;
+	char *data = (char *)malloc(PAGE_SIZE);
+	bool hasMore = returnValue == SUCCESS;
+
+	while (hasMore) {
+		hasMore = reader.getNextTuple(data) != RM_EOF;
+		if (hasMore) {
+			offsets.push_back((int)tuples.size());
+			tuples.insert(tuples.end(), data, data + getTupleLength(data, data + PAGE_SIZE, attrs));
+		}
+
+		if (offsets.size() == EXPORT_ROW_GROUP_SIZE || (!hasMore && !offsets.empty())) {
+			returnValue = appendTuples(fileHandle, recordDescriptor, tuples.data(), offsets, indexes, numOfTuples);
+			if (returnValue != SUCCESS)
+				break;
+			tuples.clear();
+			offsets.clear();
+		}
+	}
+
+	free(data);
+	reader.close();
+	return returnValue;
+}
+
+/**
+ * Workers take EXPORT_SCAN_PAGES pages at a time and scan them through a file handle of their own, the batch of a worker
+ * is encoded by the worker and only the write to the file is serialized.  The table lock is held shared by the caller
+ * for the whole export, so the workers do not lock.
+ */
+RC RelationManager::exportTable(const string &tableName, const string &fileName, const FileFormat format) {
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(tableName), false);
+
+	if (tablesMap.find(tableName) == tablesMap.end() || getPartitioning(tableName) != NULL)
+		return -1;
+
+	vector<Attribute> recordDescriptor, attrs;
+	int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+	if (returnValue == SUCCESS)
+		returnValue = getAttributes(tableName, attrs);
+	if (returnValue != SUCCESS)
+		return returnValue;
 
-	// projected attribute
 	vector<string> attributeNames;
-	attributeNames.push_back(keyAttribute.name);
+	for (unsigned i = 0; i < attrs.size(); i++)
+		attributeNames.push_back(attrs[i].name);
+
+	string tableFileName = tableName + ".tbl";
+	FileHandle fileHandle;
+	returnValue = rbfm->openFile(tableFileName, fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+	unsigned numOfPages = fileHandle.getNumberOfPages();
 
-	returnValue = scan(tableName, keyAttribute.name, NO_OP, NULL, attributeNames, rmsi);
+	RM_ExportWriter writer;
+	returnValue = writer.open(fileName, attrs, format);
 	if (returnValue != SUCCESS) {
-		ix->closeFile(indexFileHandle);
+		rbfm->closeFile(fileHandle);
 		return returnValue;
 	}
 
-	char *data = (char *) malloc(MAX_ATTRIBUTE_LENGTH);
-	RID rid;
+	int numOfWorkers = min((unsigned)thread::hardware_concurrency(), (numOfPages + EXPORT_SCAN_PAGES - 1) / EXPORT_SCAN_PAGES);
+	if (numOfWorkers < 1)
+		numOfWorkers = 1;
+
+	atomic<unsigned> nextRange(0);
+	vector<RC> results(numOfWorkers, SUCCESS);
+	vector<thread> workers;
+	for (int w = 0; w < numOfWorkers; w++) {
+		workers.push_back(thread([&, w]() {
+			FileHandle workerFileHandle;
+			if (rbfm->openFile(tableFileName, workerFileHandle) != SUCCESS) {
+				results[w] = -1;
+				return;
+			}
+
+			RM_ExportBuffer buffer(attrs, format);
+			char *data = (char *)malloc(PAGE_SIZE);
+			RID rid;
+
+			for (unsigned firstPage = EXPORT_SCAN_PAGES * nextRange++; firstPage < numOfPages && results[w] == SUCCESS;
+					firstPage = EXPORT_SCAN_PAGES * nextRange++) {
+				RBFM_ScanIterator rbfmsi;
+				results[w] = rbfm->scan(workerFileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmsi);
+				if (results[w] == SUCCESS)
+					results[w] = rbfmsi.setPageRange(firstPage, min(firstPage + EXPORT_SCAN_PAGES, numOfPages));
+
+				while (results[w] == SUCCESS && rbfmsi.getNextRecord(rid, data) != RBFM_EOF) {
+					buffer.addTuple(data);
+					if (buffer.isFull())
+						results[w] = writer.write(buffer);
+				}
+				rbfmsi.close();
+			}
+
+			if (results[w] == SUCCESS)
+				results[w] = writer.write(buffer);
+
+			free(data);
+			rbfm->closeFile(workerFileHandle);
+		}));
+	}
 
-	while (rmsi.getNextTuple(rid, data) != RM_EOF)
-		ix->insertEntry(indexFileHandle, keyAttribute, data, rid);
+	for (int w = 0; w < numOfWorkers; w++) {
+		workers[w].join();
+		if (returnValue == SUCCESS)
+			returnValue = results[w];
+	}
 
+	RC closeValue = writer.close();
+	if (returnValue == SUCCESS)
+		returnValue = closeValue;
 
-	rmsi.close();
-	free(data);
+	closeValue = rbfm->closeFile(fileHandle);
+	return returnValue == SUCCESS ? closeValue : returnValue;
+}
+
+static void appendBytes(vector<char> &output, const void *data, size_t length) {
+	output.insert(output.end(), (const char *)data, (const char *)data + length);
+}
+
+// 7 bits per byte, the high bit set on every byte but the last
+static void appendVarint(vector<char> &output, unsigned long long value) {
+	while (value >= 0x80) {
+		output.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	output.push_back((char)value);
+}
+
+static bool readVarint(const char *&pos, const char *end, unsigned long long &value) {
+	value = 0;
+	for (int shift = 0; pos < end && shift < 64; shift += 7) {
+		unsigned char byte = (unsigned char)*pos++;
+		value |= (unsigned long long)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+// small differences of either sign become small unsigned numbers: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ...
+static unsigned long long zigzagEncode(long long value) {
+	return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+static long long zigzagDecode(unsigned long long value) {
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+RM_ExportBuffer::RM_ExportBuffer(const vector<Attribute> &attrs, const FileFormat format)
+		: attrs(attrs), format(format), numOfTuples(0) {
+	if (format == ColumnarFile)
+		columns.resize(attrs.size());
+}
+
+void RM_ExportBuffer::addTuple(const void *data) {
+	const char *field = (const char *)data;
+	char text[32];
+
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		int fieldLength = attrs[i].type == TypeVarChar ? sizeof(int) + *(const int *)field : sizeof(int);
+
+		if (format == ColumnarFile) {
+			appendBytes(columns[i], field, fieldLength);
+		}
+		else if (format == BinaryFile) {
+			appendBytes(output, field, fieldLength);
+		}
+		else {
+			if (i > 0)
+				output.push_back(',');
+
+			if (attrs[i].type == TypeInt) {
+				appendBytes(output, text, snprintf(text, sizeof(text), "%d", *(const int *)field));
+			}
+			else if (attrs[i].type == TypeReal) {
+				appendBytes(output, text, snprintf(text, sizeof(text), "%.9g", *(const float *)field));
+			}
+			else {
+				// quoted when bulkLoad could not read it back as is, an empty varchar too so a line is never empty
+				const char *value = field + sizeof(int);
+				int length = fieldLength - sizeof(int);
+				bool isQuoted = length == 0;
+				for (int j = 0; j < length && !isQuoted; j++)
+					isQuoted = value[j] == ',' || value[j] == '"' || value[j] == '\r' || value[j] == '\n';
+
+				if (!isQuoted) {
+					appendBytes(output, value, length);
+				}
+				else {
+					output.push_back('"');
+					for (int j = 0; j < length; j++) {
+						if (value[j] == '"')
+							output.push_back('"');
+						output.push_back(value[j]);
+					}
+					output.push_back('"');
+				}
+			}
+		}
+		field += fieldLength;
+	}
+
+	if (format == CSVFile)
+		output.push_back('\n');
+	numOfTuples++;
+}
+
+const vector<char> &RM_ExportBuffer::encode() {
+	if (format != ColumnarFile || numOfTuples == 0)
+		return output;
+
+	output.clear();
+	appendBytes(output, &numOfTuples, sizeof(int));
+	for (unsigned i = 0; i < attrs.size(); i++)
+		encodeColumn(attrs[i], columns[i]);
+
+	return output;
+}
+
+void RM_ExportBuffer::clear() {
+	numOfTuples = 0;
+	output.clear();
+	for (unsigned i = 0; i < columns.size(); i++)
+		columns[i].clear();
+}
+
+// appends [int encoding][int numOfBytes][values] of one column of the row group to output
+void RM_ExportBuffer::encodeColumn(const Attribute &attr, const vector<char> &values) {
+	vector<char> block;
+	int encoding = PlainBlock;
+
+	if (attr.type == TypeInt) {
+		int previous = 0;
+		for (size_t offset = 0; offset < values.size(); offset += sizeof(int)) {
+			int value = *(const int *)&values[offset];
+			appendVarint(block, zigzagEncode((long long)value - previous));
+			previous = value;
+		}
+		encoding = DeltaVarintBlock;
+
+		// random values take up to 5 bytes as varints
+		if (block.size() >= values.size()) {
+			block = values;
+			encoding = PlainBlock;
+		}
+	}
+	else if (attr.type == TypeReal) {
+		block = values;
+	}
+	else {
+		// a dictionary pays off when at most half of the values are distinct, give up as soon as there are more
+		map<string, int> dictionary;
+		vector<int> entries;
+		for (size_t offset = 0; offset < values.size() && (int)dictionary.size() * 2 <= numOfTuples; ) {
+			int length = *(const int *)&values[offset];
+			string value(&values[offset + sizeof(int)], length);
+			entries.push_back(dictionary.insert(make_pair(value, (int)dictionary.size())).first->second);
+			offset += sizeof(int) + length;
+		}
+
+		if ((int)dictionary.size() * 2 <= numOfTuples) {
+			encoding = DictionaryBlock;
+			vector<const string *> orderedEntries(dictionary.size());
+			for (map<string, int>::iterator itr = dictionary.begin(); itr != dictionary.end(); ++itr)
+				orderedEntries[itr->second] = &itr->first;
+
+			appendVarint(block, orderedEntries.size());
+			for (unsigned i = 0; i < orderedEntries.size(); i++) {
+				appendVarint(block, orderedEntries[i]->size());
+				appendBytes(block, orderedEntries[i]->data(), orderedEntries[i]->size());
+			}
+			for (unsigned i = 0; i < entries.size(); i++)
+				appendVarint(block, entries[i]);
+		}
+		else {
+			for (size_t offset = 0; offset < values.size(); ) {
+				int length = *(const int *)&values[offset];
+				appendVarint(block, length);
+				appendBytes(block, &values[offset + sizeof(int)], length);
+				offset += sizeof(int) + length;
+			}
+		}
+	}
+
+	int numOfBytes = (int)block.size();
+	appendBytes(output, &encoding, sizeof(int));
+	appendBytes(output, &numOfBytes, sizeof(int));
+	appendBytes(output, block.data(), block.size());
+}
+
+RM_ExportWriter::RM_ExportWriter() : file(NULL), format(CSVFile), buffer(NULL) {
+}
+
+RM_ExportWriter::~RM_ExportWriter() {
+	if (file != NULL)
+		close();
+}
+
+RC RM_ExportWriter::open(const string &fileName, const vector<Attribute> &attrs, const FileFormat format) {
+	if (file != NULL || attrs.empty())
+		return -1;
+
+	file = fopen(fileName.c_str(), "wb");
+	if (file == NULL)
+		return -1;
+
+	this->format = format;
+	buffer = new RM_ExportBuffer(attrs, format);
+
+	if (format != ColumnarFile)
+		return SUCCESS;
+
+	vector<char> header;
+	unsigned magic = COLUMNAR_MAGIC;
+	unsigned version = COLUMNAR_VERSION;
+	int numOfColumns = (int)attrs.size();
+	appendBytes(header, &magic, sizeof(unsigned));
+	appendBytes(header, &version, sizeof(unsigned));
+	appendBytes(header, &numOfColumns, sizeof(int));
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		int column[3] = { attrs[i].type, (int)attrs[i].length, (int)attrs[i].name.size() };
+		appendBytes(header, column, sizeof(column));
+		appendBytes(header, attrs[i].name.data(), attrs[i].name.size());
+	}
+
+	if (fwrite(header.data(), 1, header.size(), file) != header.size()) {
+		close();
+		return -1;
+	}
+	return SUCCESS;
+}
+
+RC RM_ExportWriter::addTuple(const void *data) {
+	if (buffer == NULL)
+		return -1;
+
+	buffer->addTuple(data);
+	return buffer->isFull() ? write(*buffer) : SUCCESS;
+}
+
+RC RM_ExportWriter::write(RM_ExportBuffer &buffer) {
+	if (file == NULL)
+		return -1;
+	if (buffer.isEmpty())
+		return SUCCESS;
+
+	const vector<char> &bytes = buffer.encode();
+	int returnValue;
+	{
+		lock_guard<mutex> guard(writeMutex);
+		returnValue = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() ? SUCCESS : -1;
+	}
+
+	buffer.clear();
+	return returnValue;
+}
+
+RC RM_ExportWriter::close() {
+	if (file == NULL)
+		return -1;
+
+	int returnValue = write(*buffer);
+	if (returnValue == SUCCESS && format == ColumnarFile) {
+		int endOfRowGroups = 0;
+		returnValue = fwrite(&endOfRowGroups, sizeof(int), 1, file) == 1 ? SUCCESS : -1;
+	}
+
+	if (fclose(file) != 0)
+		returnValue = -1;
+	file = NULL;
+	delete buffer;
+	buffer = NULL;
+
+	return returnValue;
+}
+
+RM_ColumnarReader::RM_ColumnarReader() : file(NULL), numOfRows(0), nextRow(0) {
+}
+
+RM_ColumnarReader::~RM_ColumnarReader() {
+	if (file != NULL)
+		close();
+}
+
+RC RM_ColumnarReader::open(const string &fileName) {
+	if (file != NULL)
+		return -1;
+
+	file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		return -1;
+
+	unsigned header[2];
+	int numOfColumns = 0;
+	bool isValid = fread(header, sizeof(unsigned), 2, file) == 2 && header[0] == COLUMNAR_MAGIC && header[1] == COLUMNAR_VERSION
+			&& fread(&numOfColumns, sizeof(int), 1, file) == 1 && numOfColumns > 0;
+
+	attrs.clear();
+	for (int i = 0; i < numOfColumns && isValid; i++) {
+		int column[3];
+		isValid = fread(column, sizeof(int), 3, file) == 3 && column[2] >= 0 && column[2] <= MAX_ATTRIBUTE_LENGTH;
+		if (!isValid)
+			break;
+
+		Attribute attr;
+		attr.type = (AttrType)column[0];
+		attr.length = (AttrLength)column[1];
+		attr.name.resize(column[2]);
+		isValid = column[2] == 0 || fread(&attr.name[0], 1, column[2], file) == (size_t)column[2];
+		attrs.push_back(attr);
+	}
+
+	if (!isValid) {
+		fclose(file);
+		file = NULL;
+		return -1;
+	}
+
+	numOfRows = 0;
+	nextRow = 0;
+	columns.assign(attrs.size(), vector<char>());
+	offsets.assign(attrs.size(), vector<int>());
+	return SUCCESS;
+}
+
+RC RM_ColumnarReader::getNextTuple(void *data) {
+	if (file == NULL)
+		return RM_EOF;
+
+	if (nextRow == numOfRows && readRowGroup() != SUCCESS)
+		return RM_EOF;
+
+	char *output = (char *)data;
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		const char *value = &columns[i][offsets[i][nextRow]];
+		int fieldLength = attrs[i].type == TypeVarChar ? sizeof(int) + *(const int *)value : sizeof(int);
+		memcpy(output, value, fieldLength);
+		output += fieldLength;
+	}
+
+	nextRow++;
+	return SUCCESS;
+}
+
+RC RM_ColumnarReader::close() {
+	if (file == NULL)
+		return -1;
+
+	int returnValue = fclose(file) == 0 ? SUCCESS : -1;
+	file = NULL;
+	attrs.clear();
+	columns.clear();
+	offsets.clear();
+	numOfRows = 0;
+	nextRow = 0;
+	return returnValue;
+}
+
+// -1 at the end of the row groups, or when the file is damaged
+RC RM_ColumnarReader::readRowGroup() {
+	numOfRows = 0;
+	nextRow = 0;
+
+	int rows;
+	if (fread(&rows, sizeof(int), 1, file) != 1 || rows <= 0)
+		return -1;
+	numOfRows = rows;
+
+	vector<char> block;
+	for (unsigned i = 0; i < attrs.size(); i++) {
+		int blockHeader[2];
+		if (fread(blockHeader, sizeof(int), 2, file) != 2 || blockHeader[1] < 0)
+			return -1;
+
+		block.resize(blockHeader[1]);
+		if (blockHeader[1] > 0 && fread(block.data(), 1, blockHeader[1], file) != (size_t)blockHeader[1])
+			return -1;
+
+		if (decodeColumn(i, (ColumnEncoding)blockHeader[0], block) != SUCCESS) {
+			numOfRows = 0;
+			return -1;
+		}
+	}
+
+	return SUCCESS;
+}
+
+// decode a column block of the row group into values in the format of the tuple
+RC RM_ColumnarReader::decodeColumn(int column, ColumnEncoding encoding, const vector<char> &block) {
+	vector<char> &values = columns[column];
+	vector<int> &rowOffsets = offsets[column];
+	values.clear();
+	rowOffsets.clear();
+
+	AttrType type = attrs[column].type;
+	const char *pos = block.data();
+	const char *end = pos + block.size();
+	unsigned long long value;
+
+	if (type == TypeInt && encoding == DeltaVarintBlock) {
+		long long previous = 0;
+		for (int row = 0; row < numOfRows; row++) {
+			if (!readVarint(pos, end, value))
+				return -1;
+			int intValue = (int)(previous + zigzagDecode(value));
+			previous = intValue;
+			rowOffsets.push_back((int)values.size());
+			appendBytes(values, &intValue, sizeof(int));
+		}
+	}
+	else if (type != TypeVarChar && encoding == PlainBlock) {
+		if (block.size() != numOfRows * sizeof(int))
+			return -1;
+		values = block;
+		for (int row = 0; row < numOfRows; row++)
+			rowOffsets.push_back(row * sizeof(int));
+		pos = end;
+	}
+	else if (type == TypeVarChar && (encoding == PlainBlock || encoding == DictionaryBlock)) {
+		// the entries of a dictionary are decoded once, their rows point to them
+		unsigned long long numOfEntries = numOfRows;
+		if (encoding == DictionaryBlock && (!readVarint(pos, end, numOfEntries) || numOfEntries > (unsigned long long)numOfRows))
+			return -1;
+
+		vector<int> entryOffsets;
+		for (unsigned long long i = 0; i < numOfEntries; i++) {
+			if (!readVarint(pos, end, value) || value > attrs[column].length || value > (unsigned long long)(end - pos))
+				return -1;
+			int length = (int)value;
+			entryOffsets.push_back((int)values.size());
+			appendBytes(values, &length, sizeof(int));
+			appendBytes(values, pos, length);
+			pos += length;
+		}
+
+		if (encoding == PlainBlock) {
+			rowOffsets.swap(entryOffsets);
+		}
+		else {
+			for (int row = 0; row < numOfRows; row++) {
+				if (!readVarint(pos, end, value) || value >= numOfEntries)
+					return -1;
+				rowOffsets.push_back(entryOffsets[value]);
+			}
+		}
+	}
+	else {
+		return -1;
+	}
 
-	returnValue = ix->closeFile(indexFileHandle);
+	return pos == end ? SUCCESS : -1;
+}
+
+
+RC RelationManager::destroyIndex(const string & tableName, const string &attributeName) {
+	RM_LockGuard catalogGuard(&catalogLock, true);
+
+	TablePartitions *partitioning = getPartitioning(tableName);
+	if (partitioning != NULL) {
+		map<int, PartitionEntry> &partitions = partitioning->partitions;
+		for (map<int, PartitionEntry>::iterator itr = partitions.begin(); itr != partitions.end(); ++itr) {
+			if (destroyIndex(getPartitionName(tableName, itr->first), attributeName) != SUCCESS)
+				return -1;
+		}
+		return SUCCESS;
+	}
+
+	RM_LockGuard tableGuard(getTableLock(tableName), true);
+	int returnValue = SUCCESS;
+	string indexFileName = tableName + "_" + attributeName + ".idx";
+
+	if (tablesMap.find(tableName) == tablesMap.end() || hasOpenHandles(tableName))
+		return -1;
+
+	// STEP1: check if this .idx file exists;
+	// get table id
+	map<int, RID> * tableIDMap = tablesMap[tableName];
+	int table_ID = (*tableIDMap).begin()->first;
+
+	// get index position, "attributeName" may name a composite index
+	vector<Attribute> attributes;
+	returnValue = getRecordDescriptor(tableName, attributes);
+	if (returnValue != SUCCESS) return returnValue;
+
+	int indexPos = findIndex(table_ID, attributes, attributeName);
+
+	// no index on "attributeName" in "tableName", return error
+	if (indexPos == 0)
+		return -1;
+
+	// STEP2: remove [index position, indexRid] from indexMap
+	map<int, RID> *indexEntryMap = indexMap[table_ID];
+	RID indexRid = (*indexEntryMap)[indexPos];
+
+	invalidateSnapshot();
+	indexEntryMap->erase(indexPos);
+	if (indexEntryMap->size() == 0) {
+		delete(indexMap[table_ID]);
+		indexMap.erase(table_ID);
+	}
+	invalidateAttributes(table_ID);
+
+	// STEP3: delete tuple from indices.tbl
+	returnValue = deleteTuple("indices", indexRid);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// STEP4: delete .idx file
+	returnValue = ix->destroyFile(indexFileName);
 
 	return returnValue;
 }
 
 
 
-RC RelationManager::destroyIndex(const string & tableName, const string &attributeName) {
-	int returnValue = SUCCESS;
-	string indexFileName = tableName + "_" + attributeName + ".idx";
+// a min/max bound of analyzeTable; a varchar longer than the bound is cut to its first MAX_ATTRIBUTE_LENGTH - 4
+// characters, so the stored min and max are the prefixes of the real ones
+static void setStatisticsBound(char *bound, const char *field, int fieldLength, AttrType type) {
+	if (type == TypeVarChar && fieldLength > MAX_ATTRIBUTE_LENGTH) {
+		int prefixLength = MAX_ATTRIBUTE_LENGTH - sizeof(int);
+		memcpy(bound, &prefixLength, sizeof(int));
+		memcpy(bound + sizeof(int), field + sizeof(int), prefixLength);
+	}
+	else {
+		memcpy(bound, field, fieldLength);
+	}
+}
+
+/**************************************************************************************************************
+ * Collects the statistics of every column of a table in one scan and stores them in STATISTICS, replacing the
+ * entries of a previous run. The scan holds only the table lock (shared), the catalog lock is taken to write the
+ * result. A table of up to STATS_SAMPLE_PAGES pages is read whole: row count, min/max and the distinct count
+ * (HyperLogLog) see every tuple. A larger one is read in runs of STATS_SAMPLE_RUN pages spread evenly over the
+ * file, STATS_SAMPLE_PAGES pages in all; the row count is scaled up by the pages, min/max are those of the sample
+ * and the distinct count is estimated from the sample (see estimateTableDistinct). The equi-depth histogram is
+ * built from a reservoir sample of STATS_SAMPLE_SIZE of the tuples read so memory stays bounded.
+**************************************************************************************************************/
+RC RelationManager::analyzeTable(const string &tableName) {
+	int table_ID;
+	shared_mutex *tableLock;
+	vector<Attribute> recordDescriptor;
+	{
+		RM_LockGuard catalogGuard(&catalogLock, false);
+		if (tablesMap.find(tableName) == tablesMap.end() || getPartitioning(tableName) != NULL)
+			return -1;
+
+		table_ID = tablesMap[tableName]->begin()->first;
+		tableLock = getTableLock(table_ID);
+		if (getRecordDescriptor(tableName, recordDescriptor) != SUCCESS)
+			return -1;
+	}
+
+	int numOfCols = (int)recordDescriptor.size();
+
+	// STEP1: scan the table, keep min/max, a sketch and a sample for each column
+	vector<string> attributeNames;
+	for (int i = 0; i < numOfCols; i++) {
+		if (!recordDescriptor[i].isDropped)
+			attributeNames.push_back(recordDescriptor[i].name);
+	}
+	if (attributeNames.empty())
+		return -1;
+
+	vector<ColumnStatistics> stats(numOfCols);
+	vector<vector<unsigned char> > sketches(numOfCols, vector<unsigned char>(1 << STATS_HLL_PRECISION, 0));
+	vector<vector<string> > samples(numOfCols);
+
+	int numOfRows = 0;
+	unsigned numOfPages = 0;
+	unsigned numOfSampledPages = 0;
+	unsigned long long seed = 0x9E3779B97F4A7C15ULL ^ table_ID;
+	int returnValue = SUCCESS;
+	{
+		RM_LockGuard tableGuard(tableLock, false);
+
+		FileHandle fileHandle;
+		returnValue = rbfm->openFile(tableName + ".tbl", fileHandle);
+		if (returnValue != SUCCESS)
+			return returnValue;
+		numOfPages = fileHandle.getNumberOfPages();
+
+		// [first, end) page ranges read, the whole file or evenly spread runs
+		vector<pair<unsigned, unsigned> > ranges;
+		if (numOfPages <= STATS_SAMPLE_PAGES) {
+			ranges.push_back(make_pair(0u, numOfPages));
+		}
+		else {
+			unsigned numOfRuns = STATS_SAMPLE_PAGES / STATS_SAMPLE_RUN;
+			for (unsigned r = 0; r < numOfRuns; r++) {
+				unsigned firstPage = (unsigned)((unsigned long long)r * numOfPages / numOfRuns);
+				ranges.push_back(make_pair(firstPage, firstPage + STATS_SAMPLE_RUN));
+			}
+		}
+
+		char *data = (char *)malloc(PAGE_SIZE);
+		RID rid;
+
+		for (unsigned r = 0; r < ranges.size() && returnValue == SUCCESS; r++) {
+			numOfSampledPages += ranges[r].second - ranges[r].first;
+
+			RBFM_ScanIterator rbfmsi;
+			returnValue = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmsi);
+			if (returnValue == SUCCESS)
+				returnValue = rbfmsi.setPageRange(ranges[r].first, ranges[r].second);
+
+			while (returnValue == SUCCESS && rbfmsi.getNextRecord(rid, data) != RBFM_EOF) {
+				// reservoir sampling, one slot chosen per tuple for all of the columns
+				int sampleSlot = numOfRows;
+				if (numOfRows >= STATS_SAMPLE_SIZE) {
+					seed ^= seed << 13;
+					seed ^= seed >> 7;
+					seed ^= seed << 17;
+					sampleSlot = (int)(seed % (unsigned long long)(numOfRows + 1));
+				}
+
+				int offset = 0;
+				for (int i = 0; i < numOfCols; i++) {
+					if (recordDescriptor[i].isDropped)
+						continue;
+
+					AttrType type = recordDescriptor[i].type;
+					char *field = data + offset;
+					int fieldLength = getFieldLength(field, type);
+					offset += fieldLength;
+
+					if (numOfRows == 0 || compareFields(field, stats[i].minValue, type) < 0)
+						setStatisticsBound(stats[i].minValue, field, fieldLength, type);
+					if (numOfRows == 0 || compareFields(field, stats[i].maxValue, type) > 0)
+						setStatisticsBound(stats[i].maxValue, field, fieldLength, type);
+
+					addToSketch(sketches[i], hashField(field, type));
+
+					if (sampleSlot < STATS_SAMPLE_SIZE) {
+						// only the prefix of a varchar is kept, the bucket bounds are cut to it anyway
+						string value;
+						if (type == TypeVarChar && fieldLength > (int)(sizeof(int) + STATS_BOUND_PREFIX)) {
+							int prefixLength = STATS_BOUND_PREFIX;
+							value.append((char *)&prefixLength, sizeof(int));
+							value.append(field + sizeof(int), prefixLength);
+						}
+						else {
+							value.assign(field, fieldLength);
+						}
+
+						if (sampleSlot == (int)samples[i].size())
+							samples[i].push_back(value);
+						else
+							samples[i][sampleSlot] = value;
+					}
+				}
+
+				numOfRows++;
+			}
+			rbfmsi.close();
+		}
+
+		free(data);
+		RC closeValue = rbfm->closeFile(fileHandle);
+		if (returnValue == SUCCESS)
+			returnValue = closeValue;
+	}
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	// the rows of the pages not read, at the density of those read
+	int numOfReadRows = numOfRows;
+	if (numOfSampledPages < numOfPages)
+		numOfRows = (int)((double)numOfRows * numOfPages / numOfSampledPages + 0.5);
+
+	// STEP2: turn the samples into equi-depth histograms
+	for (int i = 0; i < numOfCols; i++) {
+		if (recordDescriptor[i].isDropped)
+			continue;
+
+		AttrType type = recordDescriptor[i].type;
+		vector<string> &sample = samples[i];
+
+		sort(sample.begin(), sample.end(), [this, type](const string &a, const string &b) {
+			return compareFields(a.data(), b.data(), type) < 0;
+		});
+
+		// the sketch counts the values of the rows read, a sample of the table is scaled up by estimateTableDistinct
+		int numOfDistinct = estimateDistinct(sketches[i]);
+		if (numOfReadRows < numOfRows)
+			numOfDistinct = max(numOfDistinct, estimateTableDistinct(sample, type, numOfRows));
+
+		stats[i].numOfRows = numOfRows;
+		stats[i].numOfPages = numOfPages;
+		stats[i].numOfDistinct = min(numOfDistinct, numOfRows);
+
+		int sampleSize = (int)sample.size();
+		int numOfBuckets = min(STATS_HISTOGRAM_BUCKETS, sampleSize);
+		int begin = 0;
+		for (int b = 0; b < numOfBuckets; b++) {
+			int end = (int)((long long)(b + 1) * sampleSize / numOfBuckets);
+			int bucketRows = (int)((double)(end - begin) * numOfRows / sampleSize + 0.5);
+			const string &upperBound = sample[end - 1];
+			begin = end;
+
+			// a frequent value spans several buckets, fold them into one
+			if (!stats[i].histogram.empty()
+					&& compareFields(stats[i].histogram.back().upperBound, upperBound.data(), type) == 0) {
+				stats[i].histogram.back().numOfRows += bucketRows;
+				continue;
+			}
+
+			HistogramBucket bucket;
+			bucket.numOfRows = bucketRows;
+			memcpy(bucket.upperBound, upperBound.data(), upperBound.size());
+			stats[i].histogram.push_back(bucket);
+		}
+	}
+
+	// STEP3: replace the entries of the table in statistics.tbl, unless it was dropped or altered during the scan
+	RM_LockGuard catalogGuard(&catalogLock, true);
+	if (tablesMap.find(tableName) == tablesMap.end() || tablesMap[tableName]->begin()->first != table_ID)
+		return -1;
+
+	vector<Attribute> currentDescriptor;
+	returnValue = getRecordDescriptor(tableName, currentDescriptor);
+	if (returnValue != SUCCESS)
+		return returnValue;
+	if (currentDescriptor.size() != recordDescriptor.size())
+		return -1;
+	for (int i = 0; i < numOfCols; i++) {
+		if (currentDescriptor[i].isDropped != recordDescriptor[i].isDropped)
+			return -1;
+	}
+
+	invalidateSnapshot();
+	returnValue = deleteStatisticsEntries(table_ID);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	FileHandle fileHandle;
+	returnValue = rbfm->openFile("statistics.tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	map<int, RID> *statisticsEntryMap = new map<int, RID>();
+	statisticsMap[table_ID] = statisticsEntryMap;
+
+	for (int i = 0; i < numOfCols; i++) {
+		if (recordDescriptor[i].isDropped)
+			continue;
+
+		RID statisticsRid;
+		returnValue = insertStatisticsEntry(tableName, recordDescriptor[i].name, table_ID, i + 1, stats[i],
+				recordDescriptor[i].type, fileHandle, statisticsRid);
+		if (returnValue != SUCCESS) {
+			rbfm->closeFile(fileHandle);
+			return returnValue;
+		}
+
+		(*statisticsEntryMap)[i + 1] = statisticsRid;
+	}
+
+	return rbfm->closeFile(fileHandle);
+}
+
+RC RelationManager::getStatistics(const string &tableName, const string &attributeName, ColumnStatistics &stats) {
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	if (tablesMap.find(tableName) == tablesMap.end())
+		return -1;
 
-	// STEP1: check if this .idx file exists;
-	// get table id
-	map<int, RID> * tableIDMap = tablesMap[tableName];
-	int table_ID = (*tableIDMap).begin()->first;
+	int table_ID = tablesMap[tableName]->begin()->first;
 
-	// get attribute position
-	vector<Attribute> attributes;
-	returnValue = getAttributes(tableName, attributes);
-	if (returnValue != SUCCESS) return returnValue;
+	vector<Attribute> recordDescriptor;
+	int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+	if (returnValue != SUCCESS)
+		return returnValue;
 
 	int attrPos = 1;
-	for (; attrPos <= (int)attributes.size(); attrPos++) {
-		if (attributes[attrPos - 1].name.compare(attributeName) == 0)
+	for (; attrPos <= (int)recordDescriptor.size(); attrPos++) {
+		if (!recordDescriptor[attrPos - 1].isDropped && recordDescriptor[attrPos - 1].name.compare(attributeName) == 0)
 			break;
 	}
 
-	// "attributeName" in "tableName" is not found, return error
-	if (attrPos > (int)attributes.size())
+	// the attribute does not exist or the table has not been analyzed yet
+	if (attrPos > (int)recordDescriptor.size() || statisticsMap.find(table_ID) == statisticsMap.end())
 		return -1;
 
-	// STEP2: remove [attribute position, indexRid] from indexMap
-	if (indexMap.find(table_ID) == indexMap.end())
+	map<int, RID> *statisticsEntryMap = statisticsMap[table_ID];
+	if (statisticsEntryMap->find(attrPos) == statisticsEntryMap->end())
 		return -1;
 
-	map<int, RID> *indexEntryMap = indexMap[table_ID];
+	FileHandle fileHandle;
+	returnValue = rbfm->openFile("statistics.tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
 
-	if (indexEntryMap->find(attrPos) == indexEntryMap->end())
-		return -1;
-	RID indexRid = (*indexEntryMap)[attrPos];
+	char *record = (char *)malloc(determineMemoryNeeded(statisticsVec));
+	returnValue = rbfm->readRecord(fileHandle, statisticsVec, (*statisticsEntryMap)[attrPos], record);
+	rbfm->closeFile(fileHandle);
+	if (returnValue != SUCCESS) {
+		free(record);
+		return returnValue;
+	}
 
-	indexEntryMap->erase(attrPos);
-	if (indexEntryMap->size() == 0) {
-		delete(indexMap[table_ID]);
-		indexMap.erase(table_ID);
+	AttrType type = recordDescriptor[attrPos - 1].type;
+	char *field = record;
+	int stringLength;
+
+	field += sizeof(int); // skip over table id
+	memcpy(&stringLength, field, sizeof(int));
+	field += sizeof(int) + stringLength; // skip over table name
+	field += sizeof(int); // skip over column position
+	memcpy(&stringLength, field, sizeof(int));
+	field += sizeof(int) + stringLength; // skip over column name
+
+	memcpy(&stats.numOfRows, field, sizeof(int));
+	field += sizeof(int);
+	memcpy(&stats.numOfPages, field, sizeof(int));
+	field += sizeof(int);
+	memcpy(&stats.numOfDistinct, field, sizeof(int));
+	field += sizeof(int);
+
+	// min and max are stored without their own length prefix, put it back for a varchar
+	char *bounds[2] = {stats.minValue, stats.maxValue};
+	for (int i = 0; i < 2; i++) {
+		memset(bounds[i], 0, MAX_ATTRIBUTE_LENGTH);
+		memcpy(&stringLength, field, sizeof(int));
+		field += sizeof(int);
+		if (type == TypeVarChar) {
+			memcpy(bounds[i], &stringLength, sizeof(int));
+			memcpy(bounds[i] + sizeof(int), field, stringLength);
+		}
+		else {
+			memcpy(bounds[i], field, stringLength);
+		}
+		field += stringLength;
 	}
 
-	// STEP3: delete tuple from indices.tbl
-	returnValue = deleteTuple("indices", indexRid);
+	stats.histogram.clear();
+	field += sizeof(int); // skip over the histogram length
+	int numOfBuckets;
+	memcpy(&numOfBuckets, field, sizeof(int));
+	field += sizeof(int);
+	for (int i = 0; i < numOfBuckets; i++) {
+		HistogramBucket bucket;
+		memcpy(&bucket.numOfRows, field, sizeof(int));
+		field += sizeof(int);
+
+		int boundLength = getFieldLength(field, type);
+		memcpy(bucket.upperBound, field, boundLength);
+		field += boundLength;
+		stats.histogram.push_back(bucket);
+	}
+
+	free(record);
+
+	return SUCCESS;
+}
+
+RC RelationManager::deleteStatisticsEntries(int tableID) {
+	if (statisticsMap.find(tableID) == statisticsMap.end())
+		return SUCCESS;
+
+	FileHandle fileHandle;
+	int returnValue = rbfm->openFile("statistics.tbl", fileHandle);
 	if (returnValue != SUCCESS)
 		return returnValue;
 
-	// STEP4: delete .idx file
-	returnValue = ix->destroyFile(indexFileName);
+	map<int, RID> *statisticsEntryMap = statisticsMap[tableID];
+	for (map<int, RID>::iterator itr = statisticsEntryMap->begin(); itr != statisticsEntryMap->end(); ++itr) {
+		returnValue = rbfm->deleteRecord(fileHandle, statisticsVec, itr->second);
+		if (returnValue != SUCCESS) {
+			rbfm->closeFile(fileHandle);
+			return -1;
+		}
+	}
 
-	return returnValue;
+	delete(statisticsEntryMap);
+	statisticsMap.erase(tableID);
+
+	return rbfm->closeFile(fileHandle);
 }
 
 
@@ -1198,8 +3979,62 @@ RC RelationManager::scan(const string &tableName,
 		const void *value,
 		const vector<string> &attributeNames,
 		RM_ScanIterator &rm_ScanIterator) {
+    RM_LockGuard catalogGuard(&catalogLock, false);
+
+    // the partitions are opened one after the other by the iterator, a condition on the partition attribute
+    // leaves out the partitions which cannot hold a matching key
+    TablePartitions *partitioning = getPartitioning(tableName);
+    if (partitioning != NULL) {
+        vector<Attribute> recordDescriptor;
+        if (getRecordDescriptor(tableName, recordDescriptor) != SUCCESS) {
+            return -1;
+        }
+
+        rm_ScanIterator.value.clear();
+        if (value != NULL) {
+            unsigned i = 0;
+            while (i < recordDescriptor.size() && recordDescriptor[i].name != conditionAttribute) {
+                i++;
+            }
+            if (i == recordDescriptor.size()) {
+                return -1;
+            }
+            const char *field = (const char *)value;
+            rm_ScanIterator.value.assign(field, field + getFieldLength(field, recordDescriptor[i].type));
+        }
+
+        const void *lowKey = NULL;
+        const void *highKey = NULL;
+        bool lowKeyInclusive = true;
+        bool highKeyInclusive = true;
+        if (value != NULL && conditionAttribute == recordDescriptor[partitioning->columnPosition - 1].name) {
+            switch (compOp) {
+            case EQ_OP: lowKey = value; highKey = value; break;
+            case LT_OP: highKey = value; highKeyInclusive = false; break;
+            case LE_OP: highKey = value; break;
+            case GT_OP: lowKey = value; lowKeyInclusive = false; break;
+            case GE_OP: lowKey = value; break;
+            default: break;
+            }
+        }
+
+        prunePartitions(*partitioning, recordDescriptor[partitioning->columnPosition - 1].type, lowKey, highKey,
+                lowKeyInclusive, highKeyInclusive, rm_ScanIterator.partitions);
+
+        rm_ScanIterator.tableName = tableName;
+        rm_ScanIterator.nextPartition = 0;
+        rm_ScanIterator.conditionAttribute = conditionAttribute;
+        rm_ScanIterator.compOp = compOp;
+        rm_ScanIterator.attributeNames = attributeNames;
+        rm_ScanIterator.ownsFileHandle = true;
+        return SUCCESS;
+    }
+
+    RM_LockGuard tableGuard(getTableLock(tableName), false);
     string fileName = tableName + ".tbl";
 
+    rm_ScanIterator.ownsFileHandle = true;
+    rm_ScanIterator.tableLock = getTableLock(tableName);
     int returnValue = rbfm->openFile(fileName, rm_ScanIterator.fileHandle);
     if (returnValue != SUCCESS) {
         return -1;
@@ -1211,7 +4046,7 @@ RC RelationManager::scan(const string &tableName,
     	return rm_ScanIterator.initialize(columnVec, compOp, value, attributeNames, conditionAttribute);
     else {
     	vector<Attribute> recordDescriptor;
-    	returnValue = getAttributes(tableName, recordDescriptor);
+    	returnValue = getRecordDescriptor(tableName, recordDescriptor);
     	if (returnValue != SUCCESS) {
     		return -1;
     	}
@@ -1229,55 +4064,505 @@ RC RelationManager::indexScan(const string &tableName,
 			bool highKeyInclusive,
 			RM_IndexScanIterator &rm_IndexScanIterator)
 {
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(tableName), false);
 	int returnValue = -1;
 	string indexFileName = tableName + "_" + attributeName + ".idx";
 
+	rm_IndexScanIterator.isCovering = false;
+	rm_IndexScanIterator.compositeAttrs.clear();
+
+	// the indexes of the partitions are scanned one after the other, see RelationManager::scan
+	TablePartitions *partitioning = getPartitioning(tableName);
+	if (partitioning != NULL) {
+		vector<Attribute> attributes;
+		if (getRecordDescriptor(tableName, attributes) != SUCCESS)
+			return -1;
+
+		// the partitions all have the same indexes
+		string partitionName = getPartitionName(tableName, partitioning->partitions.begin()->first);
+		int partition_ID = tablesMap[partitionName]->begin()->first;
+		int keyPos = findIndex(partition_ID, attributes, attributeName);
+		map<int, vector<int> > keyColumns;
+		map<int, vector<int> > includedColumns;
+		if (keyPos == 0 || getIndexColumns(partition_ID, keyColumns, includedColumns) != SUCCESS)
+			return -1;
+
+		rm_IndexScanIterator.keyAttribute = getIndexAttribute(attributes, keyColumns[keyPos]);
+		AttrType keyType = rm_IndexScanIterator.keyAttribute.type;
+		rm_IndexScanIterator.lowKey.clear();
+		rm_IndexScanIterator.highKey.clear();
+		if (lowKey != NULL)
+			rm_IndexScanIterator.lowKey.assign((const char *)lowKey, (const char *)lowKey + getFieldLength((const char *)lowKey, keyType));
+		if (highKey != NULL)
+			rm_IndexScanIterator.highKey.assign((const char *)highKey, (const char *)highKey + getFieldLength((const char *)highKey, keyType));
+		rm_IndexScanIterator.lowKeyInclusive = lowKeyInclusive;
+		rm_IndexScanIterator.highKeyInclusive = highKeyInclusive;
+
+		if (keyPos == partitioning->columnPosition) {
+			prunePartitions(*partitioning, keyType, lowKey, highKey, lowKeyInclusive, highKeyInclusive,
+					rm_IndexScanIterator.partitions);
+		}
+		else {
+			prunePartitions(*partitioning, keyType, NULL, NULL, true, true, rm_IndexScanIterator.partitions);
+		}
+
+		rm_IndexScanIterator.tableName = tableName;
+		rm_IndexScanIterator.nextPartition = 0;
+		return SUCCESS;
+	}
+
 	// STEP1 : check if this .idx file exists;
-	if (!pfm->fexist(indexFileName))
+	if (!pfm->fexist(indexFileName) || tablesMap.find(tableName) == tablesMap.end())
 		return returnValue;
 
+	rm_IndexScanIterator.tableLock = getTableLock(tableName);
+
 	// STEP2 : open file with fileHandle
 	returnValue = ix->openFile(indexFileName, rm_IndexScanIterator.indexFileHandle);
 	if (returnValue != SUCCESS) return returnValue;
 
-	// STEP3 : get Attribute;
-	Attribute keyAttribute;
+	// STEP3 : get Attribute, the varchar key of a composite index
 	vector<Attribute> attributes;
-	returnValue = getAttributes(tableName, attributes);
-	if (returnValue != SUCCESS) return returnValue;
-
-	unsigned i = 0;
-	for (; i < attributes.size(); i++) {
-		if (attributes[i].name.compare(attributeName) == 0) {
-			keyAttribute = attributes[i];
-			break;
-		}
+	returnValue = getRecordDescriptor(tableName, attributes);
+	if (returnValue != SUCCESS) {
+		ix->closeFile(rm_IndexScanIterator.indexFileHandle);
+		return returnValue;
 	}
 
-	// attribute not found
-	if (i == attributes.size()) {
+	int table_ID = tablesMap[tableName]->begin()->first;
+	int keyPos = findIndex(table_ID, attributes, attributeName);
+	map<int, vector<int> > keyColumns;
+	map<int, vector<int> > includedColumns;
+
+	// index not found
+	if (keyPos == 0 || getIndexColumns(table_ID, keyColumns, includedColumns) != SUCCESS) {
 		ix->closeFile(rm_IndexScanIterator.indexFileHandle);
 		return -1;
 	}
 
+	Attribute keyAttribute = getIndexAttribute(attributes, keyColumns[keyPos]);
+
 	returnValue = rm_IndexScanIterator.initialize(keyAttribute, lowKey, highKey,
 			lowKeyInclusive, highKeyInclusive);
 
 	return returnValue;
 }
 
+/**
+ * The bounds become composite keys of the index: the scan starts at the prefix followed by lowKey, or after every
+ * key starting with them when lowKey is exclusive, and stops before the first key past the prefix followed by
+ * highKey (inclusive), or at that key (exclusive).
+ */
+RC RelationManager::indexScan(const string &tableName,
+			const vector<string> &attributeNames,
+			const void *prefixValues,
+			unsigned numOfPrefixValues,
+			const void *lowKey,
+			const void *highKey,
+			bool lowKeyInclusive,
+			bool highKeyInclusive,
+			RM_IndexScanIterator &rm_IndexScanIterator)
+{
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(tableName), false);
+
+	vector<Attribute> attributes;
+	if (tablesMap.find(tableName) == tablesMap.end() || getRecordDescriptor(tableName, attributes) != SUCCESS)
+		return -1;
+
+	vector<Attribute> keyAttributes;
+	for (unsigned i = 0; i < attributeNames.size(); i++) {
+		unsigned j = 0;
+		while (j < attributes.size() && (attributes[j].isDropped || attributes[j].name != attributeNames[i]))
+			j++;
+
+		if (j == attributes.size())
+			return -1;
+		keyAttributes.push_back(attributes[j]);
+	}
+
+	// there is no attribute after the prefix for the range
+	if (numOfPrefixValues > keyAttributes.size()
+			|| (numOfPrefixValues == keyAttributes.size() && (lowKey != NULL || highKey != NULL)))
+		return -1;
+
+	char values[PAGE_SIZE];
+	int prefixLength = 0;
+	for (unsigned i = 0; i < numOfPrefixValues; i++)
+		prefixLength += getFieldLength((const char *)prefixValues + prefixLength, keyAttributes[i].type);
+	if (prefixLength > 0)
+		memcpy(values, prefixValues, prefixLength);
+
+	char low[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	char high[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	bool hasLow = false;
+	bool hasHigh = false;
+	AttrType rangeType = keyAttributes[min(numOfPrefixValues, (unsigned)keyAttributes.size() - 1)].type;
+
+	unsigned numOfLowValues = numOfPrefixValues;
+	if (lowKey != NULL) {
+		memcpy(values + prefixLength, lowKey, getFieldLength((const char *)lowKey, rangeType));
+		numOfLowValues++;
+	}
+	if (numOfLowValues > 0) {
+		hasLow = ix->prepareCompositeKey(keyAttributes, values, numOfLowValues, lowKey != NULL && !lowKeyInclusive, low) == SUCCESS;
+
+		// no key comes after the values of an exclusive lowKey: the empty range [low, low)
+		if (!hasLow) {
+			ix->prepareCompositeKey(keyAttributes, values, numOfLowValues, false, low);
+			memcpy(high, low, sizeof(int) + *(int *)low);
+			hasLow = hasHigh = true;
+		}
+	}
+
+	unsigned numOfHighValues = numOfPrefixValues;
+	if (highKey != NULL) {
+		memcpy(values + prefixLength, highKey, getFieldLength((const char *)highKey, rangeType));
+		numOfHighValues++;
+	}
+	if (numOfHighValues > 0 && !hasHigh)
+		hasHigh = ix->prepareCompositeKey(keyAttributes, values, numOfHighValues, highKey == NULL || highKeyInclusive, high) == SUCCESS;
+
+	string indexName = ix->getCompositeAttribute(keyAttributes).name;
+	int returnValue = indexScan(tableName, indexName, hasLow ? low : NULL, hasHigh ? high : NULL, true, false, rm_IndexScanIterator);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	rm_IndexScanIterator.compositeAttrs = keyAttributes;
+	rm_IndexScanIterator.keyBuffer.resize(PAGE_SIZE);
+
+	return SUCCESS;
+}
+
+RC RelationManager::indexScan(const string &tableName,
+			const string &attributeName,
+			const void *lowKey,
+			const void *highKey,
+			bool lowKeyInclusive,
+			bool highKeyInclusive,
+			const vector<string> &attributeNames,
+			RM_IndexScanIterator &rm_IndexScanIterator)
+{
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(tableName), false);
+
+	if (tablesMap.find(tableName) == tablesMap.end())
+		return -1;
+
+	int table_ID = tablesMap[tableName]->begin()->first;
+
+	// the indexes of a partitioned table are the ones of its partitions, which all have the same
+	TablePartitions *partitioning = getPartitioning(tableName);
+	if (partitioning != NULL)
+		table_ID = tablesMap[getPartitionName(tableName, partitioning->partitions.begin()->first)]->begin()->first;
+
+	vector<Attribute> attributes;
+	int returnValue = getRecordDescriptor(tableName, attributes);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	int keyPos = 1;
+	while (keyPos <= (int)attributes.size() && (attributes[keyPos - 1].isDropped || attributes[keyPos - 1].name != attributeName))
+		keyPos++;
+
+	if (keyPos > (int)attributes.size() || indexMap.find(table_ID) == indexMap.end()
+			|| indexMap[table_ID]->find(keyPos) == indexMap[table_ID]->end())
+		return -1;
+
+	map<int, vector<int> > keyColumns;
+	map<int, vector<int> > includedColumns;
+	returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	const vector<int> &included = includedColumns[keyPos];
+
+	// every projected attribute has to be found in the entries
+	vector<int> projection;
+	for (unsigned i = 0; i < attributeNames.size(); i++) {
+		if (attributeNames[i] == attributeName) {
+			projection.push_back(-1);
+			continue;
+		}
+
+		unsigned j = 0;
+		while (j < included.size() && attributes[included[j] - 1].name != attributeNames[i])
+			j++;
+
+		if (j == included.size())
+			return -1;
+		projection.push_back(j);
+	}
+
+	returnValue = indexScan(tableName, attributeName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, rm_IndexScanIterator);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	rm_IndexScanIterator.isCovering = true;
+	rm_IndexScanIterator.keyType = attributes[keyPos - 1].type;
+	rm_IndexScanIterator.includedAttrs.clear();
+	for (unsigned j = 0; j < included.size(); j++)
+		rm_IndexScanIterator.includedAttrs.push_back(attributes[included[j] - 1]);
+	rm_IndexScanIterator.projection = projection;
+	rm_IndexScanIterator.payloadOffsets.resize(included.size());
+	rm_IndexScanIterator.keyBuffer.resize(PAGE_SIZE);
+	rm_IndexScanIterator.payloadBuffer.resize(MAX_INCLUDED_LENGTH);
+
+	return SUCCESS;
+}
+
+// fails when the partition has been dropped since the scan started
+RC RelationManager::openPartitionScan(RM_ScanIterator &rm_ScanIterator, const string &partitionName)
+{
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(partitionName), false);
+
+	vector<Attribute> recordDescriptor;
+	if (tablesMap.find(partitionName) == tablesMap.end() || getRecordDescriptor(partitionName, recordDescriptor) != SUCCESS)
+		return -1;
+
+	int returnValue = rbfm->openFile(partitionName + ".tbl", rm_ScanIterator.fileHandle);
+	if (returnValue != SUCCESS)
+		return -1;
+
+	rm_ScanIterator.tableLock = getTableLock(partitionName);
+
+	const void *value = rm_ScanIterator.value.empty() ? NULL : &rm_ScanIterator.value[0];
+	returnValue = rm_ScanIterator.initialize(recordDescriptor, rm_ScanIterator.compOp, value, rm_ScanIterator.attributeNames,
+			rm_ScanIterator.conditionAttribute);
+	if (returnValue != SUCCESS) {
+		rm_ScanIterator.isScanOpen = false;
+		rm_ScanIterator.rbfm_scanner.close();
+		rbfm->closeFile(rm_ScanIterator.fileHandle);
+		return -1;
+	}
+
+	return SUCCESS;
+}
+
+RC RelationManager::openPartitionIndexScan(RM_IndexScanIterator &rm_IndexScanIterator, const string &partitionName)
+{
+	RM_LockGuard catalogGuard(&catalogLock, false);
+	RM_LockGuard tableGuard(getTableLock(partitionName), false);
+
+	string indexFileName = partitionName + "_" + rm_IndexScanIterator.keyAttribute.name + ".idx";
+	if (tablesMap.find(partitionName) == tablesMap.end() || !pfm->fexist(indexFileName))
+		return -1;
+
+	int returnValue = ix->openFile(indexFileName, rm_IndexScanIterator.indexFileHandle);
+	if (returnValue != SUCCESS)
+		return -1;
+
+	rm_IndexScanIterator.tableLock = getTableLock(partitionName);
+
+	const vector<char> &lowKey = rm_IndexScanIterator.lowKey;
+	const vector<char> &highKey = rm_IndexScanIterator.highKey;
+	returnValue = rm_IndexScanIterator.initialize(rm_IndexScanIterator.keyAttribute, lowKey.empty() ? NULL : &lowKey[0],
+			highKey.empty() ? NULL : &highKey[0], rm_IndexScanIterator.lowKeyInclusive, rm_IndexScanIterator.highKeyInclusive);
+	if (returnValue != SUCCESS) {
+		rm_IndexScanIterator.isScanOpen = false;
+		ix->closeFile(rm_IndexScanIterator.indexFileHandle);
+		return -1;
+	}
+
+	return SUCCESS;
+}
+
 
 
 // Extra credit
 RC RelationManager::dropAttribute(const string &tableName, const string &attributeName)
 {
-    return -1;
+    RM_LockGuard catalogGuard(&catalogLock, true);
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+    // the partitions of a table keep the schema of the table
+    if (tablesMap.find(tableName) == tablesMap.end() || isSystemTable(tableName) || hasOpenHandles(tableName)
+            || isPartitionTable(tableName) || getPartitioning(tableName) != NULL)
+        return -1;
+
+    int table_ID = tablesMap[tableName]->begin()->first;
+
+    vector<Attribute> recordDescriptor;
+    int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    int attrPos = 0;
+    int numOfLive = 0;
+    for (int i = 1; i <= (int)recordDescriptor.size(); i++) {
+        if (recordDescriptor[i - 1].isDropped)
+            continue;
+        numOfLive++;
+        if (recordDescriptor[i - 1].name == attributeName)
+            attrPos = i;
+    }
+
+    // not found, or the last attribute of the table
+    if (attrPos == 0 || numOfLive == 1)
+        return -1;
+
+    // the index on the attribute, or covering it, has to be destroyed first
+    if (indexMap.find(table_ID) != indexMap.end()) {
+        map<int, vector<int> > keyColumns;
+        map<int, vector<int> > includedColumns;
+        returnValue = getIndexColumns(table_ID, keyColumns, includedColumns);
+        if (returnValue != SUCCESS)
+            return -1;
+
+        for (map<int, vector<int> >::iterator itr = keyColumns.begin(); itr != keyColumns.end(); ++itr) {
+            const vector<int> &included = includedColumns[itr->first];
+            if (find(itr->second.begin(), itr->second.end(), attrPos) != itr->second.end()
+                    || find(included.begin(), included.end(), attrPos) != included.end())
+                return -1;
+        }
+    }
+
+    int schemaVersion;
+    returnValue = getSchemaVersion(table_ID, schemaVersion);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    invalidateSnapshot();
+
+    // mark the column dropped, the records keep their field for it
+    FileHandle fileHandle;
+    returnValue = rbfm->openFile("columns.tbl", fileHandle);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    RID columnRid = (*columnsMap[table_ID])[attrPos];
+    char *record = (char *)malloc(determineMemoryNeeded(columnVec));
+    returnValue = rbfm->readRecord(fileHandle, columnVec, columnRid, record);
+    if (returnValue == SUCCESS) {
+        int droppedVersion = schemaVersion + 1;
+        memcpy(record + readFieldOffset(record, 8, columnVec), &droppedVersion, sizeof(int));
+        returnValue = rbfm->updateRecord(fileHandle, columnVec, record, columnRid);
+    }
+    free(record);
+
+    invalidateAttributes(table_ID);
+
+    RC closeValue = rbfm->closeFile(fileHandle);
+    if (returnValue != SUCCESS)
+        return returnValue;
+    if (closeValue != SUCCESS)
+        return closeValue;
+
+    // the statistics of the column go with it
+    if (statisticsMap.find(table_ID) != statisticsMap.end() && statisticsMap[table_ID]->find(attrPos) != statisticsMap[table_ID]->end()) {
+        returnValue = deleteTuple("statistics", (*statisticsMap[table_ID])[attrPos]);
+        statisticsMap[table_ID]->erase(attrPos);
+    }
+
+    return returnValue;
 }
 
 // Extra credit
 RC RelationManager::addAttribute(const string &tableName, const Attribute &attr)
 {
-    return -1;
+    RM_LockGuard catalogGuard(&catalogLock, true);
+    RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+    // the partitions of a table keep the schema of the table
+    if (tablesMap.find(tableName) == tablesMap.end() || isSystemTable(tableName) || hasOpenHandles(tableName)
+            || isPartitionTable(tableName) || getPartitioning(tableName) != NULL)
+        return -1;
+
+    int table_ID = tablesMap[tableName]->begin()->first;
+    RID tableRid = tablesMap[tableName]->begin()->second;
+
+    vector<Attribute> recordDescriptor;
+    int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    for (unsigned i = 0; i < recordDescriptor.size(); i++) {
+        if (!recordDescriptor[i].isDropped && recordDescriptor[i].name == attr.name)
+            return -1;
+    }
+
+    int schemaVersion;
+    returnValue = getSchemaVersion(table_ID, schemaVersion);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    // after every column the table ever had, so an older record simply ends before it
+    int columnPosition = (int)recordDescriptor.size() + 1;
+
+    invalidateSnapshot();
+
+    FileHandle fileHandle;
+    returnValue = rbfm->openFile("columns.tbl", fileHandle);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    RID rid;
+    returnValue = insertColumnsEntry(table_ID, tableName, attr.name, fileHandle, columnPosition, attr.length, rid, attr.type, schemaVersion + 1);
+    if (returnValue == SUCCESS)
+        populateColumnsMap(table_ID, rid, columnPosition);
+
+    invalidateAttributes(table_ID);
+
+    RC closeValue = rbfm->closeFile(fileHandle);
+    if (returnValue != SUCCESS)
+        return returnValue;
+    if (closeValue != SUCCESS)
+        return closeValue;
+
+    // NumOfColumns counts the fields of the newest records, dropped ones included
+    returnValue = rbfm->openFile("tables.tbl", fileHandle);
+    if (returnValue != SUCCESS)
+        return returnValue;
+
+    char *record = (char *)malloc(determineMemoryNeeded(tableVec));
+    returnValue = rbfm->readRecord(fileHandle, tableVec, tableRid, record);
+    if (returnValue == SUCCESS) {
+        memcpy(record + readFieldOffset(record, 5, tableVec), &columnPosition, sizeof(int));
+        returnValue = rbfm->updateRecord(fileHandle, tableVec, record, tableRid);
+    }
+    free(record);
+
+    closeValue = rbfm->closeFile(fileHandle);
+    return returnValue != SUCCESS ? returnValue : closeValue;
+}
+
+RC RelationManager::upgradeTable(const string &tableName)
+{
+    unsigned pageNum = 0;
+
+    while (true) {
+        RM_LockGuard catalogGuard(&catalogLock, false);
+        RM_LockGuard tableGuard(getTableLock(tableName), true);
+
+        if (tablesMap.find(tableName) == tablesMap.end() || getPartitioning(tableName) != NULL)
+            return -1;
+
+        // read again for every batch, the schema may have changed in between
+        vector<Attribute> recordDescriptor;
+        int returnValue = getRecordDescriptor(tableName, recordDescriptor);
+        if (returnValue != SUCCESS)
+            return returnValue;
+
+        FileHandle fileHandle;
+        returnValue = rbfm->openFile(tableName + ".tbl", fileHandle);
+        if (returnValue != SUCCESS)
+            return returnValue;
+
+        unsigned numOfPages = fileHandle.getNumberOfPages();
+        for (int i = 0; i < UPGRADE_BATCH_PAGES && pageNum < numOfPages && returnValue == SUCCESS; i++, pageNum++)
+            returnValue = rbfm->upgradePage(fileHandle, recordDescriptor, pageNum);
+
+        RC closeValue = rbfm->closeFile(fileHandle);
+        if (returnValue != SUCCESS)
+            return returnValue;
+        if (closeValue != SUCCESS)
+            return closeValue;
+
+        if (pageNum >= numOfPages)
+            return SUCCESS;
+    }
 }
 
 // Extra credit
@@ -1317,6 +4602,12 @@ short RelationManager::determineMemoryNeeded(const vector<Attribute> &attributes
     return size;
 }
 
+// the catalog itself; its schema is fixed by the record descriptors built in the constructor
+bool RelationManager::isSystemTable(const string &tableName) {
+	return tableName.compare("tables") == 0 || tableName.compare("columns") == 0 || tableName.compare("indices") == 0
+			|| tableName.compare("statistics") == 0 || tableName.compare("partitions") == 0;
+}
+
 bool RelationManager::isSystemTableRequest(string tableName) {
     return false;
 
@@ -1351,11 +4642,14 @@ bool RelationManager::isSystemTableRequest(string tableName) {
     return isSysTbl;
 }
 
-int RelationManager::readFieldOffset(const void *data, int attrPosition, vector<Attribute> recordDescriptor) {
+int RelationManager::readFieldOffset(const void *data, int attrPosition, const vector<Attribute> &recordDescriptor) {
 	int offset = 0;
 
 	for (int i = 0; i < attrPosition - 1; i++) {
-		Attribute attr = recordDescriptor[i];
+		const Attribute &attr = recordDescriptor[i];
+
+		if (attr.isDropped)
+			continue;
 
 		if (attr.type == TypeInt)
 			offset += sizeof(int);
@@ -1396,9 +4690,383 @@ bool RelationManager::isFieldEqual(const char *a, const char *b, AttrType type){
 	}
 }
 
+// largest SchemaVersion and DroppedVersion among the columns of the table
+RC RelationManager::getSchemaVersion(int tableID, int &schemaVersion) {
+	FileHandle fileHandle;
+	int returnValue = rbfm->openFile("columns.tbl", fileHandle);
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	schemaVersion = 0;
+	char *record = (char *)malloc(determineMemoryNeeded(columnVec));
+	map<int, RID> *columnsEntries = columnsMap[tableID];
+	for (map<int, RID>::iterator itr = columnsEntries->begin(); itr != columnsEntries->end() && returnValue == SUCCESS; ++itr) {
+		returnValue = rbfm->readRecord(fileHandle, columnVec, itr->second, record);
+		if (returnValue != SUCCESS)
+			break;
+
+		int addedVersion = *(int *)(record + readFieldOffset(record, 7, columnVec));
+		int droppedVersion = *(int *)(record + readFieldOffset(record, 8, columnVec));
+		schemaVersion = max(schemaVersion, max(addedVersion, droppedVersion));
+	}
+
+	free(record);
+	rbfm->closeFile(fileHandle);
+	return returnValue;
+}
+
+void RelationManager::invalidateAttributes(int tableID) {
+	lock_guard<mutex> guard(cacheMutex);
+	attributesCache.erase(tableID);
+	keyColumnsCache.erase(tableID);
+	includedColumnsCache.erase(tableID);
+}
+
+// the numbers of a list written by insertIndexEntry
+static void readPositions(const char *field, vector<int> &positions) {
+	string list(field + sizeof(int), *(int *)field);
+
+	for (size_t start = 0; start < list.size(); ) {
+		size_t end = list.find(',', start);
+		if (end == string::npos)
+			end = list.size();
+		positions.push_back(atoi(list.substr(start, end - start).c_str()));
+		start = end + 1;
+	}
+}
+
+// [index position -> key column positions] and [index position -> included column positions] of every index of the
+// table, read from indices.tbl once per DDL
+RC RelationManager::getIndexColumns(int tableID, map<int, vector<int> > &keyColumns, map<int, vector<int> > &includedColumns) {
+	{
+		lock_guard<mutex> guard(cacheMutex);
+		map<int, map<int, vector<int> > >::iterator cached = includedColumnsCache.find(tableID);
+		if (cached != includedColumnsCache.end()) {
+			keyColumns = keyColumnsCache[tableID];
+			includedColumns = cached->second;
+			return SUCCESS;
+		}
+	}
+
+	keyColumns.clear();
+	includedColumns.clear();
+	if (indexMap.find(tableID) != indexMap.end()) {
+		FileHandle fileHandle;
+		int returnValue = rbfm->openFile("indices.tbl", fileHandle);
+		if (returnValue != SUCCESS)
+			return returnValue;
+
+		char *record = (char *)malloc(determineMemoryNeeded(indexVec));
+		for (map<int, RID>::iterator itr = indexMap[tableID]->begin(); itr != indexMap[tableID]->end(); ++itr) {
+			returnValue = rbfm->readRecord(fileHandle, indexVec, itr->second, record);
+			if (returnValue != SUCCESS)
+				break;
+
+			readPositions(record + readFieldOffset(record, 5, indexVec), includedColumns[itr->first]);
+
+			vector<int> &keys = keyColumns[itr->first];
+			readPositions(record + readFieldOffset(record, 6, indexVec), keys);
+			if (keys.empty())
+				keys.push_back(itr->first);
+		}
+
+		free(record);
+		rbfm->closeFile(fileHandle);
+		if (returnValue != SUCCESS)
+			return returnValue;
+	}
+
+	lock_guard<mutex> guard(cacheMutex);
+	keyColumnsCache[tableID] = keyColumns;
+	includedColumnsCache[tableID] = includedColumns;
+	return SUCCESS;
+}
+
+Attribute RelationManager::getIndexAttribute(const vector<Attribute> &recordDescriptor, const vector<int> &keyColumns) {
+	if (keyColumns.size() == 1)
+		return recordDescriptor[keyColumns[0] - 1];
+
+	vector<Attribute> keyAttributes;
+	for (unsigned i = 0; i < keyColumns.size(); i++)
+		keyAttributes.push_back(recordDescriptor[keyColumns[i] - 1]);
+	return ix->getCompositeAttribute(keyAttributes);
+}
+
+// keyBuffer holds at least sizeof(int) + MAX_COMPOSITE_KEY_LENGTH bytes
+const char *RelationManager::readIndexKey(const void *data, const vector<Attribute> &recordDescriptor,
+		const vector<int> &keyColumns, char *keyBuffer) {
+	if (keyColumns.size() == 1)
+		return (const char *)data + readFieldOffset(data, keyColumns[0], recordDescriptor);
+
+	vector<Attribute> keyAttributes;
+	for (unsigned i = 0; i < keyColumns.size(); i++)
+		keyAttributes.push_back(recordDescriptor[keyColumns[i] - 1]);
+
+	char values[PAGE_SIZE];
+	buildPayload(data, recordDescriptor, keyColumns, values);
+	ix->prepareCompositeKey(keyAttributes, values, keyColumns.size(), false, keyBuffer);
+	return keyBuffer;
+}
+
+int RelationManager::findIndex(int tableID, const vector<Attribute> &recordDescriptor, const string &indexName) {
+	if (indexMap.find(tableID) == indexMap.end())
+		return 0;
+
+	map<int, vector<int> > keyColumns;
+	map<int, vector<int> > includedColumns;
+	if (getIndexColumns(tableID, keyColumns, includedColumns) != SUCCESS)
+		return 0;
+
+	for (map<int, vector<int> >::iterator itr = keyColumns.begin(); itr != keyColumns.end(); ++itr) {
+		Attribute keyAttribute = getIndexAttribute(recordDescriptor, itr->second);
+		if (keyAttribute.name == indexName && !keyAttribute.isDropped)
+			return itr->first;
+	}
+
+	return 0;
+}
+
+// concatenate the fields at "positions" of a tuple, returns the number of bytes written
+short RelationManager::buildPayload(const void *data, const vector<Attribute> &recordDescriptor, const vector<int> &positions, char *payload) {
+	short payloadLength = 0;
+
+	for (unsigned i = 0; i < positions.size(); i++) {
+		const char *field = (const char *)data + readFieldOffset(data, positions[i], recordDescriptor);
+		int fieldLength = getFieldLength(field, recordDescriptor[positions[i] - 1].type);
+		memcpy(payload + payloadLength, field, fieldLength);
+		payloadLength += fieldLength;
+	}
+
+	return payloadLength;
+}
+
+// the caller holds the catalog lock, the entry stays valid until the next DDL
+TablePartitions *RelationManager::getPartitioning(const string &tableName) {
+	map<string, map<int, RID> *>::iterator table = tablesMap.find(tableName);
+	if (table == tablesMap.end())
+		return NULL;
+
+	map<int, TablePartitions>::iterator partitioning = partitionsMap.find(table->second->begin()->first);
+	if (partitioning == partitionsMap.end())
+		return NULL;
+
+	return &partitioning->second;
+}
+
+string RelationManager::getPartitionName(const string &tableName, int partition) {
+	return tableName + PARTITION_SEPARATOR + to_string(partition);
+}
+
+int RelationManager::routeTuple(const TablePartitions &partitioning, const void *data, const vector<Attribute> &recordDescriptor) {
+	const char *key = (const char *)data + readFieldOffset(data, partitioning.columnPosition, recordDescriptor);
+	int partition = -1;
+
+	if (partitioning.type == HashPartitioning) {
+		partition = hashField(key, recordDescriptor[partitioning.columnPosition - 1].type) % partitioning.numOfPartitions;
+	}
+	else {
+		int value = *(int *)key;
+		for (map<int, PartitionEntry>::const_iterator itr = partitioning.partitions.begin(); itr != partitioning.partitions.end(); ++itr) {
+			if (itr->second.lowKey <= value && (value < itr->second.highKey || itr->second.highKey == INT_MAX)) {
+				partition = itr->first;
+				break;
+			}
+		}
+	}
+
+	if (partitioning.partitions.find(partition) == partitioning.partitions.end())
+		return -1;
+
+	return partition;
+}
+
+RC RelationManager::findPartition(const string &tableName, const RID &rid, string &partitionName, RID &partitionRid) {
+	TablePartitions *partitioning = getPartitioning(tableName);
+	int partition = rid.pageNum >> PARTITION_SHIFT;
+
+	if (partitioning == NULL || partitioning->partitions.find(partition) == partitioning->partitions.end())
+		return -1;
+
+	partitionName = getPartitionName(tableName, partition);
+	partitionRid.pageNum = rid.pageNum & ((1u << PARTITION_SHIFT) - 1);
+	partitionRid.slotNum = rid.slotNum;
+
+	return SUCCESS;
+}
+
+void RelationManager::prunePartitions(const TablePartitions &partitioning, AttrType keyType, const void *lowKey, const void *highKey,
+		bool lowKeyInclusive, bool highKeyInclusive, vector<int> &partitions) {
+	partitions.clear();
+
+	// a hash partition can only be told for a single key
+	int hashPartition = -1;
+	if (partitioning.type == HashPartitioning && lowKey != NULL && highKey != NULL && lowKeyInclusive && highKeyInclusive
+			&& isFieldEqual((const char *)lowKey, (const char *)highKey, keyType))
+		hashPartition = hashField((const char *)lowKey, keyType) % partitioning.numOfPartitions;
+
+	// inclusive bounds of the range, in long long so the open bounds can step over INT_MIN and INT_MAX
+	long long low = LLONG_MIN;
+	long long high = LLONG_MAX;
+	if (partitioning.type == RangePartitioning && lowKey != NULL)
+		low = (long long)*(int *)lowKey + (lowKeyInclusive ? 0 : 1);
+	if (partitioning.type == RangePartitioning && highKey != NULL)
+		high = (long long)*(int *)highKey - (highKeyInclusive ? 0 : 1);
+
+	for (map<int, PartitionEntry>::const_iterator itr = partitioning.partitions.begin(); itr != partitioning.partitions.end(); ++itr) {
+		if (partitioning.type == HashPartitioning) {
+			if (hashPartition == -1 || hashPartition == itr->first)
+				partitions.push_back(itr->first);
+			continue;
+		}
+
+		long long partitionHigh = itr->second.highKey == INT_MAX ? INT_MAX : (long long)itr->second.highKey - 1;
+		if (itr->second.lowKey <= high && partitionHigh >= low)
+			partitions.push_back(itr->first);
+	}
+}
+
+// lock of a table, NULL if there is no such table; the caller holds the catalog lock
+shared_mutex *RelationManager::getTableLock(const string &tableName) {
+	map<string, map<int, RID> *>::iterator table = tablesMap.find(tableName);
+	if (table == tablesMap.end())
+		return NULL;
+
+	return getTableLock(table->second->begin()->first);
+}
+
+shared_mutex *RelationManager::getTableLock(int tableID) {
+	lock_guard<mutex> guard(tableLocksMutex);
+	return &tableLocks[tableID];
+}
+
+// DDL must not change the files or the indexes under an open RM_TableHandle
+bool RelationManager::hasOpenHandles(const string &tableName) {
+	if (tablesMap.find(tableName) == tablesMap.end())
+		return false;
+
+	int table_ID = tablesMap[tableName]->begin()->first;
+	lock_guard<mutex> guard(cacheMutex);
+	if (openTableHandles.find(table_ID) == openTableHandles.end())
+		return false;
+
+	cout << "Table " + tableName + " is still opened by a table handle" << endl;
+	return true;
+}
+
+int RelationManager::compareFields(const char *a, const char *b, AttrType type) {
+	if (type == TypeInt) {
+		int A = *(int *)a;
+		int B = *(int *)b;
+
+		return A < B ? -1 : (A > B ? 1 : 0);
+	}
+	else if (type == TypeReal) {
+		float A = *(float *)a;
+		float B = *(float *)b;
+
+		return A < B ? -1 : (A > B ? 1 : 0);
+	}
+	else {
+		int lengthA = *(int *)a;
+		int lengthB = *(int *)b;
+		int result = memcmp(a + sizeof(int), b + sizeof(int), min(lengthA, lengthB));
+
+		if (result != 0)
+			return result;
+		return lengthA < lengthB ? -1 : (lengthA > lengthB ? 1 : 0);
+	}
+}
+
+// length of a field in tuple format, including the length prefix of a varchar
+int RelationManager::getFieldLength(const char *field, AttrType type) {
+	if (type == TypeVarChar)
+		return sizeof(int) + *(int *)field;
+
+	return sizeof(int);
+}
+
+// 64 bit FNV-1a over the value bytes, followed by the splitmix64 finalizer to spread the low bits
+unsigned long long RelationManager::hashField(const char *field, AttrType type) {
+	int length = sizeof(int);
+	if (type == TypeVarChar) {
+		length = *(int *)field;
+		field += sizeof(int);
+	}
+
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	for (int i = 0; i < length; i++) {
+		hash ^= (unsigned char)field[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111ebULL;
+	hash ^= hash >> 31;
+
+	return hash;
+}
+
+// the first STATS_HLL_PRECISION bits pick the register, the register keeps the longest run of leading zeros + 1
+void RelationManager::addToSketch(vector<unsigned char> &registers, unsigned long long hash) {
+	unsigned index = (unsigned)(hash >> (64 - STATS_HLL_PRECISION));
+	unsigned long long rest = hash << STATS_HLL_PRECISION;
+
+	unsigned char rank = rest == 0 ? 64 - STATS_HLL_PRECISION + 1 : __builtin_clzll(rest) + 1;
+	if (rank > registers[index])
+		registers[index] = rank;
+}
+
+int RelationManager::estimateDistinct(const vector<unsigned char> &registers) {
+	double m = (double)registers.size();
+	double alpha = 0.7213 / (1 + 1.079 / m);
+	double sum = 0;
+	int numOfZeros = 0;
+
+	for (int i = 0; i < (int)registers.size(); i++) {
+		sum += ldexp(1.0, -registers[i]);
+		if (registers[i] == 0)
+			numOfZeros++;
+	}
+
+	double estimate = alpha * m * m / sum;
+
+	// small cardinalities: linear counting is more accurate
+	if (estimate <= 2.5 * m && numOfZeros != 0)
+		estimate = m * log(m / numOfZeros);
+
+	return (int)(estimate + 0.5);
+}
+
+// distinct values of a table of numOfRows rows from a sorted sample of it, the Duj1 estimator of Haas and Stokes:
+// n * d / (n - f1 + f1 * n / N), d the distinct values of the n sampled, f1 those seen once
+int RelationManager::estimateTableDistinct(const vector<string> &sortedSample, AttrType type, int numOfRows) {
+	int n = (int)sortedSample.size();
+	if (n == 0)
+		return 0;
+
+	int numOfDistinct = 0;
+	int numOfSingles = 0;
+	for (int i = 0; i < n;) {
+		int j = i + 1;
+		while (j < n && compareFields(sortedSample[i].data(), sortedSample[j].data(), type) == 0)
+			j++;
+		numOfDistinct++;
+		if (j - i == 1)
+			numOfSingles++;
+		i = j;
+	}
+
+	double estimate = (double)n * numOfDistinct / (n - numOfSingles + (double)numOfSingles * n / numOfRows);
+	return (int)(estimate + 0.5);
+}
+
+
 /**********RECORD SCAN ITERATOR****************/
 
-RM_ScanIterator::RM_ScanIterator() {
+RM_ScanIterator::RM_ScanIterator() : ownsFileHandle(true), tableLock(NULL), isScanOpen(false), partition(-1), nextPartition(0),
+		compOp(NO_OP) {
 	rbfm = RecordBasedFileManager::instance();
 }
 
@@ -1409,20 +5077,232 @@ RC RM_ScanIterator::initialize(const vector<Attribute> &recordDescriptor,
                                const void *value,
                                const vector<string> &attributeNames,
                                const string &conditionAttribute) {
+    isScanOpen = true;
     return rbfm_scanner.initialize(fileHandle, recordDescriptor, compOp, value, attributeNames, conditionAttribute);
 }
 
 RC RM_ScanIterator::getNextTuple(RID &rid, void *data) {
-    return rbfm_scanner.getNextRecord(rid, data);
+    int returnValue;
+
+    while (true) {
+        if (isScanOpen) {
+            RM_LockGuard tableGuard(tableLock, false);
+            returnValue = rbfm_scanner.getNextRecord(rid, data);
+            if (returnValue != RBFM_EOF)
+                break;
+        }
+
+        if (!openNextPartition())
+            return RM_EOF;
+    }
+
+    if (returnValue == SUCCESS && partition != -1)
+        rid.pageNum |= (unsigned)partition << PARTITION_SHIFT;
+
+    return returnValue;
+}
+
+// close the partition being scanned and open the next one which still exists, the last one stays open until close()
+bool RM_ScanIterator::openNextPartition() {
+    // not taken before the check, RelationManager scans its system tables while it is constructed
+    if (nextPartition >= partitions.size())
+        return false;
+
+    RelationManager *rm = RelationManager::instance();
+
+    while (nextPartition < partitions.size()) {
+        if (isScanOpen) {
+            rbfm_scanner.close();
+            rbfm->closeFile(fileHandle);
+            isScanOpen = false;
+        }
+
+        partition = partitions[nextPartition++];
+        if (rm->openPartitionScan(*this, rm->getPartitionName(tableName, partition)) == SUCCESS)
+            return true;
+    }
+
+    return false;
 }
 
 RC RM_ScanIterator::close() {
+	bool wasOpen = isScanOpen;
+
+	isScanOpen = false;
+	partition = -1;
+	partitions.clear();
+	nextPartition = 0;
+
+	if (!wasOpen)
+		return SUCCESS;
+
 	rbfm_scanner.close();
+	if (!ownsFileHandle)
+		return SUCCESS;
 	return rbfm->closeFile(fileHandle);
 }
 
+/**********TABLE HANDLE****************/
+RM_TableHandle::RM_TableHandle() : isOpen(false), tableID(0), tableLock(NULL) {
+	rbfm = RecordBasedFileManager::instance();
+	ix = IndexManager::instance();
+}
+
+RM_TableHandle::~RM_TableHandle() {
+	if (isOpen)
+		close();
+}
+
+RC RM_TableHandle::close() {
+	return RelationManager::instance()->closeTable(*this);
+}
+
+RC RM_TableHandle::insertTuple(const void *data, RID &rid) {
+	if (!isOpen)
+		return -1;
+
+	RM_LockGuard tableGuard(tableLock, true);
+
+	int returnValue = rbfm->insertRecord(fileHandle, recordDescriptor, data, rid);
+	if (returnValue != SUCCESS)
+		return -1;
+
+	RelationManager *rm = RelationManager::instance();
+	char payload[MAX_INCLUDED_LENGTH];
+	char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	for (map<int, FileHandle>::iterator itr = indexFileHandles.begin(); itr != indexFileHandles.end(); ++itr) {
+		int position = itr->first;
+		const char *key = rm->readIndexKey(data, recordDescriptor, keyColumns[position], keyBuffer);
+		short payloadLength = rm->buildPayload(data, recordDescriptor, includedColumns[position], payload);
+
+		returnValue = ix->insertEntry(itr->second, rm->getIndexAttribute(recordDescriptor, keyColumns[position]), key, rid,
+				payload, payloadLength);
+		if (returnValue != SUCCESS)
+			return returnValue;
+	}
+
+	return SUCCESS;
+}
+
+RC RM_TableHandle::deleteTuple(const RID &rid) {
+	if (!isOpen)
+		return -1;
+
+	RM_LockGuard tableGuard(tableLock, true);
+
+	// read the tuple first, its keys are needed to delete the index entries
+	void *data = malloc(PAGE_SIZE);
+	int returnValue = SUCCESS;
+
+	if (!indexFileHandles.empty())
+		returnValue = rbfm->readRecord(fileHandle, recordDescriptor, rid, data);
+
+	if (returnValue == SUCCESS)
+		returnValue = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+
+	if (returnValue != SUCCESS) {
+		free(data);
+		return -1;
+	}
+
+	RelationManager *rm = RelationManager::instance();
+	char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	for (map<int, FileHandle>::iterator itr = indexFileHandles.begin(); itr != indexFileHandles.end(); ++itr) {
+		int position = itr->first;
+		const char *key = rm->readIndexKey(data, recordDescriptor, keyColumns[position], keyBuffer);
+
+		returnValue = ix->deleteEntry(itr->second, rm->getIndexAttribute(recordDescriptor, keyColumns[position]), key, rid);
+		if (returnValue != SUCCESS)
+			break;
+	}
+
+	free(data);
+
+	return returnValue;
+}
+
+RC RM_TableHandle::updateTuple(const void *data, const RID &rid) {
+	if (!isOpen)
+		return -1;
+
+	RM_LockGuard tableGuard(tableLock, true);
+
+	void *oldData = malloc(PAGE_SIZE);
+	int returnValue = SUCCESS;
+
+	if (!indexFileHandles.empty())
+		returnValue = rbfm->readRecord(fileHandle, recordDescriptor, rid, oldData);
+
+	if (returnValue == SUCCESS)
+		returnValue = rbfm->updateRecord(fileHandle, recordDescriptor, data, rid);
+
+	if (returnValue != SUCCESS) {
+		free(oldData);
+		return -1;
+	}
+
+	// only the indexes whose key or included values changed are touched
+	RelationManager *rm = RelationManager::instance();
+	char oldPayload[MAX_INCLUDED_LENGTH];
+	char payload[MAX_INCLUDED_LENGTH];
+	char oldKeyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	char keyBuffer[sizeof(int) + MAX_COMPOSITE_KEY_LENGTH];
+	for (map<int, FileHandle>::iterator itr = indexFileHandles.begin(); itr != indexFileHandles.end(); ++itr) {
+		int position = itr->first;
+		Attribute keyAttribute = rm->getIndexAttribute(recordDescriptor, keyColumns[position]);
+		const char *oldKey = rm->readIndexKey(oldData, recordDescriptor, keyColumns[position], oldKeyBuffer);
+		const char *newKey = rm->readIndexKey(data, recordDescriptor, keyColumns[position], keyBuffer);
+		short oldPayloadLength = rm->buildPayload(oldData, recordDescriptor, includedColumns[position], oldPayload);
+		short payloadLength = rm->buildPayload(data, recordDescriptor, includedColumns[position], payload);
+
+		if (rm->isFieldEqual(oldKey, newKey, keyAttribute.type)
+				&& oldPayloadLength == payloadLength && memcmp(oldPayload, payload, payloadLength) == 0)
+			continue;
+
+		returnValue = ix->deleteEntry(itr->second, keyAttribute, oldKey, rid);
+		if (returnValue != SUCCESS)
+			break;
+
+		returnValue = ix->insertEntry(itr->second, keyAttribute, newKey, rid, payload, payloadLength);
+		if (returnValue != SUCCESS)
+			break;
+	}
+
+	free(oldData);
+
+	return returnValue;
+}
+
+RC RM_TableHandle::readTuple(const RID &rid, void *data) {
+	if (!isOpen)
+		return -1;
+
+	RM_LockGuard tableGuard(tableLock, false);
+
+	return rbfm->readRecord(fileHandle, recordDescriptor, rid, data);
+}
+
+RC RM_TableHandle::scan(const string &conditionAttribute,
+		const CompOp compOp,
+		const void *value,
+		const vector<string> &attributeNames,
+		RM_ScanIterator &rm_ScanIterator) {
+	if (!isOpen)
+		return -1;
+
+	// the iterator borrows the file of this handle, closing the iterator leaves it open
+	rm_ScanIterator.fileHandle = fileHandle;
+	rm_ScanIterator.ownsFileHandle = false;
+	rm_ScanIterator.tableLock = tableLock;
+
+	RM_LockGuard tableGuard(tableLock, false);
+
+	return rm_ScanIterator.initialize(recordDescriptor, compOp, value, attributeNames, conditionAttribute);
+}
+
 /**********INDEX SCAN ITERATOR****************/
-RM_IndexScanIterator::RM_IndexScanIterator() {
+RM_IndexScanIterator::RM_IndexScanIterator() : tableLock(NULL), isScanOpen(false), partition(-1), nextPartition(0),
+		lowKeyInclusive(false), highKeyInclusive(false), isCovering(false), keyType(TypeInt) {
 	ix = IndexManager::instance();
 }
 
@@ -1434,14 +5314,115 @@ RC RM_IndexScanIterator::initialize(const Attribute keyAttribute,
 		bool lowKeyInclusive,
 		bool highKeyInclusive)
 {
+	isScanOpen = true;
 	return ix->scan(indexFileHandle, keyAttribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive, ix_scanner);
 }
 
 RC RM_IndexScanIterator::getNextEntry(RID &rid, void *key) {
-	return ix_scanner.getNextEntry(rid, key);
+	int returnValue;
+
+	// a composite key is read into keyBuffer, then returned as the values of its attributes
+	void *entryKey = compositeAttrs.empty() ? key : &keyBuffer[0];
+
+	while (true) {
+		if (isScanOpen) {
+			RM_LockGuard tableGuard(tableLock, false);
+			returnValue = ix_scanner.getNextEntry(rid, entryKey);
+			if (returnValue != IX_EOF)
+				break;
+		}
+
+		if (!openNextPartition())
+			return IX_EOF;
+	}
+
+	if (returnValue == SUCCESS && !compositeAttrs.empty())
+		ix->readCompositeKey(compositeAttrs, &keyBuffer[0], key);
+
+	if (returnValue == SUCCESS && partition != -1)
+		rid.pageNum |= (unsigned)partition << PARTITION_SHIFT;
+
+	return returnValue;
+}
+
+// same as RM_ScanIterator::openNextPartition
+bool RM_IndexScanIterator::openNextPartition() {
+	if (nextPartition >= partitions.size())
+		return false;
+
+	RelationManager *rm = RelationManager::instance();
+
+	while (nextPartition < partitions.size()) {
+		if (isScanOpen) {
+			ix_scanner.close();
+			ix->closeFile(indexFileHandle);
+			isScanOpen = false;
+		}
+
+		partition = partitions[nextPartition++];
+		if (rm->openPartitionIndexScan(*this, rm->getPartitionName(tableName, partition)) == SUCCESS)
+			return true;
+	}
+
+	return false;
+}
+
+RC RM_IndexScanIterator::getNextTuple(RID &rid, void *data) {
+	if (!isCovering)
+		return -1;
+
+	short payloadLength;
+	int returnValue;
+
+	while (true) {
+		if (isScanOpen) {
+			RM_LockGuard tableGuard(tableLock, false);
+			returnValue = ix_scanner.getNextEntry(rid, &keyBuffer[0], &payloadBuffer[0], payloadLength);
+			if (returnValue != IX_EOF)
+				break;
+		}
+
+		if (!openNextPartition())
+			return IX_EOF;
+	}
+
+	if (returnValue != SUCCESS)
+		return returnValue;
+
+	if (partition != -1)
+		rid.pageNum |= (unsigned)partition << PARTITION_SHIFT;
+
+	int offset = 0;
+	for (unsigned i = 0; i < includedAttrs.size(); i++) {
+		payloadOffsets[i] = offset;
+		offset += includedAttrs[i].type == TypeVarChar ? sizeof(int) + *(int *)&payloadBuffer[offset] : sizeof(int);
+	}
+
+	// the key and included values in the order of the projection
+	offset = 0;
+	for (unsigned i = 0; i < projection.size(); i++) {
+		const char *field = projection[i] == -1 ? &keyBuffer[0] : &payloadBuffer[payloadOffsets[projection[i]]];
+		AttrType type = projection[i] == -1 ? keyType : includedAttrs[projection[i]].type;
+		int fieldLength = type == TypeVarChar ? sizeof(int) + *(int *)field : sizeof(int);
+
+		memcpy((char *)data + offset, field, fieldLength);
+		offset += fieldLength;
+	}
+
+	return SUCCESS;
 }
 
 RC RM_IndexScanIterator::close() {
+	bool wasOpen = isScanOpen;
+
+	isScanOpen = false;
+	partition = -1;
+	partitions.clear();
+	nextPartition = 0;
+
+	if (!wasOpen)
+		return SUCCESS;
+
 	int returnValue = ix_scanner.close();
 
 	if (returnValue != SUCCESS) {
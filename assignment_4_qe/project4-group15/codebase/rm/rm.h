@@ -5,6 +5,8 @@
 #include <string.h>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <shared_mutex>
 
 #include "../rbf/rbfm.h"
 #include "../ix/ix.h"
@@ -13,9 +15,122 @@ using namespace std;
 
 # define SUCCESS 0
 # define MAX_TABLE_RECORD_SIZE 768
-# define MAX_COLUMNS_RECORD_SIZE 784
+# define MAX_COLUMNS_RECORD_SIZE 800
 # define RM_EOF (-1)  // end of a scan operator
 # define MAX_ATTRIBUTE_LENGTH 260
+# define STATS_SAMPLE_SIZE 10000 // values per column kept (reservoir sampling) to build the histogram
+# define STATS_SAMPLE_PAGES 1024 // a table of more pages is analyzed from this many of its pages
+# define STATS_SAMPLE_RUN 16 // sampled pages are read in runs of this many consecutive pages, spread over the file
+# define STATS_HISTOGRAM_BUCKETS 20
+# define STATS_BOUND_PREFIX 32 // varchar bucket bounds are cut to this many characters
+# define STATS_HLL_PRECISION 12 // 2^12 HyperLogLog registers per column
+# define MAX_HISTOGRAM_LENGTH (sizeof(int) + STATS_HISTOGRAM_BUCKETS * (2 * sizeof(int) + STATS_BOUND_PREFIX))
+# define CATALOG_SNAPSHOT_FILE "catalog.snapshot"
+# define CATALOG_SNAPSHOT_MAGIC 0x50534E43 // "CNSP"
+# define CATALOG_SNAPSHOT_VERSION 3 // a snapshot of an older version makes loadSystem upgrade the system tables
+# define NUM_OF_SYSTEM_TABLES 4 // tables, columns, indices, statistics
+# define MAX_INCLUDED_LENGTH (PAGE_SIZE / 4) // largest sum of the included attributes of an index entry
+# define MAX_COMPOSITE_KEY_LENGTH (PAGE_SIZE / 4) // longest key of a composite index, see IndexManager::getCompositeAttribute
+# define UPGRADE_BATCH_PAGES 16 // pages upgradeTable rewrites per hold of the table lock
+# define BULK_LOAD_CHUNK_SIZE (1024 * 1024) // bytes of input bulkLoad hands to one parsing thread
+# define EXPORT_ROW_GROUP_SIZE 4096 // tuples of a row group in a columnar file, and of a batch written by an export worker
+# define EXPORT_SCAN_PAGES 64 // pages an exportTable worker scans at a time
+# define COLUMNAR_MAGIC 0x524C4F43 // "COLR"
+# define COLUMNAR_VERSION 1
+# define PARTITION_SEPARATOR '@' // partition i of table t is the table "t@i"
+# define MAX_PARTITIONS 256
+# define PARTITION_SHIFT 24 // a rid of a partitioned table carries the partition number in pageNum above this bit
+
+// file read by RelationManager::bulkLoad and written by RelationManager::exportTable
+//  CSVFile: one tuple per line, fields separated by ',' and no header line; ints and reals are written as text, a varchar
+//           may be quoted with '"' (a quote inside is doubled) to hold a ',', a '"' or a line break. A '"' inside a
+//           field which does not start with one is an ordinary character.
+//  BinaryFile: tuples back to back, each in the format of insertTuple
+//  ColumnarFile: row groups stored column by column, see RM_ExportWriter
+typedef enum { CSVFile = 0, BinaryFile, ColumnarFile } FileFormat;
+
+// how the values of a column are stored in a row group of a columnar file
+//  PlainBlock: ints and reals as 4 bytes, varchars as [varint length][characters]
+//  DeltaVarintBlock: ints only, the first value then each difference to the previous value, zigzag varints
+//  DictionaryBlock: varchars only, [varint numOfEntries][entries as in PlainBlock][varint entry number per row]
+typedef enum { PlainBlock = 0, DeltaVarintBlock, DictionaryBlock } ColumnEncoding;
+
+// how createTable spreads the tuples of a table over its partitions
+//  RangePartitioning: int attributes only, partition i holds the keys in [rangeBounds[i - 1], rangeBounds[i]), the first
+//                     partition has no lower bound and the last one no upper bound
+//  HashPartitioning: partition i holds the keys whose hash modulo numOfPartitions is i
+typedef enum { RangePartitioning = 0, HashPartitioning } PartitionType;
+
+struct PartitionScheme {
+	PartitionType type;
+	string attributeName;
+	int numOfPartitions;
+	vector<int> rangeBounds; // range partitioning: numOfPartitions - 1 bounds in ascending order
+};
+
+// a partition of a table, read from partitions.tbl
+struct PartitionEntry {
+	int lowKey; // range partitioning: lowKey <= key < highKey, INT_MIN and INT_MAX stand for no bound
+	int highKey;
+	RID rid; // of the entry in partitions.tbl
+};
+
+struct TablePartitions {
+	PartitionType type;
+	int columnPosition;
+	int numOfPartitions;
+	map<int, PartitionEntry> partitions; // [partition number -> entry], a dropped partition is missing
+};
+
+// size and modification time of a system table file when the snapshot was taken
+struct SystemFileStamp {
+	long long size;
+	long long mtimeSec;
+	long long mtimeNsec;
+};
+
+// catalog.snapshot: header, then numOfTables x [SnapshotEntry (position unused), int nameLength, name],
+// then numOfColumns + numOfIndexes + numOfStatistics x SnapshotEntry
+struct SnapshotHeader {
+	unsigned magic;
+	unsigned version;
+	int tableIdCounter;
+	unsigned numOfTables;
+	unsigned numOfColumns;
+	unsigned numOfIndexes;
+	unsigned numOfStatistics;
+	SystemFileStamp stamps[NUM_OF_SYSTEM_TABLES];
+};
+
+struct SnapshotEntry {
+	int tableId;
+	int position;
+	unsigned pageNum;
+	unsigned slotNum;
+};
+
+// an index of the table bulkLoad appends to, the entries of the appended tuples go to it through fileHandle
+struct BulkLoadIndex {
+	Attribute keyAttribute;
+	vector<int> keyColumns;
+	vector<int> includedColumns;
+	FileHandle fileHandle;
+};
+
+struct HistogramBucket {
+	int numOfRows; // rows estimated to fall in this bucket
+	char upperBound[STATS_BOUND_PREFIX + sizeof(int)]; // largest value of the bucket, same format as in a tuple
+};
+
+// statistics of one column, collected by RelationManager::analyzeTable
+struct ColumnStatistics {
+	int numOfRows;
+	int numOfPages;
+	int numOfDistinct; // HyperLogLog estimate
+	char minValue[MAX_ATTRIBUTE_LENGTH]; // same format as the attribute in a tuple
+	char maxValue[MAX_ATTRIBUTE_LENGTH];
+	vector<HistogramBucket> histogram; // equi-depth, in ascending order of upperBound
+};
 
 // RM_ScanIterator is an iteratr to go through tuples
 // The way to use it is like the following:
@@ -32,6 +147,8 @@ public:
 	RM_ScanIterator();
 	~RM_ScanIterator();
 
+	// a scan of a partitioned table goes through the partitions left after pruning one after the other
+
 	FileHandle fileHandle;
 
 	RC initialize(const vector<Attribute> &recordDescriptor, const CompOp compOp, const void *value,
@@ -41,10 +158,28 @@ public:
 	RC getNextTuple(RID &rid, void *data);
 	RC close();
 
+	friend class RelationManager;
+	friend class RM_TableHandle;
+
 private:
 
 	RBFM_ScanIterator rbfm_scanner;
 	RecordBasedFileManager *rbfm;
+	bool ownsFileHandle; // false when scanning through an RM_TableHandle, which keeps the file open
+	shared_mutex *tableLock; // taken shared for every tuple, so the pages are not read while a writer changes them
+
+	// partitioned table: the partitions still to scan, the condition and projection are kept to open them
+	bool isScanOpen;
+	int partition; // partition being scanned, -1 for a table which is not partitioned
+	string tableName;
+	vector<int> partitions;
+	unsigned nextPartition;
+	string conditionAttribute;
+	CompOp compOp;
+	vector<char> value;
+	vector<string> attributeNames;
+
+	bool openNextPartition();
 };
 
 
@@ -55,6 +190,10 @@ public:
 
 	// "key" follows the same format as in IndexManager::insertEntry()
 	RC getNextEntry(RID &rid, void *key);  	// Get next matching entry
+
+	// index-only scan opened with the attribute names: "data" is the tuple projected to those attributes,
+	// in the same format as RelationManager::insertTuple(), built from the entry without reading the table
+	RC getNextTuple(RID &rid, void *data);
 	RC close();             			// Terminate index scan
 
 	RC initialize(const Attribute keyAttribute,
@@ -65,13 +204,172 @@ public:
 
 	FileHandle indexFileHandle;
 
+	friend class RelationManager;
+
 private:
 	IX_ScanIterator ix_scanner;
 	IndexManager *ix;
+	shared_mutex *tableLock; // taken shared for every entry
+
+	// partitioned table: same as in RM_ScanIterator, the keys are copied to open the index of every partition
+	bool isScanOpen;
+	int partition;
+	string tableName;
+	vector<int> partitions;
+	unsigned nextPartition;
+	Attribute keyAttribute;
+	vector<char> lowKey;
+	vector<char> highKey;
+	bool lowKeyInclusive;
+	bool highKeyInclusive;
+
+	bool openNextPartition();
+
+	vector<Attribute> compositeAttrs; // attributes of a composite index, getNextEntry returns their values
+	bool isCovering;
+	AttrType keyType;
+	vector<Attribute> includedAttrs; // included attributes of the index, in the order they are in the payload
+	vector<int> projection; // per projected attribute: -1 for the key, else its position in includedAttrs
+	vector<int> payloadOffsets; // start of every included value in the payload of the current entry
+	vector<char> keyBuffer;
+	vector<char> payloadBuffer;
+};
+
+
+// RM_TableHandle keeps a table and its index files open across calls:
+//  RM_TableHandle tableHandle;
+//  rm.openTable("emp", tableHandle);
+//  tableHandle.insertTuple(data, rid);
+//  ...
+//  tableHandle.close();
+// DDL on the table (deleteTable, deleteTuples, createIndex, destroyIndex, addAttribute, dropAttribute) is rejected
+// while a handle is open.
+// A handle may be used from several threads, every call takes the lock of the table.
+class RM_TableHandle {
+public:
+	RM_TableHandle();
+	~RM_TableHandle(); // closes the handle if it is still open
+
+	// same as the RelationManager calls with the table name, without the catalog lookup and file open per call
+	RC insertTuple(const void *data, RID &rid);
+	RC deleteTuple(const RID &rid);
+	RC updateTuple(const void *data, const RID &rid);
+	RC readTuple(const RID &rid, void *data);
+	RC scan(const string &conditionAttribute,
+			const CompOp compOp,
+			const void *value,
+			const vector<string> &attributeNames,
+			RM_ScanIterator &rm_ScanIterator);
+
+	RC close();
+
+	const vector<Attribute> &getAttributes() const { return attributes; }
+
+	friend class RelationManager;
+
+private:
+	bool isOpen;
+	string tableName;
+	int tableID;
+	vector<Attribute> recordDescriptor;
+	vector<Attribute> attributes; // recordDescriptor without the dropped attributes
+	FileHandle fileHandle;
+	map<int, FileHandle> indexFileHandles; // [index position -> open .idx file], see RelationManager::indexMap
+	map<int, vector<int> > keyColumns; // [index position -> positions of its key columns]
+	map<int, vector<int> > includedColumns; // [index position -> positions of the columns included in its index]
+	shared_mutex *tableLock;
+
+	RecordBasedFileManager *rbfm;
+	IndexManager *ix;
+};
+
+
+// RM_ExportBuffer is a batch of tuples turned into the bytes of an export file, a worker fills its own buffer and
+// hands it to RM_ExportWriter::write when it is full.
+class RM_ExportBuffer {
+public:
+	RM_ExportBuffer(const vector<Attribute> &attrs, const FileFormat format);
+
+	void addTuple(const void *data);
+	bool isFull() const { return numOfTuples >= EXPORT_ROW_GROUP_SIZE; }
+	bool isEmpty() const { return numOfTuples == 0; }
+
+	// bytes of the batch in the file format (a row group for a columnar file)
+	const vector<char> &encode();
+	void clear();
+
+private:
+	vector<Attribute> attrs;
+	FileFormat format;
+	int numOfTuples;
+	vector<char> output;
+	vector<vector<char> > columns; // columnar: the values of each column, in the format of the tuple
+
+	void encodeColumn(const Attribute &attr, const vector<char> &values);
+};
+
+
+// RM_ExportWriter writes an export file from tuples in the format of insertTuple:
+//  RM_ExportWriter writer;
+//  writer.open("emp.col", attrs, ColumnarFile);
+//  writer.addTuple(data);
+//  ...
+//  writer.close();
+// A columnar file is [unsigned COLUMNAR_MAGIC][unsigned COLUMNAR_VERSION][int numOfColumns], per column
+// [int type][int length][int nameLength][name], then row groups [int numOfRows] + per column
+// [int ColumnEncoding][int numOfBytes][values], and an int 0 after the last row group.
+class RM_ExportWriter {
+public:
+	RM_ExportWriter();
+	~RM_ExportWriter(); // closes the file if it is still open
+
+	RC open(const string &fileName, const vector<Attribute> &attrs, const FileFormat format);
+
+	// buffered, for a single producer
+	RC addTuple(const void *data);
+
+	// write the batch of a worker and clear it, may be called from several threads
+	RC write(RM_ExportBuffer &buffer);
+
+	RC close();
+
+private:
+	FILE *file;
+	FileFormat format;
+	RM_ExportBuffer *buffer;
+	mutex writeMutex;
+};
+
+
+// RM_ColumnarReader reads the tuples of a columnar file back, one row group in memory at a time.
+class RM_ColumnarReader {
+public:
+	RM_ColumnarReader();
+	~RM_ColumnarReader();
+
+	RC open(const string &fileName);
+	void getAttributes(vector<Attribute> &attrs) const { attrs = this->attrs; }
+
+	// "data" follows the same format as RelationManager::insertTuple()
+	RC getNextTuple(void *data);
+	RC close();
+
+private:
+	FILE *file;
+	vector<Attribute> attrs;
+	int numOfRows;
+	int nextRow;
+	vector<vector<char> > columns; // decoded values of the row group, in the format of the tuple
+	vector<vector<int> > offsets; // offset of each row in columns
+
+	RC readRowGroup();
+	RC decodeColumn(int column, ColumnEncoding encoding, const vector<char> &block);
 };
 
 
 // Relation Manager
+// Every call may be made from any thread once instance() has returned; tuples of a table are read concurrently,
+// a writer holds its table exclusively and DDL holds the whole catalog exclusively.
 class RelationManager
 {
 public:
@@ -79,13 +377,36 @@ public:
 
 	RC createTable(const string &tableName, const vector<Attribute> &attrs);
 
+	// partitioned table: every partition is a table of its own (see PARTITION_SEPARATOR) with its own files and indexes.
+	// The tuple calls, deleteTuples, setFillFactor, createIndex(es) and destroyIndex on the table go to its partitions,
+	// scan and indexScan skip the partitions which cannot hold a key matching the condition. The other calls are
+	// rejected on the table and made on each partition instead; a partition takes no schema change.
+	RC createTable(const string &tableName, const vector<Attribute> &attrs, const PartitionScheme &scheme);
+
 	RC deleteTable(const string &tableName);
 
+	// delete a range partition with its files, its tuples are gone and its keys can no longer be inserted
+	RC dropPartition(const string &tableName, const int partition);
+
+	// numbers of the partitions of a partitioned table which have not been dropped
+	RC getPartitions(const string &tableName, vector<int> &partitions);
+
 	RC getAttributes(const string &tableName, vector<Attribute> &attrs);
 
 	RC insertTuple(const string &tableName, const void *data, RID &rid); //read the attributes from the attribute system table
 
-	RC deleteTuples(const string &tableName); //just call deleteRecords in rbf
+	RC deleteTuples(const string &tableName); // truncates the table file and its index files in place
+
+	// write every tuple of the table to fileName, in no particular order; the pages are scanned by parallel workers, each
+	// holding at most one batch of EXPORT_ROW_GROUP_SIZE tuples, so memory does not grow with the table
+	RC exportTable(const string &tableName, const string &fileName, const FileFormat format);
+
+	// append the tuples of fileName to the table: the input is parsed in BULK_LOAD_CHUNK_SIZE chunks on parallel threads
+	// (a columnar file is read a row group at a time), the tuples are written page by page at the end of the table.
+	// The index entries of each chunk are added to the indexes as it is appended; only a table which was empty gets its
+	// indexes built once at the end instead (and is emptied again if that fails).
+	// On a bad line the tuples before it stay loaded; numOfTuples receives the number of tuples loaded.
+	RC bulkLoad(const string &tableName, const string &fileName, const FileFormat format, unsigned &numOfTuples);
 
 	RC deleteTuple(const string &tableName, const RID &rid);   //read the attributes from the attribute system table
 
@@ -94,10 +415,24 @@ public:
 
 	RC readTuple(const string &tableName, const RID &rid, void *data);   //read the attributes from the attribute system table
 
+	// read a batch of tuples with one catalog lookup and one file open, data[i] receives the tuple of rids[i]
+	RC readTuples(const string &tableName, const vector<RID> &rids, const vector<void *> &data);
+
 	RC readAttribute(const string &tableName, const RID &rid, const string &attributeName, void *data);
 
+	// open the table file and all of its index files once, see RM_TableHandle
+	RC openTable(const string &tableName, RM_TableHandle &tableHandle);
+
+	RC closeTable(RM_TableHandle &tableHandle);
+
 	RC reorganizePage(const string &tableName, const unsigned pageNumber);  //call method in rbf
 
+	// percentage of each page insertTuple may fill, the rest is kept for updated tuples to grow in place
+	RC setFillFactor(const string &tableName, const short fillFactor);
+
+	// live and forwarded tuple counts of the table, forwarding rate = numOfForwarded / numOfRecords
+	RC getForwardingStats(const string &tableName, ForwardingStats &stats);
+
 	// scan returns an iterator to allow the caller to go through the results one by one.
 	RC scan(const string &tableName,
 			const string &conditionAttribute,
@@ -108,8 +443,31 @@ public:
 
 	RC createIndex(const string &tableName, const string &attributeName);
 
+	// covering index: the values of includedAttributes are stored in every entry next to the key
+	RC createIndex(const string &tableName, const string &attributeName, const vector<string> &includedAttributes);
+
+	// HashIndex: an extendible hash index, for equality lookups (INLJoin probes); its scans of a range read every bucket
+	// and return the entries in no particular order
+	RC createIndex(const string &tableName, const string &attributeName, IndexType indexType);
+
+	// build the indexes of several attributes with one scan of the table, the trees are built in parallel;
+	// includedAttributes[i], when given, are the attributes covered by the index on attributeNames[i]
+	RC createIndexes(const string &tableName, const vector<string> &attributeNames,
+			const vector<vector<string> > &includedAttributes = vector<vector<string> >(), IndexType indexType = BTreeIndex);
+
+	// composite index on several attributes, its keys ordered on the first attribute, then on the second, and so on.
+	// destroyIndex takes its name, the attribute names joined by COMPOSITE_KEY_SEPARATOR ("Name,Age").
+	RC createIndex(const string &tableName, const vector<string> &attributeNames);
+
 	RC destroyIndex(const string &tableName, const string &attributeName);
 
+	// collect row count, page count and per column min/max, distinct values and histogram into statistics.tbl; a
+	// table of more than STATS_SAMPLE_PAGES pages is estimated from a sample of its pages
+	RC analyzeTable(const string &tableName);
+
+	// read the statistics of a column stored by the last analyzeTable
+	RC getStatistics(const string &tableName, const string &attributeName, ColumnStatistics &stats);
+
 	// indexScan returns an iterator to allow the caller to go through qualified entries in index
 	RC indexScan(const string &tableName,
 			const string &attributeName,
@@ -119,14 +477,49 @@ public:
 			bool highKeyInclusive,
 			RM_IndexScanIterator &rm_IndexScanIterator);
 
+	// prefix range scan of the composite index on attributeNames: the entries whose first numOfPrefixValues attributes
+	// equal prefixValues (one after the other, in the format of insertTuple) and whose next attribute is in the range
+	// of lowKey and highKey, a NULL key being unbounded. getNextEntry returns the values of every attribute of the index.
+	RC indexScan(const string &tableName,
+			const vector<string> &attributeNames,
+			const void *prefixValues,
+			unsigned numOfPrefixValues,
+			const void *lowKey,
+			const void *highKey,
+			bool lowKeyInclusive,
+			bool highKeyInclusive,
+			RM_IndexScanIterator &rm_IndexScanIterator);
+
+	// index-only scan, see RM_IndexScanIterator::getNextTuple(); fails unless every attribute in attributeNames
+	// is the key or an included attribute of the index
+	RC indexScan(const string &tableName,
+			const string &attributeName,
+			const void *lowKey,
+			const void *highKey,
+			bool lowKeyInclusive,
+			bool highKeyInclusive,
+			const vector<string> &attributeNames,
+			RM_IndexScanIterator &rm_IndexScanIterator);
+
 	// Extra credit
 public:
+	// instant schema changes, only columns.tbl is written: tuples stored before an addAttribute read the new
+	// attribute as 0 or an empty varchar, and keep the bytes of a dropped attribute until they are rewritten.
+	// An attribute which is indexed, or included in an index, cannot be dropped.
 	RC dropAttribute(const string &tableName, const string &attributeName);
 
 	RC addAttribute(const string &tableName, const Attribute &attr);
 
+	// rewrite the tuples stored before the last addAttribute / dropAttribute, UPGRADE_BATCH_PAGES pages per hold
+	// of the table lock so it can run on a background thread; updateTuple also rewrites the tuple it updates
+	RC upgradeTable(const string &tableName);
+
 	RC reorganizeTable(const string &tableName);
 
+	friend class RM_TableHandle;
+	friend class RM_ScanIterator;
+	friend class RM_IndexScanIterator;
+
 protected:
 	RelationManager();
 	~RelationManager();
@@ -138,11 +531,11 @@ private:
 	IndexManager * ix;
 	PagedFileManager * pfm;
 
-
-	RBFM_ScanIterator rbfmScanner;
 	vector<Attribute> tableVec;
 	vector<Attribute> columnVec;
 	vector<Attribute> indexVec;
+	vector<Attribute> statisticsVec;
+	vector<Attribute> partitionsVec;
 
 	// [tableName -> [tableID -> RID in tables.tbl]
 	map<string, map<int, RID> *> tablesMap;
@@ -150,35 +543,166 @@ private:
 	// [tableID -> [column position -> RID in columns.tbl]]
 	map<int, map<int, RID> *> columnsMap;
 
-	// [tableID -> [column position -> RID in indice.tbl]]
+	// [tableID -> [index position -> RID in indice.tbl]]: the column position of an index on one column, -1, -2...
+	// for the composite indexes of the table
 	map<int, map<int, RID> *> indexMap;
 
+	// [tableID -> [column position -> RID in statistics.tbl]]
+	map<int, map<int, RID> *> statisticsMap;
+
+	// [tableID -> partitions of the table], loaded from partitions.tbl
+	map<int, TablePartitions> partitionsMap;
+
+	// [tableID -> record descriptor read from columns.tbl], dropped by every DDL on the table
+	map<int, vector<Attribute> > attributesCache;
+
+	// [tableID -> [index position -> positions of its key columns]], read from indices.tbl
+	map<int, map<int, vector<int> > > keyColumnsCache;
+
+	// [tableID -> [index position -> positions of the columns included in its index]], read from indices.tbl
+	map<int, map<int, vector<int> > > includedColumnsCache;
+
 
 	int TABLE_ID_COUNTER;
 
+	bool snapshotExists; // catalog.snapshot matches the maps, DDL removes it
+
+	// [tableID -> number of open RM_TableHandle]
+	map<int, int> openTableHandles;
+
+	// DDL holds catalogLock exclusively, every other call shares it: the maps above only change under the exclusive lock
+	shared_mutex catalogLock;
+
+	// [tableID -> lock on the tuples and indexes of the table], entries are never removed so iterators can keep a pointer
+	map<int, shared_mutex> tableLocks;
+	mutex tableLocksMutex;
+
+	mutex cacheMutex; // attributesCache, the index column caches and openTableHandles change under the shared catalog lock
+
 
 	void appendData(int fieldLength, int &offset, char * pageBuffer, const char * dataToWrite, AttrType attrType);
 
 	RC insertTablesEntry(string tableName, string tableType, string fileName, FileHandle &fileHandle, int numOfCol, RID &rid);
 
-	RC insertColumnsEntry(string tableName, string columnName, FileHandle &fileHandle, int colPosition, int maxLength, RID &rid, AttrType colType);
+	RC insertColumnsEntry(int tableID, string tableName, string columnName, FileHandle &fileHandle, int colPosition, int maxLength, RID &rid,
+			AttrType colType, int schemaVersion);
+
+	RC insertIndexEntry(string tableName, string columnName, int tableID, int columnPos, const vector<int> &keyPositions,
+			const vector<int> &includedPositions, FileHandle & fileHandle, RID &rid);
+
+	RC insertStatisticsEntry(string tableName, string columnName, int tableID, int columnPos, const ColumnStatistics &stats,
+			AttrType colType, FileHandle &fileHandle, RID &rid);
 
-	RC insertIndexEntry(string tableName, string columnName, int tableID, int columnPos, FileHandle & fileHandle, RID &rid);
+	RC deleteStatisticsEntries(int tableID);
+
+	RC insertPartitionEntry(string tableName, int tableID, int partition, const TablePartitions &partitioning,
+			PartitionEntry &entry, FileHandle &fileHandle);
+
+	RC deleteTableHelper(const string &tableName);
+
+	// NULL when the table is not partitioned
+	TablePartitions *getPartitioning(const string &tableName);
+
+	bool isPartitionTable(const string &tableName) { return tableName.find(PARTITION_SEPARATOR) != string::npos; }
+
+	string getPartitionName(const string &tableName, int partition);
+
+	// partition the tuple belongs to, -1 when its range partition was dropped
+	int routeTuple(const TablePartitions &partitioning, const void *data, const vector<Attribute> &recordDescriptor);
+
+	// partition table and rid in it of a rid of a partitioned table
+	RC findPartition(const string &tableName, const RID &rid, string &partitionName, RID &partitionRid);
+
+	// partitions which may hold a key in the range, a NULL key is unbounded
+	void prunePartitions(const TablePartitions &partitioning, AttrType keyType, const void *lowKey, const void *highKey,
+			bool lowKeyInclusive, bool highKeyInclusive, vector<int> &partitions);
+
+	RC openPartitionScan(RM_ScanIterator &rm_ScanIterator, const string &partitionName);
+
+	RC openPartitionIndexScan(RM_IndexScanIterator &rm_IndexScanIterator, const string &partitionName);
+
+	// every column the table ever had in position order, dropped ones flagged: the layout of its records
+	RC getRecordDescriptor(const string &tableName, vector<Attribute> &recordDescriptor);
+
+	RC getSchemaVersion(int tableID, int &schemaVersion);
+
+	void invalidateAttributes(int tableID);
+
+	RC getIndexColumns(int tableID, map<int, vector<int> > &keyColumns, map<int, vector<int> > &includedColumns);
+
+	// the attribute the index on keyColumns is built on: the column, or the varchar key of a composite index
+	Attribute getIndexAttribute(const vector<Attribute> &recordDescriptor, const vector<int> &keyColumns);
+
+	// the key of a tuple in the index on keyColumns: its field, or the key of a composite index built in keyBuffer
+	const char *readIndexKey(const void *data, const vector<Attribute> &recordDescriptor, const vector<int> &keyColumns,
+			char *keyBuffer);
+
+	// position in indexMap of the index named indexName (see createIndex), 0 when the table has none
+	int findIndex(int tableID, const vector<Attribute> &recordDescriptor, const string &indexName);
+
+	short buildPayload(const void *data, const vector<Attribute> &recordDescriptor, const vector<int> &positions, char *payload);
+
+	// append tuples (at offsets) to the table and their entries to indexes; a tuple which did not get all of its entries
+	// is deleted again with the tuples after it, numOfTuples counts the tuples kept
+	RC appendTuples(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *tuples, const vector<int> &offsets,
+			vector<BulkLoadIndex> &indexes, unsigned &numOfTuples);
+
+	// bulkLoad of a columnar file, EXPORT_ROW_GROUP_SIZE tuples per appendTuples
+	RC appendColumnarFile(const string &fileName, const vector<Attribute> &attrs, const vector<Attribute> &recordDescriptor,
+			FileHandle &fileHandle, vector<BulkLoadIndex> &indexes, unsigned &numOfTuples);
+
+	// fill the empty index files on keyColumns (with their included columns) from one scan of the table
+	RC buildIndexes(const string &tableName, const vector<Attribute> &recordDescriptor, const vector<vector<int> > &keyColumns,
+			const vector<vector<int> > &includedPositions);
+
+	shared_mutex *getTableLock(const string &tableName);
+
+	shared_mutex *getTableLock(int tableID);
+
+	bool hasOpenHandles(const string &tableName);
 
 	short determineMemoryNeeded(const vector<Attribute> &attributes);
 
-	void populateColumnsMap(RID &rid, int columnIndex);
+	void populateColumnsMap(int tableID, RID &rid, int columnIndex);
 
 	RC loadSystem();
 
+	RC upgradeSystemTable(const string &tableName, const vector<Attribute> &recordDescriptor, map<int, map<int, RID> *> &entryMap);
+
+	RC loadPartitions();
+
+	RC loadSnapshot();
+
+	RC writeSnapshot();
+
+	void invalidateSnapshot();
+
+	RC stampSystemFiles(SystemFileStamp *stamps);
+
+	void clearCatalogMaps();
+
 	RC createTableHelper(const string &tableName, const vector<Attribute> & attr, const string & type);
 
+	bool isSystemTable(const string &tableName);
+
 	bool isSystemTableRequest(string tableName);
 
-	int readFieldOffset(const void *data, int attrPosition, vector<Attribute> recordDescriptor);
+	int readFieldOffset(const void *data, int attrPosition, const vector<Attribute> &recordDescriptor);
 
 	bool isFieldEqual(const char *a, const char *b, AttrType type);
 
+	int compareFields(const char *a, const char *b, AttrType type);
+
+	int getFieldLength(const char *field, AttrType type);
+
+	unsigned long long hashField(const char *field, AttrType type);
+
+	void addToSketch(vector<unsigned char> &registers, unsigned long long hash);
+
+	int estimateDistinct(const vector<unsigned char> &registers);
+
+	int estimateTableDistinct(const vector<string> &sortedSample, AttrType type, int numOfRows);
+
 };
 
 #endif
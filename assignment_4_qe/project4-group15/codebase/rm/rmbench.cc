@@ -0,0 +1,193 @@
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <thread>
+
+#include "rm.h"
+
+using namespace std;
+
+// YCSB style throughput of the RelationManager against the number of threads.
+// usage: rmbench [numOfRecords] [opsPerThread] [maxThreads]
+//
+// usertable is [Key int, Field varchar(100)], a key is found through the rid it was loaded at.
+// Workload A is 50% reads / 50% updates, B 95% / 5%, C read only, keys follow a scrambled zipfian distribution.
+// Column "A own table" runs workload A with every thread on a table of its own, so writers never share a table lock.
+
+RelationManager *rm = RelationManager::instance();
+const int success = 0;
+const int fieldLength = 100;
+
+// Gray et al. "Quickly generating billion-record synthetic databases", as in YCSB with theta 0.99
+class ZipfianGenerator {
+public:
+	ZipfianGenerator(int numOfItems, unsigned seed) : numOfItems(numOfItems), random(seed), uniform(0.0, 1.0) {
+		double theta = 0.99;
+		double zetaN = 0;
+		for (int i = 1; i <= numOfItems; i++)
+			zetaN += 1.0 / pow(i, theta);
+		double zeta2 = 1.0 + 1.0 / pow(2, theta);
+
+		this->theta = theta;
+		this->zetaN = zetaN;
+		alpha = 1.0 / (1.0 - theta);
+		eta = (1.0 - pow(2.0 / numOfItems, 1.0 - theta)) / (1.0 - zeta2 / zetaN);
+	}
+
+	int next() {
+		double u = uniform(random);
+		double uz = u * zetaN;
+		long long item;
+		if (uz < 1.0)
+			item = 0;
+		else if (uz < 1.0 + pow(0.5, theta))
+			item = 1;
+		else
+			item = (long long)(numOfItems * pow(eta * u - eta + 1, alpha));
+
+		// spread the hot keys over the table
+		unsigned long long hash = 14695981039346656037ULL;
+		for (int i = 0; i < 8; i++) {
+			hash ^= (item >> (i * 8)) & 0xff;
+			hash *= 1099511628211ULL;
+		}
+		return (int)(hash % numOfItems);
+	}
+
+	double nextDouble() {
+		return uniform(random);
+	}
+
+private:
+	int numOfItems;
+	double theta, zetaN, alpha, eta;
+	mt19937_64 random;
+	uniform_real_distribution<double> uniform;
+};
+
+int prepareRecord(int key, char fill, void *buffer)
+{
+	int offset = 0;
+	memcpy((char *)buffer + offset, &key, sizeof(int));
+	offset += sizeof(int);
+	memcpy((char *)buffer + offset, &fieldLength, sizeof(int));
+	offset += sizeof(int);
+	memset((char *)buffer + offset, fill, fieldLength);
+	offset += fieldLength;
+	return offset;
+}
+
+void createUserTable(const string &tableName, int numOfRecords, vector<RID> &rids)
+{
+	vector<Attribute> attrs;
+	Attribute attr;
+	attr.name = "Key";
+	attr.type = TypeInt;
+	attr.length = (AttrLength)4;
+	attrs.push_back(attr);
+	attr.name = "Field";
+	attr.type = TypeVarChar;
+	attr.length = (AttrLength)fieldLength;
+	attrs.push_back(attr);
+
+	RC rc = rm->createTable(tableName, attrs);
+	assert(rc == success);
+
+	void *record = malloc(PAGE_SIZE);
+	RID rid;
+	rids.clear();
+	for (int key = 0; key < numOfRecords; key++) {
+		prepareRecord(key, 'a', record);
+		rc = rm->insertTuple(tableName, record, rid);
+		assert(rc == success);
+		rids.push_back(rid);
+	}
+	free(record);
+}
+
+void runClient(const string &tableName, const vector<RID> &rids, double readProportion, int numOfOps, unsigned seed)
+{
+	ZipfianGenerator keys((int)rids.size(), seed);
+	void *record = malloc(PAGE_SIZE);
+	void *returnedData = malloc(PAGE_SIZE);
+
+	for (int op = 0; op < numOfOps; op++) {
+		int key = keys.next();
+		RC rc;
+		if (keys.nextDouble() < readProportion) {
+			rc = rm->readTuple(tableName, rids[key], returnedData);
+			assert(rc == success && *(int *)returnedData == key);
+		}
+		else {
+			prepareRecord(key, 'a' + op % 26, record);
+			rc = rm->updateTuple(tableName, record, rids[key]);
+			assert(rc == success);
+		}
+	}
+
+	free(record);
+	free(returnedData);
+}
+
+// ops per second of numOfThreads clients, client i works on tableNames[i % tableNames.size()]
+double runWorkload(const vector<string> &tableNames, const vector<vector<RID> > &rids, double readProportion,
+		int numOfThreads, int opsPerThread)
+{
+	vector<thread> clients;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < numOfThreads; i++) {
+		int table = i % (int)tableNames.size();
+		clients.push_back(thread(runClient, tableNames[table], cref(rids[table]), readProportion, opsPerThread, 1234u + i));
+	}
+	for (int i = 0; i < numOfThreads; i++)
+		clients[i].join();
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	return numOfThreads * opsPerThread / elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+	int numOfRecords = argc > 1 ? atoi(argv[1]) : 10000;
+	int opsPerThread = argc > 2 ? atoi(argv[2]) : 5000;
+	int maxThreads = argc > 3 ? atoi(argv[3]) : 8;
+
+	vector<string> sharedTable(1, "usertable");
+	vector<vector<RID> > sharedRids(1);
+	createUserTable(sharedTable[0], numOfRecords, sharedRids[0]);
+
+	vector<string> ownTables;
+	vector<vector<RID> > ownRids(maxThreads);
+	for (int i = 0; i < maxThreads; i++) {
+		ownTables.push_back("usertable_" + to_string(i));
+		createUserTable(ownTables[i], max(numOfRecords / maxThreads, 1), ownRids[i]);
+	}
+
+	cout << numOfRecords << " records, " << opsPerThread << " operations per thread, "
+			<< thread::hardware_concurrency() << " hardware threads" << endl;
+	cout << setw(8) << "threads" << setw(14) << "A ops/s" << setw(14) << "B ops/s" << setw(14) << "C ops/s"
+			<< setw(20) << "A own table ops/s" << endl;
+
+	for (int numOfThreads = 1; numOfThreads <= maxThreads; numOfThreads *= 2) {
+		vector<string> tables(ownTables.begin(), ownTables.begin() + numOfThreads);
+		vector<vector<RID> > rids(ownRids.begin(), ownRids.begin() + numOfThreads);
+
+		cout << setw(8) << numOfThreads << fixed << setprecision(0)
+				<< setw(14) << runWorkload(sharedTable, sharedRids, 0.5, numOfThreads, opsPerThread)
+				<< setw(14) << runWorkload(sharedTable, sharedRids, 0.95, numOfThreads, opsPerThread)
+				<< setw(14) << runWorkload(sharedTable, sharedRids, 1.0, numOfThreads, opsPerThread)
+				<< setw(20) << runWorkload(tables, rids, 0.5, numOfThreads, opsPerThread) << endl;
+	}
+
+	RC rc = rm->deleteTable(sharedTable[0]);
+	assert(rc == success);
+	for (int i = 0; i < maxThreads; i++) {
+		rc = rm->deleteTable(ownTables[i]);
+		assert(rc == success);
+	}
+
+	return 0;
+}
@@ -1,20 +1,3099 @@
-
 #include <fstream>
 #include <iostream>
 #include <cassert>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <set>
 
 #include "rm.h"
 
 using namespace std;
 
+RelationManager *rm = RelationManager::instance();
+const int success = 0;
+
+void createNameAgeTable(const string &tableName)
+{
+    vector<Attribute> attrs;
+    Attribute attr;
+
+    attr.name = "Name";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength)100;
+    attrs.push_back(attr);
+
+    attr.name = "Age";
+    attr.type = TypeInt;
+    attr.length = (AttrLength)4;
+    attrs.push_back(attr);
+
+    RC rc = rm->createTable(tableName, attrs);
+    assert(rc == success);
+}
+
+// Function to prepare a [Name, Age] tuple, returns the tuple size
+int prepareNameAgeTuple(const string &name, const int age, void *buffer)
+{
+    int offset = 0;
+    int nameLength = (int)name.size();
+
+    memcpy((char *)buffer + offset, &nameLength, sizeof(int));
+    offset += sizeof(int);
+    memcpy((char *)buffer + offset, name.c_str(), nameLength);
+    offset += nameLength;
+    memcpy((char *)buffer + offset, &age, sizeof(int));
+    offset += sizeof(int);
+
+    return offset;
+}
+
+void testFillFactor()
+{
+    // Functions tested
+    // 1. Set Fill Factor **
+    // 2. Update Tuple -- growing tuples stay in their page
+    // 3. Get Forwarding Stats **
+    cout << "****In Extra Test Case Fill Factor****" << endl;
+
+    string tableName = "tbl_fill_factor";
+    string packedTableName = "tbl_packed";
+    createNameAgeTable(tableName);
+    createNameAgeTable(packedTableName);
+
+    RC rc = rm->setFillFactor(tableName, 60);
+    assert(rc == success);
+
+    // a fill factor outside of [MIN_FILL_FACTOR, 100] is rejected
+    rc = rm->setFillFactor(tableName, 0);
+    assert(rc != success);
+
+    void *tuple = malloc(200);
+    void *returnedData = malloc(200);
+    int numOfTuples = 500;
+    vector<RID> rids, packedRids;
+    RID rid;
+
+    for (int i = 0; i < numOfTuples; i++) {
+        prepareNameAgeTuple("short_name", i, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+
+        rc = rm->insertTuple(packedTableName, tuple, rid);
+        assert(rc == success);
+        packedRids.push_back(rid);
+    }
+
+    // every tuple grows by ten bytes
+    for (int i = 0; i < numOfTuples; i++) {
+        prepareNameAgeTuple("a_longer_short_name", i, tuple);
+        rc = rm->updateTuple(tableName, tuple, rids[i]);
+        assert(rc == success);
+
+        rc = rm->updateTuple(packedTableName, tuple, packedRids[i]);
+        assert(rc == success);
+    }
+
+    for (int i = 0; i < numOfTuples; i++) {
+        int tupleSize = prepareNameAgeTuple("a_longer_short_name", i, tuple);
+        rc = rm->readTuple(tableName, rids[i], returnedData);
+        assert(rc == success);
+        assert(memcmp(tuple, returnedData, tupleSize) == 0);
+    }
+
+    ForwardingStats stats, packedStats;
+    rc = rm->getForwardingStats(tableName, stats);
+    assert(rc == success);
+    rc = rm->getForwardingStats(packedTableName, packedStats);
+    assert(rc == success);
+
+    cout << "fill factor 60: " << stats.numOfForwarded << " of " << stats.numOfRecords << " tuples forwarded, "
+         << stats.numOfPages << " pages" << endl;
+    cout << "fill factor 100: " << packedStats.numOfForwarded << " of " << packedStats.numOfRecords << " tuples forwarded, "
+         << packedStats.numOfPages << " pages" << endl;
+
+    assert(stats.numOfRecords == (unsigned)numOfTuples);
+    assert(stats.numOfForwarded == 0);
+    assert(stats.numOfInPlaceUpdates == (unsigned)numOfTuples);
+    assert(packedStats.numOfRecords == (unsigned)numOfTuples);
+    assert(packedStats.numOfForwarded > 0);
+
+    free(tuple);
+    free(returnedData);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+    rc = rm->deleteTable(packedTableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Fill Factor passed****" << endl << endl;
+}
+
+void testReadTuples()
+{
+    // Functions tested
+    // 1. Read Tuples ** -- rids in random order, some of the tuples forwarded
+    cout << "****In Extra Test Case Read Tuples****" << endl;
+
+    string tableName = "tbl_read_tuples";
+    createNameAgeTable(tableName);
+
+    void *tuple = malloc(200);
+    int numOfTuples = 400;
+    vector<RID> rids;
+    RID rid;
+
+    for (int i = 0; i < numOfTuples; i++) {
+        prepareNameAgeTuple("name", i, tuple);
+        RC rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+
+    // grow every third tuple until the pages overflow and tuples get forwarded
+    for (int i = 0; i < numOfTuples; i += 3) {
+        prepareNameAgeTuple("a much longer name which does not fit into the page any more", i, tuple);
+        RC rc = rm->updateTuple(tableName, tuple, rids[i]);
+        assert(rc == success);
+    }
+
+    ForwardingStats stats;
+    RC rc = rm->getForwardingStats(tableName, stats);
+    assert(rc == success);
+    assert(stats.numOfForwarded > 0);
+
+    // read the tuples back in a scrambled order
+    vector<RID> batchRids;
+    vector<int> ages;
+    vector<void *> batchData;
+    for (int i = 0; i < numOfTuples; i++) {
+        int age = (i * 7919) % numOfTuples;
+        batchRids.push_back(rids[age]);
+        ages.push_back(age);
+        batchData.push_back(malloc(200));
+    }
+
+    rc = rm->readTuples(tableName, batchRids, batchData);
+    assert(rc == success);
+
+    void *returnedData = malloc(200);
+    for (int i = 0; i < numOfTuples; i++) {
+        rc = rm->readTuple(tableName, batchRids[i], returnedData);
+        assert(rc == success);
+
+        int tupleSize = sizeof(int) + *(int *)returnedData + sizeof(int);
+        assert(memcmp(batchData[i], returnedData, tupleSize) == 0);
+        assert(*(int *)((char *)batchData[i] + tupleSize - sizeof(int)) == ages[i]);
+        free(batchData[i]);
+    }
+
+    // a deleted rid fails the whole batch
+    rc = rm->deleteTuple(tableName, rids[1]);
+    assert(rc == success);
+    vector<RID> deletedRids(1, rids[1]);
+    vector<void *> deletedData(1, returnedData);
+    rc = rm->readTuples(tableName, deletedRids, deletedData);
+    assert(rc != success);
+
+    free(tuple);
+    free(returnedData);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Read Tuples passed****" << endl << endl;
+}
+
+void testAnalyzeTable()
+{
+    // Functions tested
+    // 1. Analyze Table **
+    // 2. Get Statistics **
+    // 3. Delete Table -- removes the statistics
+    // 4. Analyze Table -- a large table from a sample of its pages
+    cout << "****In Extra Test Case Analyze Table****" << endl;
+
+    string tableName = "tbl_analyze";
+    createNameAgeTable(tableName);
+
+    ColumnStatistics stats;
+    RC rc = rm->getStatistics(tableName, "Age", stats);
+    assert(rc != success);
+
+    // 20000 tuples, 100 distinct names, ages 0 .. 19999
+    void *tuple = malloc(200);
+    int numOfTuples = 20000;
+    RID rid;
+    for (int i = 0; i < numOfTuples; i++) {
+        char name[16];
+        sprintf(name, "name%03d", i % 100);
+        prepareNameAgeTuple(name, i, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+
+    rc = rm->analyzeTable(tableName);
+    assert(rc == success);
+
+    rc = rm->getStatistics(tableName, "Age", stats);
+    assert(rc == success);
+    cout << "Age: " << stats.numOfRows << " rows, " << stats.numOfPages << " pages, " << stats.numOfDistinct
+         << " distinct, " << stats.histogram.size() << " buckets" << endl;
+    assert(stats.numOfRows == numOfTuples);
+    assert(stats.numOfPages > 0);
+    assert(*(int *)stats.minValue == 0);
+    assert(*(int *)stats.maxValue == numOfTuples - 1);
+    assert(stats.numOfDistinct > numOfTuples * 0.95 && stats.numOfDistinct < numOfTuples * 1.05);
+    assert(stats.histogram.size() == STATS_HISTOGRAM_BUCKETS);
+
+    int bucketRows = 0;
+    for (unsigned i = 0; i < stats.histogram.size(); i++) {
+        bucketRows += stats.histogram[i].numOfRows;
+        if (i > 0)
+            assert(*(int *)stats.histogram[i].upperBound > *(int *)stats.histogram[i - 1].upperBound);
+    }
+    assert(bucketRows > numOfTuples * 0.99 && bucketRows < numOfTuples * 1.01);
+    assert(*(int *)stats.histogram.back().upperBound <= numOfTuples - 1);
+
+    rc = rm->getStatistics(tableName, "Name", stats);
+    assert(rc == success);
+    cout << "Name: " << stats.numOfDistinct << " distinct, " << stats.histogram.size() << " buckets" << endl;
+    assert(stats.numOfDistinct >= 95 && stats.numOfDistinct <= 105);
+    assert(*(int *)stats.minValue == 7 && memcmp((char *)stats.minValue + sizeof(int), "name000", 7) == 0);
+    assert(*(int *)stats.maxValue == 7 && memcmp((char *)stats.maxValue + sizeof(int), "name099", 7) == 0);
+
+    // analyzing again replaces the statistics
+    rc = rm->deleteTuples(tableName);
+    assert(rc == success);
+    prepareNameAgeTuple("only", 42, tuple);
+    rc = rm->insertTuple(tableName, tuple, rid);
+    assert(rc == success);
+
+    rc = rm->analyzeTable(tableName);
+    assert(rc == success);
+    rc = rm->getStatistics(tableName, "Age", stats);
+    assert(rc == success);
+    assert(stats.numOfRows == 1 && stats.numOfDistinct == 1 && stats.histogram.size() == 1);
+    assert(*(int *)stats.minValue == 42 && *(int *)stats.maxValue == 42);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    // a new table must not see the statistics of the deleted one
+    createNameAgeTable(tableName);
+    rc = rm->getStatistics(tableName, "Age", stats);
+    assert(rc != success);
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    // values longer than the min/max buffer keep their prefix
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "Text";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength)1000;
+    attrs.push_back(attr);
+    attr.name = "Id";
+    attr.type = TypeInt;
+    attr.length = (AttrLength)4;
+    attrs.push_back(attr);
+    rc = rm->createTable(tableName, attrs);
+    assert(rc == success);
+
+    int textLength = 900;
+    tuple = malloc(PAGE_SIZE);
+    for (int i = 0; i < 100; i++) {
+        memcpy(tuple, &textLength, sizeof(int));
+        memset((char *)tuple + sizeof(int), 'a' + i % 5, textLength);
+        memcpy((char *)tuple + sizeof(int) + textLength, &i, sizeof(int));
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+
+    rc = rm->analyzeTable(tableName);
+    assert(rc == success);
+    rc = rm->getStatistics(tableName, "Text", stats);
+    assert(rc == success);
+    int prefixLength = MAX_ATTRIBUTE_LENGTH - sizeof(int);
+    assert(*(int *)stats.minValue == prefixLength && *(int *)stats.maxValue == prefixLength);
+    for (int i = 0; i < prefixLength; i++)
+        assert(stats.minValue[sizeof(int) + i] == 'a' && stats.maxValue[sizeof(int) + i] == 'e');
+    rc = rm->getStatistics(tableName, "Id", stats);
+    assert(rc == success);
+    assert(*(int *)stats.minValue == 0 && *(int *)stats.maxValue == 99);
+
+    // four tuples a page: more than STATS_SAMPLE_PAGES pages, the statistics are estimated from a sample of them
+    int numOfLarge = 6000;
+    for (int i = 100; i < numOfLarge; i++) {
+        memcpy(tuple, &textLength, sizeof(int));
+        memset((char *)tuple + sizeof(int), 'a' + i % 5, textLength);
+        memcpy((char *)tuple + sizeof(int) + textLength, &i, sizeof(int));
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+
+    rc = rm->analyzeTable(tableName);
+    assert(rc == success);
+    rc = rm->getStatistics(tableName, "Id", stats);
+    assert(rc == success);
+    cout << "Id (sampled): " << stats.numOfRows << " rows, " << stats.numOfPages << " pages, " << stats.numOfDistinct
+         << " distinct" << endl;
+    assert(stats.numOfPages > STATS_SAMPLE_PAGES);
+    assert(stats.numOfRows > numOfLarge * 0.95 && stats.numOfRows < numOfLarge * 1.05);
+    assert(stats.numOfDistinct > numOfLarge * 0.8 && stats.numOfDistinct <= stats.numOfRows);
+    assert(*(int *)stats.minValue == 0);
+    rc = rm->getStatistics(tableName, "Text", stats);
+    assert(rc == success);
+    assert(stats.numOfDistinct == 5);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Analyze Table passed****" << endl << endl;
+}
+
+void testAttributesCache()
+{
+    // Functions tested
+    // 1. Get Attributes -- served from the cache after the first call
+    // 2. Delete Table / Create Table -- the cached descriptor is dropped
+    cout << "****In Extra Test Case Attributes Cache****" << endl;
+
+    string tableName = "tbl_attributes_cache";
+    createNameAgeTable(tableName);
+
+    vector<Attribute> attrs, cachedAttrs;
+    RC rc = rm->getAttributes(tableName, attrs);
+    assert(rc == success);
+    rc = rm->getAttributes(tableName, cachedAttrs);
+    assert(rc == success);
+    assert(attrs.size() == 2 && cachedAttrs.size() == 2);
+    for (unsigned i = 0; i < attrs.size(); i++) {
+        assert(attrs[i].name == cachedAttrs[i].name);
+        assert(attrs[i].type == cachedAttrs[i].type);
+        assert(attrs[i].length == cachedAttrs[i].length);
+    }
+
+    // the same name with a new schema must not see the old descriptor
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+    rc = rm->getAttributes(tableName, attrs);
+    assert(rc != success);
+
+    vector<Attribute> newAttrs;
+    Attribute attr;
+    attr.name = "Height";
+    attr.type = TypeReal;
+    attr.length = (AttrLength)4;
+    newAttrs.push_back(attr);
+    rc = rm->createTable(tableName, newAttrs);
+    assert(rc == success);
+
+    rc = rm->getAttributes(tableName, attrs);
+    assert(rc == success);
+    assert(attrs.size() == 1 && attrs[0].name == "Height" && attrs[0].type == TypeReal);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Attributes Cache passed****" << endl << endl;
+}
+
+void testTableHandle()
+{
+    // Functions tested
+    // 1. Open Table **
+    // 2. Insert / Read / Update / Delete / Scan through the table handle **
+    // 3. Create Index / Delete Table -- rejected while the handle is open
+    cout << "****In Extra Test Case Table Handle****" << endl;
+
+    string tableName = "tbl_table_handle";
+    createNameAgeTable(tableName);
+    RC rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+
+    RM_TableHandle tableHandle;
+    rc = rm->openTable(tableName, tableHandle);
+    assert(rc == success);
+    assert(tableHandle.getAttributes().size() == 2);
+
+    rc = rm->createIndex(tableName, "Name");
+    assert(rc != success);
+    rc = rm->deleteTable(tableName);
+    assert(rc != success);
+
+    void *tuple = malloc(200);
+    void *returnedData = malloc(200);
+    int numOfTuples = 1000;
+    vector<RID> rids;
+    RID rid;
+
+    for (int i = 0; i < numOfTuples; i++) {
+        prepareNameAgeTuple("handle", i, tuple);
+        rc = tableHandle.insertTuple(tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+
+    // ages of the even tuples move up by numOfTuples, the tuples divisible by 3 are deleted
+    for (int i = 0; i < numOfTuples; i += 2) {
+        prepareNameAgeTuple("handle", i + numOfTuples, tuple);
+        rc = tableHandle.updateTuple(tuple, rids[i]);
+        assert(rc == success);
+    }
+    for (int i = 0; i < numOfTuples; i += 3) {
+        rc = tableHandle.deleteTuple(rids[i]);
+        assert(rc == success);
+    }
+
+    for (int i = 1; i < numOfTuples; i += 3) {
+        int age = i % 2 == 0 ? i + numOfTuples : i;
+        int tupleSize = prepareNameAgeTuple("handle", age, tuple);
+        rc = tableHandle.readTuple(rids[i], returnedData);
+        assert(rc == success);
+        assert(memcmp(tuple, returnedData, tupleSize) == 0);
+    }
+    rc = tableHandle.readTuple(rids[0], returnedData);
+    assert(rc != success);
+
+    // scan through the handle, then through the index once the handle is closed
+    int numOfLeft = numOfTuples - (numOfTuples + 2) / 3;
+    int lowAge = numOfTuples;
+    vector<string> attributeNames(1, "Age");
+    RM_ScanIterator rmsi;
+    rc = tableHandle.scan("Age", GE_OP, &lowAge, attributeNames, rmsi);
+    assert(rc == success);
+    int numOfScanned = 0;
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+        assert(*(int *)returnedData >= lowAge);
+        numOfScanned++;
+    }
+    rmsi.close();
+
+    // the handle is still usable after the scan closed
+    rc = tableHandle.readTuple(rids[1], returnedData);
+    assert(rc == success);
+
+    rc = tableHandle.close();
+    assert(rc == success);
+
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, "Age", &lowAge, NULL, true, true, rmisi);
+    assert(rc == success);
+    int numOfIndexed = 0;
+    while (rmisi.getNextEntry(rid, returnedData) != RM_EOF)
+        numOfIndexed++;
+    rmisi.close();
+
+    rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc == success);
+    int numOfEntries = 0;
+    while (rmisi.getNextEntry(rid, returnedData) != RM_EOF)
+        numOfEntries++;
+    rmisi.close();
+
+    cout << numOfScanned << " tuples scanned, " << numOfIndexed << " found in the index, " << numOfEntries << " index entries" << endl;
+    assert(numOfScanned == numOfIndexed);
+    assert(numOfEntries == numOfLeft);
+
+    free(tuple);
+    free(returnedData);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Table Handle passed****" << endl << endl;
+}
+
+// scans the whole index, checks the entries are strictly ascending by key then rid and each rid points to a tuple with
+// that key
+int checkIndexOrder(const string &tableName, const string &attributeName, int keyPosition)
+{
+    vector<Attribute> attrs;
+    RC rc = rm->getAttributes(tableName, attrs);
+    assert(rc == success);
+    AttrType type = attrs[keyPosition].type;
+
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, attributeName, NULL, NULL, true, true, rmisi);
+    assert(rc == success);
+
+    void *key = malloc(PAGE_SIZE);
+    void *lastKey = malloc(PAGE_SIZE);
+    void *tuple = malloc(PAGE_SIZE);
+    int numOfEntries = 0;
+    RID rid, lastRid;
+
+    while (rmisi.getNextEntry(rid, key) != RM_EOF) {
+        int keyLength = type == TypeVarChar ? sizeof(int) + *(int *)key : sizeof(int);
+        if (numOfEntries > 0) {
+            int result;
+            if (type == TypeVarChar)
+                result = string((char *)lastKey + 4, *(int *)lastKey).compare(string((char *)key + 4, *(int *)key));
+            else
+                result = *(int *)lastKey < *(int *)key ? -1 : *(int *)lastKey > *(int *)key;
+            assert(result < 0 || (result == 0 && (lastRid.pageNum < rid.pageNum
+                    || (lastRid.pageNum == rid.pageNum && lastRid.slotNum < rid.slotNum))));
+        }
+
+        rc = rm->readTuple(tableName, rid, tuple);
+        assert(rc == success);
+        int offset = 0;
+        for (int i = 0; i < keyPosition; i++)
+            offset += attrs[i].type == TypeVarChar ? sizeof(int) + *(int *)((char *)tuple + offset) : sizeof(int);
+        assert(memcmp((char *)tuple + offset, key, keyLength) == 0);
+
+        memcpy(lastKey, key, keyLength);
+        lastRid = rid;
+        numOfEntries++;
+    }
+    rmisi.close();
+
+    free(key);
+    free(lastKey);
+    free(tuple);
+
+    return numOfEntries;
+}
+
+void testBulkLoad()
+{
+    // Functions tested
+    // 1. Create Index -- built bottom-up from sorted keys **
+    // 2. Insert Tuple -- into the bulk loaded tree
+    // 3. External sorter with spilled runs **
+    cout << "****In Extra Test Case Bulk Load****" << endl;
+
+    string tableName = "tbl_bulk_load";
+    createNameAgeTable(tableName);
+
+    void *tuple = malloc(200);
+    int numOfTuples = 30000;
+    RID rid;
+
+    // ages are a permutation of 0 .. numOfTuples - 1, then 1000 duplicated ages, which share posting lists
+    for (int i = 0; i < numOfTuples + 1000; i++) {
+        int age = (int)(((long long)i * 7919) % numOfTuples);
+        char name[16];
+        sprintf(name, "name%05d", age);
+        prepareNameAgeTuple(name, age, tuple);
+        RC rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+
+    RC rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+    rc = rm->createIndex(tableName, "Name");
+    assert(rc == success);
+
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples + 1000);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples + 1000);
+
+    // new keys on both ends and in the middle split the packed pages
+    for (int i = 0; i < 2000; i++) {
+        int age = i % 2 == 0 ? numOfTuples + i : -i;
+        char name[16];
+        sprintf(name, "name%05d_", i);
+        prepareNameAgeTuple(name, age, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples + 3000);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples + 3000);
+
+    RM_IndexScanIterator rmisi;
+    int lowAge = 100, highAge = 199;
+    rc = rm->indexScan(tableName, "Age", &lowAge, &highAge, true, true, rmisi);
+    assert(rc == success);
+    int numOfInRange = 0;
+    while (rmisi.getNextEntry(rid, tuple) != RM_EOF) {
+        assert(*(int *)tuple >= lowAge && *(int *)tuple <= highAge);
+        numOfInRange++;
+    }
+    rmisi.close();
+    int numOfDuplicated = 0;
+    for (int i = numOfTuples; i < numOfTuples + 1000; i++) {
+        int age = (int)(((long long)i * 7919) % numOfTuples);
+        numOfDuplicated += age >= lowAge && age <= highAge;
+    }
+    assert(numOfInRange == 100 + numOfDuplicated);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    // a small memory limit forces the sorter to spill runs and merge them
+    Attribute attr;
+    attr.name = "Key";
+    attr.type = TypeInt;
+    attr.length = 4;
+    IX_ExternalSorter sorter(attr, 4096);
+    int numOfKeys = 20000;
+    for (int i = 0; i < numOfKeys; i++) {
+        int key = (int)(((long long)i * 104729) % 5000);
+        rid.pageNum = i;
+        rid.slotNum = 0;
+        rc = sorter.addEntry(&key, rid);
+        assert(rc == success);
+    }
+    rc = sorter.sort();
+    assert(rc == success);
+    assert(sorter.getNumOfRuns() > 1);
+
+    int numOfSorted = 0, key, lastKey = -1;
+    RID lastRid;
+    lastRid.pageNum = 0;
+    while (sorter.getNextEntry(rid, &key) != IX_EOF) {
+        assert(key > lastKey || (key == lastKey && rid.pageNum > lastRid.pageNum));
+        lastKey = key;
+        lastRid = rid;
+        numOfSorted++;
+    }
+    assert(numOfSorted == numOfKeys);
+
+    free(tuple);
+
+    cout << "****Extra Test Case Bulk Load passed****" << endl << endl;
+}
+
+void testCreateIndexes()
+{
+    // Functions tested
+    // 1. Create Indexes -- one scan, trees built in parallel **
+    // 2. Create Indexes with a bad attribute list -- nothing is created
+    cout << "****In Extra Test Case Create Indexes****" << endl;
+
+    string tableName = "tbl_create_indexes";
+    createNameAgeTable(tableName);
+
+    void *tuple = malloc(200);
+    int numOfTuples = 10000;
+    RID rid;
+    for (int i = 0; i < numOfTuples; i++) {
+        int age = (int)(((long long)i * 7919) % numOfTuples);
+        char name[16];
+        sprintf(name, "name%05d", numOfTuples - age);
+        prepareNameAgeTuple(name, age, tuple);
+        RC rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+    attributeNames.push_back("Height");
+    RC rc = rm->createIndexes(tableName, attributeNames);
+    assert(rc != success);
+
+    attributeNames[1] = "Age";
+    rc = rm->createIndexes(tableName, attributeNames);
+    assert(rc != success);
+
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc != success);
+
+    attributeNames[0] = "Name";
+    rc = rm->createIndexes(tableName, attributeNames);
+    assert(rc == success);
+
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples);
+
+    // both indexes are maintained afterwards
+    prepareNameAgeTuple("name99999", numOfTuples, tuple);
+    rc = rm->insertTuple(tableName, tuple, rid);
+    assert(rc == success);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples + 1);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples + 1);
+
+    rc = rm->createIndex(tableName, "Age");
+    assert(rc != success);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Create Indexes passed****" << endl << endl;
+}
+
+// index-only scan of [Name, Age] through the Age index, every tuple must match the table; returns the count
+int checkCoveredScan(const string &tableName)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Name");
+    attributeNames.push_back("Age");
+    void *returnedData = malloc(200);
+    void *tuple = malloc(200);
+    RM_IndexScanIterator rmisi;
+    RID rid;
+    RC rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, attributeNames, rmisi);
+    assert(rc == success);
+
+    int numOfScanned = 0;
+    int lastAge = -1;
+    while (rmisi.getNextTuple(rid, returnedData) != RM_EOF) {
+        rc = rm->readTuple(tableName, rid, tuple);
+        assert(rc == success);
+        int tupleSize = sizeof(int) + *(int *)tuple + sizeof(int);
+        assert(memcmp(tuple, returnedData, tupleSize) == 0);
+
+        int age = *(int *)((char *)returnedData + tupleSize - sizeof(int));
+        assert(age >= lastAge);
+        lastAge = age;
+        numOfScanned++;
+    }
+    rmisi.close();
+
+    free(returnedData);
+    free(tuple);
+    return numOfScanned;
+}
+
+void testCoveringIndex()
+{
+    // Functions tested
+    // 1. Create Index with included attributes, then Insert / Update Tuple **
+    // 2. Index Scan over the key and included attributes, without reading the table **
+    // 3. Create Indexes with included attributes on a loaded table **
+    // 4. Index Scan of an attribute that is not in the index -- rejected
+    cout << "****In Extra Test Case Covering Index****" << endl;
+
+    string tableName = "tbl_covering_index";
+    createNameAgeTable(tableName);
+
+    RC rc = rm->createIndex(tableName, "Age", vector<string>(1, "Height"));
+    assert(rc != success);
+    rc = rm->createIndex(tableName, "Age", vector<string>(1, "Age"));
+    assert(rc != success);
+    rc = rm->createIndex(tableName, "Age", vector<string>(1, "Name"));
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    int numOfTuples = 1000;
+    vector<RID> rids;
+    RID rid;
+    for (int i = 0; i < numOfTuples; i++) {
+        char name[16];
+        sprintf(name, "name%05d", i * 7);
+        prepareNameAgeTuple(name, (i * 7919) % numOfTuples, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+    assert(checkCoveredScan(tableName) == numOfTuples);
+
+    // a new name with the same age must reach the index entry
+    for (int i = 0; i < numOfTuples; i += 10) {
+        char name[40];
+        sprintf(name, "a much longer updated name %05d", i);
+        prepareNameAgeTuple(name, (i * 7919) % numOfTuples, tuple);
+        rc = rm->updateTuple(tableName, tuple, rids[i]);
+        assert(rc == success);
+    }
+
+    RM_TableHandle tableHandle;
+    rc = rm->openTable(tableName, tableHandle);
+    assert(rc == success);
+    for (int i = 5; i < numOfTuples; i += 10) {
+        char name[16];
+        sprintf(name, "n%d", i);
+        prepareNameAgeTuple(name, (i * 7919) % numOfTuples, tuple);
+        rc = tableHandle.updateTuple(tuple, rids[i]);
+        assert(rc == success);
+    }
+    prepareNameAgeTuple("handle", numOfTuples, tuple);
+    rc = tableHandle.insertTuple(tuple, rid);
+    assert(rc == success);
+    rc = tableHandle.close();
+    assert(rc == success);
+    assert(checkCoveredScan(tableName) == numOfTuples + 1);
+
+    // only the key and included attributes can be projected
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, vector<string>(1, "Height"), rmisi);
+    assert(rc != success);
+
+    rc = rm->destroyIndex(tableName, "Age");
+    assert(rc == success);
+    rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+    rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, vector<string>(1, "Name"), rmisi);
+    assert(rc != success);
+    rc = rm->destroyIndex(tableName, "Age");
+    assert(rc == success);
+
+    // bulk loaded indexes carry the included values too
+    vector<string> attributeNames;
+    attributeNames.push_back("Name");
+    attributeNames.push_back("Age");
+    vector<vector<string> > includedAttributes(2);
+    includedAttributes[1].push_back("Name");
+    rc = rm->createIndexes(tableName, attributeNames, includedAttributes);
+    assert(rc == success);
+    assert(checkCoveredScan(tableName) == numOfTuples + 1);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples + 1);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Covering Index passed****" << endl << endl;
+}
+
+// helpers to extend a tuple, return the new tuple size
+int appendInt(void *buffer, int offset, int value)
+{
+    memcpy((char *)buffer + offset, &value, sizeof(int));
+    return offset + sizeof(int);
+}
+
+int appendVarChar(void *buffer, int offset, const string &text)
+{
+    int textLength = (int)text.size();
+    memcpy((char *)buffer + offset, &textLength, sizeof(int));
+    memcpy((char *)buffer + offset + sizeof(int), text.c_str(), textLength);
+    return offset + sizeof(int) + textLength;
+}
+
+// size of a [varchar, int, varchar, varchar] tuple
+int getVarCharIntVarCharVarCharLength(const void *data)
+{
+    int offset = sizeof(int) + *(int *)data + sizeof(int);
+    offset += sizeof(int) + *(int *)((char *)data + offset);
+    offset += sizeof(int) + *(int *)((char *)data + offset);
+    return offset;
+}
+
+void testSchemaVersioning()
+{
+    // Functions tested
+    // 1. Add Attribute -- old tuples read the new attributes as 0 and empty **
+    // 2. Drop Attribute -- the attribute is gone from tuples, scans and getAttributes **
+    // 3. Update Tuple / Upgrade Table -- old tuples are rewritten to the current schema **
+    // 4. Drop Attribute of an indexed attribute -- rejected
+    cout << "****In Extra Test Case Schema Versioning****" << endl;
+
+    string tableName = "tbl_schema_versioning";
+    createNameAgeTable(tableName);
+
+    void *tuple = malloc(200);
+    void *returnedData = malloc(200);
+    int numOfTuples = 500;
+    vector<RID> rids;
+    RID rid;
+    for (int i = 0; i < numOfTuples; i++) {
+        char name[8];
+        sprintf(name, "o%03d", i);
+        prepareNameAgeTuple(name, i, tuple);
+        RC rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+
+    Attribute attr;
+    attr.name = "Salary";
+    attr.type = TypeInt;
+    attr.length = 4;
+    RC rc = rm->addAttribute(tableName, attr);
+    assert(rc == success);
+    attr.name = "Note";
+    attr.type = TypeVarChar;
+    attr.length = 50;
+    rc = rm->addAttribute(tableName, attr);
+    assert(rc == success);
+    rc = rm->addAttribute(tableName, attr);
+    assert(rc != success);
+
+    // the schema of the system tables is fixed
+    rc = rm->addAttribute("columns", attr);
+    assert(rc != success);
+    rc = rm->dropAttribute("tables", "FileName");
+    assert(rc != success);
+
+    vector<Attribute> attrs;
+    rc = rm->getAttributes(tableName, attrs);
+    assert(rc == success && attrs.size() == 4 && attrs[3].name == "Note");
+
+    // [o007, 7, 0, ""] for a tuple stored before the change
+    int tupleSize = appendVarChar(tuple, appendInt(tuple, prepareNameAgeTuple("o007", 7, tuple), 0), "");
+    rc = rm->readTuple(tableName, rids[7], returnedData);
+    assert(rc == success && memcmp(tuple, returnedData, tupleSize) == 0);
+
+    tupleSize = appendVarChar(tuple, appendInt(tuple, prepareNameAgeTuple("new", numOfTuples, tuple), 1000), "hired");
+    rc = rm->insertTuple(tableName, tuple, rid);
+    assert(rc == success);
+    rids.push_back(rid);
+    rc = rm->readTuple(tableName, rid, returnedData);
+    assert(rc == success && memcmp(tuple, returnedData, tupleSize) == 0);
+
+    rc = rm->createIndex(tableName, "Name");
+    assert(rc == success);
+    rc = rm->dropAttribute(tableName, "Name");
+    assert(rc != success);
+
+    rc = rm->dropAttribute(tableName, "Age");
+    assert(rc == success);
+    rc = rm->getAttributes(tableName, attrs);
+    assert(rc == success && attrs.size() == 3 && attrs[1].name == "Salary");
+    rc = rm->readAttribute(tableName, rids[7], "Age", returnedData);
+    assert(rc != success);
+
+    // the name can be used again, the new attribute has no value in any tuple yet
+    attr.name = "Age";
+    rc = rm->addAttribute(tableName, attr);
+    assert(rc == success);
+
+    // [Name, Salary, Note, Age]
+    tupleSize = appendVarChar(tuple, appendVarChar(tuple, prepareNameAgeTuple("upd", 2000, tuple), "raised"), "42");
+    rc = rm->updateTuple(tableName, tuple, rids[8]);
+    assert(rc == success);
+    rc = rm->readTuple(tableName, rids[8], returnedData);
+    assert(rc == success && memcmp(tuple, returnedData, tupleSize) == 0);
+
+    // every tuple reads the same before and after the upgrade
+    vector<string> before;
+    for (int i = 0; i <= numOfTuples; i++) {
+        rc = rm->readTuple(tableName, rids[i], returnedData);
+        assert(rc == success);
+        before.push_back(string((char *)returnedData, getVarCharIntVarCharVarCharLength(returnedData)));
+    }
+    assert(before[7].size() == sizeof(int) + 4 + 3 * sizeof(int));
+
+    // tuples with room in their page are rewritten, none is forwarded by the upgrade
+    ForwardingStats stats;
+    rc = rm->getForwardingStats(tableName, stats);
+    assert(rc == success);
+    unsigned numOfUpdates = stats.numOfUpdates;
+    unsigned numOfForwarded = stats.numOfForwarded;
+    rc = rm->upgradeTable(tableName);
+    assert(rc == success);
+    rc = rm->getForwardingStats(tableName, stats);
+    assert(rc == success);
+    assert(stats.numOfUpdates > numOfUpdates && stats.numOfForwarded == numOfForwarded);
+    for (int i = 0; i <= numOfTuples; i++) {
+        rc = rm->readTuple(tableName, rids[i], returnedData);
+        assert(rc == success);
+        assert(before[i] == string((char *)returnedData, getVarCharIntVarCharVarCharLength(returnedData)));
+    }
+
+    // scan the new attribute: one value, empty everywhere else
+    vector<string> attributeNames(1, "Salary");
+    RM_ScanIterator rmsi;
+    rc = rm->scan(tableName, "", NO_OP, NULL, attributeNames, rmsi);
+    assert(rc == success);
+    int numOfScanned = 0;
+    int sum = 0;
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+        numOfScanned++;
+        sum += *(int *)returnedData;
+    }
+    rmsi.close();
+    assert(numOfScanned == numOfTuples + 1 && sum == 3000);
+
+    free(tuple);
+    free(returnedData);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Schema Versioning passed****" << endl << endl;
+}
+
+// size of a file, -1 when it does not exist
+long getFileSize(const string &fileName)
+{
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0)
+        return -1;
+    return (long)fileStat.st_size;
+}
+
+void testTruncate()
+{
+    // Functions tested
+    // 1. Delete Tuples -- table and index files truncated in place **
+    // 2. Insert Tuple / Index Scan -- after many truncations
+    cout << "****In Extra Test Case Truncate****" << endl;
+
+    string tableName = "tbl_truncate";
+    createNameAgeTable(tableName);
+    RC rc = rm->setFillFactor(tableName, 60);
+    assert(rc == success);
+    rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    RID rid;
+    int numOfTuples = 300;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < numOfTuples; i++) {
+            char name[16];
+            sprintf(name, "r%03d_%03d", round, i);
+            prepareNameAgeTuple(name, round * numOfTuples + (i * 7) % numOfTuples, tuple);
+            rc = rm->insertTuple(tableName, tuple, rid);
+            assert(rc == success);
+        }
+        if (round % 50 == 0)
+            assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples);
+
+        rc = rm->deleteTuples(tableName);
+        assert(rc == success);
+
+        // heap back to no page, meta file to its header page, index to header, root and first leaf
+        assert(getFileSize(tableName + ".tbl") == 0);
+        assert(getFileSize("meta_" + tableName + ".tbl") == PAGE_SIZE);
+        assert(getFileSize(tableName + "_Age.idx") == 3 * PAGE_SIZE);
+    }
+
+    RM_ScanIterator rmsi;
+    vector<string> attributeNames(1, "Age");
+    rc = rm->scan(tableName, "", NO_OP, NULL, attributeNames, rmsi);
+    assert(rc == success);
+    assert(rmsi.getNextTuple(rid, tuple) == RM_EOF);
+    rmsi.close();
+    assert(checkIndexOrder(tableName, "Age", 1) == 0);
+
+    // the fill factor is kept: 60 percent pages hold fewer tuples than packed ones
+    string packedTableName = "tbl_truncate_packed";
+    createNameAgeTable(packedTableName);
+    for (int i = 0; i < 2000; i++) {
+        prepareNameAgeTuple("after_truncate", i, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        rc = rm->insertTuple(packedTableName, tuple, rid);
+        assert(rc == success);
+    }
+    assert(checkIndexOrder(tableName, "Age", 1) == 2000);
+    ForwardingStats stats, packedStats;
+    rc = rm->getForwardingStats(tableName, stats);
+    assert(rc == success);
+    rc = rm->getForwardingStats(packedTableName, packedStats);
+    assert(rc == success);
+    assert(stats.numOfRecords == 2000 && stats.numOfPages > packedStats.numOfPages);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+    rc = rm->deleteTable(packedTableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Truncate passed****" << endl << endl;
+}
+
+// reads the tuple with key "age" through the Age index into tuple
+void readByAge(const string &tableName, int age, void *tuple)
+{
+    RM_IndexScanIterator rmisi;
+    RID rid;
+    RC rc = rm->indexScan(tableName, "Age", &age, &age, true, true, rmisi);
+    assert(rc == success);
+    assert(rmisi.getNextEntry(rid, tuple) != RM_EOF);
+    rmisi.close();
+    rc = rm->readTuple(tableName, rid, tuple);
+    assert(rc == success);
+}
+
+void testBulkLoadFile()
+{
+    // Functions tested
+    // 1. Bulk Load of a csv file -- quoted fields, a '\n' in a quoted field, a '"' in an unquoted field, chunks cut
+    //    between lines **
+    // 2. Bulk Load of a bad csv file -- tuples before the bad line are kept **
+    // 3. Bulk Load of a binary file **
+    // 4. Entries of the loaded tuples added to the indexes, the indexes of an empty table rebuilt
+    cout << "****In Extra Test Case Bulk Load File****" << endl;
+
+    string tableName = "tbl_bulk_load_file";
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "Name";
+    attr.type = TypeVarChar;
+    attr.length = 30;
+    attrs.push_back(attr);
+    attr.name = "Age";
+    attr.type = TypeInt;
+    attr.length = 4;
+    attrs.push_back(attr);
+    attr.name = "Height";
+    attr.type = TypeReal;
+    attr.length = 4;
+    attrs.push_back(attr);
+    RC rc = rm->createTable(tableName, attrs);
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    RID rid;
+    for (int i = 0; i < 10; i++) {
+        float height = 1.5;
+        int offset = appendVarChar(tuple, 0, "inserted");
+        offset = appendInt(tuple, offset, i);
+        memcpy((char *)tuple + offset, &height, sizeof(float));
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+    rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+    rc = rm->createIndex(tableName, "Name");
+    assert(rc == success);
+
+    // more than BULK_LOAD_CHUNK_SIZE bytes, so the file is cut in several chunks
+    int numOfLines = 60000;
+    ofstream csv("bulk_load_file.csv");
+    for (int i = 0; i < numOfLines; i++) {
+        if (i == 777)
+            csv << "\"a, \"\"quoted\"\" name\"," << 10 + i << ",2.25\r\n";
+        else if (i == 888)
+            csv << "\"two\nlines\"," << 10 + i << ",1\n";
+        else if (i == 999)
+            csv << "stray\"quote," << 10 + i << ",1\n";
+        else
+            csv << "name" << i << "," << 10 + i << "," << i * 0.5 << "\n";
+        if (i == 1000)
+            csv << "\n";
+    }
+    csv.close();
+
+    unsigned numOfLoaded;
+    rc = rm->bulkLoad(tableName, "bulk_load_file.csv", CSVFile, numOfLoaded);
+    assert(rc == success);
+    assert(numOfLoaded == (unsigned)numOfLines);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfLines + 10);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfLines + 10);
+
+    readByAge(tableName, 10 + 777, tuple);
+    assert(*(int *)tuple == 16 && memcmp((char *)tuple + 4, "a, \"quoted\" name", 16) == 0);
+    assert(*(float *)((char *)tuple + 24) == 2.25);
+    readByAge(tableName, 10 + 888, tuple);
+    assert(*(int *)tuple == 9 && memcmp((char *)tuple + 4, "two\nlines", 9) == 0);
+    readByAge(tableName, 10 + 999, tuple);
+    assert(*(int *)tuple == 11 && memcmp((char *)tuple + 4, "stray\"quote", 11) == 0);
+    readByAge(tableName, 10 + 1000, tuple);
+    assert(*(int *)tuple == 8 && memcmp((char *)tuple + 4, "name1000", 8) == 0);
+    readByAge(tableName, 10 + 4321, tuple);
+    assert(*(int *)tuple == 8 && memcmp((char *)tuple + 4, "name4321", 8) == 0);
+    assert(*(float *)((char *)tuple + 16) == 4321 * 0.5);
+
+    // the third line has a bad int: two tuples are loaded and indexed
+    ofstream badCsv("bulk_load_bad.csv");
+    badCsv << "bad0,-1,0\nbad1,-2,0\nbad2,abc,0\nbad3,-4,0\n";
+    badCsv.close();
+    rc = rm->bulkLoad(tableName, "bulk_load_bad.csv", CSVFile, numOfLoaded);
+    assert(rc != success);
+    assert(numOfLoaded == 2);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfLines + 12);
+
+    // tuples in the format of insertTuple
+    int numOfBinary = 1000;
+    ofstream binary("bulk_load_file.bin", ios::binary);
+    for (int i = 0; i < numOfBinary; i++) {
+        char name[16];
+        sprintf(name, "bin%d", i);
+        float height = i;
+        int offset = appendVarChar(tuple, 0, name);
+        offset = appendInt(tuple, offset, -100 - i);
+        memcpy((char *)tuple + offset, &height, sizeof(float));
+        binary.write((char *)tuple, offset + sizeof(float));
+    }
+    binary.close();
+
+    rc = rm->bulkLoad(tableName, "bulk_load_file.bin", BinaryFile, numOfLoaded);
+    assert(rc == success);
+    assert(numOfLoaded == (unsigned)numOfBinary);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfLines + 12 + numOfBinary);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfLines + 12 + numOfBinary);
+    readByAge(tableName, -100 - 999, tuple);
+    assert(*(int *)tuple == 6 && memcmp((char *)tuple + 4, "bin999", 6) == 0);
+
+    // into the emptied table: the indexes are built once at the end
+    rc = rm->deleteTuples(tableName);
+    assert(rc == success);
+    rc = rm->bulkLoad(tableName, "bulk_load_file.bin", BinaryFile, numOfLoaded);
+    assert(rc == success);
+    assert(numOfLoaded == (unsigned)numOfBinary);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfBinary);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfBinary);
+
+    rc = rm->bulkLoad(tableName, "no_such_file.csv", CSVFile, numOfLoaded);
+    assert(rc != success);
+
+    remove("bulk_load_file.csv");
+    remove("bulk_load_bad.csv");
+    remove("bulk_load_file.bin");
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Bulk Load File passed****" << endl << endl;
+}
+
+// [Name varchar(30), Age int, Height real] tuple of the export test, the name of age 3 holds a ',', a '\n' and a '"'
+int prepareExportTuple(int age, void *buffer)
+{
+    char name[32];
+    if (age == 3)
+        sprintf(name, "a,\n\"b\"");
+    else if (age % 100 == 0)
+        sprintf(name, "long_updated_name_%08d", age);
+    else
+        sprintf(name, "city%d", age % 10);
+    float height = age * 0.25f;
+    int offset = appendVarChar(buffer, 0, name);
+    offset = appendInt(buffer, offset, age);
+    memcpy((char *)buffer + offset, &height, sizeof(float));
+    return offset + sizeof(float);
+}
+
+// every age in [0, numOfTuples) is found once in the tuples of the table, with the content prepareExportTuple gives
+void checkExportedTable(const string &tableName, int numOfTuples)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Name");
+    attributeNames.push_back("Age");
+    attributeNames.push_back("Height");
+    RM_ScanIterator rmsi;
+    RC rc = rm->scan(tableName, "", NO_OP, NULL, attributeNames, rmsi);
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    void *expected = malloc(200);
+    vector<bool> isSeen(numOfTuples, false);
+    RID rid;
+    while (rmsi.getNextTuple(rid, tuple) != RM_EOF) {
+        int age = *(int *)((char *)tuple + sizeof(int) + *(int *)tuple);
+        assert(age >= 0 && age < numOfTuples && !isSeen[age]);
+        isSeen[age] = true;
+        int length = prepareExportTuple(age, expected);
+        assert(memcmp(tuple, expected, length) == 0);
+    }
+    rmsi.close();
+    assert(find(isSeen.begin(), isSeen.end(), false) == isSeen.end());
+
+    free(tuple);
+    free(expected);
+}
+
+void testExportTable()
+{
+    // Functions tested
+    // 1. Export Table -- columnar, binary and csv files, forwarded tuples exported once **
+    // 2. Columnar Reader **
+    // 3. Bulk Load of the exported files
+    cout << "****In Extra Test Case Export Table****" << endl;
+
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "Name";
+    attr.type = TypeVarChar;
+    attr.length = 30;
+    attrs.push_back(attr);
+    attr.name = "Age";
+    attr.type = TypeInt;
+    attr.length = 4;
+    attrs.push_back(attr);
+    attr.name = "Height";
+    attr.type = TypeReal;
+    attr.length = 4;
+    attrs.push_back(attr);
+
+    string tableName = "tbl_export";
+    RC rc = rm->createTable(tableName, attrs);
+    assert(rc == success);
+
+    // short names first, the updates to long names forward tuples out of the full pages
+    void *tuple = malloc(200);
+    int numOfTuples = 20000;
+    vector<RID> rids;
+    RID rid;
+    for (int age = 0; age < numOfTuples; age++) {
+        int offset = appendVarChar(tuple, 0, age == 3 ? "a,\n\"b\"" : "s");
+        offset = appendInt(tuple, offset, age);
+        float height = age * 0.25f;
+        memcpy((char *)tuple + offset, &height, sizeof(float));
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+    for (int age = 0; age < numOfTuples; age++) {
+        prepareExportTuple(age, tuple);
+        rc = rm->updateTuple(tableName, tuple, rids[age]);
+        assert(rc == success);
+    }
+    ForwardingStats stats;
+    rc = rm->getForwardingStats(tableName, stats);
+    assert(rc == success && stats.numOfForwarded > 0);
+
+    rc = rm->exportTable(tableName, "tbl_export.col", ColumnarFile);
+    assert(rc == success);
+    rc = rm->exportTable(tableName, "tbl_export.bin", BinaryFile);
+    assert(rc == success);
+    rc = rm->exportTable(tableName, "tbl_export.csv", CSVFile);
+    assert(rc == success);
+    rc = rm->exportTable("no_such_table", "no_such_table.col", ColumnarFile);
+    assert(rc != success);
+
+    // dictionary names and close ages make the columnar file much smaller than the tuples
+    assert(getFileSize("tbl_export.col") * 2 < getFileSize("tbl_export.bin"));
+
+    RM_ColumnarReader reader;
+    rc = reader.open("tbl_export.col");
+    assert(rc == success);
+    vector<Attribute> fileAttrs;
+    reader.getAttributes(fileAttrs);
+    assert(fileAttrs.size() == 3 && fileAttrs[0].name == "Name" && fileAttrs[2].type == TypeReal);
+
+    void *expected = malloc(200);
+    vector<bool> isSeen(numOfTuples, false);
+    while (reader.getNextTuple(tuple) != RM_EOF) {
+        int age = *(int *)((char *)tuple + sizeof(int) + *(int *)tuple);
+        assert(age >= 0 && age < numOfTuples && !isSeen[age]);
+        isSeen[age] = true;
+        int length = prepareExportTuple(age, expected);
+        assert(memcmp(tuple, expected, length) == 0);
+    }
+    reader.close();
+    assert(find(isSeen.begin(), isSeen.end(), false) == isSeen.end());
+
+    // each file loads back into a table equal to the exported one
+    const char *fileNames[3] = { "tbl_export.col", "tbl_export.bin", "tbl_export.csv" };
+    FileFormat formats[3] = { ColumnarFile, BinaryFile, CSVFile };
+    for (int i = 0; i < 3; i++) {
+        string copyName = "tbl_export_copy";
+        rc = rm->createTable(copyName, attrs);
+        assert(rc == success);
+
+        unsigned numOfLoaded;
+        rc = rm->bulkLoad(copyName, fileNames[i], formats[i], numOfLoaded);
+        assert(rc == success && numOfLoaded == (unsigned)numOfTuples);
+        checkExportedTable(copyName, numOfTuples);
+
+        rc = rm->deleteTable(copyName);
+        assert(rc == success);
+        remove(fileNames[i]);
+    }
+
+    free(tuple);
+    free(expected);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Export Table passed****" << endl << endl;
+}
+
+// number of tuples of the scan with the condition, in the same format as RelationManager::scan
+int countTuples(const string &tableName, const string &conditionAttribute, const CompOp compOp, const void *value)
+{
+    RM_ScanIterator rmsi;
+    vector<string> attributeNames(1, "Age");
+    RC rc = rm->scan(tableName, conditionAttribute, compOp, value, attributeNames, rmsi);
+    assert(rc == success);
+
+    RID rid;
+    int age;
+    int numOfTuples = 0;
+    while (rmsi.getNextTuple(rid, &age) != RM_EOF)
+        numOfTuples++;
+    rmsi.close();
+
+    return numOfTuples;
+}
+
+void testPartitioning()
+{
+    // Functions tested
+    // 1. Create Table -- range and hash partitioned **
+    // 2. Insert / Read / Update / Delete Tuple, Read Tuples -- routed to the partitions **
+    // 3. Scan / Index Scan -- partitions pruned by the condition **
+    // 4. Drop Partition **
+    cout << "****In Extra Test Case Partitioning****" << endl;
+
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "Name";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength)100;
+    attrs.push_back(attr);
+    attr.name = "Age";
+    attr.type = TypeInt;
+    attr.length = (AttrLength)4;
+    attrs.push_back(attr);
+
+    // ages [0, 100), [100, 200), [200, 300), [300, ...)
+    string tableName = "tbl_range";
+    PartitionScheme scheme;
+    scheme.type = RangePartitioning;
+    scheme.attributeName = "Age";
+    scheme.numOfPartitions = 4;
+    scheme.rangeBounds.push_back(100);
+    scheme.rangeBounds.push_back(200);
+    scheme.rangeBounds.push_back(300);
+    RC rc = rm->createTable(tableName, attrs, scheme);
+    assert(rc == success);
+    assert(getFileSize("tbl_range@3.tbl") == 0);
+
+    // bounds must ascend, range partitioning takes an int attribute
+    scheme.rangeBounds[2] = 150;
+    assert(rm->createTable("tbl_range_bad", attrs, scheme) != success);
+    scheme.rangeBounds[2] = 300;
+    scheme.attributeName = "Name";
+    assert(rm->createTable("tbl_range_bad", attrs, scheme) != success);
+
+    rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    void *returnedTuple = malloc(200);
+    vector<RID> rids;
+    RID rid;
+    for (int age = 0; age < 400; age++) {
+        char name[16];
+        sprintf(name, "range_%03d", age);
+        int tupleSize = prepareNameAgeTuple(name, age, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        assert((int)(rid.pageNum >> PARTITION_SHIFT) == age / 100);
+        rids.push_back(rid);
+
+        rc = rm->readTuple(tableName, rid, returnedTuple);
+        assert(rc == success);
+        assert(memcmp(tuple, returnedTuple, tupleSize) == 0);
+    }
+
+    int value = 150;
+    assert(countTuples(tableName, "", NO_OP, NULL) == 400);
+    assert(countTuples(tableName, "Age", LT_OP, &value) == 150);
+    assert(countTuples(tableName, "Age", GE_OP, &value) == 250);
+    assert(countTuples(tableName, "Age", EQ_OP, &value) == 1);
+    value = 99;
+    assert(countTuples(tableName, "Age", LE_OP, &value) == 100);
+    assert(countTuples(tableName, "Age", GT_OP, &value) == 300);
+
+    // index scan across two partitions, the rids read back through readTuples
+    RM_IndexScanIterator rmisi;
+    int lowKey = 150;
+    int highKey = 250;
+    rc = rm->indexScan(tableName, "Age", &lowKey, &highKey, true, false, rmisi);
+    assert(rc == success);
+    vector<RID> scannedRids;
+    int key;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        assert(key == lowKey + (int)scannedRids.size());
+        scannedRids.push_back(rid);
+    }
+    rmisi.close();
+    assert(scannedRids.size() == 100);
+
+    vector<void *> tuples;
+    for (unsigned i = 0; i < scannedRids.size(); i++)
+        tuples.push_back(malloc(200));
+    rc = rm->readTuples(tableName, scannedRids, tuples);
+    assert(rc == success);
+    for (unsigned i = 0; i < tuples.size(); i++) {
+        assert(*(int *)((char *)tuples[i] + sizeof(int) + 9) == lowKey + (int)i);
+        free(tuples[i]);
+    }
+
+    // an update keeps the tuple in its partition
+    prepareNameAgeTuple("range_updated", 120, tuple);
+    rc = rm->updateTuple(tableName, tuple, rids[110]);
+    assert(rc == success);
+    rc = rm->readAttribute(tableName, rids[110], "Age", returnedTuple);
+    assert(rc == success && *(int *)returnedTuple == 120);
+    prepareNameAgeTuple("range_moved", 250, tuple);
+    assert(rm->updateTuple(tableName, tuple, rids[111]) != success);
+
+    rc = rm->deleteTuple(tableName, rids[120]);
+    assert(rc == success);
+    assert(rm->readTuple(tableName, rids[120], returnedTuple) != success);
+    value = 120;
+    assert(countTuples(tableName, "Age", EQ_OP, &value) == 1);
+
+    // retention: the oldest partition is dropped with its files
+    vector<int> partitions;
+    assert(rm->deleteTable("tbl_range@0") != success);
+    rc = rm->dropPartition(tableName, 0);
+    assert(rc == success);
+    assert(getFileSize("tbl_range@0.tbl") == -1 && getFileSize("tbl_range@0_Age.idx") == -1);
+    rc = rm->getPartitions(tableName, partitions);
+    assert(rc == success && partitions.size() == 3 && partitions[0] == 1);
+    assert(countTuples(tableName, "", NO_OP, NULL) == 299);
+    value = 50;
+    assert(countTuples(tableName, "Age", LT_OP, &value) == 0);
+    prepareNameAgeTuple("range_dropped", 50, tuple);
+    assert(rm->insertTuple(tableName, tuple, rid) != success);
+    assert(rm->readTuple(tableName, rids[50], returnedTuple) != success);
+
+    // the partitions are tables of their own
+    rc = rm->deleteTuples("tbl_range@3");
+    assert(rc == success);
+    assert(countTuples(tableName, "", NO_OP, NULL) == 199);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+    assert(getFileSize("tbl_range@1.tbl") == -1 && getFileSize("tbl_range.tbl") == -1);
+
+    // hash partitions on a varchar, an equality condition reads a single partition
+    tableName = "tbl_hash";
+    scheme.type = HashPartitioning;
+    scheme.attributeName = "Name";
+    scheme.rangeBounds.clear();
+    rc = rm->createTable(tableName, attrs, scheme);
+    assert(rc == success);
+    rc = rm->createIndex(tableName, "Name");
+    assert(rc == success);
+
+    vector<int> partitionSizes(scheme.numOfPartitions, 0);
+    for (int age = 0; age < 200; age++) {
+        char name[16];
+        sprintf(name, "hash_%03d", age);
+        prepareNameAgeTuple(name, age, tuple);
+        rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        partitionSizes[rid.pageNum >> PARTITION_SHIFT]++;
+    }
+    for (int i = 0; i < scheme.numOfPartitions; i++)
+        assert(partitionSizes[i] > 0 && partitionSizes[i] < 200);
+
+    prepareNameAgeTuple("hash_042", 42, tuple);
+    assert(countTuples(tableName, "Name", EQ_OP, tuple) == 1);
+    assert(countTuples(tableName, "", NO_OP, NULL) == 200);
+
+    rc = rm->indexScan(tableName, "Name", tuple, tuple, true, true, rmisi);
+    assert(rc == success);
+    assert(rmisi.getNextEntry(rid, returnedTuple) != RM_EOF);
+    assert(rmisi.getNextEntry(rid, returnedTuple) == RM_EOF);
+    rmisi.close();
+
+    // hash partitions are not dropped
+    assert(rm->dropPartition(tableName, 0) != success);
+
+    rc = rm->deleteTuples(tableName);
+    assert(rc == success);
+    assert(countTuples(tableName, "", NO_OP, NULL) == 0);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    free(tuple);
+    free(returnedTuple);
+
+    cout << "****Extra Test Case Partitioning passed****" << endl << endl;
+}
+
+// inserts ages [firstAge, firstAge + numOfTuples), through the table handle when there is one
+void insertAges(const string &tableName, RM_TableHandle *tableHandle, int firstAge, int numOfTuples)
+{
+    void *tuple = malloc(200);
+    RID rid;
+    for (int age = firstAge; age < firstAge + numOfTuples; age++) {
+        prepareNameAgeTuple("concurrent", age, tuple);
+        RC rc = tableHandle != NULL ? tableHandle->insertTuple(tuple, rid) : rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+    free(tuple);
+}
+
+// reads every rid back a few times, tuple i has age i
+void readAges(const string &tableName, const vector<RID> &rids, int rounds)
+{
+    void *tuple = malloc(200);
+    void *returnedData = malloc(200);
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < (int)rids.size(); i++) {
+            int tupleSize = prepareNameAgeTuple("concurrent", i, tuple);
+            RC rc = rm->readTuple(tableName, rids[i], returnedData);
+            assert(rc == success);
+            assert(memcmp(tuple, returnedData, tupleSize) == 0);
+        }
+    }
+    free(tuple);
+    free(returnedData);
+}
+
+void scanAges(const string &tableName, int numOfTuples)
+{
+    vector<string> attributeNames(1, "Age");
+    void *returnedData = malloc(200);
+    RM_ScanIterator rmsi;
+    RID rid;
+    RC rc = rm->scan(tableName, "", NO_OP, NULL, attributeNames, rmsi);
+    assert(rc == success);
+    int numOfScanned = 0;
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF)
+        numOfScanned++;
+    rmsi.close();
+    assert(numOfScanned == numOfTuples);
+    free(returnedData);
+}
+
+void testConcurrentTables()
+{
+    // Functions tested
+    // 1. Read Tuple / Scan from several threads while other threads insert into another table **
+    // 2. Insert Tuple from several threads into one indexed table, through the RM and a shared table handle **
+    cout << "****In Extra Test Case Concurrent Tables****" << endl;
+
+    string readTable = "tbl_concurrent_read";
+    string writeTable = "tbl_concurrent_write";
+    createNameAgeTable(readTable);
+    createNameAgeTable(writeTable);
+    RC rc = rm->createIndex(writeTable, "Age");
+    assert(rc == success);
+
+    int numOfTuples = 2000;
+    void *tuple = malloc(200);
+    vector<RID> rids;
+    RID rid;
+    for (int i = 0; i < numOfTuples; i++) {
+        prepareNameAgeTuple("concurrent", i, tuple);
+        rc = rm->insertTuple(readTable, tuple, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+    free(tuple);
+
+    RM_TableHandle tableHandle;
+    rc = rm->openTable(writeTable, tableHandle);
+    assert(rc == success);
+
+    vector<thread> threads;
+    for (int i = 0; i < 4; i++)
+        threads.push_back(thread(insertAges, writeTable, i % 2 == 0 ? (RM_TableHandle *)NULL : &tableHandle, i * numOfTuples, numOfTuples));
+    threads.push_back(thread(readAges, readTable, rids, 2));
+    threads.push_back(thread(readAges, readTable, rids, 2));
+    threads.push_back(thread(scanAges, readTable, numOfTuples));
+    for (unsigned i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    rc = tableHandle.close();
+    assert(rc == success);
+
+    scanAges(writeTable, 4 * numOfTuples);
+    assert(checkIndexOrder(writeTable, "Age", 1) == 4 * numOfTuples);
+
+    rc = rm->deleteTable(readTable);
+    assert(rc == success);
+    rc = rm->deleteTable(writeTable);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Concurrent Tables passed****" << endl << endl;
+}
+
+void testIndexDelete()
+{
+    // Functions tested
+    // 1. Delete Tuple -- index pages merged, freed pages reused by later inserts **
+    // 2. Index Scan -- deleting each returned tuple during the scan **
+    cout << "****In Extra Test Case Index Delete****" << endl;
+
+    string tableName = "tbl_index_delete";
+    createNameAgeTable(tableName);
+    RC rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    int numOfTuples = 20000;
+    vector<RID> rids(numOfTuples);
+    int numOfIndexPages = 0;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < numOfTuples; i++) {
+            if (round > 0 && i % 10 == 0)
+                continue;
+            // ages in a scattered order so the deletes hit every leaf
+            int age = (i * 7919) % numOfTuples;
+            if (round == 1) {
+                rc = rm->deleteTuple(tableName, rids[age]);
+            } else {
+                prepareNameAgeTuple("index_delete", age, tuple);
+                rc = rm->insertTuple(tableName, tuple, rids[age]);
+            }
+            assert(rc == success);
+        }
+        int numOfPages = getFileSize(tableName + "_Age.idx") / PAGE_SIZE;
+        cout << "round " << round << ": " << numOfPages << " index pages" << endl;
+        if (round == 0)
+            numOfIndexPages = numOfPages;
+    }
+    // the pages freed by the merges are taken again instead of growing the file by a new leaf per split
+    assert(getFileSize(tableName + "_Age.idx") / PAGE_SIZE < numOfIndexPages * 3 / 2);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples);
+
+    // delete everything in [5000, 15000) while scanning it
+    int lowAge = 5000;
+    int highAge = 15000;
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, "Age", &lowAge, &highAge, true, false, rmisi);
+    assert(rc == success);
+    RID rid;
+    int key;
+    int expectedAge = lowAge;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        assert(key == expectedAge++);
+        rc = rm->deleteTuple(tableName, rid);
+        assert(rc == success);
+    }
+    rmisi.close();
+    assert(expectedAge == highAge);
+    assert(checkIndexOrder(tableName, "Age", 1) == numOfTuples - (highAge - lowAge));
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Index Delete passed****" << endl << endl;
+}
+
+string getUrl(int i)
+{
+    char url[100];
+    sprintf(url, "http://www.example.com/catalog/products/item?id=%06d", i);
+    return url;
+}
+
+void testIndexPrefix()
+{
+    // Functions tested
+    // 1. Insert Tuple -- varchar keys sharing a long prefix, stored once per leaf **
+    // 2. Index Scan -- range of the keys **
+    // 3. Delete Tuple **
+    cout << "****In Extra Test Case Index Prefix****" << endl;
+
+    string tableName = "tbl_index_prefix";
+    createNameAgeTable(tableName);
+    RC rc = rm->createIndex(tableName, "Name");
+    assert(rc == success);
+
+    void *tuple = malloc(200);
+    int numOfTuples = 10000;
+    vector<RID> rids(numOfTuples);
+    for (int i = 0; i < numOfTuples; i++) {
+        int id = (i * 7919) % numOfTuples;
+        prepareNameAgeTuple(getUrl(id), id, tuple);
+        rc = rm->insertTuple(tableName, tuple, rids[id]);
+        assert(rc == success);
+    }
+
+    // the keys alone would take more pages than the whole index
+    int numOfPages = getFileSize(tableName + "_Name.idx") / PAGE_SIZE;
+    cout << numOfPages << " index pages for " << numOfTuples << " keys of " << getUrl(0).size() << " bytes" << endl;
+    assert(numOfPages < numOfTuples * (int)getUrl(0).size() / PAGE_SIZE);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples);
+
+    // [2000, 3000]
+    char lowKey[100], highKey[100], key[100];
+    prepareNameAgeTuple(getUrl(2000), 0, lowKey);
+    prepareNameAgeTuple(getUrl(3000), 0, highKey);
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, "Name", lowKey, highKey, true, true, rmisi);
+    assert(rc == success);
+    RID rid;
+    int expectedId = 2000;
+    while (rmisi.getNextEntry(rid, key) != RM_EOF) {
+        string url = getUrl(expectedId++);
+        assert(*(int *)key == (int)url.size() && memcmp(key + sizeof(int), url.data(), url.size()) == 0);
+    }
+    rmisi.close();
+    assert(expectedId == 3001);
+
+    // every other tuple is deleted, keys without the prefix go before and after the others
+    for (int i = 0; i < numOfTuples; i += 2) {
+        rc = rm->deleteTuple(tableName, rids[i]);
+        assert(rc == success);
+    }
+    prepareNameAgeTuple("ftp://www.example.com/", 0, tuple);
+    rc = rm->insertTuple(tableName, tuple, rid);
+    assert(rc == success);
+    prepareNameAgeTuple("https://www.example.com/", 0, tuple);
+    rc = rm->insertTuple(tableName, tuple, rid);
+    assert(rc == success);
+    assert(checkIndexOrder(tableName, "Name", 0) == numOfTuples / 2 + 2);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Index Prefix passed****" << endl << endl;
+}
+
+void testHashIndex()
+{
+    // Functions tested
+    // 1. Create Index -- as a hash index **
+    // 2. Index Scan -- one key, and every key in no order **
+    // 3. Update Tuple and Delete Tuple **
+    cout << "****In Extra Test Case Hash Index****" << endl;
+
+    string tableName = "tbl_hash_index";
+    createNameAgeTable(tableName);
+    RC rc = rm->createIndex(tableName, "Age", HashIndex);
+    assert(rc == success);
+
+    // 10 tuples per age, enough for the buckets to be split and the directory doubled
+    void *tuple = malloc(200);
+    int numOfAges = 2000;
+    int numOfTuples = numOfAges * 10;
+    vector<RID> rids(numOfTuples);
+    for (int i = 0; i < numOfTuples; i++) {
+        prepareNameAgeTuple("hash_index", i % numOfAges, tuple);
+        rc = rm->insertTuple(tableName, tuple, rids[i]);
+        assert(rc == success);
+    }
+
+    RM_IndexScanIterator rmisi;
+    RID rid;
+    int key;
+    int age = 1234;
+    rc = rm->indexScan(tableName, "Age", &age, &age, true, true, rmisi);
+    assert(rc == success);
+    int count = 0;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        assert(key == age);
+        count++;
+    }
+    rmisi.close();
+    assert(count == 10);
+
+    // move the tuples of every tenth age to the age after the others, delete those of the age after that
+    for (int i = 0; i < numOfTuples; i++) {
+        int oldAge = i % numOfAges;
+        if (oldAge % 10 == 1) {
+            rc = rm->deleteTuple(tableName, rids[i]);
+        } else if (oldAge % 10 == 0) {
+            prepareNameAgeTuple("hash_index", numOfAges + oldAge, tuple);
+            rc = rm->updateTuple(tableName, tuple, rids[i]);
+        } else {
+            continue;
+        }
+        assert(rc == success);
+    }
+
+    age = 10;
+    rc = rm->indexScan(tableName, "Age", &age, &age, true, true, rmisi);
+    assert(rc == success);
+    assert(rmisi.getNextEntry(rid, &key) == RM_EOF);
+    rmisi.close();
+    age = 11;
+    rc = rm->indexScan(tableName, "Age", &age, &age, true, true, rmisi);
+    assert(rc == success);
+    assert(rmisi.getNextEntry(rid, &key) == RM_EOF);
+    rmisi.close();
+
+    // the whole index, in no order
+    vector<int> counts(numOfAges * 2, 0);
+    rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc == success);
+    count = 0;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        assert(key >= 0 && key < numOfAges * 2);
+        counts[key]++;
+        count++;
+    }
+    rmisi.close();
+    assert(count == numOfTuples - numOfTuples / 10);
+    for (int i = 0; i < numOfAges * 2; i++) {
+        bool present = i < numOfAges ? i % 10 > 1 : i % 10 == 0;
+        assert(counts[i] == (present ? 10 : 0));
+    }
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Hash Index passed****" << endl << endl;
+}
+
+// the name of the tuples of the composite index test, varchar keys with a 0 byte sort before the others
+string getCompositeName(int i)
+{
+    string name = "name_" + to_string(i / 10) + to_string(i % 10);
+    if (i % 5 == 0)
+        name += '\0';
+    return name;
+}
+
+// count the entries of a composite scan on [Name, Age], check their order, -1 on a key out of order or range
+int scanComposite(const string &tableName, const void *prefix, unsigned numOfPrefixValues, const int *lowAge,
+        const int *highAge, bool lowInclusive, bool highInclusive)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Name");
+    attributeNames.push_back("Age");
+
+    RM_IndexScanIterator rmisi;
+    RC rc = rm->indexScan(tableName, attributeNames, prefix, numOfPrefixValues, lowAge, highAge, lowInclusive,
+            highInclusive, rmisi);
+    assert(rc == success);
+
+    RID rid;
+    char key[200];
+    string lastName;
+    int lastAge = 0;
+    int count = 0;
+    while (rmisi.getNextEntry(rid, key) != RM_EOF) {
+        string name(key + sizeof(int), *(int *)key);
+        int age = *(int *)(key + sizeof(int) + name.size());
+        if (count > 0 && (name < lastName || (name == lastName && age < lastAge)))
+            return -1;
+        if (numOfPrefixValues == 1 && memcmp(key, prefix, sizeof(int) + name.size()) != 0)
+            return -1;
+        if ((lowAge != NULL && (lowInclusive ? age < *lowAge : age <= *lowAge))
+                || (highAge != NULL && (highInclusive ? age > *highAge : age >= *highAge)))
+            return -1;
+        lastName = name;
+        lastAge = age;
+        count++;
+    }
+    rmisi.close();
+
+    return count;
+}
+
+void testCompositeIndex()
+{
+    // Functions tested
+    // 1. Create Index -- on [Name, Age], next to the index on Name alone **
+    // 2. Index Scan -- equality on Name and a range of Age, Name alone, the whole index **
+    // 3. Update Tuple and Delete Tuple **
+    // 4. Drop Attribute -- rejected on a column of the index **
+    cout << "****In Extra Test Case Composite Index****" << endl;
+
+    string tableName = "tbl_composite_index";
+    createNameAgeTable(tableName);
+
+    // 30 names, 200 ages each, the index is built from the tuples already inserted
+    void *tuple = malloc(200);
+    int numOfNames = 30;
+    int numOfAges = 200;
+    vector<RID> rids;
+    for (int i = 0; i < numOfNames * numOfAges; i++) {
+        RID rid;
+        prepareNameAgeTuple(getCompositeName((i * 7) % numOfNames), i / numOfNames, tuple);
+        RC rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+        if ((i * 7) % numOfNames == 7)
+            rids.push_back(rid);
+    }
+
+    RC rc = rm->createIndex(tableName, "Name");
+    assert(rc == success);
+    vector<string> attributeNames;
+    attributeNames.push_back("Name");
+    attributeNames.push_back("Age");
+    rc = rm->createIndex(tableName, attributeNames);
+    assert(rc == success);
+    rc = rm->createIndex(tableName, attributeNames);
+    assert(rc != success);
+    cout << endl;
+
+    char prefix[100];
+    prepareNameAgeTuple(getCompositeName(7), 0, prefix);
+    int lowAge = 50;
+    int highAge = 100;
+    assert(scanComposite(tableName, prefix, 1, &lowAge, &highAge, true, false) == 50);
+    assert(scanComposite(tableName, prefix, 1, &lowAge, &highAge, false, true) == 50);
+    assert(scanComposite(tableName, prefix, 1, NULL, &highAge, true, true) == 101);
+    assert(scanComposite(tableName, prefix, 1, NULL, NULL, true, true) == numOfAges);
+    assert(scanComposite(tableName, NULL, 0, NULL, NULL, true, true) == numOfNames * numOfAges);
+
+    // the key with a 0 byte is a name of its own
+    prepareNameAgeTuple(getCompositeName(10), 0, prefix);
+    assert(scanComposite(tableName, prefix, 1, NULL, NULL, true, true) == numOfAges);
+    assert(scanComposite(tableName, prefix, 1, NULL, &highAge, true, false) == highAge);
+    *(int *)prefix -= 1;
+    assert(scanComposite(tableName, prefix, 1, NULL, NULL, true, true) == 0);
+
+    // name_07: ages below 100 deleted, the others moved to name_08 with their age + 1000
+    for (unsigned i = 0; i < rids.size(); i++) {
+        rc = rm->readTuple(tableName, rids[i], tuple);
+        assert(rc == success);
+        int age = *(int *)((char *)tuple + sizeof(int) + getCompositeName(7).size());
+        if (age < 100) {
+            rc = rm->deleteTuple(tableName, rids[i]);
+        } else {
+            prepareNameAgeTuple(getCompositeName(8), age + 1000, tuple);
+            rc = rm->updateTuple(tableName, tuple, rids[i]);
+        }
+        assert(rc == success);
+    }
+
+    prepareNameAgeTuple(getCompositeName(7), 0, prefix);
+    assert(scanComposite(tableName, prefix, 1, NULL, NULL, true, true) == 0);
+    prepareNameAgeTuple(getCompositeName(8), 0, prefix);
+    lowAge = 1000;
+    assert(scanComposite(tableName, prefix, 1, &lowAge, NULL, true, true) == 100);
+    assert(scanComposite(tableName, prefix, 1, NULL, NULL, true, true) == numOfAges + 100);
+
+    // every value of the key: the one entry of [name_08, 1150]
+    char values[100];
+    int offset = prepareNameAgeTuple(getCompositeName(8), 1150, values);
+    assert(offset > 0);
+    assert(scanComposite(tableName, values, 2, NULL, NULL, true, true) == 1);
+
+    rc = rm->dropAttribute(tableName, "Age");
+    assert(rc != success);
+    rc = rm->destroyIndex(tableName, "Name,Age");
+    assert(rc == success);
+    rc = rm->dropAttribute(tableName, "Age");
+    assert(rc == success);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Composite Index passed****" << endl << endl;
+}
+
+void testIndexFormat()
+{
+    // Functions tested
+    // 1. Index Scan -- an index file of an older format is refused, not read as empty **
+    // 2. Create Index -- again over the refused file **
+    cout << "****In Extra Test Case Index Format****" << endl;
+
+    string tableName = "tbl_index_format";
+    createNameAgeTable(tableName);
+    void *tuple = malloc(200);
+    RID rid;
+    for (int age = 0; age < 100; age++) {
+        prepareNameAgeTuple("index_format", age, tuple);
+        RC rc = rm->insertTuple(tableName, tuple, rid);
+        assert(rc == success);
+    }
+    RC rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+
+    // page 0 as the files before INDEX_FILE_MAGIC were written: the root page number first
+    PagedFileManager *pfm = PagedFileManager::instance();
+    FileHandle fileHandle;
+    char page[PAGE_SIZE];
+    rc = pfm->openFile((tableName + "_Age.idx").c_str(), fileHandle);
+    assert(rc == success);
+    rc = fileHandle.readPage(0, page);
+    assert(rc == success);
+    memset(page, 0, PAGE_SIZE);
+    *(unsigned *)page = 1;
+    rc = fileHandle.writePage(0, page);
+    assert(rc == success);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+
+    FileHandle indexFileHandle;
+    rc = IndexManager::instance()->openFile(tableName + "_Age.idx", indexFileHandle);
+    assert(rc == 5);
+    RM_IndexScanIterator rmisi;
+    rc = rm->indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc != success);
+
+    rc = rm->destroyIndex(tableName, "Age");
+    assert(rc == success);
+    rc = rm->createIndex(tableName, "Age");
+    assert(rc == success);
+    assert(checkIndexOrder(tableName, "Age", 1) == 100);
+
+    free(tuple);
+
+    rc = rm->deleteTable(tableName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Index Format passed****" << endl << endl;
+}
+
+// key of an index test as insertEntry takes it, a varchar is [length][characters]
+string makeIndexKey(AttrType type, int intValue, float realValue = 0, const string &text = "")
+{
+    if (type == TypeInt)
+        return string((char *)&intValue, sizeof(int));
+    if (type == TypeReal)
+        return string((char *)&realValue, sizeof(float));
+
+    int length = (int)text.size();
+    return string((char *)&length, sizeof(int)) + text;
+}
+
+// the order of the keys the comparators had before they searched the pages in place (ints without the overflow of
+// k - v): reals within 0.00001 of each other are equal, varchars compare as strings
+int compareReferenceKeys(const string &a, const string &b, AttrType type)
+{
+    if (type == TypeInt) {
+        int x = *(int *)a.data();
+        int y = *(int *)b.data();
+        return (x > y) - (x < y);
+    }
+    if (type == TypeReal) {
+        float difference = *(float *)a.data() - *(float *)b.data();
+        return difference > 0.00001 ? 1 : (difference < -0.00001 ? -1 : 0);
+    }
+
+    int result = a.substr(sizeof(int)).compare(b.substr(sizeof(int)));
+    return (result > 0) - (result < 0);
+}
+
+// entries of an index scan, their keys appended to keys when it is given
+int countIndexEntries(FileHandle &fileHandle, const Attribute &attribute, const string *lowKey, const string *highKey,
+        bool lowKeyInclusive, bool highKeyInclusive, vector<string> *keys = NULL, vector<RID> *rids = NULL)
+{
+    IX_ScanIterator ixsi;
+    RC rc = IndexManager::instance()->scan(fileHandle, attribute, lowKey == NULL ? NULL : lowKey->data(),
+            highKey == NULL ? NULL : highKey->data(), lowKeyInclusive, highKeyInclusive, ixsi);
+    assert(rc == success);
+
+    char key[PAGE_SIZE];
+    RID rid;
+    int numOfEntries = 0;
+    while (ixsi.getNextEntry(rid, key) == success) {
+        numOfEntries++;
+        if (keys != NULL) {
+            int length = attribute.type == TypeVarChar ? sizeof(int) + *(int *)key : sizeof(int);
+            keys->push_back(string(key, length));
+        }
+        if (rids != NULL)
+            rids->push_back(rid);
+    }
+    ixsi.close();
+    return numOfEntries;
+}
+
+// keys inserted in a random order, then each probe is looked up and bounds three scans; the results must be those of
+// compareReferenceKeys over all the keys
+void checkIndexComparator(const Attribute &attribute, const vector<string> &keys, const vector<string> &probes)
+{
+    IndexManager *ix = IndexManager::instance();
+    string fileName = "ix_comparator_" + attribute.name + ".idx";
+    RC rc = ix->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = ix->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    vector<int> order(keys.size());
+    for (unsigned i = 0; i < order.size(); i++)
+        order[i] = i;
+    shuffle(order.begin(), order.end(), mt19937(41));
+    for (unsigned i = 0; i < order.size(); i++) {
+        RID rid;
+        rid.pageNum = order[i] / 100 + 1;
+        rid.slotNum = order[i] % 100;
+        rc = ix->insertEntry(fileHandle, attribute, keys[order[i]].data(), rid);
+        assert(rc == success);
+    }
+
+    // the scan returns every entry, in order
+    vector<string> scanned;
+    assert(countIndexEntries(fileHandle, attribute, NULL, NULL, true, true, &scanned) == (int)keys.size());
+    for (unsigned i = 1; i < scanned.size(); i++)
+        assert(compareReferenceKeys(scanned[i - 1], scanned[i], attribute.type) <= 0);
+
+    for (unsigned p = 0; p < probes.size(); p++) {
+        int numOfLess = 0, numOfEqual = 0, numOfGreater = 0;
+        for (unsigned i = 0; i < keys.size(); i++) {
+            int result = compareReferenceKeys(keys[i], probes[p], attribute.type);
+            numOfLess += result < 0;
+            numOfEqual += result == 0;
+            numOfGreater += result > 0;
+        }
+
+        RID rid;
+        EID entryId;
+        rc = ix->searchEntry(fileHandle, attribute, probes[p].data(), rid, entryId);
+        assert(numOfEqual > 0 ? rc == success : rc == 1);
+        assert(countIndexEntries(fileHandle, attribute, &probes[p], &probes[p], true, true) == numOfEqual);
+        assert(countIndexEntries(fileHandle, attribute, &probes[p], NULL, false, true) == numOfGreater);
+        assert(countIndexEntries(fileHandle, attribute, NULL, &probes[p], true, false) == numOfLess);
+    }
+
+    rc = ix->closeFile(fileHandle);
+    assert(rc == success);
+    rc = ix->destroyFile(fileName);
+    assert(rc == success);
+}
+
+void testIndexComparators()
+{
+    // Functions tested
+    // 1. Insert Entry, Search Entry, Scan -- int, real and varchar keys ordered as before the in-place comparators:
+    //    negative and extreme ints, reals equal within the tolerance, varchars with shared prefixes and high bytes **
+    cout << "****In Extra Test Case Index Comparators****" << endl;
+
+    mt19937 random(4141);
+    Attribute attribute;
+    attribute.length = 4;
+    vector<string> keys, probes;
+
+    int ints[] = { INT_MIN, INT_MIN + 1, -1000000, -5, -1, 0, 1, 5, 1000000, INT_MAX - 1, INT_MAX };
+    for (unsigned i = 0; i < sizeof(ints) / sizeof(int); i++) {
+        keys.push_back(makeIndexKey(TypeInt, ints[i]));
+        probes.push_back(keys.back());
+    }
+    for (int i = 0; i < 5000; i++)
+        keys.push_back(makeIndexKey(TypeInt, (int)random()));
+    probes.push_back(makeIndexKey(TypeInt, -2));
+    probes.push_back(makeIndexKey(TypeInt, INT_MIN + 2));
+    attribute.name = "Int";
+    attribute.type = TypeInt;
+    checkIndexComparator(attribute, keys, probes);
+
+    // 1.0 and 1.000001, -2.5 and -2.500001, and the three values around 0 are equal; 1.00002 is not
+    keys.clear();
+    probes.clear();
+    float reals[] = { -1e30f, -2.5f, -2.500001f, -1e-6f, 0.0f, 1e-6f, 1.0f, 1.000001f, 1.00002f, 1e30f };
+    for (unsigned i = 0; i < sizeof(reals) / sizeof(float); i++) {
+        keys.push_back(makeIndexKey(TypeReal, 0, reals[i]));
+        probes.push_back(keys.back());
+    }
+    // multiples of 0.001, so no two of them are within the tolerance
+    for (int i = 0; i < 5000; i++)
+        keys.push_back(makeIndexKey(TypeReal, 0, (float)((int)(random() % 2000000) - 1000000) / 1000));
+    probes.push_back(makeIndexKey(TypeReal, 0, 1.000009f));
+    probes.push_back(makeIndexKey(TypeReal, 0, 1.5005f));
+    attribute.name = "Real";
+    attribute.type = TypeReal;
+    checkIndexComparator(attribute, keys, probes);
+
+    keys.clear();
+    probes.clear();
+    const char *texts[] = { "", "a", "ab", "abc", "abd", "b", "B", "\x7f", "\x80", "\xff", "\xff\xff" };
+    for (unsigned i = 0; i < sizeof(texts) / sizeof(char *); i++) {
+        keys.push_back(makeIndexKey(TypeVarChar, 0, 0, texts[i]));
+        probes.push_back(keys.back());
+    }
+    // keys sharing a long prefix fill leaves which store it once
+    for (int i = 0; i < 3000; i++) {
+        char text[64];
+        sprintf(text, "common_prefix_of_the_keys_%06d", (int)(random() % 1000000));
+        keys.push_back(makeIndexKey(TypeVarChar, 0, 0, text));
+    }
+    for (int i = 0; i < 2000; i++) {
+        string text;
+        for (int length = random() % 12; length > 0; length--)
+            text += (char)(random() % 2 == 0 ? 'a' + random() % 3 : 0x7e + random() % 4);
+        keys.push_back(makeIndexKey(TypeVarChar, 0, 0, text));
+    }
+    probes.push_back(makeIndexKey(TypeVarChar, 0, 0, "abcc"));
+    probes.push_back(makeIndexKey(TypeVarChar, 0, 0, "common_prefix_of_the_keys_"));
+    probes.push_back(makeIndexKey(TypeVarChar, 0, 0, "common_prefix_of_the_keys_5"));
+    attribute.name = "VarChar";
+    attribute.type = TypeVarChar;
+    attribute.length = 50;
+    checkIndexComparator(attribute, keys, probes);
+
+    cout << "****Extra Test Case Index Comparators passed****" << endl << endl;
+}
+
+// levels of a B+ tree index from the root down to the leaves
+int getIndexHeight(FileHandle &fileHandle)
+{
+    char page[PAGE_SIZE];
+    RC rc = fileHandle.readPage(0, page);
+    assert(rc == success);
+    unsigned pageNum = ((FileHeader *)page)->rootPage;
+
+    int height = 1;
+    for (;; height++) {
+        rc = fileHandle.readPage(pageNum, page);
+        assert(rc == success);
+        if (*(PageType *)page == Leaf)
+            return height;
+        pageNum = ((IndexHeader *)page)->firstPtr;
+    }
+}
+
+// value v as an int, a real or a varchar key; the varchar repeats each of the six digits of v 30 times, so that two
+// keys next to each other share a long prefix and the keys copied up from the leaves are long
+string makeValueKey(AttrType type, int v)
+{
+    char digits[8];
+    sprintf(digits, "%06d", v);
+    string text;
+    for (int d = 0; d < 6; d++)
+        text.append(30, digits[d]);
+    return makeIndexKey(type, v, (float)v, text);
+}
+
+// index pages of a B+ tree index, the root included
+int countIndexPages(FileHandle &fileHandle)
+{
+    char page[PAGE_SIZE];
+    int numOfIndexPages = 0;
+    for (unsigned pageNum = 1; pageNum < fileHandle.getNumberOfPages(); pageNum++) {
+        RC rc = fileHandle.readPage(pageNum, page);
+        assert(rc == success);
+        numOfIndexPages += *(PageType *)page == Root || *(PageType *)page == Index;
+    }
+    return numOfIndexPages;
+}
+
+// key 2 * i of a dense index test; the odd keys between them are never inserted
+string makeDenseKey(AttrType type, int i)
+{
+    return makeValueKey(type, 2 * i);
+}
+
+// the smallest and the largest key inserted, every stride-th key, and the odd keys around them are looked up: found
+// exactly when isInserted says so, with the rid they were inserted with
+void checkDenseLookups(FileHandle &fileHandle, const Attribute &attribute, const vector<bool> &isInserted, int stride)
+{
+    IndexManager *ix = IndexManager::instance();
+    int numOfKeys = (int)isInserted.size();
+    int first = find(isInserted.begin(), isInserted.end(), true) - isInserted.begin();
+    int last = numOfKeys - 1 - (find(isInserted.rbegin(), isInserted.rend(), true) - isInserted.rbegin());
+
+    vector<int> checked;
+    if (first < numOfKeys) {
+        checked.push_back(first);
+        checked.push_back(last);
+    }
+    for (int i = 0; i < numOfKeys; i += stride)
+        checked.push_back(i);
+
+    RID rid;
+    EID entryId;
+    for (unsigned c = 0; c < checked.size(); c++) {
+        int i = checked[c];
+        RC rc = ix->searchEntry(fileHandle, attribute, makeDenseKey(attribute.type, i).data(), rid, entryId);
+        assert(rc == (isInserted[i] ? success : 1));
+        if (isInserted[i])
+            assert(rid.pageNum == (unsigned)i / 100 + 1 && rid.slotNum == (unsigned)i % 100);
+
+        for (int neighbour = 2 * i - 1; neighbour <= 2 * i + 1; neighbour += 2) {
+            rc = ix->searchEntry(fileHandle, attribute, makeValueKey(attribute.type, neighbour).data(), rid, entryId);
+            assert(rc == 1);
+        }
+    }
+}
+
+void testDenseIndexPages()
+{
+    // Functions tested
+    // 1. Search Entry -- on the fixed width index pages of int and real keys, as the pages fill up, split, merge and
+    //    take entries from their siblings; the first, the last and the keys in between are found, the keys between
+    //    them are not **
+    cout << "****In Extra Test Case Dense Index Pages****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    AttrType types[2] = { TypeInt, TypeReal };
+    int numOfKeys = 120000;
+    int checkEvery = 1000;
+
+    for (int t = 0; t < 2; t++) {
+        Attribute attribute;
+        attribute.name = types[t] == TypeInt ? "DenseInt" : "DenseReal";
+        attribute.type = types[t];
+        attribute.length = 4;
+        string fileName = "ix_" + attribute.name + ".idx";
+        RC rc = ix->createFile(fileName);
+        assert(rc == success);
+        FileHandle fileHandle;
+        rc = ix->openFile(fileName, fileHandle);
+        assert(rc == success);
+
+        vector<int> order(numOfKeys);
+        for (int i = 0; i < numOfKeys; i++)
+            order[i] = i;
+        shuffle(order.begin(), order.end(), mt19937(42 + t));
+
+        // the root splits too: three levels, index pages of every fill level on the way
+        vector<bool> isInserted(numOfKeys, false);
+        for (int n = 0; n < numOfKeys; n++) {
+            int i = order[n];
+            RID rid;
+            rid.pageNum = i / 100 + 1;
+            rid.slotNum = i % 100;
+            rc = ix->insertEntry(fileHandle, attribute, makeDenseKey(attribute.type, i).data(), rid);
+            assert(rc == success);
+            isInserted[i] = true;
+            if ((n + 1) % checkEvery == 0)
+                checkDenseLookups(fileHandle, attribute, isInserted, 101);
+        }
+        assert(getIndexHeight(fileHandle) == 3);
+
+        // 90% deleted in another order: the pages merge and redistribute down to a few
+        shuffle(order.begin(), order.end(), mt19937(142 + t));
+        for (int n = 0; n < numOfKeys * 9 / 10; n++) {
+            int i = order[n];
+            RID rid;
+            rid.pageNum = i / 100 + 1;
+            rid.slotNum = i % 100;
+            rc = ix->deleteEntry(fileHandle, attribute, makeDenseKey(attribute.type, i).data(), rid);
+            assert(rc == success);
+            isInserted[i] = false;
+            if ((n + 1) % checkEvery == 0)
+                checkDenseLookups(fileHandle, attribute, isInserted, 101);
+        }
+        checkDenseLookups(fileHandle, attribute, isInserted, 1);
+
+        rc = ix->closeFile(fileHandle);
+        assert(rc == success);
+        rc = ix->destroyFile(fileName);
+        assert(rc == success);
+    }
+
+    cout << "****Extra Test Case Dense Index Pages passed****" << endl << endl;
+}
+
+void testBulkLoadNearEqualReals()
+{
+    // Functions tested
+    // 1. Bulk Load, Scan -- real keys equal within the tolerance of the index but not to the sorter, the larger key
+    //    with the smaller rid: every entry is loaded with its payload, an entry given twice is loaded once **
+    cout << "****In Extra Test Case Bulk Load Near-Equal Reals****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    Attribute attribute;
+    attribute.name = "NearReal";
+    attribute.type = TypeReal;
+    attribute.length = 4;
+    string fileName = "ix_near_real.idx";
+    RC rc = ix->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = ix->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // key i / 1000 with rid i + 1 and key i / 1000 + 0.000002 with rid i, enough of them for many leaves; the
+    // payload of an entry is the page number of its rid
+    IX_ExternalSorter sorter(attribute, 4096);
+    int numOfKeys = 2000;
+    for (int i = 1; i <= numOfKeys; i++) {
+        float keys[2] = { i / 1000.0f, i / 1000.0f + 0.000002f };
+        for (int k = 0; k < 2; k++) {
+            RID rid;
+            rid.pageNum = 2 * i + 1 - k;
+            rid.slotNum = 0;
+            int payload = rid.pageNum;
+            rc = sorter.addEntry(&keys[k], rid, &payload, sizeof(int));
+            assert(rc == success);
+        }
+    }
+    float twice = 1.0f;
+    RID twiceRid;
+    twiceRid.pageNum = 2 * 1000 + 1;
+    twiceRid.slotNum = 0;
+    int twicePayload = twiceRid.pageNum;
+    rc = sorter.addEntry(&twice, twiceRid, &twicePayload, sizeof(int));
+    assert(rc == success);
+    rc = sorter.sort();
+    assert(rc == success);
+    rc = ix->bulkLoad(fileHandle, attribute, sorter);
+    assert(rc == success);
+
+    IX_ScanIterator ixsi;
+    rc = ix->scan(fileHandle, attribute, NULL, NULL, true, true, ixsi);
+    assert(rc == success);
+    RID rid;
+    float key;
+    char payload[PAGE_SIZE];
+    short payloadLength;
+    int numOfEntries = 0;
+    while (ixsi.getNextEntry(rid, &key, payload, payloadLength) == success) {
+        assert(payloadLength == sizeof(int) && *(int *)payload == (int)rid.pageNum);
+        int i = rid.pageNum / 2;
+        assert(fabs(key - i / 1000.0f) < 0.00001);
+        numOfEntries++;
+    }
+    ixsi.close();
+    assert(numOfEntries == 2 * numOfKeys);
+
+    // the two entries of a key are found by it, as after insertEntry
+    for (int i = 1; i <= numOfKeys; i += 97) {
+        string low = makeIndexKey(TypeReal, 0, i / 1000.0f);
+        vector<RID> rids;
+        assert(countIndexEntries(fileHandle, attribute, &low, &low, true, true, NULL, &rids) == 2);
+        assert((rids[0].pageNum == (unsigned)2 * i && rids[1].pageNum == (unsigned)2 * i + 1) ||
+               (rids[1].pageNum == (unsigned)2 * i && rids[0].pageNum == (unsigned)2 * i + 1));
+        EID entryId;
+        rc = ix->searchEntry(fileHandle, attribute, low.data(), rid, entryId);
+        assert(rc == success);
+    }
+
+    rc = ix->closeFile(fileHandle);
+    assert(rc == success);
+    rc = ix->destroyFile(fileName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Bulk Load Near-Equal Reals passed****" << endl << endl;
+}
+
+// the rid an entry of a concurrent index test is inserted with
+RID makeConcurrentRid(int key)
+{
+    RID rid;
+    rid.pageNum = key / 100 + 1;
+    rid.slotNum = key % 100;
+    return rid;
+}
+
+// writer "writer" of a shared index: inserts its keys 8 * i + writer in a random order, deleting every third key it
+// inserted; each insert is looked up right away and along with a random key acknowledged before, each delete too.
+// The keys left in the index are added to "inserted".
+void runIndexWriter(FileHandle *fileHandle, const Attribute *attribute, int writer, int numOfKeys, vector<int> *inserted)
+{
+    IndexManager *ix = IndexManager::instance();
+    mt19937 random(4600 + writer);
+    vector<int> order(numOfKeys);
+    for (int i = 0; i < numOfKeys; i++)
+        order[i] = 8 * i + writer;
+    shuffle(order.begin(), order.end(), random);
+
+    RID rid;
+    EID entryId;
+    for (int n = 0; n < numOfKeys; n++) {
+        int key = order[n];
+        RC rc = ix->insertEntry(*fileHandle, *attribute, &key, makeConcurrentRid(key));
+        assert(rc == success);
+        inserted->push_back(key);
+        rc = ix->searchEntry(*fileHandle, *attribute, &key, rid, entryId);
+        assert(rc == success && rid.pageNum == makeConcurrentRid(key).pageNum && rid.slotNum == makeConcurrentRid(key).slotNum);
+
+        int acknowledged = (*inserted)[random() % inserted->size()];
+        rc = ix->searchEntry(*fileHandle, *attribute, &acknowledged, rid, entryId);
+        assert(rc == success && rid.pageNum == makeConcurrentRid(acknowledged).pageNum);
+
+        if (n % 3 == 2) {
+            unsigned victim = random() % inserted->size();
+            key = (*inserted)[victim];
+            rc = ix->deleteEntry(*fileHandle, *attribute, &key, makeConcurrentRid(key));
+            assert(rc == success);
+            (*inserted)[victim] = inserted->back();
+            inserted->pop_back();
+            rc = ix->searchEntry(*fileHandle, *attribute, &key, rid, entryId);
+            assert(rc == 1);
+        }
+    }
+}
+
+// then deletes all but one in ten of the keys it left, the pages merge again
+void runIndexDeleter(FileHandle *fileHandle, const Attribute *attribute, vector<int> *inserted)
+{
+    IndexManager *ix = IndexManager::instance();
+    RID rid;
+    EID entryId;
+    unsigned numOfKept = inserted->size() / 10;
+    while (inserted->size() > numOfKept) {
+        int key = inserted->back();
+        RC rc = ix->deleteEntry(*fileHandle, *attribute, &key, makeConcurrentRid(key));
+        assert(rc == success);
+        inserted->pop_back();
+        rc = ix->searchEntry(*fileHandle, *attribute, &key, rid, entryId);
+        assert(rc == 1);
+    }
+}
+
+// reader of a shared index while the writers run: the keys 8 * i + 7, i < numOfStableKeys, are never deleted, each
+// lookup of one finds it, each scan between two of them returns them all, in order
+void runIndexReader(FileHandle *fileHandle, const Attribute *attribute, int reader, int numOfStableKeys,
+        const atomic<bool> *isDone)
+{
+    IndexManager *ix = IndexManager::instance();
+    mt19937 random(4700 + reader);
+    RID rid;
+    EID entryId;
+    for (int n = 0; !*isDone; n++) {
+        int key = 8 * (random() % numOfStableKeys) + 7;
+        RC rc = ix->searchEntry(*fileHandle, *attribute, &key, rid, entryId);
+        assert(rc == success && rid.pageNum == makeConcurrentRid(key).pageNum && rid.slotNum == makeConcurrentRid(key).slotNum);
+
+        if (n % 50 == 0) {
+            int low = 8 * (random() % (numOfStableKeys - 500)) + 7;
+            int high = low + 8 * 499;
+            IX_ScanIterator ixsi;
+            rc = ix->scan(*fileHandle, *attribute, &low, &high, true, true, ixsi);
+            assert(rc == success);
+            int scanned, lastKey = low - 1, numOfStable = 0;
+            while (ixsi.getNextEntry(rid, &scanned) == success) {
+                assert(scanned > lastKey && scanned >= low && scanned <= high);
+                assert(rid.pageNum == makeConcurrentRid(scanned).pageNum && rid.slotNum == makeConcurrentRid(scanned).slotNum);
+                numOfStable += scanned % 8 == 7;
+                lastKey = scanned;
+            }
+            ixsi.close();
+            assert(numOfStable == 500);
+        }
+    }
+}
+
+void testConcurrentIndex()
+{
+    // Functions tested
+    // 1. Insert Entry, Delete Entry, Search Entry, Scan -- four writers and two readers sharing one open index while
+    //    its pages split up to three levels and merge again; every acknowledged entry is found during and after **
+    cout << "****In Extra Test Case Concurrent Index****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    Attribute attribute;
+    attribute.name = "ConcurrentInt";
+    attribute.type = TypeInt;
+    attribute.length = 4;
+    string fileName = "ix_concurrent.idx";
+    RC rc = ix->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = ix->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    int numOfStableKeys = 20000;
+    for (int i = 0; i < numOfStableKeys; i++) {
+        int key = 8 * i + 7;
+        rc = ix->insertEntry(fileHandle, attribute, &key, makeConcurrentRid(key));
+        assert(rc == success);
+    }
+
+    int numOfWriters = 4, numOfReaders = 2, numOfKeys = 30000;
+    vector<vector<int> > inserted(numOfWriters);
+    for (int w = 0; w < numOfWriters; w++)
+        inserted[w].reserve(numOfKeys);
+    for (int phase = 0; phase < 2; phase++) {
+        atomic<bool> isDone(false);
+        vector<thread> readers, writers;
+        for (int r = 0; r < numOfReaders; r++)
+            readers.push_back(thread(runIndexReader, &fileHandle, &attribute, r, numOfStableKeys, &isDone));
+        for (int w = 0; w < numOfWriters; w++) {
+            if (phase == 0)
+                writers.push_back(thread(runIndexWriter, &fileHandle, &attribute, w, numOfKeys, &inserted[w]));
+            else
+                writers.push_back(thread(runIndexDeleter, &fileHandle, &attribute, &inserted[w]));
+        }
+        for (unsigned w = 0; w < writers.size(); w++)
+            writers[w].join();
+        isDone = true;
+        for (unsigned r = 0; r < readers.size(); r++)
+            readers[r].join();
+        if (phase == 0)
+            assert(getIndexHeight(fileHandle) == 3);
+
+        // every entry acknowledged and not deleted is found, the scan returns exactly them
+        vector<int> expected;
+        for (int i = 0; i < numOfStableKeys; i++)
+            expected.push_back(8 * i + 7);
+        for (int w = 0; w < numOfWriters; w++)
+            expected.insert(expected.end(), inserted[w].begin(), inserted[w].end());
+        sort(expected.begin(), expected.end());
+        RID rid;
+        EID entryId;
+        for (unsigned i = 0; i < expected.size(); i++) {
+            rc = ix->searchEntry(fileHandle, attribute, &expected[i], rid, entryId);
+            assert(rc == success);
+        }
+        vector<string> keys;
+        vector<RID> rids;
+        assert(countIndexEntries(fileHandle, attribute, NULL, NULL, true, true, &keys, &rids) == (int)expected.size());
+        for (unsigned i = 0; i < keys.size(); i++) {
+            assert(*(int *)keys[i].data() == expected[i]);
+            assert(rids[i].pageNum == makeConcurrentRid(expected[i]).pageNum && rids[i].slotNum == makeConcurrentRid(expected[i]).slotNum);
+        }
+    }
+
+    rc = ix->closeFile(fileHandle);
+    assert(rc == success);
+    rc = ix->destroyFile(fileName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Concurrent Index passed****" << endl << endl;
+}
+
+// key k of a scan test, an int or a varchar in the same order
+string makeScanKey(AttrType type, int k)
+{
+    char text[32];
+    sprintf(text, "scan_key_%06d", k);
+    return makeIndexKey(type, k, 0, text);
+}
+
+void testScanDeletes()
+{
+    // Functions tested
+    // 1. Scan, Delete Entry -- a range scan over a few hundred leaves, their reads issued ahead, deleting each entry
+    //    it returns, entries some leaves further on and entries before its range: the leaves merge behind and ahead
+    //    of it, it returns every entry not deleted before it got there, exactly once and in order **
+    cout << "****In Extra Test Case Scan Deletes****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    AttrType types[2] = { TypeInt, TypeVarChar };
+    int numOfKeys = 100000, low = 2000, high = 98000;
+
+    for (int t = 0; t < 2; t++) {
+        Attribute attribute;
+        attribute.name = types[t] == TypeInt ? "ScanInt" : "ScanVarChar";
+        attribute.type = types[t];
+        attribute.length = types[t] == TypeInt ? 4 : 20;
+        string fileName = "ix_" + attribute.name + ".idx";
+        RC rc = ix->createFile(fileName);
+        assert(rc == success);
+        FileHandle fileHandle;
+        rc = ix->openFile(fileName, fileHandle);
+        assert(rc == success);
+
+        // every 50th key has three rids, the others one
+        vector<pair<int, unsigned> > entries;
+        for (int k = 0; k < numOfKeys; k++)
+            for (unsigned r = 0; r < (k % 50 == 0 ? 3u : 1u); r++)
+                entries.push_back(make_pair(k, r));
+        vector<int> order(entries.size());
+        for (unsigned i = 0; i < order.size(); i++)
+            order[i] = i;
+        shuffle(order.begin(), order.end(), mt19937(47 + t));
+        for (unsigned i = 0; i < order.size(); i++) {
+            RID rid;
+            rid.pageNum = entries[order[i]].first + 1;
+            rid.slotNum = entries[order[i]].second;
+            rc = ix->insertEntry(fileHandle, attribute, makeScanKey(attribute.type, entries[order[i]].first).data(), rid);
+            assert(rc == success);
+        }
+
+        // the entries the scan returns: those of [low, high) in order, less the ones deleted ahead of it; a leaf holds
+        // fewer than 1000 entries, the ones deleted are never on the leaf the scan walks a copy of
+        set<pair<int, unsigned> > deletedAhead;
+        vector<pair<int, unsigned> > expected;
+        for (unsigned i = 0; i < entries.size(); i++) {
+            if (entries[i].first < low || entries[i].first >= high || deletedAhead.count(entries[i]) > 0)
+                continue;
+            expected.push_back(entries[i]);
+            int k = entries[i].first;
+            if (k % 10 == 0 && entries[i].second == 0) {
+                if (k + 1007 < high)
+                    deletedAhead.insert(make_pair(k + 1007, 0u));
+                if (k + 1305 < high)
+                    deletedAhead.insert(make_pair(k + 1305, 0u));
+            }
+        }
+
+        string lowKey = makeScanKey(attribute.type, low), highKey = makeScanKey(attribute.type, high);
+        IX_ScanIterator ixsi;
+        rc = ix->scan(fileHandle, attribute, lowKey.data(), highKey.data(), true, false, ixsi);
+        assert(rc == success);
+        RID rid;
+        char key[PAGE_SIZE];
+        unsigned numOfReturned = 0;
+        int numOfDeletedBefore = 0;
+        while (ixsi.getNextEntry(rid, key) == success) {
+            assert(numOfReturned < expected.size());
+            int k = expected[numOfReturned].first;
+            string expectedKey = makeScanKey(attribute.type, k);
+            assert(memcmp(key, expectedKey.data(), expectedKey.size()) == 0);
+            assert(rid.pageNum == (unsigned)k + 1 && rid.slotNum == expected[numOfReturned].second);
+            numOfReturned++;
+
+            rc = ix->deleteEntry(fileHandle, attribute, expectedKey.data(), rid);
+            assert(rc == success);
+            if (k % 10 == 0 && rid.slotNum == 0) {
+                for (int ahead = k + 1007; ahead <= k + 1305 && ahead < high; ahead += 298) {
+                    RID aheadRid;
+                    aheadRid.pageNum = ahead + 1;
+                    aheadRid.slotNum = 0;
+                    rc = ix->deleteEntry(fileHandle, attribute, makeScanKey(attribute.type, ahead).data(), aheadRid);
+                    assert(rc == success);
+                }
+            }
+            // the entries before the range go too, the first leaves merge while the scan is far from them
+            if (numOfDeletedBefore < low && numOfReturned % 2 == 0) {
+                int before = low - 1 - numOfDeletedBefore++;
+                RID beforeRid;
+                beforeRid.pageNum = before + 1;
+                for (beforeRid.slotNum = 0; beforeRid.slotNum < (before % 50 == 0 ? 3u : 1u); beforeRid.slotNum++) {
+                    rc = ix->deleteEntry(fileHandle, attribute, makeScanKey(attribute.type, before).data(), beforeRid);
+                    assert(rc == success);
+                }
+            }
+        }
+        ixsi.close();
+        assert(numOfReturned == expected.size());
+
+        // only the entries after the range are left
+        vector<RID> rids;
+        int numOfAfter = 0;
+        for (int k = high; k < numOfKeys; k++)
+            numOfAfter += k % 50 == 0 ? 3 : 1;
+        assert(countIndexEntries(fileHandle, attribute, NULL, NULL, true, true, NULL, &rids) == numOfAfter);
+        assert(rids[0].pageNum == (unsigned)high + 1);
+
+        rc = ix->closeFile(fileHandle);
+        assert(rc == success);
+        rc = ix->destroyFile(fileName);
+        assert(rc == success);
+    }
+
+    cout << "****Extra Test Case Scan Deletes passed****" << endl << endl;
+}
+
+// insert (or delete) the keys of order from n on, through the two handles in turn, each handle checking the lookups
+// of the other one's changes every checkEvery keys; the payload makes the leaves hold few entries
+void changePinnedIndex(FileHandle *fileHandles[2], const Attribute &attribute, const vector<int> &order, bool isInsert,
+        vector<bool> &isInserted, int checkEvery)
+{
+    IndexManager *ix = IndexManager::instance();
+    char payload[200];
+    memset(payload, 'p', sizeof(payload));
+    for (unsigned n = 0; n < order.size(); n++) {
+        int i = order[n];
+        RID rid;
+        rid.pageNum = i / 100 + 1;
+        rid.slotNum = i % 100;
+        RC rc;
+        if (isInsert)
+            rc = ix->insertEntry(*fileHandles[n % 2], attribute, makeDenseKey(attribute.type, i).data(), rid, payload,
+                    sizeof(payload));
+        else
+            rc = ix->deleteEntry(*fileHandles[n % 2], attribute, makeDenseKey(attribute.type, i).data(), rid);
+        assert(rc == success);
+        isInserted[i] = isInsert;
+        if ((n + 1) % checkEvery == 0)
+            checkDenseLookups(*fileHandles[(n + 1) % 2], attribute, isInserted, 53);
+    }
+}
+
+void testPinnedIndexLevels()
+{
+    // Functions tested
+    // 1. Insert Entry, Delete Entry, Search Entry -- long varchar keys and payloads make a tree of PINNED_LEVELS
+    //    levels with more index pages than an open index pins, which splits and merges at every level while two
+    //    handles of the file change it and look keys up in turn; the file closed and opened again finds the same
+    //    keys **
+    cout << "****In Extra Test Case Pinned Index Levels****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    Attribute attribute;
+    attribute.name = "PinnedVarChar";
+    attribute.type = TypeVarChar;
+    attribute.length = 180;
+    string fileName = "ix_pinned.idx";
+    RC rc = ix->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle, otherFileHandle;
+    FileHandle *fileHandles[2] = { &fileHandle, &otherFileHandle };
+    rc = ix->openFile(fileName, fileHandle);
+    assert(rc == success);
+    rc = ix->openFile(fileName, otherFileHandle);
+    assert(rc == success);
+
+    int numOfKeys = 150000;
+    vector<int> order(numOfKeys);
+    for (int i = 0; i < numOfKeys; i++)
+        order[i] = i;
+    shuffle(order.begin(), order.end(), mt19937(48));
+    vector<bool> isInserted(numOfKeys, false);
+    changePinnedIndex(fileHandles, attribute, order, true, isInserted, 10000);
+    int height = getIndexHeight(fileHandle);
+    assert(height == PINNED_LEVELS && countIndexPages(fileHandle) > PINNED_PAGES);
+    checkDenseLookups(otherFileHandle, attribute, isInserted, 1);
+
+    // 99% deleted in another order, the tree shrinks
+    shuffle(order.begin(), order.end(), mt19937(148));
+    vector<int> deleted(order.begin(), order.begin() + numOfKeys * 99 / 100);
+    changePinnedIndex(fileHandles, attribute, deleted, false, isInserted, 10000);
+    assert(getIndexHeight(otherFileHandle) < height);
+    checkDenseLookups(fileHandle, attribute, isInserted, 1);
+
+    // pinned again from the file
+    rc = ix->closeFile(fileHandle);
+    assert(rc == success);
+    rc = ix->closeFile(otherFileHandle);
+    assert(rc == success);
+    rc = ix->openFile(fileName, fileHandle);
+    assert(rc == success);
+    checkDenseLookups(fileHandle, attribute, isInserted, 1);
+
+    // the keys deleted go back, splitting the pages pinned after the file was opened again
+    rc = ix->openFile(fileName, otherFileHandle);
+    assert(rc == success);
+    changePinnedIndex(fileHandles, attribute, deleted, true, isInserted, 10000);
+    assert(getIndexHeight(fileHandle) == height);
+    rc = ix->closeFile(otherFileHandle);
+    assert(rc == success);
+    checkDenseLookups(fileHandle, attribute, isInserted, 1);
+
+    rc = ix->closeFile(fileHandle);
+    assert(rc == success);
+    rc = ix->destroyFile(fileName);
+    assert(rc == success);
+
+    cout << "****Extra Test Case Pinned Index Levels passed****" << endl << endl;
+}
+
+void testHashIndexKeys()
+{
+    // Functions tested
+    // 1. Insert Entry -- the same entry twice is refused with 3 by a hash index as by a B+ tree **
+    // 2. Search Entry, Scan, Delete Entry -- reals within 0.00001 of each other are the same key in both, on either side
+    //    of the ranges of reals a hash index hashes alike, -0.0 is 0.0 **
+    cout << "****In Extra Test Case Hash Index Keys****" << endl;
+
+    IndexManager *ix = IndexManager::instance();
+    IndexType indexTypes[2] = { BTreeIndex, HashIndex };
+    float deltas[4] = { -0.000009f, -0.000002f, 0.000002f, 0.000009f };
+    int numOfKeys = 20000;
+
+    for (int t = 0; t < 2; t++) {
+        Attribute attribute;
+        attribute.length = 4;
+        string fileName = "ix_keys.idx";
+        RC rc = ix->createFile(fileName, indexTypes[t]);
+        assert(rc == success);
+        FileHandle fileHandle;
+        rc = ix->openFile(fileName, fileHandle);
+        assert(rc == success);
+        RID rid, otherRid;
+        EID entryId;
+
+        attribute.type = TypeInt;
+        rid.pageNum = 1;
+        rid.slotNum = 1;
+        int intKey = 7;
+        rc = ix->insertEntry(fileHandle, attribute, &intKey, rid);
+        assert(rc == success);
+        rc = ix->insertEntry(fileHandle, attribute, &intKey, rid);
+        assert(rc == 3);
+
+        rc = ix->closeFile(fileHandle);
+        assert(rc == success);
+        rc = ix->destroyFile(fileName);
+        assert(rc == success);
+        rc = ix->createFile(fileName, indexTypes[t]);
+        assert(rc == success);
+        rc = ix->openFile(fileName, fileHandle);
+        assert(rc == success);
+
+        attribute.type = TypeVarChar;
+        attribute.length = 10;
+        string varCharKey = makeIndexKey(TypeVarChar, 0, 0, "abc");
+        rc = ix->insertEntry(fileHandle, attribute, varCharKey.data(), rid);
+        assert(rc == success);
+        rc = ix->insertEntry(fileHandle, attribute, varCharKey.data(), rid);
+        assert(rc == 3);
+
+        rc = ix->closeFile(fileHandle);
+        assert(rc == success);
+        rc = ix->destroyFile(fileName);
+        assert(rc == success);
+        rc = ix->createFile(fileName, indexTypes[t]);
+        assert(rc == success);
+        rc = ix->openFile(fileName, fileHandle);
+        assert(rc == success);
+
+        // key i is 0.5 + i / 1000, at the end of a range of REAL_HASH_CELL, with rid i; a key a little below or above
+        // it has rid numOfKeys + i
+        attribute.type = TypeReal;
+        attribute.length = 4;
+        vector<float> keys(numOfKeys);
+        for (int i = 0; i < numOfKeys; i++) {
+            keys[i] = 0.5f + i / 1000.0f;
+            float nearKey = keys[i] + deltas[i % 4];
+            rid.pageNum = i + 1;
+            rid.slotNum = 0;
+            otherRid.pageNum = numOfKeys + i + 1;
+            otherRid.slotNum = 0;
+            rc = ix->insertEntry(fileHandle, attribute, &keys[i], rid);
+            assert(rc == success);
+            rc = ix->insertEntry(fileHandle, attribute, &nearKey, otherRid);
+            assert(rc == success);
+
+            // the same rids under keys equal to theirs
+            rc = ix->insertEntry(fileHandle, attribute, &nearKey, rid);
+            assert(rc == 3);
+            rc = ix->insertEntry(fileHandle, attribute, &keys[i], otherRid);
+            assert(rc == 3);
+        }
+
+        for (int i = 0; i < numOfKeys; i++) {
+            float nearKey = keys[i] - deltas[i % 4];
+            float otherKey = keys[i] + 0.00005f;
+            rc = ix->searchEntry(fileHandle, attribute, &nearKey, rid, entryId);
+            assert(rc == success);
+            rc = ix->searchEntry(fileHandle, attribute, &otherKey, rid, entryId);
+            assert(rc == 1);
+
+            string key = makeIndexKey(TypeReal, 0, keys[i]);
+            vector<RID> rids;
+            assert(countIndexEntries(fileHandle, attribute, &key, &key, true, true, NULL, &rids) == 2);
+            assert(rids[0].pageNum + rids[1].pageNum == 2 * (unsigned)i + numOfKeys + 2);
+        }
+
+        // deleted by a key equal to its own, once
+        for (int i = 0; i < numOfKeys; i += 7) {
+            float nearKey = keys[i] + deltas[(i + 1) % 4];
+            rid.pageNum = i + 1;
+            rid.slotNum = 0;
+            rc = ix->deleteEntry(fileHandle, attribute, &nearKey, rid);
+            assert(rc == success);
+            rc = ix->deleteEntry(fileHandle, attribute, &nearKey, rid);
+            assert(rc != success);
+
+            string key = makeIndexKey(TypeReal, 0, keys[i]);
+            vector<RID> rids;
+            assert(countIndexEntries(fileHandle, attribute, &key, &key, true, true, NULL, &rids) == 1);
+            assert(rids[0].pageNum == (unsigned)numOfKeys + i + 1);
+        }
+
+        float negativeZero = -0.0f, zero = 0.0f, nearZero = 0.000003f;
+        rid.pageNum = 3 * numOfKeys;
+        rc = ix->insertEntry(fileHandle, attribute, &negativeZero, rid);
+        assert(rc == success);
+        rc = ix->insertEntry(fileHandle, attribute, &zero, rid);
+        assert(rc == 3);
+        rc = ix->searchEntry(fileHandle, attribute, &zero, otherRid, entryId);
+        assert(rc == success && otherRid.pageNum == rid.pageNum);
+        rid.pageNum++;
+        rc = ix->insertEntry(fileHandle, attribute, &nearZero, rid);
+        assert(rc == success);
+        string key = makeIndexKey(TypeReal, 0, zero);
+        assert(countIndexEntries(fileHandle, attribute, &key, &key, true, true) == 2);
+
+        rc = ix->closeFile(fileHandle);
+        assert(rc == success);
+        rc = ix->destroyFile(fileName);
+        assert(rc == success);
+    }
+
+    cout << "****Extra Test Case Hash Index Keys passed****" << endl << endl;
+}
+
 void rmTest()
 {
   // RM *rm = RM::instance();
 
   // write your own testing cases here
+  testFillFactor();
+  testReadTuples();
+  testAnalyzeTable();
+  testAttributesCache();
+  testTableHandle();
+  testBulkLoad();
+  testCreateIndexes();
+  testConcurrentTables();
+  testCoveringIndex();
+  testSchemaVersioning();
+  testTruncate();
+  testBulkLoadFile();
+  testExportTable();
+  testPartitioning();
+  testIndexDelete();
+  testIndexPrefix();
+  testHashIndex();
+  testCompositeIndex();
+  testIndexFormat();
+  testIndexComparators();
+  testDenseIndexPages();
+  testBulkLoadNearEqualReals();
+  testConcurrentIndex();
+  testScanDeletes();
+  testPinnedIndexLevels();
+  testHashIndexKeys();
 }
 
-int main() 
+int main()
 {
   cout << "test..." << endl;
 